@@ -22,6 +22,8 @@ const EXTENSION_DISABLE_VERSION_CHECK_KEY = 'disable-extension-version-validatio
 
 const UPDATE_CHECK_TIMEOUT = 24 * 60 * 60; // 1 day in seconds
 
+Gio._promisify(St.Theme.prototype, 'load_stylesheet_async');
+
 function stateToString(state) {
     return Object.keys(ExtensionState).find(k => ExtensionState[k] === state);
 }
@@ -39,10 +41,11 @@ export class ExtensionManager extends Signals.EventEmitter {
         this._unloadedExtensions = new Map();
         this._enabledExtensions = [];
         this._extensionOrder = [];
+        this._stylesheetLoads = new Map();
         this._checkVersion = false;
 
         St.Settings.get().connect('notify::color-scheme',
-            () => this._reloadExtensionStylesheets());
+            () => this._reloadExtensionStylesheets().catch(logError));
 
         Main.sessionMode.connect('updated', () => {
             this._sessionUpdated().catch(logError);
@@ -100,7 +103,7 @@ export class ExtensionManager extends Signals.EventEmitter {
         return [...this._extensions.keys()];
     }
 
-    _reloadExtensionStylesheets() {
+    async _reloadExtensionStylesheets() {
         for (const ext of this._extensions.values()) {
             // No stylesheet, nothing to reload
             if (!ext.stylesheet)
@@ -112,8 +115,8 @@ export class ExtensionManager extends Signals.EventEmitter {
                 continue;
 
             try {
-                this._unloadExtensionStylesheet(ext);
-                this._loadExtensionStylesheet(ext);
+                // eslint-disable-next-line no-await-in-loop
+                await this._loadExtensionStylesheet(ext);
             } catch (e) {
                 this._callExtensionDisableWithRebase(ext.uuid);
                 this.logExtensionError(ext.uuid, e);
@@ -122,8 +125,30 @@ export class ExtensionManager extends Signals.EventEmitter {
     }
 
     _loadExtensionStylesheet(extension) {
-        if (extension.state !== ExtensionState.ACTIVE &&
-            extension.state !== ExtensionState.ACTIVATING)
+        // Loads for the same extension run one after the other, so that
+        // the one for the most recent style variant is applied last
+        const {uuid} = extension;
+        const previous = this._stylesheetLoads.get(uuid) ?? Promise.resolve();
+        const load = previous.catch(() => {}).then(
+            () => this._doLoadExtensionStylesheet(extension));
+        const cleanup = () => {
+            if (this._stylesheetLoads.get(uuid) === load)
+                this._stylesheetLoads.delete(uuid);
+        };
+
+        this._stylesheetLoads.set(uuid, load);
+        load.then(cleanup, cleanup);
+
+        return load;
+    }
+
+    _isStylesheetWanted(extension) {
+        return extension.state === ExtensionState.ACTIVE ||
+            extension.state === ExtensionState.ACTIVATING;
+    }
+
+    async _doLoadExtensionStylesheet(extension) {
+        if (!this._isStylesheetWanted(extension))
             return;
 
         const variant = Main.getStyleVariant();
@@ -135,16 +160,33 @@ export class ExtensionManager extends Signals.EventEmitter {
         ];
         const theme = St.ThemeContext.get_for_stage(global.stage).get_theme();
         for (const name of stylesheetNames) {
+            const stylesheetFile = extension.dir.get_child(name);
+
+            // Already loaded, e.g. when there is no variant for the new
+            // color scheme
+            if (extension.stylesheet?.equal(stylesheetFile))
+                return;
+
             try {
-                const stylesheetFile = extension.dir.get_child(name);
-                theme.load_stylesheet(stylesheetFile);
-                extension.stylesheet = stylesheetFile;
-                break;
+                // eslint-disable-next-line no-await-in-loop
+                await theme.load_stylesheet_async(stylesheetFile, null);
             } catch (e) {
                 if (e.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.NOT_FOUND))
                     continue; // not an error
                 throw e;
             }
+
+            // The extension may have been disabled while loading
+            if (!this._isStylesheetWanted(extension)) {
+                theme.unload_stylesheet(stylesheetFile);
+                return;
+            }
+
+            // Only replace the previous stylesheet now, so that the
+            // extension is never left unstyled in between
+            this._unloadExtensionStylesheet(extension);
+            extension.stylesheet = stylesheetFile;
+            return;
         }
     }
 
@@ -256,7 +298,7 @@ export class ExtensionManager extends Signals.EventEmitter {
         this._changeExtensionState(extension, ExtensionState.ACTIVATING);
 
         try {
-            this._loadExtensionStylesheet(extension);
+            await this._loadExtensionStylesheet(extension);
         } catch (e) {
             this.logExtensionError(uuid, e);
             return;
@@ -1272,6 +1272,25 @@ class DebugControlExportedDebugFlag extends DebugFlag {
     }
 });
 
+const ShaderBackgroundsDebugFlag = GObject.registerClass(
+class ShaderBackgroundsDebugFlag extends DebugFlag {
+    _init() {
+        super._init('shader-backgrounds');
+    }
+
+    _isEnabled() {
+        return St.Settings.get().shader_backgrounds;
+    }
+
+    _enable() {
+        St.Settings.get().shader_backgrounds = true;
+    }
+
+    _disable() {
+        St.Settings.get().shader_backgrounds = false;
+    }
+});
+
 const SlowDownFactorDebugFlag = GObject.registerClass(
 class SlowDownFactorDebugFlag extends St.Button {
     constructor() {
@@ -1355,6 +1374,8 @@ class DebugFlags extends St.BoxLayout {
         this.add_child(new UnsafeModeDebugFlag());
         // DebugControl::exported
         this.add_child(new DebugControlExportedDebugFlag());
+        // StSettings::shader-backgrounds
+        this.add_child(new ShaderBackgroundsDebugFlag());
         // StSettings::slow-down-factor
         this.add_child(new SlowDownFactorDebugFlag());
     }
@@ -317,9 +317,107 @@ malloc_statistics_callback (ShellPerfLog *perf_log,
 #endif /* defined (HAVE_MALLINFO) || defined (HAVE_MALLINFO2) */
 }
 
+static const struct {
+  StThemeNodeGroup group;
+  const char *name;
+  const char *description;
+} theme_node_statistics[] = {
+  { ST_THEME_NODE_GROUP_GEOMETRY, "themeNode.geometryComputed",
+    "Number of times theme node border widths, padding, margins and sizes were resolved" },
+  { ST_THEME_NODE_GROUP_BORDERS, "themeNode.bordersComputed",
+    "Number of times theme node border colors, radii and outlines were resolved" },
+  { ST_THEME_NODE_GROUP_BACKGROUND, "themeNode.backgroundComputed",
+    "Number of times theme node backgrounds were resolved" },
+  { ST_THEME_NODE_GROUP_FOREGROUND, "themeNode.foregroundComputed",
+    "Number of times theme node foreground colors were resolved" },
+  { ST_THEME_NODE_GROUP_FONT, "themeNode.fontComputed",
+    "Number of times theme node fonts were resolved" },
+  { ST_THEME_NODE_GROUP_BORDER_IMAGE, "themeNode.borderImageComputed",
+    "Number of times theme node border images were resolved" },
+  { ST_THEME_NODE_GROUP_SHADOWS, "themeNode.shadowsComputed",
+    "Number of times theme node box, background image or text shadows were resolved" },
+  { ST_THEME_NODE_GROUP_ICON_COLORS, "themeNode.iconColorsComputed",
+    "Number of times theme node icon colors were resolved" },
+};
+
+static void
+theme_node_statistics_callback (ShellPerfLog *perf_log,
+                                gpointer      data)
+{
+  guint n_corners, n_pixels, n_used_pixels;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (theme_node_statistics); i++)
+    {
+      guint count =
+        st_theme_node_get_group_computations (theme_node_statistics[i].group);
+
+      shell_perf_log_update_statistic_i (perf_log,
+                                         theme_node_statistics[i].name,
+                                         count);
+    }
+
+  st_theme_node_get_corner_atlas_usage (&n_corners, &n_pixels, &n_used_pixels);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "themeNode.cornerAtlasCorners",
+                                     n_corners);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "themeNode.cornerAtlasSize",
+                                     n_pixels);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "themeNode.cornerAtlasUsed",
+                                     n_used_pixels);
+}
+
+static void
+texture_cache_statistics_callback (ShellPerfLog *perf_log,
+                                   gpointer      data)
+{
+  StTextureCache *cache = st_texture_cache_get_default ();
+  StIconTheme *icon_theme = st_texture_cache_get_icon_theme (cache);
+  guint n_pending, n_cancelled;
+  gint64 average_latency, max_latency;
+  guint hits, misses, evictions;
+  gsize used_size;
+
+  st_texture_cache_get_load_statistics (cache,
+                                        &n_pending, NULL, &n_cancelled,
+                                        &average_latency, &max_latency);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "textureCache.loadsPending",
+                                     n_pending);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "textureCache.loadsCancelled",
+                                     n_cancelled);
+  shell_perf_log_update_statistic_x (perf_log,
+                                     "textureCache.averageLoadLatency",
+                                     average_latency);
+  shell_perf_log_update_statistic_x (perf_log,
+                                     "textureCache.maxLoadLatency",
+                                     max_latency);
+
+  st_icon_theme_get_cache_statistics (icon_theme,
+                                      &hits, &misses, &evictions,
+                                      &used_size);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "iconTheme.cacheHits",
+                                     hits);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "iconTheme.cacheMisses",
+                                     misses);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "iconTheme.cacheEvictions",
+                                     evictions);
+  shell_perf_log_update_statistic_x (perf_log,
+                                     "iconTheme.cacheUsedSize",
+                                     used_size);
+}
+
 static void
 shell_perf_log_init (void)
 {
+  guint i;
+
   ShellPerfLog *perf_log = shell_perf_log_get_default ();
 
   /* For probably historical reasons, mallinfo() defines the returned values,
@@ -342,6 +440,66 @@ shell_perf_log_init (void)
   shell_perf_log_add_statistics_callback (perf_log,
                                           malloc_statistics_callback,
                                           NULL, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (theme_node_statistics); i++)
+    shell_perf_log_define_statistic (perf_log,
+                                     theme_node_statistics[i].name,
+                                     theme_node_statistics[i].description,
+                                     "i");
+
+  shell_perf_log_define_statistic (perf_log,
+                                   "themeNode.cornerAtlasCorners",
+                                   "Number of distinct rounded corners in the corner atlas",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "themeNode.cornerAtlasSize",
+                                   "Size of the corner atlas textures, in pixels",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "themeNode.cornerAtlasUsed",
+                                   "Number of corner atlas pixels taken by corners",
+                                   "i");
+
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          theme_node_statistics_callback,
+                                          NULL, NULL);
+
+  shell_perf_log_define_statistic (perf_log,
+                                   "textureCache.loadsPending",
+                                   "Number of images waiting to be loaded",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "textureCache.loadsCancelled",
+                                   "Number of image loads dropped because their actors were destroyed",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "textureCache.averageLoadLatency",
+                                   "Average time from requesting an image to loading it, in microseconds",
+                                   "x");
+  shell_perf_log_define_statistic (perf_log,
+                                   "textureCache.maxLoadLatency",
+                                   "Longest time from requesting an image to loading it, in microseconds",
+                                   "x");
+  shell_perf_log_define_statistic (perf_log,
+                                   "iconTheme.cacheHits",
+                                   "Number of icon lookups that found a cached icon",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "iconTheme.cacheMisses",
+                                   "Number of icon lookups that did not find a cached icon",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "iconTheme.cacheEvictions",
+                                   "Number of unused icons dropped to stay within the icon cache size",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "iconTheme.cacheUsedSize",
+                                   "Size of the unused icons kept in the icon cache, in bytes",
+                                   "x");
+
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          texture_cache_statistics_callback,
+                                          NULL, NULL);
 }
 
 static void
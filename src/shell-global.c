@@ -91,6 +91,7 @@ struct _ShellGlobal {
 
   guint before_paint_id;
   guint after_swap_id;
+  guint restyle_count;
 
   GDBusProxy *switcheroo_control;
   GCancellable *switcheroo_cancellable;
@@ -930,10 +931,18 @@ global_stage_after_swap (gpointer data)
   /* Everything is done, we're ready for a new frame */
 
   ShellGlobal *global = SHELL_GLOBAL (data);
+  guint restyle_count = st_widget_get_restyle_count ();
 
   if (global->frame_timestamps)
-    shell_perf_log_event (shell_perf_log_get_default (),
-                          "clutter.stagePaintDone");
+    {
+      shell_perf_log_event_i (shell_perf_log_get_default (),
+                              "st.widgetsRestyled",
+                              restyle_count - global->restyle_count);
+      shell_perf_log_event (shell_perf_log_get_default (),
+                            "clutter.stagePaintDone");
+    }
+
+  global->restyle_count = restyle_count;
 
   return TRUE;
 }
@@ -1027,6 +1036,10 @@ _shell_global_set_plugin (ShellGlobal *global,
                                "clutter.stagePaintDone",
                                "End of frame, possibly including swap time",
                                "");
+  shell_perf_log_define_event (shell_perf_log_get_default(),
+                               "st.widgetsRestyled",
+                               "Number of widgets restyled in the frame",
+                               "i");
 
 #ifdef HAVE_XWAYLAND
   x11_display = meta_display_get_x11_display (display);
@@ -0,0 +1,102 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * bench-blur.c: micro-benchmark for the shadow blur
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Usage: bench-blur [-n ITERATIONS]
+ *
+ * Blurs alpha masks of typical shadow sizes ITERATIONS times and
+ * reports the time per blur and the resulting throughput.
+ */
+
+#include "st-blur.h"
+
+static int opt_iterations = 100;
+
+static GOptionEntry opt_entries[] =
+  {
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &opt_iterations, "Blur each mask N times", "N" },
+    { NULL }
+  };
+
+static void
+bench_blur (int    width,
+            int    height,
+            double blur)
+{
+  int rowstride = (width + 3) & ~3;
+  g_autofree guchar *pixels_in = g_malloc0 (rowstride * height);
+  gint64 start, elapsed;
+  double per_blur;
+  int x, y, i;
+
+  /* Something resembling a line of text */
+  for (y = height / 4; y < height * 3 / 4; y++)
+    for (x = 0; x < width; x++)
+      if ((x / 3) % 4 != 0)
+        pixels_in[y * rowstride + x] = 0xff;
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < opt_iterations; i++)
+    {
+      int width_out, height_out;
+      size_t rowstride_out;
+
+      g_free (_st_blur_pixels (pixels_in, width, height, rowstride, blur,
+                               &width_out, &height_out, &rowstride_out));
+    }
+
+  elapsed = g_get_monotonic_time () - start;
+  per_blur = (double) elapsed / opt_iterations;
+
+  g_print ("%dx%d, blur %g: %.3f ms/blur, %.2f Mpixels/s\n",
+           width, height, blur, per_blur / 1000.,
+           width * height / per_blur);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GOptionContext) context = NULL;
+  g_autoptr (GError) error = NULL;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, opt_entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (opt_iterations < 1)
+    {
+      g_autofree char *help = g_option_context_get_help (context, TRUE, NULL);
+
+      g_printerr ("%s", help);
+      return 1;
+    }
+
+  /* Label text shadows, then large inset and drawing area shadows */
+  bench_blur (200, 24, 2.0);
+  bench_blur (200, 24, 6.0);
+  bench_blur (800, 64, 10.0);
+  bench_blur (400, 400, 20.0);
+  bench_blur (400, 400, 40.0);
+
+  return 0;
+}
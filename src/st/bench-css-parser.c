@@ -0,0 +1,112 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * bench-css-parser.c: micro-benchmark for the CSS parser
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Usage: bench-css-parser [-n ITERATIONS] STYLESHEET...
+ *
+ * Parses each stylesheet ITERATIONS times and reports the time per
+ * parse and the resulting throughput.
+ */
+
+#include <glib.h>
+
+#include "croco/libcroco.h"
+
+static int opt_iterations = 50;
+
+static GOptionEntry opt_entries[] =
+  {
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &opt_iterations, "Parse each stylesheet N times", "N" },
+    { NULL }
+  };
+
+static gboolean
+bench_stylesheet (const char *filename)
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *contents = NULL;
+  gsize length;
+  gint64 start, elapsed;
+  double per_parse;
+  int i;
+
+  if (!g_file_get_contents (filename, &contents, &length, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return FALSE;
+    }
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < opt_iterations; i++)
+    {
+      CRStyleSheet *stylesheet = NULL;
+      enum CRStatus status;
+
+      status = cr_om_parser_simply_parse_buf ((const guchar *) contents,
+                                              length,
+                                              &stylesheet);
+      if (status != CR_OK)
+        {
+          g_printerr ("Error parsing stylesheet '%s'; errcode:%d\n",
+                      filename, status);
+          return FALSE;
+        }
+
+      cr_stylesheet_unref (stylesheet);
+    }
+
+  elapsed = g_get_monotonic_time () - start;
+  per_parse = (double) elapsed / opt_iterations;
+
+  g_print ("%s: %" G_GSIZE_FORMAT " bytes, %.3f ms/parse, %.2f MB/s\n",
+           filename, length, per_parse / 1000.,
+           length / per_parse);
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GOptionContext) context = NULL;
+  g_autoptr (GError) error = NULL;
+  gboolean success = TRUE;
+  int i;
+
+  context = g_option_context_new ("STYLESHEET...");
+  g_option_context_add_main_entries (context, opt_entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (argc < 2 || opt_iterations < 1)
+    {
+      g_autofree char *help = g_option_context_get_help (context, TRUE, NULL);
+
+      g_printerr ("%s", help);
+      return 1;
+    }
+
+  for (i = 1; i < argc; i++)
+    success &= bench_stylesheet (argv[i]);
+
+  return success ? 0 : 1;
+}
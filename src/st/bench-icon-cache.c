@@ -0,0 +1,243 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * bench-icon-cache.c: micro-benchmark for loading icons from icon caches
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Usage: bench-icon-cache [-n ITERATIONS] [THEME_DIR...]
+ *
+ * Takes the PNG icons of each icon theme directory to the premultiplied
+ * pixels that are uploaded to textures, ITERATIONS times, once from the
+ * pixel data in its icon-theme.cache and once by decoding the files,
+ * and reports the time per icon for both. Only icons that have pixel
+ * data in the cache are counted, which needs the cache to be generated
+ * with gtk-update-icon-cache --include-image-data.
+ *
+ * Without THEME_DIR, the hicolor themes of the system data directories
+ * are used.
+ */
+
+#include <string.h>
+
+#include "st-icon-cache.h"
+#include "st-premultiply.h"
+
+typedef struct {
+  char *directory;
+  char *name;
+  char *path;
+} Icon;
+
+static int opt_iterations = 10;
+static char **opt_theme_dirs = NULL;
+
+static GOptionEntry opt_entries[] =
+  {
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &opt_iterations, "Load each icon N times", "N" },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_theme_dirs, NULL, "THEME_DIR..." },
+    { NULL }
+  };
+
+static void
+icon_free (Icon *icon)
+{
+  g_free (icon->directory);
+  g_free (icon->name);
+  g_free (icon->path);
+  g_free (icon);
+}
+
+static void
+premultiply (GdkPixbuf *pixbuf)
+{
+  int width = gdk_pixbuf_get_width (pixbuf);
+  int height = gdk_pixbuf_get_height (pixbuf);
+  g_autofree guchar *pixels = g_malloc (width * height * 4);
+
+  _st_premultiply_pixels (gdk_pixbuf_read_pixels (pixbuf),
+                          gdk_pixbuf_get_rowstride (pixbuf),
+                          gdk_pixbuf_get_n_channels (pixbuf),
+                          width, height,
+                          pixels, width * 4);
+}
+
+/* Finds the PNG icons of @theme_dir that have pixel data in @cache */
+static GPtrArray *
+find_icons (const char  *theme_dir,
+            StIconCache *cache)
+{
+  g_autofree char *index_path = g_build_filename (theme_dir, "index.theme", NULL);
+  g_autoptr (GKeyFile) index = g_key_file_new ();
+  g_auto (GStrv) directories = NULL;
+  GPtrArray *icons;
+  int i;
+
+  icons = g_ptr_array_new_with_free_func ((GDestroyNotify) icon_free);
+
+  if (!g_key_file_load_from_file (index, index_path, G_KEY_FILE_NONE, NULL))
+    return icons;
+
+  directories = g_key_file_get_string_list (index, "Icon Theme", "Directories",
+                                            NULL, NULL);
+
+  for (i = 0; directories != NULL && directories[i] != NULL; i++)
+    {
+      g_autofree char *dir_path = g_build_filename (theme_dir, directories[i], NULL);
+      g_autoptr (GDir) dir = g_dir_open (dir_path, 0, NULL);
+      int directory_index;
+      const char *filename;
+
+      directory_index = st_icon_cache_get_directory_index (cache, directories[i]);
+      if (dir == NULL || directory_index < 0)
+        continue;
+
+      while ((filename = g_dir_read_name (dir)) != NULL)
+        {
+          g_autoptr (GdkPixbuf) pixbuf = NULL;
+          g_autofree char *name = NULL;
+          Icon *icon;
+
+          if (!g_str_has_suffix (filename, ".png"))
+            continue;
+
+          name = g_strndup (filename, strlen (filename) - strlen (".png"));
+          pixbuf = st_icon_cache_get_icon (cache, name, directory_index);
+          if (pixbuf == NULL)
+            continue;
+
+          icon = g_new0 (Icon, 1);
+          icon->directory = g_strdup (directories[i]);
+          icon->name = g_steal_pointer (&name);
+          icon->path = g_build_filename (dir_path, filename, NULL);
+          g_ptr_array_add (icons, icon);
+        }
+    }
+
+  return icons;
+}
+
+static void
+bench_theme (const char *theme_dir)
+{
+  g_autoptr (GPtrArray) icons = NULL;
+  StIconCache *cache;
+  gint64 start, cached, uncached;
+  int i, j;
+
+  cache = st_icon_cache_new_for_path (theme_dir);
+  if (cache == NULL)
+    {
+      g_print ("%s: no up to date icon-theme.cache\n", theme_dir);
+      return;
+    }
+
+  icons = find_icons (theme_dir, cache);
+  if (icons->len == 0)
+    {
+      g_print ("%s: no pixel data in icon-theme.cache\n", theme_dir);
+      st_icon_cache_unref (cache);
+      return;
+    }
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < opt_iterations; i++)
+    {
+      for (j = 0; j < icons->len; j++)
+        {
+          Icon *icon = g_ptr_array_index (icons, j);
+          int directory_index;
+          g_autoptr (GdkPixbuf) pixbuf = NULL;
+
+          directory_index = st_icon_cache_get_directory_index (cache, icon->directory);
+          pixbuf = st_icon_cache_get_icon (cache, icon->name, directory_index);
+          premultiply (pixbuf);
+        }
+    }
+
+  cached = g_get_monotonic_time () - start;
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < opt_iterations; i++)
+    {
+      for (j = 0; j < icons->len; j++)
+        {
+          Icon *icon = g_ptr_array_index (icons, j);
+          g_autoptr (GdkPixbuf) pixbuf = NULL;
+
+          pixbuf = gdk_pixbuf_new_from_file (icon->path, NULL);
+          if (pixbuf != NULL)
+            premultiply (pixbuf);
+        }
+    }
+
+  uncached = g_get_monotonic_time () - start;
+
+  g_print ("%s: %u icons, cached: %.3f ms/icon, uncached: %.3f ms/icon\n",
+           theme_dir, icons->len,
+           (double) cached / (opt_iterations * icons->len) / 1000.,
+           (double) uncached / (opt_iterations * icons->len) / 1000.);
+
+  st_icon_cache_unref (cache);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GOptionContext) context = NULL;
+  g_autoptr (GError) error = NULL;
+  int i;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, opt_entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (opt_iterations < 1)
+    {
+      g_autofree char *help = g_option_context_get_help (context, TRUE, NULL);
+
+      g_printerr ("%s", help);
+      return 1;
+    }
+
+  if (opt_theme_dirs != NULL)
+    {
+      for (i = 0; opt_theme_dirs[i] != NULL; i++)
+        bench_theme (opt_theme_dirs[i]);
+    }
+  else
+    {
+      const char * const *data_dirs = g_get_system_data_dirs ();
+
+      for (i = 0; data_dirs[i] != NULL; i++)
+        {
+          g_autofree char *theme_dir = g_build_filename (data_dirs[i],
+                                                         "icons", "hicolor",
+                                                         NULL);
+
+          if (g_file_test (theme_dir, G_FILE_TEST_IS_DIR))
+            bench_theme (theme_dir);
+        }
+    }
+
+  g_strfreev (opt_theme_dirs);
+
+  return 0;
+}
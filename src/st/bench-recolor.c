@@ -0,0 +1,199 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * bench-recolor.c: micro-benchmark for the recoloring of symbolic icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Usage: bench-recolor [-n ITERATIONS] [FILE...]
+ *
+ * Recolors symbolic PNGs ITERATIONS times and reports the time per
+ * icon and the resulting throughput, for example for all of them with
+ *
+ *   bench-recolor $(find /usr/share/icons -name '*.symbolic.png')
+ *
+ * Without FILE, icons of the usual symbolic sizes are made up.
+ */
+
+#include <math.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "st-recolor.h"
+
+static int opt_iterations = 100;
+static char **opt_files = NULL;
+
+static GOptionEntry opt_entries[] =
+  {
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &opt_iterations, "Recolor each icon N times", "N" },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_files, NULL, "FILE..." },
+    { NULL }
+  };
+
+/* A foreground ring with antialiased edges and a dot in the success
+ * color, on a transparent background, like most symbolic icons
+ */
+static GdkPixbuf *
+create_icon (int size)
+{
+  GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
+  int rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  guchar *pixels = gdk_pixbuf_get_pixels (pixbuf);
+  double center = size / 2.;
+  int x, y;
+
+  for (y = 0; y < size; y++)
+    for (x = 0; x < size; x++)
+      {
+        guchar *p = pixels + y * rowstride + 4 * x;
+        double dx = x + .5 - center, dy = y + .5 - center;
+        double d = sqrt (dx * dx + dy * dy) / size;
+        double coverage = CLAMP (1. - ABS (d - .35) * size / 2., 0., 1.);
+
+        p[0] = d < .15 ? 255 : 0;
+        p[1] = 0;
+        p[2] = 0;
+        p[3] = d < .15 ? 255 : (guchar) (coverage * 255);
+      }
+
+  return pixbuf;
+}
+
+static void
+bench_icons (const char *name,
+             GPtrArray  *icons)
+{
+  const guint8 fg[3] = { 0x2e, 0x34, 0x36 };
+  const guint8 success[3] = { 0x33, 0xd1, 0x7a };
+  const guint8 warning[3] = { 0xf5, 0x79, 0x00 };
+  const guint8 error[3] = { 0xcc, 0x00, 0x00 };
+  g_autoptr (GPtrArray) colored = NULL;
+  gint64 start, elapsed;
+  double per_icon;
+  gint64 n_pixels = 0;
+  guint i, j;
+
+  colored = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (j = 0; j < icons->len; j++)
+    {
+      GdkPixbuf *icon = g_ptr_array_index (icons, j);
+
+      g_ptr_array_add (colored,
+                       gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                                       gdk_pixbuf_get_width (icon),
+                                       gdk_pixbuf_get_height (icon)));
+      n_pixels += gdk_pixbuf_get_width (icon) * gdk_pixbuf_get_height (icon);
+    }
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < opt_iterations; i++)
+    {
+      for (j = 0; j < icons->len; j++)
+        {
+          GdkPixbuf *icon = g_ptr_array_index (icons, j);
+          GdkPixbuf *dst = g_ptr_array_index (colored, j);
+
+          _st_recolor_symbolic_pixels (gdk_pixbuf_read_pixels (icon),
+                                       gdk_pixbuf_get_rowstride (icon),
+                                       gdk_pixbuf_get_pixels (dst),
+                                       gdk_pixbuf_get_rowstride (dst),
+                                       gdk_pixbuf_get_width (icon),
+                                       gdk_pixbuf_get_height (icon),
+                                       fg, success, warning, error, 255);
+        }
+    }
+
+  elapsed = g_get_monotonic_time () - start;
+  per_icon = (double) elapsed / (opt_iterations * icons->len);
+
+  g_print ("%s: %u icons, %.3f ms/icon, %.2f Mpixels/s\n",
+           name, icons->len, per_icon / 1000.,
+           (double) n_pixels * opt_iterations / elapsed);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GOptionContext) context = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GPtrArray) icons = NULL;
+  int i;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, opt_entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (opt_iterations < 1)
+    {
+      g_autofree char *help = g_option_context_get_help (context, TRUE, NULL);
+
+      g_printerr ("%s", help);
+      return 1;
+    }
+
+  icons = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (opt_files != NULL)
+    {
+      for (i = 0; opt_files[i] != NULL; i++)
+        {
+          g_autoptr (GError) load_error = NULL;
+          GdkPixbuf *pixbuf;
+
+          pixbuf = gdk_pixbuf_new_from_file (opt_files[i], &load_error);
+          if (pixbuf == NULL)
+            {
+              g_printerr ("%s\n", load_error->message);
+              continue;
+            }
+
+          /* Symbolic PNGs always have alpha */
+          if (gdk_pixbuf_get_n_channels (pixbuf) != 4)
+            {
+              g_object_unref (pixbuf);
+              continue;
+            }
+
+          g_ptr_array_add (icons, pixbuf);
+        }
+
+      if (icons->len > 0)
+        bench_icons ("files", icons);
+    }
+  else
+    {
+      const int sizes[] = { 16, 24, 32, 48, 64, 96, 128 };
+
+      /* Each size at scale 1 and 2 */
+      for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+        {
+          g_ptr_array_add (icons, create_icon (sizes[i]));
+          g_ptr_array_add (icons, create_icon (sizes[i] * 2));
+        }
+
+      bench_icons ("generated", icons);
+    }
+
+  g_strfreev (opt_files);
+
+  return 0;
+}
@@ -56,6 +56,72 @@ dump (CRDeclaration const * a_this, FILE * a_fp, glong a_indent)
         }
 }
 
+G_LOCK_DEFINE_STATIC (property_ids) ;
+static GHashTable *property_ids = NULL ;
+
+/**
+ * cr_declaration_intern_property_name:
+ *@a_name: a property name.
+ *
+ *Maps @a_name to a small integer id that is unique for the lifetime
+ *of the process. Ids are handed out sequentially starting at 1, so
+ *they can be used to index dense tables. This may be called from any
+ *thread.
+ *
+ *Returns the id of the property name.
+ */
+guint
+cr_declaration_intern_property_name (const gchar *a_name)
+{
+        guint id = 0 ;
+
+        g_return_val_if_fail (a_name, 0) ;
+
+        G_LOCK (property_ids) ;
+
+        if (!property_ids)
+                property_ids = g_hash_table_new_full (g_str_hash,
+                                                      g_str_equal,
+                                                      g_free, NULL) ;
+
+        id = GPOINTER_TO_UINT (g_hash_table_lookup (property_ids, a_name)) ;
+        if (!id) {
+                id = g_hash_table_size (property_ids) + 1 ;
+                g_hash_table_insert (property_ids, g_strdup (a_name),
+                                     GUINT_TO_POINTER (id)) ;
+        }
+
+        G_UNLOCK (property_ids) ;
+
+        return id ;
+}
+
+/**
+ * cr_declaration_lookup_property_id:
+ *@a_name: a property name.
+ *
+ *Returns the id of @a_name as returned by
+ *cr_declaration_intern_property_name(), or 0 if no declaration
+ *of that property has been created yet.
+ */
+guint
+cr_declaration_lookup_property_id (const gchar *a_name)
+{
+        guint id = 0 ;
+
+        g_return_val_if_fail (a_name, 0) ;
+
+        G_LOCK (property_ids) ;
+
+        if (property_ids)
+                id = GPOINTER_TO_UINT (g_hash_table_lookup (property_ids,
+                                                            a_name)) ;
+
+        G_UNLOCK (property_ids) ;
+
+        return id ;
+}
+
 /**
  * cr_declaration_new:
  * @a_statement: the statement this declaration belongs to. can be NULL.
@@ -93,6 +159,10 @@ cr_declaration_new (CRStatement * a_statement,
         }
         memset (result, 0, sizeof (CRDeclaration));
         result->property = a_property;
+        if (a_property->stryng && a_property->stryng->str)
+                result->property_id =
+                        cr_declaration_intern_property_name
+                        (a_property->stryng->str);
         result->value = a_value;
 
         if (a_value) {
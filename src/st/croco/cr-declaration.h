@@ -63,6 +63,10 @@ struct _CRDeclaration
 	/*does the declaration have the important keyword ?*/
 	gboolean important ;
 
+	/*the interned id of the property name, see
+	 *cr_declaration_intern_property_name()*/
+	guint property_id ;
+
 	glong ref_count ;
 
 	CRParsingLocation location ;
@@ -78,6 +82,10 @@ CRDeclaration * cr_declaration_new (CRStatement *a_statement,
 				    CRString *a_property, 
 				    CRTerm *a_value) ;
 
+guint cr_declaration_intern_property_name (const gchar *a_name) ;
+
+guint cr_declaration_lookup_property_id (const gchar *a_name) ;
+
 
 CRDeclaration * cr_declaration_parse_from_buf (CRStatement *a_statement,
 					       const guchar *a_str) ;
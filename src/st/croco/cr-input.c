@@ -107,6 +107,26 @@ cr_input_new_real (void)
         return result;
 }
 
+/**
+ *Updates the line and column numbers of the input
+ *after a_char has been read.
+ */
+static inline void
+cr_input_update_position (CRInput * a_this, guint32 a_char)
+{
+        if (PRIVATE (a_this)->end_of_line == TRUE) {
+                PRIVATE (a_this)->col = 1;
+                PRIVATE (a_this)->line++;
+                PRIVATE (a_this)->end_of_line = FALSE;
+        } else if (a_char != '\n') {
+                PRIVATE (a_this)->col++;
+        }
+
+        if (a_char == '\n') {
+                PRIVATE (a_this)->end_of_line = TRUE;
+        }
+}
+
 /****************
  *Public methods
  ***************/
@@ -293,6 +313,7 @@ enum CRStatus
 cr_input_read_char (CRInput * a_this, guint32 * a_char)
 {
         enum CRStatus status = CR_OK;
+        const guchar *cur = NULL;
         gulong consumed = 0,
                 nb_bytes_left = 0;
 
@@ -308,33 +329,77 @@ cr_input_read_char (CRInput * a_this, guint32 * a_char)
                 return CR_END_OF_INPUT_ERROR;
         }
 
-        status = cr_utils_read_char_from_utf8_buf
-                (PRIVATE (a_this)->in_buf
-                 +
-                 PRIVATE (a_this)->next_byte_index,
-                 nb_bytes_left, a_char, &consumed);
+        cur = PRIVATE (a_this)->in_buf + PRIVATE (a_this)->next_byte_index;
+
+        /*plain ASCII doesn't need decoding */
+        if (*cur > 0 && *cur < 0x80) {
+                *a_char = *cur;
+                consumed = 1;
+        } else {
+                status = cr_utils_read_char_from_utf8_buf
+                        (cur, nb_bytes_left, a_char, &consumed);
+        }
 
         if (status == CR_OK) {
                 /*update next byte index */
                 PRIVATE (a_this)->next_byte_index += consumed;
 
                 /*update line and column number */
-                if (PRIVATE (a_this)->end_of_line == TRUE) {
-                        PRIVATE (a_this)->col = 1;
-                        PRIVATE (a_this)->line++;
-                        PRIVATE (a_this)->end_of_line = FALSE;
-                } else if (*a_char != '\n') {
-                        PRIVATE (a_this)->col++;
-                }
-
-                if (*a_char == '\n') {
-                        PRIVATE (a_this)->end_of_line = TRUE;
-                }
+                cr_input_update_position (a_this, *a_char);
         }
 
         return status;
 }
 
+/**
+ * cr_input_read_ascii_run:
+ *@a_this: the current instance of #CRInput.
+ *@a_classes: a mask of #CRAsciiClass flags.
+ *@a_max_len: the maximum number of characters to read.
+ *@a_start: out parameter. The address of the first character read.
+ *@a_len: out parameter. The number of characters read.
+ *
+ *Reads in one go the longest run (up to @a_max_len) of ASCII
+ *characters belonging to one of @a_classes, updating the line and
+ *column numbers like as many cr_input_read_char() calls would.
+ *The run stops at the first non-ASCII byte; callers are expected
+ *to go on with cr_input_read_char() for those.
+ *
+ *Returns CR_OK upon successful completion, even if no character
+ *was read, an error code otherwise.
+ */
+enum CRStatus
+cr_input_read_ascii_run (CRInput * a_this, guint a_classes,
+                         gulong a_max_len,
+                         guchar ** a_start, gulong * a_len)
+{
+        const guchar *start = NULL,
+                *cur = NULL,
+                *end = NULL;
+        gulong nb_bytes_left = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_start && a_len, CR_BAD_PARAM_ERROR);
+
+        nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
+        start = PRIVATE (a_this)->in_buf + PRIVATE (a_this)->next_byte_index;
+        end = start + MIN (nb_bytes_left, a_max_len);
+
+        for (cur = start; cur < end; cur++) {
+                if (*cur >= 0x80
+                    || !(cr_utils_ascii_classes[*cur] & a_classes))
+                        break;
+
+                cr_input_update_position (a_this, *cur);
+        }
+
+        *a_start = (guchar *) start;
+        *a_len = cur - start;
+        PRIVATE (a_this)->next_byte_index += *a_len;
+
+        return CR_OK;
+}
+
 /**
  * cr_input_set_line_num:
  *@a_this: the "this pointer" of the current instance of #CRInput.
@@ -549,13 +614,24 @@ enum CRStatus
 cr_input_consume_white_spaces (CRInput * a_this, gulong * a_nb_chars)
 {
         enum CRStatus status = CR_OK;
+        guchar *run = NULL;
+        gulong run_len = 0;
         guint32 cur_char = 0,
                 nb_consumed = 0;
 
         g_return_val_if_fail (a_this && PRIVATE (a_this) && a_nb_chars,
                               CR_BAD_PARAM_ERROR);
 
-        for (nb_consumed = 0;
+        /*
+         *Consume the ASCII white spaces directly from the buffer,
+         *the loop below only has to deal with what is left.
+         */
+        status = cr_input_read_ascii_run (a_this, CR_ASCII_WHITE_SPACE,
+                                          *a_nb_chars, &run, &run_len);
+        if (status != CR_OK)
+                return status;
+
+        for (nb_consumed = run_len;
              ((*a_nb_chars > 0) && (nb_consumed < *a_nb_chars));
              nb_consumed++) {
                 status = cr_input_peek_char (a_this, &cur_char);
@@ -600,6 +676,7 @@ enum CRStatus
 cr_input_peek_char (CRInput const * a_this, guint32 * a_char)
 {
         enum CRStatus status = CR_OK;
+        const guchar *cur = NULL;
         gulong consumed = 0,
                 nb_bytes_left = 0;
 
@@ -617,10 +694,16 @@ cr_input_peek_char (CRInput const * a_this, guint32 * a_char)
                 return CR_END_OF_INPUT_ERROR;
         }
 
+        cur = PRIVATE (a_this)->in_buf + PRIVATE (a_this)->next_byte_index;
+
+        /*plain ASCII doesn't need decoding */
+        if (*cur > 0 && *cur < 0x80) {
+                *a_char = *cur;
+                return CR_OK;
+        }
+
         status = cr_utils_read_char_from_utf8_buf
-                (PRIVATE (a_this)->in_buf +
-                 PRIVATE (a_this)->next_byte_index,
-                 nb_bytes_left, a_char, &consumed);
+                (cur, nb_bytes_left, a_char, &consumed);
 
         return status;
 }
@@ -78,6 +78,11 @@ cr_input_read_byte (CRInput *a_this, guchar *a_byte) ;
 enum CRStatus
 cr_input_read_char (CRInput *a_this, guint32 *a_char) ;
 
+enum CRStatus
+cr_input_read_ascii_run (CRInput *a_this, guint a_classes,
+                         gulong a_max_len,
+                         guchar **a_start, gulong *a_len) ;
+
 enum CRStatus
 cr_input_consume_chars (CRInput *a_this, guint32 a_char, 
                         gulong *a_nb_char) ;
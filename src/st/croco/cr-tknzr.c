@@ -245,6 +245,36 @@ static enum CRStatus cr_tknzr_parse_num (CRTknzr * a_this,
  *PRIVATE methods
  **********************************/
 
+/**
+ *Reads the run of plain ASCII characters of the given
+ *classes directly from the input buffer and appends it
+ *to a_str. This is only a shortcut for the common case,
+ *callers still need to handle the characters that follow
+ *the run one by one.
+ *
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_classes a mask of #CRAsciiClass flags.
+ *@param a_str the string to append the run to.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+cr_tknzr_read_ascii_run (CRTknzr * a_this,
+                         guint a_classes,
+                         GString * a_str)
+{
+        guchar *run = NULL;
+        gulong run_len = 0;
+        enum CRStatus status = CR_OK;
+
+        status = cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                          a_classes, G_MAXULONG,
+                                          &run, &run_len);
+        if (status == CR_OK && run_len > 0)
+                g_string_append_len (a_str, (const gchar *) run, run_len);
+
+        return status;
+}
+
 /**
  *Parses a "w" as defined by the css spec at [4.1.1]:
  * w ::= [ \t\r\n\f]*
@@ -264,6 +294,8 @@ cr_tknzr_parse_w (CRTknzr * a_this,
                   CRParsingLocation *a_location)
 {
         guint32 cur_char = 0;
+        guchar *run = NULL;
+        gulong run_len = 0;
         CRInputPos init_pos;
         enum CRStatus status = CR_OK;
 
@@ -290,6 +322,13 @@ cr_tknzr_parse_w (CRTknzr * a_this,
         RECORD_CUR_BYTE_ADDR (a_this, a_start);
         *a_end = *a_start;
 
+        status = cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                          CR_ASCII_WHITE_SPACE, G_MAXULONG,
+                                          &run, &run_len);
+        CHECK_PARSING_STATUS (status, TRUE);
+        if (run_len > 0)
+                *a_end = run + run_len - 1;
+
         for (;;) {
                 gboolean is_eof = FALSE;
 
@@ -447,6 +486,9 @@ cr_tknzr_parse_comment (CRTknzr * a_this,
         READ_NEXT_CHAR (a_this, &cur_char);
         ENSURE_PARSING_COND (cur_char == '*');
         comment = cr_string_new ();
+        status = cr_tknzr_read_ascii_run (a_this, CR_ASCII_COMMENT,
+                                          comment->stryng);
+        CHECK_PARSING_STATUS (status, TRUE);
         for (;;) { /* [^*]* */
                 PEEK_NEXT_CHAR (a_this, &next_char);
                 if (next_char == '*')
@@ -469,6 +511,9 @@ cr_tknzr_parse_comment (CRTknzr * a_this,
                         break;
                 READ_NEXT_CHAR(a_this, &cur_char);
                 g_string_append_unichar (comment->stryng, cur_char);
+                status = cr_tknzr_read_ascii_run (a_this, CR_ASCII_COMMENT,
+                                                  comment->stryng);
+                CHECK_PARSING_STATUS (status, TRUE);
                 for (;;) { /* [^*]* */
                         PEEK_NEXT_CHAR (a_this, &next_char);
                         if (next_char == '*')
@@ -963,6 +1008,10 @@ cr_tknzr_parse_ident (CRTknzr * a_this, CRString ** a_str)
         }
         g_string_append_unichar (stringue->stryng, tmp_char);
         for (;;) {
+                status = cr_tknzr_read_ascii_run (a_this, CR_ASCII_NMCHAR,
+                                                  stringue->stryng);
+                if (status != CR_OK)
+                        goto end;
                 status = cr_tknzr_parse_nmchar (a_this, 
                                                 &tmp_char, 
                                                 NULL);
@@ -1041,6 +1090,11 @@ cr_tknzr_parse_name (CRTknzr * a_this,
                                  &loc) ;
                         is_first_nmchar = FALSE ;
                 } else {
+                        status = cr_tknzr_read_ascii_run
+                                (a_this, CR_ASCII_NMCHAR,
+                                 (*a_str)->stryng) ;
+                        if (status != CR_OK)
+                                break;
                         status = cr_tknzr_parse_nmchar 
                                 (a_this, &tmp_char, NULL) ;
                 }
@@ -191,6 +191,31 @@ cr_utils_read_char_from_utf8_buf (const guchar * a_in,
  *CSS basic types identification utilities
  *****************************************/
 
+#define C CR_ASCII_COMMENT
+#define S (CR_ASCII_WHITE_SPACE | CR_ASCII_COMMENT)
+#define N (CR_ASCII_NMCHAR | CR_ASCII_COMMENT)
+
+/**
+ *The #CRAsciiClass flags of each ASCII character,
+ *used by the tokenizer to scan runs of characters
+ *directly in the input buffer. NUL belongs to no class
+ *since cr_utils_read_char_from_utf8_buf() rejects it.
+ */
+const guchar cr_utils_ascii_classes[128] = {
+        0, C, C, C, C, C, C, C, C, S, S, C, S, S, C, C, /* 0x00 */
+        C, C, C, C, C, C, C, C, C, C, C, C, C, C, C, C, /* 0x10 */
+        S, C, C, C, C, C, C, C, C, C, 0, C, C, N, C, C, /* 0x20 */
+        N, N, N, N, N, N, N, N, N, N, C, C, C, C, C, C, /* 0x30 */
+        C, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, /* 0x40 */
+        N, N, N, N, N, N, N, N, N, N, N, C, C, C, C, N, /* 0x50 */
+        C, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, /* 0x60 */
+        N, N, N, N, N, N, N, N, N, N, N, C, C, C, C, C, /* 0x70 */
+} ;
+
+#undef C
+#undef S
+#undef N
+
 /**
  *Returns TRUE if a_char is a white space as
  *defined in the css spec in chap 4.1.1.
@@ -136,6 +136,21 @@ cr_utils_read_char_from_utf8_buf (const guchar * a_in, gulong a_in_len,
  *CSS basic types identification utilities
  *****************************************/
 
+/**
+ *Character classes of the ASCII characters,
+ *see cr_utils_ascii_classes.
+ */
+enum CRAsciiClass {
+        /*white-space ::= ' '| \t|\r|\n|\f */
+        CR_ASCII_WHITE_SPACE = 1 << 0,
+        /*the ASCII part of nmchar ::= [_a-zA-Z0-9-] */
+        CR_ASCII_NMCHAR = 1 << 1,
+        /*any character that can't end a comment, i.e. not '*' */
+        CR_ASCII_COMMENT = 1 << 2
+} ;
+
+extern const guchar cr_utils_ascii_classes[128] ;
+
 gboolean
 cr_utils_is_white_space (guint32 a_char) ;
 
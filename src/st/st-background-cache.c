@@ -0,0 +1,312 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-background-cache.c: Shared cache of prerendered backgrounds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Backgrounds that can't be painted with cogl primitives are rendered
+ * with cairo into a texture the size of the node, once per paint
+ * state. Rows of a list, buttons in a grid or the days of the calendar
+ * share both their style and their size though, so the textures are
+ * kept here and shared between all nodes that paint the same, as told
+ * by st_theme_node_paint_equal().
+ *
+ * Entries are keyed on the values that function compares, not on a
+ * node: the interned records are compared by identity, so entries hold
+ * a reference on them to keep them from being reused for other values.
+ * Like the shadow cache, the least recently used entries are dropped
+ * once the textures take more than MAX_CACHE_SIZE bytes; paint states
+ * using them keep their own reference.
+ */
+
+#include "st-background-cache.h"
+#include "st-texture-cache.h"
+#include "st-theme-node-private.h"
+
+#define MAX_CACHE_SIZE (32 * 1024 * 1024)
+
+typedef struct {
+  StThemeGeometry *geometry;
+  StThemeBorders *borders;
+  StThemeBackground *background;
+  StShadow *box_shadow;
+  StShadow *background_image_shadow;
+  StBorderImage *border_image;
+  int scale_factor;
+  float width;
+  float height;
+  float resource_scale;
+} StBackgroundCacheKey;
+
+typedef struct {
+  StBackgroundCacheKey key;
+  CoglPipeline *pipeline;
+  gsize size;
+  GList link;
+} StBackgroundCacheEntry;
+
+static GHashTable *cache = NULL;
+
+/* Most recently used first */
+static GQueue lru = G_QUEUE_INIT;
+static gsize cache_size = 0;
+
+static guint
+key_hash (gconstpointer data)
+{
+  const StBackgroundCacheKey *key = data;
+  guint hash;
+
+  hash = g_direct_hash (key->background);
+  hash = hash * 33 + g_direct_hash (key->borders);
+  hash = hash * 33 + g_direct_hash (key->geometry);
+  hash = hash * 33 + (guint) key->width;
+  hash = hash * 33 + (guint) key->height;
+  hash = hash * 33 + (guint) (key->resource_scale * 100);
+
+  return hash;
+}
+
+static gboolean
+shadow_equal (StShadow *shadow,
+              StShadow *other)
+{
+  if (shadow == other)
+    return TRUE;
+
+  return shadow != NULL && other != NULL && st_shadow_equal (shadow, other);
+}
+
+static gboolean
+border_image_equal (StBorderImage *image,
+                    StBorderImage *other)
+{
+  if (image == other)
+    return TRUE;
+
+  return image != NULL && other != NULL && st_border_image_equal (image, other);
+}
+
+static gboolean
+key_equal (gconstpointer a,
+           gconstpointer b)
+{
+  const StBackgroundCacheKey *key_a = a;
+  const StBackgroundCacheKey *key_b = b;
+
+  return key_a->geometry == key_b->geometry &&
+         key_a->borders == key_b->borders &&
+         key_a->background == key_b->background &&
+         key_a->width == key_b->width &&
+         key_a->height == key_b->height &&
+         key_a->resource_scale == key_b->resource_scale &&
+         key_a->scale_factor == key_b->scale_factor &&
+         shadow_equal (key_a->box_shadow, key_b->box_shadow) &&
+         shadow_equal (key_a->background_image_shadow,
+                       key_b->background_image_shadow) &&
+         border_image_equal (key_a->border_image, key_b->border_image);
+}
+
+static void
+entry_free (StBackgroundCacheEntry *entry)
+{
+  g_clear_pointer (&entry->key.geometry, _st_theme_geometry_unref);
+  g_clear_pointer (&entry->key.borders, _st_theme_borders_unref);
+  g_clear_pointer (&entry->key.background, _st_theme_background_unref);
+  g_clear_pointer (&entry->key.box_shadow, st_shadow_unref);
+  g_clear_pointer (&entry->key.background_image_shadow, st_shadow_unref);
+  g_clear_object (&entry->key.border_image);
+  g_clear_object (&entry->pipeline);
+
+  g_free (entry);
+}
+
+static void
+remove_entry (StBackgroundCacheEntry *entry)
+{
+  g_queue_unlink (&lru, &entry->link);
+  cache_size -= entry->size;
+
+  /* Frees the entry */
+  g_hash_table_remove (cache, &entry->key);
+}
+
+/* Borrows the values from @node */
+static void
+init_key (StBackgroundCacheKey *key,
+          StThemeNode          *node,
+          float                 width,
+          float                 height,
+          float                 resource_scale)
+{
+  _st_theme_node_ensure_background (node);
+  _st_theme_node_ensure_geometry (node);
+  _st_theme_node_ensure_borders (node);
+
+  key->geometry = node->geometry;
+  key->borders = node->borders;
+  key->background = node->background;
+  key->box_shadow = st_theme_node_get_box_shadow (node);
+  key->background_image_shadow = st_theme_node_get_background_image_shadow (node);
+  key->border_image = st_theme_node_get_border_image (node);
+  key->scale_factor = node->cached_scale_factor;
+  key->width = width;
+  key->height = height;
+  key->resource_scale = resource_scale;
+}
+
+/* Drops the backgrounds showing @file as their background image */
+static void
+on_texture_file_changed (StTextureCache *texture_cache,
+                         GFile          *file,
+                         gpointer        data)
+{
+  GList *l, *next;
+
+  for (l = lru.head; l != NULL; l = next)
+    {
+      StBackgroundCacheEntry *entry = l->data;
+      GFile *image = entry->key.background->image;
+
+      next = l->next;
+
+      if (image != NULL && g_file_equal (image, file))
+        remove_entry (entry);
+    }
+}
+
+/**
+ * _st_background_cache_lookup:
+ * @node: the node to paint
+ * @width: the width of the allocation
+ * @height: the height of the allocation
+ * @resource_scale: the resource scale
+ *
+ * Looks up the prerendered background of a node painting like @node,
+ * previously added with _st_background_cache_insert(). The pipeline is
+ * shared, callers must only change its color, like paint states do
+ * anyway.
+ *
+ * Returns: (transfer full) (nullable): the pipeline, or %NULL
+ */
+CoglPipeline *
+_st_background_cache_lookup (StThemeNode *node,
+                             float        width,
+                             float        height,
+                             float        resource_scale)
+{
+  StBackgroundCacheEntry *entry;
+  StBackgroundCacheKey key;
+
+  if (cache == NULL)
+    return NULL;
+
+  init_key (&key, node, width, height, resource_scale);
+
+  entry = g_hash_table_lookup (cache, &key);
+  if (entry == NULL)
+    return NULL;
+
+  g_queue_unlink (&lru, &entry->link);
+  g_queue_push_head_link (&lru, &entry->link);
+
+  return g_object_ref (entry->pipeline);
+}
+
+/**
+ * _st_background_cache_insert:
+ * @node: the node that was painted
+ * @width: the width of the allocation
+ * @height: the height of the allocation
+ * @resource_scale: the resource scale
+ * @pipeline: the pipeline of the prerendered background
+ *
+ * Adds @pipeline to the cache, so that it is returned by future lookups
+ * for nodes painting like @node at the same size.
+ */
+void
+_st_background_cache_insert (StThemeNode  *node,
+                             float         width,
+                             float         height,
+                             float         resource_scale,
+                             CoglPipeline *pipeline)
+{
+  StBackgroundCacheEntry *entry;
+  StBackgroundCacheKey key;
+  CoglTexture *texture;
+
+  g_return_if_fail (ST_IS_THEME_NODE (node));
+  g_return_if_fail (COGL_IS_PIPELINE (pipeline));
+
+  texture = cogl_pipeline_get_layer_texture (pipeline, 0);
+  if (texture == NULL)
+    return;
+
+  if (cache == NULL)
+    {
+      cache = g_hash_table_new_full (key_hash, key_equal,
+                                     NULL, (GDestroyNotify) entry_free);
+      g_signal_connect (st_texture_cache_get_default (), "texture-file-changed",
+                        G_CALLBACK (on_texture_file_changed), NULL);
+    }
+
+  init_key (&key, node, width, height, resource_scale);
+
+  entry = g_hash_table_lookup (cache, &key);
+  if (entry != NULL)
+    remove_entry (entry);
+
+  entry = g_new0 (StBackgroundCacheEntry, 1);
+  entry->key = key;
+  _st_theme_geometry_ref (entry->key.geometry);
+  _st_theme_borders_ref (entry->key.borders);
+  _st_theme_background_ref (entry->key.background);
+  if (entry->key.box_shadow)
+    st_shadow_ref (entry->key.box_shadow);
+  if (entry->key.background_image_shadow)
+    st_shadow_ref (entry->key.background_image_shadow);
+  if (entry->key.border_image)
+    g_object_ref (entry->key.border_image);
+  entry->link.data = entry;
+  entry->pipeline = g_object_ref (pipeline);
+  entry->size = (gsize) cogl_texture_get_width (texture) *
+                cogl_texture_get_height (texture) * 4;
+
+  g_hash_table_insert (cache, &entry->key, entry);
+  g_queue_push_head_link (&lru, &entry->link);
+  cache_size += entry->size;
+
+  /* Always keep the entry we just added */
+  while (cache_size > MAX_CACHE_SIZE && lru.tail != &entry->link)
+    remove_entry (lru.tail->data);
+}
+
+/**
+ * _st_background_cache_clear:
+ *
+ * Drops all backgrounds, for example because the theme changed and
+ * nodes painting like the old ones are unlikely to come back.
+ */
+void
+_st_background_cache_clear (void)
+{
+  if (cache == NULL)
+    return;
+
+  /* Frees the entries and with them the links */
+  g_queue_init (&lru);
+  g_hash_table_remove_all (cache);
+  cache_size = 0;
+}
@@ -0,0 +1,37 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-background-cache.h: Shared cache of prerendered backgrounds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "st-theme-node.h"
+
+G_BEGIN_DECLS
+
+CoglPipeline *_st_background_cache_lookup (StThemeNode  *node,
+                                           float         width,
+                                           float         height,
+                                           float         resource_scale);
+void          _st_background_cache_insert (StThemeNode  *node,
+                                           float         width,
+                                           float         height,
+                                           float         resource_scale,
+                                           CoglPipeline *pipeline);
+
+void          _st_background_cache_clear  (void);
+
+G_END_DECLS
@@ -0,0 +1,286 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-blur.c: Gaussian blur of alpha masks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "st-blur.h"
+
+/* The kernel weights are fixed point numbers with WEIGHT_SHIFT
+ * fractional bits that add up to exactly WEIGHT_ONE, so the weighted
+ * sum of 8 bit values always fits into 32 bits and flat areas keep
+ * their value.
+ */
+#define WEIGHT_SHIFT 15
+#define WEIGHT_ONE (1 << WEIGHT_SHIFT)
+
+static guint16 *
+calculate_gaussian_kernel (double sigma,
+                           int    n_values)
+{
+  guint16 *kernel;
+  double *values;
+  double sum, exp_divisor;
+  int half, total, i;
+
+  half = n_values / 2;
+
+  values = g_new (double, n_values);
+  sum = 0.0;
+
+  exp_divisor = 2 * sigma * sigma;
+
+  /* n_values of 1D Gauss function */
+  for (i = 0; i < n_values; i++)
+    {
+      values[i] = exp (-(i - half) * (i - half) / exp_divisor);
+      sum += values[i];
+    }
+
+  /* normalize */
+  kernel = g_new (guint16, n_values);
+  total = 0;
+
+  for (i = 0; i < n_values; i++)
+    {
+      kernel[i] = (guint16) round (values[i] / sum * WEIGHT_ONE);
+      total += kernel[i];
+    }
+
+  /* Put the rounding error on the center tap */
+  kernel[half] += WEIGHT_ONE - total;
+
+  g_free (values);
+
+  return kernel;
+}
+
+/* acc[x] += weight * src[x] for a row of @width pixels */
+static void
+accumulate_row (guint32      *acc,
+                const guchar *src,
+                guint16       weight,
+                int           width)
+{
+  int x = 0;
+
+#if defined (__SSE2__)
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i w = _mm_set1_epi16 ((short) weight);
+
+  for (; x + 16 <= width; x += 16)
+    {
+      __m128i *a = (__m128i *) (acc + x);
+      __m128i pixels, lo, hi, lo_l, lo_h, hi_l, hi_h;
+
+      pixels = _mm_loadu_si128 ((const __m128i *) (src + x));
+      lo = _mm_unpacklo_epi8 (pixels, zero);
+      hi = _mm_unpackhi_epi8 (pixels, zero);
+
+      /* 16 x 16 -> 32 bit products, as low and high halves */
+      lo_l = _mm_mullo_epi16 (lo, w);
+      lo_h = _mm_mulhi_epu16 (lo, w);
+      hi_l = _mm_mullo_epi16 (hi, w);
+      hi_h = _mm_mulhi_epu16 (hi, w);
+
+      _mm_storeu_si128 (a + 0, _mm_add_epi32 (_mm_loadu_si128 (a + 0),
+                                              _mm_unpacklo_epi16 (lo_l, lo_h)));
+      _mm_storeu_si128 (a + 1, _mm_add_epi32 (_mm_loadu_si128 (a + 1),
+                                              _mm_unpackhi_epi16 (lo_l, lo_h)));
+      _mm_storeu_si128 (a + 2, _mm_add_epi32 (_mm_loadu_si128 (a + 2),
+                                              _mm_unpacklo_epi16 (hi_l, hi_h)));
+      _mm_storeu_si128 (a + 3, _mm_add_epi32 (_mm_loadu_si128 (a + 3),
+                                              _mm_unpackhi_epi16 (hi_l, hi_h)));
+    }
+#elif defined (__ARM_NEON)
+  for (; x + 8 <= width; x += 8)
+    {
+      uint16x8_t pixels = vmovl_u8 (vld1_u8 (src + x));
+
+      vst1q_u32 (acc + x,
+                 vmlal_n_u16 (vld1q_u32 (acc + x),
+                              vget_low_u16 (pixels), weight));
+      vst1q_u32 (acc + x + 4,
+                 vmlal_n_u16 (vld1q_u32 (acc + x + 4),
+                              vget_high_u16 (pixels), weight));
+    }
+#endif
+
+  for (; x < width; x++)
+    acc[x] += (guint32) weight * src[x];
+}
+
+/* Rounds the sums in @acc back to 8 bit values */
+static void
+store_row (guchar        *dst,
+           const guint32 *acc,
+           int            width)
+{
+  int x = 0;
+
+#if defined (__SSE2__)
+  const __m128i round = _mm_set1_epi32 (WEIGHT_ONE / 2);
+
+  for (; x + 16 <= width; x += 16)
+    {
+      const __m128i *a = (const __m128i *) (acc + x);
+      __m128i v0, v1, v2, v3;
+
+      v0 = _mm_srli_epi32 (_mm_add_epi32 (_mm_loadu_si128 (a + 0), round), WEIGHT_SHIFT);
+      v1 = _mm_srli_epi32 (_mm_add_epi32 (_mm_loadu_si128 (a + 1), round), WEIGHT_SHIFT);
+      v2 = _mm_srli_epi32 (_mm_add_epi32 (_mm_loadu_si128 (a + 2), round), WEIGHT_SHIFT);
+      v3 = _mm_srli_epi32 (_mm_add_epi32 (_mm_loadu_si128 (a + 3), round), WEIGHT_SHIFT);
+
+      _mm_storeu_si128 ((__m128i *) (dst + x),
+                        _mm_packus_epi16 (_mm_packs_epi32 (v0, v1),
+                                          _mm_packs_epi32 (v2, v3)));
+    }
+#elif defined (__ARM_NEON)
+  for (; x + 8 <= width; x += 8)
+    {
+      uint16x4_t lo = vqrshrn_n_u32 (vld1q_u32 (acc + x), WEIGHT_SHIFT);
+      uint16x4_t hi = vqrshrn_n_u32 (vld1q_u32 (acc + x + 4), WEIGHT_SHIFT);
+
+      vst1_u8 (dst + x, vqmovn_u16 (vcombine_u16 (lo, hi)));
+    }
+#endif
+
+  for (; x < width; x++)
+    dst[x] = MIN ((acc[x] + WEIGHT_ONE / 2) >> WEIGHT_SHIFT, 255);
+}
+
+/**
+ * _st_blur_pixels:
+ * @pixels_in: the A8 pixels to blur
+ * @width_in: the width of @pixels_in
+ * @height_in: the height of @pixels_in
+ * @rowstride_in: the rowstride of @pixels_in
+ * @blur: the blur radius, as used in CSS shadows
+ * @width_out: (out): return location for the width of the result
+ * @height_out: (out): return location for the height of the result
+ * @rowstride_out: (out): return location for the rowstride of the result
+ *
+ * Applies a Gaussian blur to an alpha mask. The result is padded on
+ * all sides, so that it includes the parts of the blur extending
+ * beyond the input.
+ *
+ * Both passes work on whole rows, accumulating one kernel tap of a
+ * row at a time in fixed point, which keeps all memory accesses
+ * sequential and can be vectorized.
+ *
+ * Returns: (transfer full): the newly allocated blurred pixels
+ */
+guchar *
+_st_blur_pixels (const guchar *pixels_in,
+                 int           width_in,
+                 int           height_in,
+                 int           rowstride_in,
+                 double        blur,
+                 int          *width_out,
+                 int          *height_out,
+                 size_t       *rowstride_out)
+{
+  guchar *pixels_out;
+  guint16 *kernel;
+  guint32 *acc;
+  guchar *line;
+  double sigma;
+  int n_values, half;
+  int y_out, i;
+
+  if ((guint) blur == 0)
+    {
+      *width_out  = width_in;
+      *height_out = height_in;
+      *rowstride_out = rowstride_in;
+      return g_memdup2 (pixels_in, *rowstride_out * *height_out);
+    }
+
+  /* The CSS specification defines (or will define) the blur radius as twice
+   * the Gaussian standard deviation. See:
+   *
+   * http://lists.w3.org/Archives/Public/www-style/2010Sep/0002.html
+   */
+  sigma = blur / 2.;
+
+  n_values = (int) (5 * sigma);
+  half = n_values / 2;
+
+  *width_out  = width_in  + 2 * half;
+  *height_out = height_in + 2 * half;
+  *rowstride_out = (*width_out + 3) & ~3;
+
+  pixels_out = g_malloc0 (*rowstride_out * *height_out);
+  acc = g_new (guint32, *width_out);
+
+  /* Zero padded copy of an output row for the horizontal pass, so
+   * that the taps don't need to be clamped at the edges
+   */
+  line = g_malloc0 (*width_out + n_values);
+
+  kernel = calculate_gaussian_kernel (sigma, n_values);
+
+  /* vertical blur; output row y_out is centered on input row
+   * y_out - half and takes input row y_out + i - 2 * half with
+   * weight kernel[i]
+   */
+  for (y_out = 0; y_out < *height_out; y_out++)
+    {
+      int i0, i1;
+
+      /* clamp the full i range [0, n_values) to rows in [0, height_in) */
+      i0 = MAX (2 * half - y_out, 0);
+      i1 = MIN (height_in + 2 * half - y_out, n_values);
+
+      memset (acc, 0, width_in * sizeof (guint32));
+
+      for (i = i0; i < i1; i++)
+        accumulate_row (acc,
+                        pixels_in + (y_out + i - 2 * half) * rowstride_in,
+                        kernel[i],
+                        width_in);
+
+      store_row (pixels_out + y_out * *rowstride_out + half, acc, width_in);
+    }
+
+  /* horizontal blur */
+  for (y_out = 0; y_out < *height_out; y_out++)
+    {
+      guchar *row = pixels_out + y_out * *rowstride_out;
+
+      memcpy (line + half, row, *width_out);
+      memset (acc, 0, *width_out * sizeof (guint32));
+
+      for (i = 0; i < n_values; i++)
+        accumulate_row (acc, line + i, kernel[i], *width_out);
+
+      store_row (row, acc, *width_out);
+    }
+
+  g_free (kernel);
+  g_free (line);
+  g_free (acc);
+
+  return pixels_out;
+}
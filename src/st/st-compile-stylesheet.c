@@ -0,0 +1,77 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-compile-stylesheet.c: Build-time tool to precompile stylesheets
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Usage: st-compile-stylesheet INPUT OUTPUT
+ *
+ * Parses INPUT and writes its compiled form to OUTPUT. StTheme picks up
+ * the result when it is installed next to the stylesheet (or in the same
+ * resource bundle) with ST_COMPILED_STYLESHEET_SUFFIX appended to its name.
+ */
+
+#include "config.h"
+
+#include "st-compiled-stylesheet.h"
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GBytes) compiled = NULL;
+  g_autofree char *contents = NULL;
+  CRStyleSheet *stylesheet = NULL;
+  enum CRStatus status;
+  gsize length;
+
+  if (argc != 3)
+    {
+      g_printerr ("Usage: %s INPUT OUTPUT\n", argv[0]);
+      return 1;
+    }
+
+  if (!g_file_get_contents (argv[1], &contents, &length, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  status = cr_om_parser_simply_parse_buf ((const guchar *) contents,
+                                          length,
+                                          &stylesheet);
+  if (status != CR_OK)
+    {
+      g_printerr ("Error parsing stylesheet '%s'; errcode:%d\n",
+                  argv[1], status);
+      return 1;
+    }
+
+  compiled = _st_compiled_stylesheet_compile (stylesheet, contents, length,
+                                              &error);
+  cr_stylesheet_unref (stylesheet);
+
+  if (compiled == NULL ||
+      !g_file_set_contents (argv[2],
+                            g_bytes_get_data (compiled, NULL),
+                            g_bytes_get_size (compiled),
+                            &error))
+    {
+      g_printerr ("%s: %s\n", argv[1], error->message);
+      return 1;
+    }
+
+  return 0;
+}
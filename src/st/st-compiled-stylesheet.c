@@ -0,0 +1,1033 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-compiled-stylesheet.c: Precompiled binary stylesheets
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Tokenizing and parsing CSS with libcroco is by far the most expensive
+ * part of loading a stylesheet, so stylesheets can be shipped together
+ * with a compiled form that holds the already parsed statements. It is
+ * only used when it was compiled from the exact same source.
+ *
+ * All integers are stored little endian. The layout is:
+ *
+ *   char    magic[8]
+ *   guint32 version
+ *   guint32 source_length
+ *   guint8  source_digest[32]    SHA-256 of the source
+ *   guint8  data_digest[32]      SHA-256 of everything that follows
+ *   guint32 n_strings
+ *   guint32 n_statements
+ *
+ *   n_strings times:
+ *     guint32 length
+ *     char    str[length + 1]    NUL-terminated
+ *
+ *   n_statements times:
+ *     guint32 type               RULESET_STMT or AT_IMPORT_RULE_STMT
+ *     ruleset:
+ *       guint32 n_selectors, followed by the selectors
+ *       guint32 n_declarations, followed by the declarations
+ *     import:
+ *       string  url
+ *
+ * Strings (including property names, class names and identifiers) are
+ * stored once and referenced by their index, or NO_STRING. The other
+ * records are written by the write_*() functions below and read back by
+ * the matching read_*() functions. Only the statements StTheme cares
+ * about are kept; @media, @page, @font-face and @charset rules are
+ * dropped.
+ *
+ * The data digest makes sure that a truncated or otherwise damaged file
+ * is rejected as a whole rather than read back into wrong statements.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "st-compiled-stylesheet.h"
+
+#define MAGIC "StCSS\r\n\032"
+#define MAGIC_LENGTH 8
+#define VERSION 2
+
+#define DIGEST_LENGTH 32
+#define DATA_DIGEST_OFFSET (MAGIC_LENGTH + 4 + 4 + DIGEST_LENGTH)
+#define DATA_OFFSET (DATA_DIGEST_OFFSET + DIGEST_LENGTH)
+#define HEADER_LENGTH (DATA_OFFSET + 4 + 4)
+
+#define NO_STRING G_MAXUINT32
+
+typedef struct
+{
+  GByteArray *data;
+
+  /* string => index + 1 */
+  GHashTable *string_indices;
+  GPtrArray *strings;
+} Writer;
+
+typedef struct
+{
+  const guint8 *data;
+  gsize length;
+  gsize offset;
+
+  const char **strings;
+  guint n_strings;
+
+  gboolean failed;
+} Reader;
+
+static void
+compute_digest (const char *source,
+                gsize       source_length,
+                guint8      digest[DIGEST_LENGTH])
+{
+  g_autoptr (GChecksum) checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  gsize digest_length = DIGEST_LENGTH;
+
+  g_checksum_update (checksum, (const guchar *) source, source_length);
+  g_checksum_get_digest (checksum, digest, &digest_length);
+}
+
+static void
+write_uint32 (Writer  *writer,
+              guint32  value)
+{
+  guint32 le_value = GUINT32_TO_LE (value);
+
+  g_byte_array_append (writer->data, (const guint8 *) &le_value, sizeof (le_value));
+}
+
+static void
+write_double (Writer  *writer,
+              gdouble  value)
+{
+  guint64 bits;
+
+  memcpy (&bits, &value, sizeof (bits));
+  bits = GUINT64_TO_LE (bits);
+
+  g_byte_array_append (writer->data, (const guint8 *) &bits, sizeof (bits));
+}
+
+static void
+write_string (Writer     *writer,
+              const char *str)
+{
+  guint index;
+
+  if (str == NULL)
+    {
+      write_uint32 (writer, NO_STRING);
+      return;
+    }
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (writer->string_indices, str));
+  if (index == 0)
+    {
+      g_ptr_array_add (writer->strings, g_strdup (str));
+      index = writer->strings->len;
+      g_hash_table_insert (writer->string_indices,
+                           g_ptr_array_index (writer->strings, index - 1),
+                           GUINT_TO_POINTER (index));
+    }
+
+  write_uint32 (writer, index - 1);
+}
+
+static void
+write_cr_string (Writer   *writer,
+                 CRString *str)
+{
+  if (str == NULL || str->stryng == NULL)
+    write_string (writer, NULL);
+  else
+    write_string (writer, str->stryng->str);
+}
+
+static gboolean
+write_terms (Writer  *writer,
+             CRTerm  *terms,
+             GError **error)
+{
+  CRTerm *term;
+  guint n_terms = 0;
+
+  for (term = terms; term; term = term->next)
+    n_terms++;
+
+  write_uint32 (writer, n_terms);
+
+  for (term = terms; term; term = term->next)
+    {
+      write_uint32 (writer, term->type);
+      write_uint32 (writer, term->unary_op);
+      write_uint32 (writer, term->the_operator);
+
+      switch (term->type)
+        {
+        case TERM_NUMBER:
+          write_uint32 (writer, term->content.num->type);
+          write_double (writer, term->content.num->val);
+          break;
+
+        case TERM_FUNCTION:
+          write_cr_string (writer, term->content.str);
+          if (!write_terms (writer, term->ext_content.func_param, error))
+            return FALSE;
+          break;
+
+        case TERM_STRING:
+        case TERM_IDENT:
+        case TERM_URI:
+        case TERM_HASH:
+          write_cr_string (writer, term->content.str);
+          break;
+
+        case TERM_RGB:
+          write_uint32 (writer, term->content.rgb->red);
+          write_uint32 (writer, term->content.rgb->green);
+          write_uint32 (writer, term->content.rgb->blue);
+          write_uint32 (writer, term->content.rgb->is_percentage);
+          break;
+
+        case TERM_NO_TYPE:
+          break;
+
+        case TERM_UNICODERANGE:
+        default:
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                       "Unsupported term type %d", term->type);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+write_additional_selector (Writer          *writer,
+                           CRAdditionalSel *add_sel)
+{
+  CRAttrSel *attr_sel;
+  guint n_attr_sels = 0;
+
+  write_uint32 (writer, add_sel->type);
+
+  switch (add_sel->type)
+    {
+    case CLASS_ADD_SELECTOR:
+      write_cr_string (writer, add_sel->content.class_name);
+      break;
+
+    case ID_ADD_SELECTOR:
+      write_cr_string (writer, add_sel->content.id_name);
+      break;
+
+    case PSEUDO_CLASS_ADD_SELECTOR:
+      write_uint32 (writer, add_sel->content.pseudo ? add_sel->content.pseudo->type : 0);
+      write_cr_string (writer, add_sel->content.pseudo ? add_sel->content.pseudo->name : NULL);
+      write_cr_string (writer, add_sel->content.pseudo ? add_sel->content.pseudo->extra : NULL);
+      break;
+
+    case ATTRIBUTE_ADD_SELECTOR:
+      for (attr_sel = add_sel->content.attr_sel; attr_sel; attr_sel = attr_sel->next)
+        n_attr_sels++;
+
+      write_uint32 (writer, n_attr_sels);
+
+      for (attr_sel = add_sel->content.attr_sel; attr_sel; attr_sel = attr_sel->next)
+        {
+          write_cr_string (writer, attr_sel->name);
+          write_cr_string (writer, attr_sel->value);
+          write_uint32 (writer, attr_sel->match_way);
+        }
+      break;
+
+    case NO_ADD_SELECTOR:
+    default:
+      break;
+    }
+}
+
+static void
+write_selector (Writer     *writer,
+                CRSelector *selector)
+{
+  CRSimpleSel *simple_sel;
+  guint n_simple_sels = 0;
+
+  cr_simple_sel_compute_specificity (selector->simple_sel);
+
+  for (simple_sel = selector->simple_sel; simple_sel; simple_sel = simple_sel->next)
+    n_simple_sels++;
+
+  write_uint32 (writer, n_simple_sels);
+
+  for (simple_sel = selector->simple_sel; simple_sel; simple_sel = simple_sel->next)
+    {
+      CRAdditionalSel *add_sel;
+      guint n_add_sels = 0;
+
+      write_uint32 (writer, simple_sel->type_mask);
+      write_uint32 (writer, simple_sel->is_case_sentive);
+      write_cr_string (writer, simple_sel->name);
+      write_uint32 (writer, simple_sel->combinator);
+      write_uint32 (writer, simple_sel->specificity);
+
+      for (add_sel = simple_sel->add_sel; add_sel; add_sel = add_sel->next)
+        n_add_sels++;
+
+      write_uint32 (writer, n_add_sels);
+
+      for (add_sel = simple_sel->add_sel; add_sel; add_sel = add_sel->next)
+        write_additional_selector (writer, add_sel);
+    }
+}
+
+static gboolean
+write_ruleset (Writer      *writer,
+               CRStatement *stmt,
+               GError     **error)
+{
+  CRSelector *selector;
+  CRDeclaration *decl;
+  guint n_selectors = 0;
+  guint n_declarations = 0;
+
+  for (selector = stmt->kind.ruleset->sel_list; selector; selector = selector->next)
+    {
+      if (selector->simple_sel)
+        n_selectors++;
+    }
+
+  write_uint32 (writer, n_selectors);
+
+  for (selector = stmt->kind.ruleset->sel_list; selector; selector = selector->next)
+    {
+      if (selector->simple_sel)
+        write_selector (writer, selector);
+    }
+
+  for (decl = stmt->kind.ruleset->decl_list; decl; decl = decl->next)
+    n_declarations++;
+
+  write_uint32 (writer, n_declarations);
+
+  for (decl = stmt->kind.ruleset->decl_list; decl; decl = decl->next)
+    {
+      write_cr_string (writer, decl->property);
+      write_uint32 (writer, decl->important);
+
+      if (!write_terms (writer, decl->value, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * _st_compiled_stylesheet_compile:
+ * @stylesheet: a parsed stylesheet
+ * @source: the text @stylesheet was parsed from
+ * @source_length: the length of @source
+ * @error: a #GError
+ *
+ * Serializes @stylesheet so that it can be loaded again with
+ * _st_compiled_stylesheet_load() instead of parsing @source.
+ *
+ * Returns: (transfer full): the compiled stylesheet, or %NULL if
+ *   @stylesheet contains something that can't be represented
+ */
+GBytes *
+_st_compiled_stylesheet_compile (CRStyleSheet  *stylesheet,
+                                 const char    *source,
+                                 gsize          source_length,
+                                 GError       **error)
+{
+  g_autoptr (GByteArray) body = NULL;
+  g_autoptr (GHashTable) string_indices = NULL;
+  g_autoptr (GPtrArray) strings = NULL;
+  guint8 digest[DIGEST_LENGTH];
+  Writer writer;
+  CRStatement *stmt;
+  guint n_statements = 0;
+  guint i;
+
+  g_return_val_if_fail (stylesheet != NULL, NULL);
+  g_return_val_if_fail (source_length <= G_MAXUINT32, NULL);
+
+  body = g_byte_array_new ();
+  string_indices = g_hash_table_new (g_str_hash, g_str_equal);
+  strings = g_ptr_array_new_with_free_func (g_free);
+
+  writer.data = body;
+  writer.string_indices = string_indices;
+  writer.strings = strings;
+
+  for (stmt = stylesheet->statements; stmt; stmt = stmt->next)
+    {
+      switch (stmt->type)
+        {
+        case RULESET_STMT:
+          if (stmt->kind.ruleset == NULL || stmt->kind.ruleset->sel_list == NULL)
+            break;
+
+          write_uint32 (&writer, RULESET_STMT);
+          if (!write_ruleset (&writer, stmt, error))
+            return NULL;
+
+          n_statements++;
+          break;
+
+        case AT_IMPORT_RULE_STMT:
+          if (stmt->kind.import_rule == NULL || stmt->kind.import_rule->url == NULL)
+            break;
+
+          write_uint32 (&writer, AT_IMPORT_RULE_STMT);
+          write_cr_string (&writer, stmt->kind.import_rule->url);
+
+          n_statements++;
+          break;
+
+        case AT_MEDIA_RULE_STMT:
+        case AT_RULE_STMT:
+        case AT_PAGE_RULE_STMT:
+        case AT_CHARSET_RULE_STMT:
+        case AT_FONT_FACE_RULE_STMT:
+        default:
+          break;
+        }
+    }
+
+  /* Now that all strings are known, write the header and the string
+   * table in front of the statements */
+  writer.data = g_byte_array_sized_new (HEADER_LENGTH + body->len);
+
+  compute_digest (source, source_length, digest);
+
+  g_byte_array_append (writer.data, (const guint8 *) MAGIC, MAGIC_LENGTH);
+  write_uint32 (&writer, VERSION);
+  write_uint32 (&writer, source_length);
+  g_byte_array_append (writer.data, digest, DIGEST_LENGTH);
+  /* Filled in at the end */
+  g_byte_array_append (writer.data, digest, DIGEST_LENGTH);
+  write_uint32 (&writer, strings->len);
+  write_uint32 (&writer, n_statements);
+
+  for (i = 0; i < strings->len; i++)
+    {
+      const char *str = g_ptr_array_index (strings, i);
+      gsize length = strlen (str);
+
+      write_uint32 (&writer, length);
+      g_byte_array_append (writer.data, (const guint8 *) str, length + 1);
+    }
+
+  g_byte_array_append (writer.data, body->data, body->len);
+
+  compute_digest ((const char *) writer.data->data + DATA_OFFSET,
+                  writer.data->len - DATA_OFFSET,
+                  writer.data->data + DATA_DIGEST_OFFSET);
+
+  return g_byte_array_free_to_bytes (writer.data);
+}
+
+static gboolean
+reader_check_count (Reader  *reader,
+                    guint32  count)
+{
+  /* Every element takes at least 4 bytes, which bounds the number of
+   * elements a corrupt file can make us create */
+  if (count > (reader->length - reader->offset) / 4)
+    reader->failed = TRUE;
+
+  return !reader->failed;
+}
+
+static guint32
+read_uint32 (Reader *reader)
+{
+  guint32 value;
+
+  if (reader->failed || reader->length - reader->offset < sizeof (value))
+    {
+      reader->failed = TRUE;
+      return 0;
+    }
+
+  memcpy (&value, reader->data + reader->offset, sizeof (value));
+  reader->offset += sizeof (value);
+
+  return GUINT32_FROM_LE (value);
+}
+
+static gdouble
+read_double (Reader *reader)
+{
+  guint64 bits;
+  gdouble value;
+
+  if (reader->failed || reader->length - reader->offset < sizeof (bits))
+    {
+      reader->failed = TRUE;
+      return 0.;
+    }
+
+  memcpy (&bits, reader->data + reader->offset, sizeof (bits));
+  reader->offset += sizeof (bits);
+
+  bits = GUINT64_FROM_LE (bits);
+  memcpy (&value, &bits, sizeof (value));
+
+  return value;
+}
+
+static const char *
+read_string (Reader *reader)
+{
+  guint32 index = read_uint32 (reader);
+
+  if (reader->failed || index == NO_STRING)
+    return NULL;
+
+  if (index >= reader->n_strings)
+    {
+      reader->failed = TRUE;
+      return NULL;
+    }
+
+  return reader->strings[index];
+}
+
+static CRString *
+read_cr_string (Reader *reader)
+{
+  const char *str = read_string (reader);
+
+  return str ? cr_string_new_from_string (str) : NULL;
+}
+
+static CRTerm *
+read_terms (Reader *reader)
+{
+  CRTerm *terms = NULL;
+  CRTerm *last = NULL;
+  guint32 n_terms, i;
+
+  n_terms = read_uint32 (reader);
+  if (!reader_check_count (reader, n_terms))
+    return NULL;
+
+  for (i = 0; i < n_terms && !reader->failed; i++)
+    {
+      CRTerm *term = cr_term_new ();
+      enum CRTermType type;
+      CRNum *num;
+      CRRgb *rgb;
+
+      type = read_uint32 (reader);
+      term->unary_op = read_uint32 (reader);
+      term->the_operator = read_uint32 (reader);
+
+      /* Link the term first so it is freed along with the others on failure */
+      if (last)
+        {
+          last->next = term;
+          term->prev = last;
+        }
+      else
+        {
+          terms = term;
+        }
+      last = term;
+
+      switch (type)
+        {
+        case TERM_NUMBER:
+          num = cr_num_new ();
+          num->type = read_uint32 (reader);
+          num->val = read_double (reader);
+          cr_term_set_number (term, num);
+          break;
+
+        case TERM_FUNCTION:
+          cr_term_set_function (term, read_cr_string (reader), NULL);
+          term->ext_content.func_param = read_terms (reader);
+          if (term->content.str == NULL)
+            reader->failed = TRUE;
+          break;
+
+        case TERM_STRING:
+        case TERM_IDENT:
+        case TERM_URI:
+        case TERM_HASH:
+          term->type = type;
+          term->content.str = read_cr_string (reader);
+          if (term->content.str == NULL)
+            reader->failed = TRUE;
+          break;
+
+        case TERM_RGB:
+          rgb = cr_rgb_new ();
+          rgb->red = (gint32) read_uint32 (reader);
+          rgb->green = (gint32) read_uint32 (reader);
+          rgb->blue = (gint32) read_uint32 (reader);
+          rgb->is_percentage = read_uint32 (reader) != 0;
+          cr_term_set_rgb (term, rgb);
+          break;
+
+        case TERM_NO_TYPE:
+          break;
+
+        case TERM_UNICODERANGE:
+        default:
+          reader->failed = TRUE;
+          break;
+        }
+    }
+
+  return terms;
+}
+
+static CRAdditionalSel *
+read_additional_selector (Reader *reader)
+{
+  CRAdditionalSel *add_sel;
+  enum AddSelectorType type;
+  CRAttrSel *last_attr_sel = NULL;
+  guint32 n_attr_sels, i;
+
+  type = read_uint32 (reader);
+  add_sel = cr_additional_sel_new_with_type (type);
+
+  switch (type)
+    {
+    case CLASS_ADD_SELECTOR:
+      add_sel->content.class_name = read_cr_string (reader);
+      if (add_sel->content.class_name == NULL)
+        reader->failed = TRUE;
+      break;
+
+    case ID_ADD_SELECTOR:
+      add_sel->content.id_name = read_cr_string (reader);
+      if (add_sel->content.id_name == NULL)
+        reader->failed = TRUE;
+      break;
+
+    case PSEUDO_CLASS_ADD_SELECTOR:
+      add_sel->content.pseudo = cr_pseudo_new ();
+      add_sel->content.pseudo->type = read_uint32 (reader);
+      add_sel->content.pseudo->name = read_cr_string (reader);
+      add_sel->content.pseudo->extra = read_cr_string (reader);
+      if (add_sel->content.pseudo->name == NULL)
+        reader->failed = TRUE;
+      break;
+
+    case ATTRIBUTE_ADD_SELECTOR:
+      n_attr_sels = read_uint32 (reader);
+      if (!reader_check_count (reader, n_attr_sels))
+        break;
+
+      for (i = 0; i < n_attr_sels && !reader->failed; i++)
+        {
+          CRAttrSel *attr_sel = cr_attr_sel_new ();
+
+          if (last_attr_sel)
+            {
+              last_attr_sel->next = attr_sel;
+              attr_sel->prev = last_attr_sel;
+            }
+          else
+            {
+              add_sel->content.attr_sel = attr_sel;
+            }
+          last_attr_sel = attr_sel;
+
+          attr_sel->name = read_cr_string (reader);
+          attr_sel->value = read_cr_string (reader);
+          attr_sel->match_way = read_uint32 (reader);
+        }
+      break;
+
+    case NO_ADD_SELECTOR:
+      break;
+
+    default:
+      reader->failed = TRUE;
+      break;
+    }
+
+  return add_sel;
+}
+
+static CRSelector *
+read_selector (Reader *reader)
+{
+  CRSimpleSel *last_simple_sel = NULL;
+  CRSelector *selector;
+  guint32 n_simple_sels, i;
+
+  selector = cr_selector_new (NULL);
+
+  n_simple_sels = read_uint32 (reader);
+  if (n_simple_sels == 0)
+    reader->failed = TRUE;
+  if (!reader_check_count (reader, n_simple_sels))
+    return selector;
+
+  for (i = 0; i < n_simple_sels && !reader->failed; i++)
+    {
+      CRSimpleSel *simple_sel = cr_simple_sel_new ();
+      CRAdditionalSel *last_add_sel = NULL;
+      guint32 n_add_sels, j;
+
+      if (last_simple_sel)
+        {
+          last_simple_sel->next = simple_sel;
+          simple_sel->prev = last_simple_sel;
+        }
+      else
+        {
+          selector->simple_sel = simple_sel;
+        }
+      last_simple_sel = simple_sel;
+
+      simple_sel->type_mask = read_uint32 (reader);
+      simple_sel->is_case_sentive = read_uint32 (reader) != 0;
+      simple_sel->name = read_cr_string (reader);
+      simple_sel->combinator = read_uint32 (reader);
+      simple_sel->specificity = read_uint32 (reader);
+
+      n_add_sels = read_uint32 (reader);
+      if (!reader_check_count (reader, n_add_sels))
+        break;
+
+      for (j = 0; j < n_add_sels && !reader->failed; j++)
+        {
+          CRAdditionalSel *add_sel = read_additional_selector (reader);
+
+          if (last_add_sel)
+            {
+              last_add_sel->next = add_sel;
+              add_sel->prev = last_add_sel;
+            }
+          else
+            {
+              simple_sel->add_sel = add_sel;
+            }
+          last_add_sel = add_sel;
+        }
+    }
+
+  return selector;
+}
+
+static CRSelector *
+read_selectors (Reader *reader)
+{
+  CRSelector *selectors = NULL;
+  CRSelector *last = NULL;
+  guint32 n_selectors, i;
+
+  n_selectors = read_uint32 (reader);
+  if (n_selectors == 0)
+    reader->failed = TRUE;
+  if (!reader_check_count (reader, n_selectors))
+    return NULL;
+
+  for (i = 0; i < n_selectors && !reader->failed; i++)
+    {
+      CRSelector *selector = read_selector (reader);
+
+      if (last)
+        {
+          last->next = selector;
+          selector->prev = last;
+        }
+      else
+        {
+          selectors = selector;
+        }
+      last = selector;
+    }
+
+  return selectors;
+}
+
+static void
+read_declarations (Reader      *reader,
+                   CRStatement *stmt)
+{
+  CRDeclaration *last = NULL;
+  guint32 n_declarations, i;
+
+  n_declarations = read_uint32 (reader);
+  if (!reader_check_count (reader, n_declarations))
+    return;
+
+  for (i = 0; i < n_declarations && !reader->failed; i++)
+    {
+      CRDeclaration *decl;
+      const char *property;
+      gboolean important;
+      CRTerm *value;
+
+      property = read_string (reader);
+      important = read_uint32 (reader) != 0;
+      value = read_terms (reader);
+
+      if (property == NULL)
+        {
+          reader->failed = TRUE;
+          g_clear_pointer (&value, cr_term_destroy);
+          break;
+        }
+
+      decl = cr_declaration_new (stmt, cr_string_new_from_string (property), value);
+      decl->important = important;
+
+      if (last)
+        {
+          last->next = decl;
+          decl->prev = last;
+        }
+      else
+        {
+          stmt->kind.ruleset->decl_list = decl;
+        }
+      last = decl;
+    }
+}
+
+static CRStyleSheet *
+read_stylesheet (Reader  *reader,
+                 guint32  n_statements)
+{
+  CRStyleSheet *stylesheet;
+  CRStatement *last = NULL;
+  guint32 i;
+
+  stylesheet = cr_stylesheet_new (NULL);
+
+  for (i = 0; i < n_statements && !reader->failed; i++)
+    {
+      CRStatement *stmt = NULL;
+      CRSelector *selectors;
+      CRString *url;
+
+      switch (read_uint32 (reader))
+        {
+        case RULESET_STMT:
+          selectors = read_selectors (reader);
+          if (selectors == NULL)
+            {
+              reader->failed = TRUE;
+              break;
+            }
+
+          stmt = cr_statement_new_ruleset (stylesheet, selectors, NULL, NULL);
+          read_declarations (reader, stmt);
+          break;
+
+        case AT_IMPORT_RULE_STMT:
+          url = read_cr_string (reader);
+          if (url == NULL)
+            {
+              reader->failed = TRUE;
+              break;
+            }
+
+          stmt = cr_statement_new_at_import_rule (stylesheet, url, NULL, NULL);
+          break;
+
+        default:
+          reader->failed = TRUE;
+          break;
+        }
+
+      if (stmt == NULL)
+        break;
+
+      if (last)
+        {
+          last->next = stmt;
+          stmt->prev = last;
+        }
+      else
+        {
+          stylesheet->statements = stmt;
+        }
+      last = stmt;
+    }
+
+  if (reader->failed)
+    g_clear_pointer (&stylesheet, cr_stylesheet_unref);
+
+  return stylesheet;
+}
+
+static GBytes *
+load_compiled_data (GFile   *file,
+                    GError **error)
+{
+  if (g_file_has_uri_scheme (file, "resource"))
+    {
+      g_autofree char *uri = g_file_get_uri (file);
+      g_autofree char *path = NULL;
+      g_autofree char *compiled_path = NULL;
+
+      path = g_uri_unescape_string (uri + strlen ("resource://"), NULL);
+      compiled_path = g_strconcat (path, ST_COMPILED_STYLESHEET_SUFFIX, NULL);
+
+      return g_resources_lookup_data (compiled_path, G_RESOURCE_LOOKUP_FLAGS_NONE, error);
+    }
+  else if (g_file_is_native (file))
+    {
+      g_autofree char *path = g_file_get_path (file);
+      g_autofree char *compiled_path = NULL;
+      g_autoptr (GMappedFile) map = NULL;
+
+      compiled_path = g_strconcat (path, ST_COMPILED_STYLESHEET_SUFFIX, NULL);
+
+      map = g_mapped_file_new (compiled_path, FALSE, error);
+      if (map == NULL)
+        return NULL;
+
+      return g_mapped_file_get_bytes (map);
+    }
+
+  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                       "Compiled stylesheets are only supported for local files and resources");
+  return NULL;
+}
+
+/**
+ * _st_compiled_stylesheet_load:
+ * @file: the file of a stylesheet
+ * @source: the contents of @file
+ * @source_length: the length of @source
+ * @error: a #GError
+ *
+ * Loads the stylesheet from the compiled file next to @file (or the
+ * resource next to it, for resource URIs), if it was compiled from
+ * @source.
+ *
+ * Returns: (transfer full): the stylesheet, or %NULL if there is no
+ *   compiled stylesheet for @source
+ */
+CRStyleSheet *
+_st_compiled_stylesheet_load (GFile       *file,
+                              const char  *source,
+                              gsize        source_length,
+                              GError     **error)
+{
+  g_autoptr (GBytes) bytes = NULL;
+  g_autofree const char **strings = NULL;
+  guint8 digest[DIGEST_LENGTH];
+  CRStyleSheet *stylesheet;
+  Reader reader = { 0, };
+  guint32 n_statements;
+  guint32 i;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+  bytes = load_compiled_data (file, error);
+  if (bytes == NULL)
+    return NULL;
+
+  reader.data = g_bytes_get_data (bytes, &reader.length);
+
+  if (reader.length < HEADER_LENGTH ||
+      memcmp (reader.data, MAGIC, MAGIC_LENGTH) != 0)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                           "Not a compiled stylesheet");
+      return NULL;
+    }
+
+  reader.offset = MAGIC_LENGTH;
+
+  if (read_uint32 (&reader) != VERSION)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                           "Unsupported compiled stylesheet version");
+      return NULL;
+    }
+
+  compute_digest (source, source_length, digest);
+
+  if (read_uint32 (&reader) != source_length ||
+      memcmp (reader.data + reader.offset, digest, DIGEST_LENGTH) != 0)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                           "Compiled stylesheet is out of date");
+      return NULL;
+    }
+
+  reader.offset += DIGEST_LENGTH;
+
+  compute_digest ((const char *) reader.data + DATA_OFFSET,
+                  reader.length - DATA_OFFSET,
+                  digest);
+
+  if (memcmp (reader.data + reader.offset, digest, DIGEST_LENGTH) != 0)
+    goto invalid;
+
+  reader.offset += DIGEST_LENGTH;
+
+  reader.n_strings = read_uint32 (&reader);
+  n_statements = read_uint32 (&reader);
+
+  if (!reader_check_count (&reader, reader.n_strings))
+    goto invalid;
+
+  strings = g_new (const char *, reader.n_strings);
+
+  for (i = 0; i < reader.n_strings; i++)
+    {
+      guint32 length = read_uint32 (&reader);
+
+      if (reader.failed ||
+          length >= reader.length - reader.offset ||
+          reader.data[reader.offset + length] != '\0')
+        goto invalid;
+
+      strings[i] = (const char *) reader.data + reader.offset;
+      reader.offset += length + 1;
+    }
+
+  reader.strings = strings;
+
+  if (!reader_check_count (&reader, n_statements))
+    goto invalid;
+
+  stylesheet = read_stylesheet (&reader, n_statements);
+  if (stylesheet == NULL || reader.offset != reader.length)
+    {
+      g_clear_pointer (&stylesheet, cr_stylesheet_unref);
+      goto invalid;
+    }
+
+  return stylesheet;
+
+invalid:
+  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                       "Corrupt compiled stylesheet");
+  return NULL;
+}
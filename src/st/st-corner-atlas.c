@@ -0,0 +1,356 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-corner-atlas.c: Texture atlas for rounded corners
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Every combination of corner radius, border widths and colors needs
+ * its own small texture. Rather than creating a texture for each,
+ * they are packed into a few larger pages, so that corners painted
+ * one after the other (the four corners of a node, or the corners of
+ * the items of a menu) use the same texture and can be drawn together.
+ *
+ * Corners are placed on shelves, rows as high as their first corner
+ * that are filled from left to right. Each corner is surrounded by a
+ * one pixel gutter repeating its edges, so that linear filtering
+ * doesn't pick up its neighbours. Corners live as long as the process,
+ * like they did in the texture cache.
+ *
+ * Each page also holds a white texel, which the borders and background
+ * of a node are drawn with, so that they can be batched together with
+ * its corners.
+ */
+
+#include <string.h>
+
+#include "st-corner-atlas.h"
+
+#define PAGE_SIZE 512
+#define GUTTER 1
+
+/* A white texel, with its gutter */
+#define SOLID_SIZE (1 + 2 * GUTTER)
+
+typedef struct {
+  CoglContext *cogl_context;
+  CoglTexture *texture;
+  int size;
+
+  /* The shelf being filled */
+  int shelf_x;
+  int shelf_y;
+  int shelf_height;
+
+  /* Where solid_x and solid_y of regions on this page point to */
+  float solid_x;
+  float solid_y;
+} StCornerAtlasPage;
+
+typedef struct {
+  StCornerSpec corner;
+  StCornerAtlasRegion region;
+} StCornerAtlasEntry;
+
+static GHashTable *corners = NULL;
+static GPtrArray *pages = NULL;
+static guint used_pixels = 0;
+
+static guint
+corner_hash (gconstpointer data)
+{
+  const guint8 *p = data;
+  const guint8 *end = p + sizeof (StCornerSpec);
+  guint hash = 5381;
+
+  for (; p < end; p++)
+    hash = (hash << 5) + hash + *p;
+
+  return hash;
+}
+
+static gboolean
+corner_equal (gconstpointer a,
+              gconstpointer b)
+{
+  return memcmp (a, b, sizeof (StCornerSpec)) == 0;
+}
+
+static void
+page_free (StCornerAtlasPage *page)
+{
+  g_clear_object (&page->texture);
+  g_free (page);
+}
+
+static StCornerAtlasPage *
+page_new (CoglContext *cogl_context,
+          int          size)
+{
+  g_autofree guint8 *data = NULL;
+  g_autoptr (GError) error = NULL;
+  StCornerAtlasPage *page;
+  CoglTexture *texture;
+
+  /* Start out transparent, the gutters between shelves are never
+   * written to
+   */
+  data = g_malloc0 (size * size * 4);
+  texture = cogl_texture_2d_new_from_data (cogl_context, size, size,
+                                           COGL_PIXEL_FORMAT_ARGB32_NATIVE,
+                                           size * 4,
+                                           data,
+                                           &error);
+  if (texture == NULL)
+    {
+      g_warning ("Failed to allocate corner atlas: %s", error->message);
+      return NULL;
+    }
+
+  page = g_new0 (StCornerAtlasPage, 1);
+  page->cogl_context = cogl_context;
+  page->texture = texture;
+  page->size = size;
+
+  return page;
+}
+
+/* Finds room for a @slot_size square on @page, returning its position */
+static gboolean
+page_allocate (StCornerAtlasPage *page,
+               int                slot_size,
+               int               *x,
+               int               *y)
+{
+  if (page->shelf_x + slot_size > page->size ||
+      slot_size > page->shelf_height)
+    {
+      int next_y = page->shelf_y + page->shelf_height;
+
+      if (next_y + slot_size > page->size || slot_size > page->size)
+        return FALSE;
+
+      /* Start a new shelf below the current one */
+      page->shelf_x = 0;
+      page->shelf_y = next_y;
+      page->shelf_height = slot_size;
+    }
+
+  *x = page->shelf_x;
+  *y = page->shelf_y;
+  page->shelf_x += slot_size;
+
+  return TRUE;
+}
+
+/* Puts a white texel on @page, so that solid rectangles can be drawn
+ * with the same texture as the corners, see StCornerAtlasRegion
+ */
+static void
+page_add_solid (StCornerAtlasPage *page)
+{
+  guint8 data[SOLID_SIZE * SOLID_SIZE * 4];
+  int x = 0, y = 0;
+
+  memset (data, 0xff, sizeof (data));
+
+  page_allocate (page, SOLID_SIZE, &x, &y);
+  cogl_texture_set_region (page->texture,
+                           0, 0,
+                           x, y,
+                           SOLID_SIZE, SOLID_SIZE,
+                           SOLID_SIZE, SOLID_SIZE,
+                           COGL_PIXEL_FORMAT_ARGB32_NATIVE,
+                           SOLID_SIZE * 4,
+                           data);
+
+  /* The center of the texel */
+  page->solid_x = (x + GUTTER + 0.5f) / page->size;
+  page->solid_y = (y + GUTTER + 0.5f) / page->size;
+}
+
+/* Copies the @size x @size corner into a buffer with the gutter around
+ * it, repeating the edge pixels
+ */
+static guint8 *
+add_gutter (int           size,
+            int           rowstride,
+            const guint8 *data)
+{
+  int slot_size = size + 2 * GUTTER;
+  int slot_rowstride = slot_size * 4;
+  guint8 *slot;
+  int y;
+
+  slot = g_malloc (slot_size * slot_rowstride);
+
+  for (y = 0; y < size; y++)
+    {
+      guint8 *row = slot + (y + GUTTER) * slot_rowstride;
+
+      memcpy (row + GUTTER * 4, data + y * rowstride, size * 4);
+      memcpy (row, row + GUTTER * 4, 4);
+      memcpy (row + (size + GUTTER) * 4, row + (size + GUTTER - 1) * 4, 4);
+    }
+
+  memcpy (slot, slot + GUTTER * slot_rowstride, slot_rowstride);
+  memcpy (slot + (size + GUTTER) * slot_rowstride,
+          slot + (size + GUTTER - 1) * slot_rowstride,
+          slot_rowstride);
+
+  return slot;
+}
+
+/**
+ * _st_corner_atlas_lookup:
+ * @corner: the corner
+ *
+ * Looks up a corner previously added with _st_corner_atlas_insert().
+ *
+ * Returns: (nullable): where the corner is in the atlas, or %NULL
+ */
+const StCornerAtlasRegion *
+_st_corner_atlas_lookup (const StCornerSpec *corner)
+{
+  StCornerAtlasEntry *entry;
+
+  if (corners == NULL)
+    return NULL;
+
+  entry = g_hash_table_lookup (corners, corner);
+  if (entry == NULL)
+    return NULL;
+
+  return &entry->region;
+}
+
+/**
+ * _st_corner_atlas_insert:
+ * @corner: the corner
+ * @size: the width and height of @data
+ * @rowstride: the rowstride of @data
+ * @data: the ARGB32 pixels of the corner texture
+ *
+ * Adds the rendered texture of @corner to the atlas.
+ *
+ * Returns: (nullable): where the corner is in the atlas, or %NULL if
+ *   no texture could be allocated for it
+ */
+const StCornerAtlasRegion *
+_st_corner_atlas_insert (const StCornerSpec *corner,
+                         int                 size,
+                         int                 rowstride,
+                         const guint8       *data)
+{
+  g_autofree guint8 *slot = NULL;
+  StCornerAtlasPage *page = NULL;
+  StCornerAtlasEntry *entry;
+  int slot_size, x = 0, y = 0;
+  guint i;
+
+  g_return_val_if_fail (size > 0, NULL);
+
+  if (corners == NULL)
+    {
+      corners = g_hash_table_new_full (corner_hash, corner_equal,
+                                       NULL, g_free);
+      pages = g_ptr_array_new_with_free_func ((GDestroyNotify) page_free);
+    }
+
+  slot_size = size + 2 * GUTTER;
+
+  for (i = 0; i < pages->len; i++)
+    {
+      StCornerAtlasPage *p = g_ptr_array_index (pages, i);
+
+      if (p->cogl_context == corner->cogl_context &&
+          page_allocate (p, slot_size, &x, &y))
+        {
+          page = p;
+          break;
+        }
+    }
+
+  if (page == NULL)
+    {
+      /* Huge corners get a page of their own */
+      page = page_new (corner->cogl_context,
+                       MAX (slot_size + SOLID_SIZE, PAGE_SIZE));
+      if (page == NULL)
+        return NULL;
+
+      g_ptr_array_add (pages, page);
+      page_allocate (page, slot_size, &x, &y);
+      page_add_solid (page);
+    }
+
+  slot = add_gutter (size, rowstride, data);
+  if (!cogl_texture_set_region (page->texture,
+                                0, 0,
+                                x, y,
+                                slot_size, slot_size,
+                                slot_size, slot_size,
+                                COGL_PIXEL_FORMAT_ARGB32_NATIVE,
+                                slot_size * 4,
+                                slot))
+    return NULL;
+
+  entry = g_new0 (StCornerAtlasEntry, 1);
+  /* Copy the padding as well, for corner_hash() */
+  memcpy (&entry->corner, corner, sizeof (StCornerSpec));
+  entry->region.texture = page->texture;
+  entry->region.x1 = (float) (x + GUTTER) / page->size;
+  entry->region.y1 = (float) (y + GUTTER) / page->size;
+  entry->region.x2 = (float) (x + GUTTER + size) / page->size;
+  entry->region.y2 = (float) (y + GUTTER + size) / page->size;
+  entry->region.solid_x = page->solid_x;
+  entry->region.solid_y = page->solid_y;
+
+  g_hash_table_insert (corners, &entry->corner, entry);
+  used_pixels += slot_size * slot_size;
+
+  return &entry->region;
+}
+
+/**
+ * _st_corner_atlas_get_usage:
+ * @n_corners: (out) (optional): return location for the number of corners
+ * @n_pixels: (out) (optional): return location for the size of all pages
+ * @n_used_pixels: (out) (optional): return location for the number of
+ *   pixels taken by corners
+ *
+ * Gets statistics about the atlas.
+ */
+void
+_st_corner_atlas_get_usage (guint *n_corners,
+                            guint *n_pixels,
+                            guint *n_used_pixels)
+{
+  guint total = 0;
+  guint i;
+
+  for (i = 0; pages != NULL && i < pages->len; i++)
+    {
+      StCornerAtlasPage *page = g_ptr_array_index (pages, i);
+
+      total += page->size * page->size;
+    }
+
+  if (n_corners)
+    *n_corners = corners != NULL ? g_hash_table_size (corners) : 0;
+  if (n_pixels)
+    *n_pixels = total;
+  if (n_used_pixels)
+    *n_used_pixels = used_pixels;
+}
@@ -0,0 +1,68 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-corner-atlas.h: Texture atlas for rounded corners
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+/* Everything a corner texture depends on. Specs are hashed and compared
+ * bytewise, so they must be zero-initialized.
+ */
+typedef struct {
+  /*
+   * The context here is not really part of the corner
+   * definition per se, but is used for the drawing part.
+  */
+  CoglContext   *cogl_context;
+  CoglColor      color;
+  CoglColor      border_color_1;
+  CoglColor      border_color_2;
+  guint          radius;
+  guint          border_width_1;
+  guint          border_width_2;
+  float          resource_scale;
+} StCornerSpec;
+
+typedef struct {
+  /* The atlas page, owned by the atlas */
+  CoglTexture *texture;
+
+  /* The square holding the corner, in texture coordinates */
+  float x1;
+  float y1;
+  float x2;
+  float y2;
+
+  /* An opaque white texel on the same page, in texture coordinates */
+  float solid_x;
+  float solid_y;
+} StCornerAtlasRegion;
+
+const StCornerAtlasRegion *_st_corner_atlas_lookup (const StCornerSpec *corner);
+const StCornerAtlasRegion *_st_corner_atlas_insert (const StCornerSpec *corner,
+                                                    int                 size,
+                                                    int                 rowstride,
+                                                    const guint8       *data);
+
+void _st_corner_atlas_get_usage (guint *n_corners,
+                                 guint *n_pixels,
+                                 guint *n_used_pixels);
+
+G_END_DECLS
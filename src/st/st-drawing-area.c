@@ -301,7 +301,8 @@ st_drawing_area_queue_repaint (StDrawingArea *area)
   if (priv->width <= 0 || priv->height <= 0)
     return;
 
-  clutter_actor_queue_redraw (CLUTTER_ACTOR (area));
+  /* Only the content changed, not the background */
+  st_widget_queue_redraw_area (ST_WIDGET (area), NULL);
   st_drawing_area_emit_repaint (area);
 }
 
@@ -0,0 +1,371 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-icon-disk-cache.c: Persistent cache of rendered icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Rendering icons, SVGs in particular, is what takes most of the time
+ * when showing the app grid for the first time. The rendered pixels
+ * are kept in $XDG_CACHE_HOME/gnome-shell/icons, one file per icon,
+ * so that after a restart they only need to be mapped and uploaded.
+ *
+ * Entries are named after a digest of everything the pixels depend on:
+ * the path of the icon file, the device, inode, size and modification
+ * time of the file it points to, the size, the scale and the colors of
+ * symbolic icons. OSTree and Flatpak checkouts give all files the same
+ * modification time, so after an update only the inode tells that an
+ * icon at the same path was replaced. The change time is left out, as
+ * every new deployment hard links the unchanged files and so changes
+ * it. So an entry is never out of date, it just stops being used. The
+ * whole cache is cleared when switching to another icon theme, which
+ * is when most of them do; otherwise the least recently used entries
+ * are pruned once they take too much space.
+ *
+ * Entries are only ever replaced atomically, never modified, so they
+ * can stay mapped while the cache is written to or cleared. All
+ * integers are stored little endian. The layout is:
+ *
+ *   char    magic[8]
+ *   guint32 version
+ *   guint32 width
+ *   guint32 height
+ *   guint32 rowstride
+ *   guint8  padding[8]
+ *   guint8  pixels[rowstride * height]  premultiplied RGBA
+ *
+ * None of this touches global state, so that it can be done in
+ * threads.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "st-icon-disk-cache.h"
+#include "st-premultiply.h"
+
+#define MAGIC "StIcon\r\n"
+#define MAGIC_LENGTH 8
+#define VERSION 1
+
+/* Keeps the pixels aligned */
+#define HEADER_LENGTH 32
+
+#define MAX_CACHE_SIZE (128 * 1024 * 1024)
+
+typedef struct {
+  char *path;
+  gint64 size;
+  gint64 last_used;
+} CacheFile;
+
+static char *
+get_cache_dir (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "icons", NULL);
+}
+
+static void
+write_uint32 (guint8  *data,
+              guint32  value)
+{
+  guint32 le_value = GUINT32_TO_LE (value);
+
+  memcpy (data, &le_value, sizeof (le_value));
+}
+
+static guint32
+read_uint32 (const guint8 *data)
+{
+  guint32 le_value;
+
+  memcpy (&le_value, data, sizeof (le_value));
+
+  return GUINT32_FROM_LE (le_value);
+}
+
+/**
+ * _st_icon_disk_cache_get_entry:
+ * @filename: the icon file
+ * @size: the size the icon is loaded at
+ * @scale: the scale the icon is loaded at
+ * @colors: (nullable): the colors of a symbolic icon
+ *
+ * Gets the name of the cache entry for an icon, which stays the same
+ * for as long as the icon file isn't changed.
+ *
+ * Returns: (transfer full) (nullable): the entry, or %NULL if the icon
+ *   cannot be cached
+ */
+char *
+_st_icon_disk_cache_get_entry (const char   *filename,
+                               int           size,
+                               int           scale,
+                               StIconColors *colors)
+{
+  g_autoptr (GString) key = NULL;
+  GStatBuf stat_buf;
+
+  if (filename == NULL || g_stat (filename, &stat_buf) != 0)
+    return NULL;
+
+  key = g_string_new (NULL);
+  g_string_append_printf (key,
+                          "%s\n"
+                          "%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT "\n"
+                          "%" G_GINT64_FORMAT "\n"
+                          "%" G_GINT64_FORMAT ".%09ld\n"
+                          "%d\n%d",
+                          filename,
+                          (guint64) stat_buf.st_dev, (guint64) stat_buf.st_ino,
+                          (gint64) stat_buf.st_size,
+                          (gint64) stat_buf.st_mtim.tv_sec, stat_buf.st_mtim.tv_nsec,
+                          size, scale);
+
+  if (colors != NULL)
+    {
+      const CoglColor *c[] = {
+        &colors->foreground, &colors->warning,
+        &colors->error, &colors->success,
+      };
+      int i;
+
+      for (i = 0; i < G_N_ELEMENTS (c); i++)
+        g_string_append_printf (key, "\n%02x%02x%02x%02x",
+                                c[i]->red, c[i]->green, c[i]->blue, c[i]->alpha);
+    }
+
+  return g_compute_checksum_for_string (G_CHECKSUM_SHA256, key->str, key->len);
+}
+
+/**
+ * _st_icon_disk_cache_lookup:
+ * @entry: an entry from _st_icon_disk_cache_get_entry()
+ * @width: (out): return location for the width of the icon
+ * @height: (out): return location for the height of the icon
+ * @rowstride: (out): return location for the rowstride of the pixels
+ *
+ * Maps the pixels of a cached icon, in %ST_ICON_DISK_CACHE_FORMAT.
+ *
+ * Returns: (transfer full) (nullable): the pixels, or %NULL if the
+ *   icon isn't cached
+ */
+GBytes *
+_st_icon_disk_cache_lookup (const char *entry,
+                            int        *width,
+                            int        *height,
+                            int        *rowstride)
+{
+  g_autofree char *dir = get_cache_dir ();
+  g_autofree char *path = g_build_filename (dir, entry, NULL);
+  g_autoptr (GMappedFile) mapped_file = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  const guint8 *data;
+  gsize length;
+  guint32 w, h, stride;
+
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  data = g_bytes_get_data (bytes, &length);
+
+  if (length < HEADER_LENGTH ||
+      memcmp (data, MAGIC, MAGIC_LENGTH) != 0 ||
+      read_uint32 (data + MAGIC_LENGTH) != VERSION)
+    return NULL;
+
+  w = read_uint32 (data + MAGIC_LENGTH + 4);
+  h = read_uint32 (data + MAGIC_LENGTH + 8);
+  stride = read_uint32 (data + MAGIC_LENGTH + 12);
+
+  /* Everything has to fit the ints we return, and the size of the
+   * pixels into a gsize
+   */
+  if (w == 0 || w > G_MAXINT / 4 ||
+      h == 0 || h > G_MAXINT ||
+      stride < w * 4 || stride > G_MAXINT ||
+      h > (G_MAXSIZE - HEADER_LENGTH) / stride)
+    return NULL;
+
+  if (length != HEADER_LENGTH + (gsize) stride * h)
+    return NULL;
+
+  *width = w;
+  *height = h;
+  *rowstride = stride;
+
+  return g_bytes_new_from_bytes (bytes, HEADER_LENGTH, length - HEADER_LENGTH);
+}
+
+/**
+ * _st_icon_disk_cache_store:
+ * @entry: an entry from _st_icon_disk_cache_get_entry()
+ * @pixbuf: the rendered icon
+ *
+ * Writes @pixbuf to the cache. This blocks, so it should be done in
+ * a thread.
+ */
+void
+_st_icon_disk_cache_store (const char *entry,
+                           GdkPixbuf  *pixbuf)
+{
+  g_autofree char *dir = get_cache_dir ();
+  g_autofree char *path = NULL;
+  g_autofree guint8 *data = NULL;
+  g_autoptr (GError) error = NULL;
+  const guint8 *pixels;
+  int width, height, rowstride, n_channels;
+  int stride;
+  gsize length;
+
+  g_return_if_fail (gdk_pixbuf_get_bits_per_sample (pixbuf) == 8);
+
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+  pixels = gdk_pixbuf_read_pixels (pixbuf);
+
+  stride = width * 4;
+  length = HEADER_LENGTH + (gsize) stride * height;
+  data = g_malloc0 (length);
+
+  memcpy (data, MAGIC, MAGIC_LENGTH);
+  write_uint32 (data + MAGIC_LENGTH, VERSION);
+  write_uint32 (data + MAGIC_LENGTH + 4, width);
+  write_uint32 (data + MAGIC_LENGTH + 8, height);
+  write_uint32 (data + MAGIC_LENGTH + 12, stride);
+
+  _st_premultiply_pixels (pixels, rowstride, n_channels, width, height,
+                          data + HEADER_LENGTH, stride);
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      g_debug ("Failed to create icon cache directory: %s", g_strerror (errno));
+      return;
+    }
+
+  path = g_build_filename (dir, entry, NULL);
+  if (!g_file_set_contents (path, (const char *) data, length, &error))
+    g_debug ("Failed to write icon cache entry: %s", error->message);
+}
+
+/**
+ * _st_icon_disk_cache_clear:
+ *
+ * Removes all entries from the cache. This blocks, so it should be
+ * done in a thread.
+ */
+void
+_st_icon_disk_cache_clear (void)
+{
+  g_autofree char *dir_path = get_cache_dir ();
+  g_autoptr (GDir) dir = NULL;
+  const char *name;
+
+  dir = g_dir_open (dir_path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree char *path = g_build_filename (dir_path, name, NULL);
+
+      g_unlink (path);
+    }
+}
+
+static void
+cache_file_clear (CacheFile *file)
+{
+  g_free (file->path);
+}
+
+static int
+compare_last_used (gconstpointer a,
+                   gconstpointer b)
+{
+  const CacheFile *file_a = a;
+  const CacheFile *file_b = b;
+
+  if (file_a->last_used < file_b->last_used)
+    return -1;
+
+  return file_a->last_used > file_b->last_used;
+}
+
+/**
+ * _st_icon_disk_cache_prune:
+ *
+ * Removes the least recently used entries until the rest fit into
+ * the size of the cache. Entries are never modified and, even with
+ * relatime, their access time is updated at least once a day, so it
+ * tells well enough when they were last used. This blocks, so it
+ * should be done in a thread.
+ */
+void
+_st_icon_disk_cache_prune (void)
+{
+  g_autofree char *dir_path = get_cache_dir ();
+  g_autoptr (GDir) dir = NULL;
+  g_autoptr (GArray) files = NULL;
+  const char *name;
+  gint64 total_size = 0;
+  guint i;
+
+  dir = g_dir_open (dir_path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+  g_array_set_clear_func (files, (GDestroyNotify) cache_file_clear);
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      CacheFile file;
+      GStatBuf stat_buf;
+
+      file.path = g_build_filename (dir_path, name, NULL);
+      if (g_stat (file.path, &stat_buf) != 0)
+        {
+          g_free (file.path);
+          continue;
+        }
+
+      file.size = stat_buf.st_size;
+      file.last_used = MAX (stat_buf.st_atime, stat_buf.st_mtime);
+      total_size += file.size;
+
+      g_array_append_val (files, file);
+    }
+
+  if (total_size <= MAX_CACHE_SIZE)
+    return;
+
+  g_array_sort (files, compare_last_used);
+
+  for (i = 0; i < files->len && total_size > MAX_CACHE_SIZE; i++)
+    {
+      CacheFile *file = &g_array_index (files, CacheFile, i);
+
+      if (g_unlink (file->path) == 0)
+        total_size -= file->size;
+    }
+}
@@ -0,0 +1,45 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-icon-disk-cache.h: Persistent cache of rendered icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "st-icon-colors.h"
+
+G_BEGIN_DECLS
+
+/* The format of the pixels returned by _st_icon_disk_cache_lookup() */
+#define ST_ICON_DISK_CACHE_FORMAT COGL_PIXEL_FORMAT_RGBA_8888_PRE
+
+char   *_st_icon_disk_cache_get_entry (const char   *filename,
+                                       int           size,
+                                       int           scale,
+                                       StIconColors *colors);
+
+GBytes *_st_icon_disk_cache_lookup    (const char   *entry,
+                                       int          *width,
+                                       int          *height,
+                                       int          *rowstride);
+void    _st_icon_disk_cache_store     (const char   *entry,
+                                       GdkPixbuf    *pixbuf);
+
+void    _st_icon_disk_cache_clear     (void);
+void    _st_icon_disk_cache_prune     (void);
+
+G_END_DECLS
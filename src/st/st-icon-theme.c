@@ -29,6 +29,7 @@
 
 #include "st-icon-theme.h"
 #include "st-icon-cache.h"
+#include "st-recolor.h"
 #include "st-settings.h"
 
 #define DEFAULT_ICON_THEME "Adwaita"
@@ -75,7 +76,8 @@ typedef enum
   ICON_SUFFIX_SYMBOLIC_PNG = 1 << 4
 } IconSuffix;
 
-#define INFO_CACHE_LRU_SIZE 32
+/* How much pixel data infos kept alive only by the LRU may hold */
+#define INFO_CACHE_LRU_DEFAULT_SIZE (4 * 1024 * 1024)
 #if 0
 #define DEBUG_CACHE(args) g_print args
 #else
@@ -87,7 +89,13 @@ struct _StIconTheme
   GObject parent_instance;
 
   GHashTable *info_cache;
-  GList *info_cache_lru;
+  GQueue info_cache_lru;
+  gsize info_cache_lru_size;
+  gsize info_cache_max_size;
+
+  guint info_cache_hits;
+  guint info_cache_misses;
+  guint info_cache_evictions;
 
   char *current_theme;
   char **search_path;
@@ -136,6 +144,12 @@ struct _StIconInfo
   IconInfoKey key;
   StIconTheme *in_cache;
 
+  /* Our link in the LRU of in_cache, with data set while queued,
+   * and the size it was accounted with
+   */
+  GList lru_link;
+  gsize lru_size;
+
   char *filename;
   GFile *icon_file;
   GLoadableIcon *loadable;
@@ -451,6 +465,8 @@ st_icon_theme_init (StIconTheme *icon_theme)
 
   icon_theme->info_cache = g_hash_table_new_full (icon_info_key_hash, icon_info_key_equal, NULL,
                                                   (GDestroyNotify)icon_info_uncached);
+  g_queue_init (&icon_theme->info_cache_lru);
+  icon_theme->info_cache_max_size = INFO_CACHE_LRU_DEFAULT_SIZE;
 
   xdg_data_dirs = g_get_system_data_dirs ();
   for (i = 0; xdg_data_dirs[i]; i++) ;
@@ -553,7 +569,7 @@ st_icon_theme_finalize (GObject *object)
   icon_theme = ST_ICON_THEME (object);
 
   g_hash_table_destroy (icon_theme->info_cache);
-  g_assert (icon_theme->info_cache_lru == NULL);
+  g_assert (g_queue_is_empty (&icon_theme->info_cache_lru));
 
   g_clear_handle_id (&icon_theme->theme_changed_idle, g_source_remove);
 
@@ -1099,7 +1115,7 @@ ensure_valid_themes (StIconTheme *icon_theme)
   icon_theme->loading_themes = FALSE;
 }
 
-/* The LRU cache is a short list of IconInfos that are kept
+/* The LRU cache is a queue of IconInfos that are kept
  * alive even though their IconInfo would otherwise have
  * been freed, so that we can avoid reloading these
  * constantly.
@@ -1107,25 +1123,64 @@ ensure_valid_themes (StIconTheme *icon_theme)
  * references the info. So, when we get a cache hit
  * we remove it from the list, and when the proxy
  * pixmap is released we put it on the list.
+ *
+ * Each info carries its own link, so that all of this is
+ * constant time, and the queue is bounded by the size of
+ * the pixbufs it keeps alive rather than by their number,
+ * so that it holds many small icons but few large ones.
  */
+static gsize
+pixbuf_get_size (GdkPixbuf *pixbuf)
+{
+  return pixbuf != NULL ? gdk_pixbuf_get_byte_length (pixbuf) : 0;
+}
+
+static gsize
+icon_info_get_lru_size (StIconInfo *icon_info)
+{
+  SymbolicPixbufCache *symbolic_cache;
+  gsize size = sizeof (StIconInfo);
+
+  size += pixbuf_get_size (icon_info->pixbuf);
+  size += pixbuf_get_size (icon_info->cache_pixbuf);
+
+  for (symbolic_cache = icon_info->symbolic_pixbuf_cache;
+       symbolic_cache != NULL;
+       symbolic_cache = symbolic_cache->next)
+    size += pixbuf_get_size (symbolic_cache->pixbuf);
+
+  return size;
+}
+
 static void
-ensure_lru_cache_space (StIconTheme *icon_theme)
+unlink_from_lru_cache (StIconTheme *icon_theme,
+                       StIconInfo  *icon_info)
 {
-  GList *l;
+  g_queue_unlink (&icon_theme->info_cache_lru, &icon_info->lru_link);
+  icon_info->lru_link.data = NULL;
+  icon_theme->info_cache_lru_size -= icon_info->lru_size;
+  icon_info->lru_size = 0;
+}
 
-  /* Remove last item if LRU full */
-  l = g_list_nth (icon_theme->info_cache_lru, INFO_CACHE_LRU_SIZE - 1);
-  if (l)
+static void
+ensure_lru_cache_space (StIconTheme *icon_theme)
+{
+  /* Remove the least recently used items while over budget,
+   * but always keep the most recent one
+   */
+  while (icon_theme->info_cache_lru_size > icon_theme->info_cache_max_size &&
+         icon_theme->info_cache_lru.length > 1)
     {
-      StIconInfo *icon_info = l->data;
+      StIconInfo *icon_info = icon_theme->info_cache_lru.tail->data;
 
       DEBUG_CACHE (("removing (due to out of space) %p (%s %d 0x%x) from LRU cache (cache size %d)\n",
                     icon_info,
                     g_strjoinv (",", icon_info->key.icon_names),
                     icon_info->key.size, icon_info->key.flags,
-                    g_list_length (icon_theme->info_cache_lru)));
+                    icon_theme->info_cache_lru.length));
 
-      icon_theme->info_cache_lru = g_list_delete_link (icon_theme->info_cache_lru, l);
+      unlink_from_lru_cache (icon_theme, icon_info);
+      icon_theme->info_cache_evictions++;
       g_object_unref (icon_info);
     }
 }
@@ -1138,28 +1193,36 @@ add_to_lru_cache (StIconTheme *icon_theme,
                 icon_info,
                 g_strjoinv (",", icon_info->key.icon_names),
                 icon_info->key.size, icon_info->key.flags,
-                g_list_length (icon_theme->info_cache_lru)));
+                icon_theme->info_cache_lru.length));
 
-  g_assert (g_list_find (icon_theme->info_cache_lru, icon_info) == NULL);
+  g_assert (icon_info->lru_link.data == NULL);
 
-  ensure_lru_cache_space (icon_theme);
   /* prepend new info to LRU */
-  icon_theme->info_cache_lru = g_list_prepend (icon_theme->info_cache_lru,
-                                         g_object_ref (icon_info));
+  icon_info->lru_link.data = g_object_ref (icon_info);
+  icon_info->lru_size = icon_info_get_lru_size (icon_info);
+  g_queue_push_head_link (&icon_theme->info_cache_lru, &icon_info->lru_link);
+  icon_theme->info_cache_lru_size += icon_info->lru_size;
+
+  ensure_lru_cache_space (icon_theme);
 }
 
 static void
 ensure_in_lru_cache (StIconTheme *icon_theme,
                      StIconInfo  *icon_info)
 {
-  GList *l;
-
-  l = g_list_find (icon_theme->info_cache_lru, icon_info);
-  if (l)
+  if (icon_info->lru_link.data != NULL)
     {
-      /* Move to front of LRU if already in it */
-      icon_theme->info_cache_lru = g_list_remove_link (icon_theme->info_cache_lru, l);
-      icon_theme->info_cache_lru = g_list_concat (l, icon_theme->info_cache_lru);
+      gsize size = icon_info_get_lru_size (icon_info);
+
+      /* Move to front of LRU if already in it, accounting for
+       * pixbufs loaded since it was added
+       */
+      g_queue_unlink (&icon_theme->info_cache_lru, &icon_info->lru_link);
+      g_queue_push_head_link (&icon_theme->info_cache_lru, &icon_info->lru_link);
+      icon_theme->info_cache_lru_size += size - icon_info->lru_size;
+      icon_info->lru_size = size;
+
+      ensure_lru_cache_space (icon_theme);
     }
   else
     add_to_lru_cache (icon_theme, icon_info);
@@ -1169,15 +1232,15 @@ static void
 remove_from_lru_cache (StIconTheme *icon_theme,
                        StIconInfo  *icon_info)
 {
-  if (g_list_find (icon_theme->info_cache_lru, icon_info))
+  if (icon_info->lru_link.data != NULL)
     {
       DEBUG_CACHE (("removing %p (%s %d 0x%x) from LRU cache (cache size %d)\n",
                     icon_info,
                     g_strjoinv (",", icon_info->key.icon_names),
                     icon_info->key.size, icon_info->key.flags,
-                    g_list_length (icon_theme->info_cache_lru)));
+                    icon_theme->info_cache_lru.length));
 
-      icon_theme->info_cache_lru = g_list_remove (icon_theme->info_cache_lru, icon_info);
+      unlink_from_lru_cache (icon_theme, icon_info);
       g_object_unref (icon_info);
     }
 }
@@ -1278,12 +1341,16 @@ real_choose_icon (StIconTheme       *icon_theme,
                     icon_info->key.size, icon_info->key.flags,
                     g_hash_table_size (icon_theme->info_cache)));
 
+      icon_theme->info_cache_hits++;
+
       icon_info = g_object_ref (icon_info);
       remove_from_lru_cache (icon_theme, icon_info);
 
       return icon_info;
     }
 
+  icon_theme->info_cache_misses++;
+
   if (flags & ST_ICON_LOOKUP_NO_SVG)
     allow_svg = FALSE;
   else if (flags & ST_ICON_LOOKUP_FORCE_SVG)
@@ -2160,6 +2227,75 @@ st_icon_theme_rescan_if_needed (StIconTheme *icon_theme)
   return retval;
 }
 
+/**
+ * st_icon_theme_set_cache_size:
+ * @icon_theme: a #StIconTheme
+ * @size: the size in bytes
+ *
+ * Sets how much pixel data @icon_theme may keep around for icons
+ * that are not in use anymore, so that looking them up again
+ * doesn't need to load them again.
+ */
+void
+st_icon_theme_set_cache_size (StIconTheme *icon_theme,
+                              gsize        size)
+{
+  g_return_if_fail (ST_IS_ICON_THEME (icon_theme));
+
+  icon_theme->info_cache_max_size = size;
+  ensure_lru_cache_space (icon_theme);
+}
+
+/**
+ * st_icon_theme_get_cache_size:
+ * @icon_theme: a #StIconTheme
+ *
+ * Gets the size set with st_icon_theme_set_cache_size().
+ *
+ * Returns: the size in bytes
+ */
+gsize
+st_icon_theme_get_cache_size (StIconTheme *icon_theme)
+{
+  g_return_val_if_fail (ST_IS_ICON_THEME (icon_theme), 0);
+
+  return icon_theme->info_cache_max_size;
+}
+
+/**
+ * st_icon_theme_get_cache_statistics:
+ * @icon_theme: a #StIconTheme
+ * @hits: (out) (optional): return location for the number of lookups
+ *   that found a cached icon
+ * @misses: (out) (optional): return location for the number of lookups
+ *   that did not
+ * @evictions: (out) (optional): return location for the number of
+ *   unused icons dropped to stay within the cache size
+ * @used_size: (out) (optional): return location for the size of the
+ *   unused icons currently kept, in bytes
+ *
+ * Gets statistics about the icon cache of @icon_theme, for tuning
+ * its size with st_icon_theme_set_cache_size().
+ */
+void
+st_icon_theme_get_cache_statistics (StIconTheme *icon_theme,
+                                    guint       *hits,
+                                    guint       *misses,
+                                    guint       *evictions,
+                                    gsize       *used_size)
+{
+  g_return_if_fail (ST_IS_ICON_THEME (icon_theme));
+
+  if (hits)
+    *hits = icon_theme->info_cache_hits;
+  if (misses)
+    *misses = icon_theme->info_cache_misses;
+  if (evictions)
+    *evictions = icon_theme->info_cache_evictions;
+  if (used_size)
+    *used_size = icon_theme->info_cache_lru_size;
+}
+
 static void
 theme_destroy (IconTheme *theme)
 {
@@ -3657,15 +3793,10 @@ static GdkPixbuf *
 color_symbolic_pixbuf (GdkPixbuf    *symbolic,
                        StIconColors *colors)
 {
-  int width, height, x, y, src_stride, dst_stride;
-  guchar *src_data, *dst_data;
-  guchar *src_row, *dst_row;
-  int alpha;
+  int width, height;
   GdkPixbuf *colored;
   uint8_t fg_pixel[4], success_pixel[4], warning_pixel[4], error_pixel[4];
 
-  alpha = colors->foreground.alpha;
-
   color_to_pixel (&colors->foreground, fg_pixel);
   color_to_pixel (&colors->success, success_pixel);
   color_to_pixel (&colors->warning, warning_pixel);
@@ -3676,60 +3807,14 @@ color_symbolic_pixbuf (GdkPixbuf    *symbolic,
 
   colored = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
 
-  src_stride = gdk_pixbuf_get_rowstride (symbolic);
-  src_data = gdk_pixbuf_get_pixels (symbolic);
-
-  dst_data = gdk_pixbuf_get_pixels (colored);
-  dst_stride = gdk_pixbuf_get_rowstride (colored);
-
-  for (y = 0; y < height; y++)
-    {
-      src_row = src_data + src_stride * y;
-      dst_row = dst_data + dst_stride * y;
-      for (x = 0; x < width; x++)
-        {
-          guint r, g, b, a;
-          int c1, c2, c3, c4;
-
-          a = src_row[3];
-          dst_row[3] = a * alpha / 255;
-
-          if (a == 0)
-            {
-              dst_row[0] = 0;
-              dst_row[1] = 0;
-              dst_row[2] = 0;
-            }
-          else
-            {
-              c2 = src_row[0];
-              c3 = src_row[1];
-              c4 = src_row[2];
-
-              if (c2 == 0 && c3 == 0 && c4 == 0)
-                {
-                  dst_row[0] = fg_pixel[0];
-                  dst_row[1] = fg_pixel[1];
-                  dst_row[2] = fg_pixel[2];
-                }
-              else
-                {
-                  c1 = 255 - c2 - c3 - c4;
-
-                  r = fg_pixel[0] * c1 + success_pixel[0] * c2 +  warning_pixel[0] * c3 +  error_pixel[0] * c4;
-                  g = fg_pixel[1] * c1 + success_pixel[1] * c2 +  warning_pixel[1] * c3 +  error_pixel[1] * c4;
-                  b = fg_pixel[2] * c1 + success_pixel[2] * c2 +  warning_pixel[2] * c3 +  error_pixel[2] * c4;
-
-                  dst_row[0] = r / 255;
-                  dst_row[1] = g / 255;
-                  dst_row[2] = b / 255;
-                }
-            }
-
-          src_row += 4;
-          dst_row += 4;
-        }
-    }
+  _st_recolor_symbolic_pixels (gdk_pixbuf_read_pixels (symbolic),
+                               gdk_pixbuf_get_rowstride (symbolic),
+                               gdk_pixbuf_get_pixels (colored),
+                               gdk_pixbuf_get_rowstride (colored),
+                               width, height,
+                               fg_pixel, success_pixel,
+                               warning_pixel, error_pixel,
+                               colors->foreground.alpha);
 
   return colored;
 }
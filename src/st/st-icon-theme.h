@@ -168,6 +168,17 @@ GList * st_icon_theme_list_contexts (StIconTheme *icon_theme);
 
 gboolean st_icon_theme_rescan_if_needed (StIconTheme *icon_theme);
 
+void st_icon_theme_set_cache_size (StIconTheme *icon_theme,
+                                   gsize        size);
+
+gsize st_icon_theme_get_cache_size (StIconTheme *icon_theme);
+
+void st_icon_theme_get_cache_statistics (StIconTheme *icon_theme,
+                                         guint       *hits,
+                                         guint       *misses,
+                                         guint       *evictions,
+                                         gsize       *used_size);
+
 StIconInfo * st_icon_info_new_for_pixbuf (StIconTheme *icon_theme,
                                           GdkPixbuf   *pixbuf);
 
@@ -27,4 +27,13 @@ void st_image_content_set_is_symbolic (StImageContent *content,
 
 gboolean st_image_content_get_is_symbolic (StImageContent *content);
 
+gboolean st_image_content_set_unpremultiplied_data (StImageContent  *content,
+                                                    CoglContext     *cogl_context,
+                                                    const guint8    *data,
+                                                    gboolean         has_alpha,
+                                                    guint            width,
+                                                    guint            height,
+                                                    guint            row_stride,
+                                                    GError         **error);
+
 G_END_DECLS
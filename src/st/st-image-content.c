@@ -19,6 +19,7 @@
  */
 
 #include "st-image-content-private.h"
+#include "st-premultiply.h"
 #include "st-private.h"
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -584,6 +585,94 @@ st_image_content_set_bytes (StImageContent   *content,
   return TRUE;
 }
 
+/**
+ * st_image_content_set_unpremultiplied_data:
+ * @content: a #StImageContent
+ * @cogl_context: The context to use
+ * @data: RGB or RGBA pixels, as in a #GdkPixbuf
+ * @has_alpha: whether @data is RGBA
+ * @width: the width of the image data
+ * @height: the height of the image data
+ * @row_stride: the length of each row inside @data
+ * @error: return location for a #GError, or %NULL
+ *
+ * Like st_image_content_set_data(), but rather than having Cogl
+ * premultiply the pixels into a temporary copy before uploading them,
+ * premultiplies them directly into a pixel buffer that the texture is
+ * then uploaded from. This is what icons mapped from disk take.
+ *
+ * Return value: %TRUE if the image data was successfully loaded,
+ *   and %FALSE otherwise.
+ */
+gboolean
+st_image_content_set_unpremultiplied_data (StImageContent  *content,
+                                           CoglContext     *cogl_context,
+                                           const guint8    *data,
+                                           gboolean         has_alpha,
+                                           guint            width,
+                                           guint            height,
+                                           guint            row_stride,
+                                           GError         **error)
+{
+  g_autoptr (CoglPixelBuffer) buffer = NULL;
+  g_autoptr (CoglBitmap) bitmap = NULL;
+  CoglTexture *texture;
+  guint8 *pixels;
+  int old_width = 0;
+  int old_height = 0;
+
+  g_return_val_if_fail (ST_IS_IMAGE_CONTENT (content), FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  /* Opaque pixels can be uploaded as they are */
+  if (!has_alpha)
+    return st_image_content_set_data (content, cogl_context, data,
+                                      COGL_PIXEL_FORMAT_RGB_888,
+                                      width, height, row_stride,
+                                      error);
+
+  buffer = cogl_pixel_buffer_new (cogl_context, (gsize) width * height * 4, NULL);
+  pixels = cogl_buffer_map (COGL_BUFFER (buffer),
+                            COGL_BUFFER_ACCESS_WRITE,
+                            COGL_BUFFER_MAP_HINT_DISCARD);
+  if (pixels == NULL)
+    return st_image_content_set_data (content, cogl_context, data,
+                                      COGL_PIXEL_FORMAT_RGBA_8888,
+                                      width, height, row_stride,
+                                      error);
+
+  _st_premultiply_pixels (data, row_stride, 4, width, height,
+                          pixels, width * 4);
+  cogl_buffer_unmap (COGL_BUFFER (buffer));
+
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (buffer),
+                                        COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                        width, height, width * 4, 0);
+  texture = cogl_texture_2d_new_from_bitmap (bitmap);
+  if (!cogl_texture_allocate (texture, error))
+    {
+      g_object_unref (texture);
+      return FALSE;
+    }
+
+  if (content->texture != NULL)
+    {
+      old_width = cogl_texture_get_width (content->texture);
+      old_height = cogl_texture_get_height (content->texture);
+
+      g_object_unref (content->texture);
+    }
+
+  content->texture = texture;
+
+  clutter_content_invalidate (CLUTTER_CONTENT (content));
+
+  if (old_width != width || old_height != height)
+    clutter_content_invalidate_size (CLUTTER_CONTENT (content));
+
+  return TRUE;
+}
+
 /**
  * st_image_content_get_texture:
  * @content: a #StcontentContent
@@ -0,0 +1,101 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-premultiply.c: Conversion of pixels to premultiplied alpha
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "st-premultiply.h"
+
+/* Rounds c * a / 255 exactly, without a division */
+#define MULT(d,c,a,t) G_STMT_START { t = c * a + 0x80; d = ((t >> 8) + t) >> 8; } G_STMT_END
+
+/**
+ * _st_premultiply_pixels:
+ * @pixels_in: RGB or RGBA pixels, as in a #GdkPixbuf
+ * @rowstride_in: the rowstride of @pixels_in
+ * @n_channels: 3 for RGB, 4 for RGBA
+ * @width: the width of the image
+ * @height: the height of the image
+ * @pixels_out: where to write premultiplied RGBA pixels
+ * @rowstride_out: the rowstride of @pixels_out
+ *
+ * Converts pixels to what textures hold, so that they can be uploaded
+ * without being converted again.
+ */
+void
+_st_premultiply_pixels (const guchar *pixels_in,
+                        int           rowstride_in,
+                        int           n_channels,
+                        int           width,
+                        int           height,
+                        guchar       *pixels_out,
+                        int           rowstride_out)
+{
+  int x, y;
+
+  g_return_if_fail (n_channels == 3 || n_channels == 4);
+
+  for (y = 0; y < height; y++)
+    {
+      const guchar *p = pixels_in + y * rowstride_in;
+      guchar *q = pixels_out + y * rowstride_out;
+
+      if (n_channels == 3)
+        {
+          for (x = 0; x < width; x++)
+            {
+              q[0] = p[0];
+              q[1] = p[1];
+              q[2] = p[2];
+              q[3] = 0xff;
+
+              p += 3;
+              q += 4;
+            }
+        }
+      else
+        {
+          for (x = 0; x < width; x++)
+            {
+              guint a = p[3];
+              guint t1, t2, t3;
+
+              /* Fully opaque and fully transparent pixels are
+               * most of an icon
+               */
+              if (a == 0xff)
+                {
+                  memcpy (q, p, 4);
+                }
+              else if (a == 0)
+                {
+                  memset (q, 0, 4);
+                }
+              else
+                {
+                  MULT (q[0], p[0], a, t1);
+                  MULT (q[1], p[1], a, t2);
+                  MULT (q[2], p[2], a, t3);
+                  q[3] = a;
+                }
+
+              p += 4;
+              q += 4;
+            }
+        }
+    }
+}
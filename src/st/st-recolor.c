@@ -0,0 +1,261 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-recolor.c: Recoloring of symbolic icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Symbolic PNGs, as generated by gtk-encode-symbolic-svg, store in
+ * their red, green and blue channels how much of the success, warning
+ * and error colors each pixel has; the rest is the foreground color.
+ * All symbolic icons are recolored whenever the colors change, so this
+ * is done for several pixels at a time where possible.
+ *
+ * When the three weights of a pixel add up to more than 255, the
+ * foreground weight is negative and the results wrap around. No valid
+ * icon has such pixels, but to stay identical to what was always done,
+ * they are left to the scalar code.
+ */
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "st-recolor.h"
+
+static inline void
+recolor_pixel (const guchar *p,
+               guchar       *q,
+               const guint8  fg[3],
+               const guint8  success[3],
+               const guint8  warning[3],
+               const guint8  error[3],
+               guint8        alpha)
+{
+  guint r, g, b, a;
+  int c1, c2, c3, c4;
+
+  a = p[3];
+  q[3] = a * alpha / 255;
+
+  if (a == 0)
+    {
+      q[0] = 0;
+      q[1] = 0;
+      q[2] = 0;
+      return;
+    }
+
+  c2 = p[0];
+  c3 = p[1];
+  c4 = p[2];
+
+  if (c2 == 0 && c3 == 0 && c4 == 0)
+    {
+      q[0] = fg[0];
+      q[1] = fg[1];
+      q[2] = fg[2];
+      return;
+    }
+
+  c1 = 255 - c2 - c3 - c4;
+
+  r = fg[0] * c1 + success[0] * c2 + warning[0] * c3 + error[0] * c4;
+  g = fg[1] * c1 + success[1] * c2 + warning[1] * c3 + error[1] * c4;
+  b = fg[2] * c1 + success[2] * c2 + warning[2] * c3 + error[2] * c4;
+
+  q[0] = r / 255;
+  q[1] = g / 255;
+  q[2] = b / 255;
+}
+
+#if defined (__SSE2__)
+/* Recolors the two pixels in the 16 bit lanes of @pixels. @colors are
+ * the foreground, success, warning and error colors with 0 for alpha,
+ * and the alpha with 0 for the color channels, so that every channel
+ * is a single sum. For pixels that are transparent or have the
+ * foreground color, that sum is what the scalar code special-cases.
+ */
+static inline __m128i
+recolor_pixels_sse2 (__m128i        pixels,
+                     const __m128i  colors[5],
+                     __m128i       *overflow)
+{
+  const __m128i max = _mm_set1_epi16 (255);
+  __m128i c1, c2, c3, c4, a, mix, sum;
+
+  c2 = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, 0x00), 0x00);
+  c3 = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, 0x55), 0x55);
+  c4 = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, 0xaa), 0xaa);
+  a = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (pixels, 0xff), 0xff);
+
+  mix = _mm_add_epi16 (_mm_add_epi16 (c2, c3), c4);
+  *overflow = _mm_or_si128 (*overflow, _mm_cmpgt_epi16 (mix, max));
+  c1 = _mm_sub_epi16 (max, mix);
+
+  /* At most 255 * 255, so the sums fit into 16 bits */
+  sum = _mm_mullo_epi16 (colors[0], c1);
+  sum = _mm_add_epi16 (sum, _mm_mullo_epi16 (colors[1], c2));
+  sum = _mm_add_epi16 (sum, _mm_mullo_epi16 (colors[2], c3));
+  sum = _mm_add_epi16 (sum, _mm_mullo_epi16 (colors[3], c4));
+  sum = _mm_add_epi16 (sum, _mm_mullo_epi16 (colors[4], a));
+
+  /* x / 255 == (x * 0x8081) >> 23 for all 16 bit x */
+  sum = _mm_srli_epi16 (_mm_mulhi_epu16 (sum, _mm_set1_epi16 ((short) 0x8081)), 7);
+
+  return _mm_andnot_si128 (_mm_cmpeq_epi16 (a, _mm_setzero_si128 ()), sum);
+}
+#elif defined (__ARM_NEON)
+/* x / 255 == (x + 1 + (x >> 8)) >> 8 for x up to 255 * 255 */
+static inline uint8x8_t
+div_255_neon (uint16x8_t x)
+{
+  return vaddhn_u16 (vaddq_u16 (x, vdupq_n_u16 (1)), vshrq_n_u16 (x, 8));
+}
+#endif
+
+static void
+recolor_row (const guchar *src,
+             guchar       *dst,
+             int           width,
+             const guint8  fg[3],
+             const guint8  success[3],
+             const guint8  warning[3],
+             const guint8  error[3],
+             guint8        alpha)
+{
+  int x = 0;
+
+#if defined (__SSE2__)
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i colors[5] = {
+    _mm_setr_epi16 (fg[0], fg[1], fg[2], 0, fg[0], fg[1], fg[2], 0),
+    _mm_setr_epi16 (success[0], success[1], success[2], 0,
+                    success[0], success[1], success[2], 0),
+    _mm_setr_epi16 (warning[0], warning[1], warning[2], 0,
+                    warning[0], warning[1], warning[2], 0),
+    _mm_setr_epi16 (error[0], error[1], error[2], 0,
+                    error[0], error[1], error[2], 0),
+    _mm_setr_epi16 (0, 0, 0, alpha, 0, 0, 0, alpha),
+  };
+
+  for (; x + 4 <= width; x += 4)
+    {
+      __m128i pixels, lo, hi;
+      __m128i overflow = zero;
+      int i;
+
+      pixels = _mm_loadu_si128 ((const __m128i *) (src + 4 * x));
+      lo = recolor_pixels_sse2 (_mm_unpacklo_epi8 (pixels, zero), colors, &overflow);
+      hi = recolor_pixels_sse2 (_mm_unpackhi_epi8 (pixels, zero), colors, &overflow);
+
+      if (G_UNLIKELY (_mm_movemask_epi8 (overflow) != 0))
+        {
+          for (i = 0; i < 4; i++)
+            recolor_pixel (src + 4 * (x + i), dst + 4 * (x + i),
+                           fg, success, warning, error, alpha);
+          continue;
+        }
+
+      _mm_storeu_si128 ((__m128i *) (dst + 4 * x), _mm_packus_epi16 (lo, hi));
+    }
+#elif defined (__ARM_NEON)
+  const uint8x8_t zero = vdup_n_u8 (0);
+  const uint16x8_t max = vdupq_n_u16 (255);
+
+  for (; x + 8 <= width; x += 8)
+    {
+      uint8x8x4_t p = vld4_u8 (src + 4 * x);
+      uint8x8x4_t q;
+      uint16x8_t mix;
+      uint8x8_t c1, transparent;
+      int i;
+
+      mix = vaddw_u8 (vaddl_u8 (p.val[0], p.val[1]), p.val[2]);
+
+      if (G_UNLIKELY (vget_lane_u64 (vreinterpret_u64_u8 (vmovn_u16 (vcgtq_u16 (mix, max))), 0) != 0))
+        {
+          for (i = 0; i < 8; i++)
+            recolor_pixel (src + 4 * (x + i), dst + 4 * (x + i),
+                           fg, success, warning, error, alpha);
+          continue;
+        }
+
+      c1 = vmovn_u16 (vsubq_u16 (max, mix));
+      transparent = vceq_u8 (p.val[3], zero);
+
+      /* At most 255 * 255, so the sums fit into 16 bits; for pixels
+       * that have the foreground color, they are that color
+       */
+      for (i = 0; i < 3; i++)
+        {
+          uint16x8_t sum;
+
+          sum = vmull_u8 (c1, vdup_n_u8 (fg[i]));
+          sum = vmlal_u8 (sum, p.val[0], vdup_n_u8 (success[i]));
+          sum = vmlal_u8 (sum, p.val[1], vdup_n_u8 (warning[i]));
+          sum = vmlal_u8 (sum, p.val[2], vdup_n_u8 (error[i]));
+
+          q.val[i] = vbic_u8 (div_255_neon (sum), transparent);
+        }
+
+      q.val[3] = div_255_neon (vmull_u8 (p.val[3], vdup_n_u8 (alpha)));
+
+      vst4_u8 (dst + 4 * x, q);
+    }
+#endif
+
+  for (; x < width; x++)
+    recolor_pixel (src + 4 * x, dst + 4 * x,
+                   fg, success, warning, error, alpha);
+}
+
+/**
+ * _st_recolor_symbolic_pixels:
+ * @pixels_in: the RGBA pixels of a symbolic PNG
+ * @rowstride_in: the rowstride of @pixels_in
+ * @pixels_out: where to write the recolored RGBA pixels
+ * @rowstride_out: the rowstride of @pixels_out
+ * @width: the width of the icon
+ * @height: the height of the icon
+ * @fg: the RGB foreground color
+ * @success: the RGB success color
+ * @warning: the RGB warning color
+ * @error: the RGB error color
+ * @alpha: the alpha of the foreground color, applied to the whole icon
+ *
+ * Recolors a symbolic icon that has been rendered to a PNG.
+ */
+void
+_st_recolor_symbolic_pixels (const guchar *pixels_in,
+                             int           rowstride_in,
+                             guchar       *pixels_out,
+                             int           rowstride_out,
+                             int           width,
+                             int           height,
+                             const guint8  fg[3],
+                             const guint8  success[3],
+                             const guint8  warning[3],
+                             const guint8  error[3],
+                             guint8        alpha)
+{
+  int y;
+
+  for (y = 0; y < height; y++)
+    recolor_row (pixels_in + y * rowstride_in,
+                 pixels_out + y * rowstride_out,
+                 width, fg, success, warning, error, alpha);
+}
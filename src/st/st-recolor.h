@@ -0,0 +1,37 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-recolor.h: Recoloring of symbolic icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void _st_recolor_symbolic_pixels (const guchar *pixels_in,
+                                  int           rowstride_in,
+                                  guchar       *pixels_out,
+                                  int           rowstride_out,
+                                  int           width,
+                                  int           height,
+                                  const guint8  fg[3],
+                                  const guint8  success[3],
+                                  const guint8  warning[3],
+                                  const guint8  error[3],
+                                  guint8        alpha);
+
+G_END_DECLS
@@ -0,0 +1,331 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-rounded-rect.c: Shader for rounded rectangle backgrounds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Paints the background and borders of a theme node in a single pass,
+ * computing for each fragment its signed distance to the outer and
+ * inner edges of the border. This covers what otherwise needs the
+ * background to be rendered with cairo: corners too large for the
+ * corner textures, gradients, inset box-shadows and borders of
+ * different colors, without a texture that would need to be rendered
+ * again each time the allocation changes.
+ *
+ * Compared to cairo, inner corners are circular even when the borders
+ * next to them differ in width, and inset shadows use the usual
+ * approximation of a blurred rounded rectangle, which is exact along
+ * the edges.
+ */
+
+#include "st-rounded-rect.h"
+
+static const char rounded_rect_declarations[] =
+  "uniform vec2 st_paint_size;\n"
+  "uniform vec4 st_box;\n"
+  "uniform vec4 st_radius;\n"
+  "uniform vec4 st_border_width;\n"
+  "uniform vec4 st_border_color[4];\n"
+  "uniform vec4 st_color;\n"
+  "uniform vec4 st_gradient_end;\n"
+  "uniform int st_gradient_type;\n"
+  "uniform vec4 st_shadow_color;\n"
+  "uniform vec4 st_shadow;\n"
+  "uniform float st_scale;\n"
+  "\n"
+  "/* Signed distance to the edge of @box, with the corner radii\n"
+  " * in @radius, negative inside */\n"
+  "float st_rounded_rect_distance (vec2 p, vec4 box, vec4 radius)\n"
+  "{\n"
+  "  vec2 center = (box.xy + box.zw) * 0.5;\n"
+  "  vec2 half_size = (box.zw - box.xy) * 0.5;\n"
+  "  vec2 q = p - center;\n"
+  "  float r = q.x < 0.0 ? (q.y < 0.0 ? radius.x : radius.w)\n"
+  "                      : (q.y < 0.0 ? radius.y : radius.z);\n"
+  "  vec2 d = abs (q) - half_size + r;\n"
+  "\n"
+  "  return min (max (d.x, d.y), 0.0) + length (max (d, 0.0)) - r;\n"
+  "}\n"
+  "\n"
+  "/* How much of the pixel is inside, antialiased over a device pixel */\n"
+  "float st_coverage (float distance)\n"
+  "{\n"
+  "  return clamp (0.5 - distance * st_scale, 0.0, 1.0);\n"
+  "}\n"
+  "\n"
+  "float st_erf (float x)\n"
+  "{\n"
+  "  float x2 = x * x;\n"
+  "  float e = sqrt (1.0 - exp (-x2 * (1.2732395 + 0.147 * x2) /\n"
+  "                                (1.0 + 0.147 * x2)));\n"
+  "\n"
+  "  return x < 0.0 ? -e : e;\n"
+  "}\n"
+  "\n"
+  "vec4 st_premultiply (vec4 color)\n"
+  "{\n"
+  "  return vec4 (color.rgb * color.a, color.a);\n"
+  "}\n";
+
+static const char rounded_rect_code[] =
+  "vec2 p = cogl_tex_coord_in[0].xy * st_paint_size;\n"
+  "vec2 size = st_box.zw - st_box.xy;\n"
+  "vec2 rp = p - st_box.xy;\n"
+  "vec4 bw = st_border_width;\n"
+  "vec4 inner_box = st_box + vec4 (bw.w, bw.x, -bw.y, -bw.z);\n"
+  "vec4 inner_radius = max (st_radius - 0.5 * vec4 (bw.x + bw.w, bw.x + bw.y,\n"
+  "                                                 bw.z + bw.y, bw.z + bw.w),\n"
+  "                         0.0);\n"
+  "float t = 0.0;\n"
+  "\n"
+  "if (st_gradient_type == 1)\n"
+  "  t = rp.y / size.y;\n"
+  "else if (st_gradient_type == 2)\n"
+  "  t = rp.x / size.x;\n"
+  "else if (st_gradient_type == 3)\n"
+  "  t = 2.0 * length (rp - size * 0.5) / min (size.x, size.y);\n"
+  "\n"
+  "vec4 fill = st_premultiply (mix (st_color, st_gradient_end, clamp (t, 0.0, 1.0)));\n"
+  "\n"
+  "if (st_shadow_color.a > 0.0)\n"
+  "  {\n"
+  "    vec4 hole = inner_box + vec4 (st_shadow.xy + st_shadow.z,\n"
+  "                                  st_shadow.xy - st_shadow.z);\n"
+  "    float shadow = 1.0;\n"
+  "\n"
+  "    if (hole.x < hole.z && hole.y < hole.w)\n"
+  "      {\n"
+  "        float d = st_rounded_rect_distance (p, hole,\n"
+  "                                            max (st_radius - st_shadow.z, 0.0));\n"
+  "        float sigma = st_shadow.w * 0.5;\n"
+  "\n"
+  "        if (sigma > 0.0)\n"
+  "          shadow = 0.5 + 0.5 * st_erf (d / (sigma * 1.4142136));\n"
+  "        else\n"
+  "          shadow = 1.0 - st_coverage (d);\n"
+  "      }\n"
+  "\n"
+  "    fill = st_premultiply (st_shadow_color) * shadow +\n"
+  "           fill * (1.0 - st_shadow_color.a * shadow);\n"
+  "  }\n"
+  "\n"
+  "float outer = st_coverage (st_rounded_rect_distance (p, st_box, st_radius));\n"
+  "float inner = min (st_coverage (st_rounded_rect_distance (p, inner_box, inner_radius)),\n"
+  "                   outer);\n"
+  "\n"
+  "/* The side with the relatively closest edge, which makes the\n"
+  " * borders meet diagonally like in CSS */\n"
+  "vec4 edge = vec4 (rp.y, size.x - rp.x, size.y - rp.y, rp.x) /\n"
+  "            max (bw, vec4 (0.0001));\n"
+  "vec4 border = st_border_color[0];\n"
+  "float closest = edge.x;\n"
+  "\n"
+  "if (edge.y < closest) { closest = edge.y; border = st_border_color[1]; }\n"
+  "if (edge.z < closest) { closest = edge.z; border = st_border_color[2]; }\n"
+  "if (edge.w < closest) { closest = edge.w; border = st_border_color[3]; }\n"
+  "\n"
+  "/* The background extends below the border */\n"
+  "border = st_premultiply (border);\n"
+  "border += fill * (1.0 - border.a);\n"
+  "\n"
+  "cogl_color_out = (fill * inner + border * (outer - inner)) * cogl_color_in;\n";
+
+enum {
+  UNIFORM_PAINT_SIZE,
+  UNIFORM_BOX,
+  UNIFORM_RADIUS,
+  UNIFORM_BORDER_WIDTH,
+  UNIFORM_BORDER_COLOR,
+  UNIFORM_COLOR,
+  UNIFORM_GRADIENT_END,
+  UNIFORM_GRADIENT_TYPE,
+  UNIFORM_SHADOW_COLOR,
+  UNIFORM_SHADOW,
+  UNIFORM_SCALE,
+  N_UNIFORMS
+};
+
+static const char * const uniform_names[N_UNIFORMS] = {
+  "st_paint_size",
+  "st_box",
+  "st_radius",
+  "st_border_width",
+  "st_border_color",
+  "st_color",
+  "st_gradient_end",
+  "st_gradient_type",
+  "st_shadow_color",
+  "st_shadow",
+  "st_scale",
+};
+
+static CoglPipeline *rounded_rect_pipeline_template = NULL;
+static int uniforms[N_UNIFORMS];
+
+static void
+color_to_floats (const CoglColor *color,
+                 float           *values)
+{
+  values[0] = color->red / 255.f;
+  values[1] = color->green / 255.f;
+  values[2] = color->blue / 255.f;
+  values[3] = color->alpha / 255.f;
+}
+
+/**
+ * _st_create_rounded_rect_pipeline:
+ * @cogl_context: a #CoglContext
+ * @rect: what to paint
+ *
+ * Creates a pipeline painting @rect when drawing a rectangle of
+ * @rect's paint size. Its color is multiplied with the result, so it
+ * can be used for the paint opacity.
+ *
+ * Returns: (transfer full): the new pipeline
+ */
+CoglPipeline *
+_st_create_rounded_rect_pipeline (CoglContext         *cogl_context,
+                                  const StRoundedRect *rect)
+{
+  CoglPipeline *pipeline;
+  int i;
+
+  /* Like texture pipelines, all pipelines are copies of a template,
+   * so that Cogl finds the program by looking at the ancestry
+   */
+  if (G_UNLIKELY (rounded_rect_pipeline_template == NULL))
+    {
+      CoglSnippet *snippet;
+
+      rounded_rect_pipeline_template = cogl_pipeline_new (cogl_context);
+
+      /* Only there for the texture coordinates */
+      cogl_pipeline_set_layer_null_texture (rounded_rect_pipeline_template, 0);
+
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                                  rounded_rect_declarations,
+                                  rounded_rect_code);
+      cogl_pipeline_add_snippet (rounded_rect_pipeline_template, snippet);
+      g_object_unref (snippet);
+
+      for (i = 0; i < N_UNIFORMS; i++)
+        uniforms[i] =
+          cogl_pipeline_get_uniform_location (rounded_rect_pipeline_template,
+                                              uniform_names[i]);
+    }
+
+  pipeline = cogl_pipeline_copy (rounded_rect_pipeline_template);
+  _st_rounded_rect_pipeline_set_rect (pipeline, rect);
+
+  return pipeline;
+}
+
+/**
+ * _st_rounded_rect_pipeline_set_rect:
+ * @pipeline: a pipeline created with _st_create_rounded_rect_pipeline()
+ * @rect: what to paint
+ *
+ * Changes what @pipeline paints, which only updates its uniforms.
+ */
+void
+_st_rounded_rect_pipeline_set_rect (CoglPipeline        *pipeline,
+                                    const StRoundedRect *rect)
+{
+  float values[4 * 4];
+  int gradient_type;
+  int i;
+
+  g_return_if_fail (rounded_rect_pipeline_template != NULL);
+
+  values[0] = rect->paint_width;
+  values[1] = rect->paint_height;
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_PAINT_SIZE],
+                                   2, 1, values);
+
+  values[0] = rect->box.x1;
+  values[1] = rect->box.y1;
+  values[2] = rect->box.x2;
+  values[3] = rect->box.y2;
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_BOX],
+                                   4, 1, values);
+
+  for (i = 0; i < 4; i++)
+    values[i] = rect->radius[i];
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_RADIUS],
+                                   4, 1, values);
+
+  for (i = 0; i < 4; i++)
+    values[i] = rect->border_width[i];
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_BORDER_WIDTH],
+                                   4, 1, values);
+
+  for (i = 0; i < 4; i++)
+    color_to_floats (&rect->border_color[i], values + 4 * i);
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_BORDER_COLOR],
+                                   4, 4, values);
+
+  color_to_floats (&rect->color, values);
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_COLOR],
+                                   4, 1, values);
+
+  switch (rect->gradient_type)
+    {
+    case ST_GRADIENT_VERTICAL:
+      gradient_type = 1;
+      break;
+    case ST_GRADIENT_HORIZONTAL:
+      gradient_type = 2;
+      break;
+    case ST_GRADIENT_RADIAL:
+      gradient_type = 3;
+      break;
+    case ST_GRADIENT_NONE:
+    default:
+      gradient_type = 0;
+      break;
+    }
+
+  if (gradient_type != 0)
+    color_to_floats (&rect->gradient_end, values);
+  else
+    color_to_floats (&rect->color, values);
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_GRADIENT_END],
+                                   4, 1, values);
+  cogl_pipeline_set_uniform_1i (pipeline, uniforms[UNIFORM_GRADIENT_TYPE],
+                                gradient_type);
+
+  if (rect->inset_shadow != NULL)
+    {
+      color_to_floats (&rect->inset_shadow->color, values);
+      cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_SHADOW_COLOR],
+                                       4, 1, values);
+
+      values[0] = rect->inset_shadow->xoffset;
+      values[1] = rect->inset_shadow->yoffset;
+      values[2] = rect->inset_shadow->spread;
+      values[3] = rect->inset_shadow->blur;
+    }
+  else
+    {
+      values[0] = values[1] = values[2] = values[3] = 0;
+      cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_SHADOW_COLOR],
+                                       4, 1, values);
+    }
+  cogl_pipeline_set_uniform_float (pipeline, uniforms[UNIFORM_SHADOW],
+                                   4, 1, values);
+
+  cogl_pipeline_set_uniform_1f (pipeline, uniforms[UNIFORM_SCALE],
+                                rect->resource_scale);
+}
@@ -0,0 +1,52 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-rounded-rect.h: Shader for rounded rectangle backgrounds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "st-shadow.h"
+#include "st-theme-node.h"
+
+G_BEGIN_DECLS
+
+typedef struct {
+  /* The size of the painted rectangle, and the border box within it */
+  float paint_width;
+  float paint_height;
+  ClutterActorBox box;
+
+  float radius[4];
+  float border_width[4];
+  CoglColor border_color[4];
+
+  CoglColor color;
+  StGradientType gradient_type;
+  CoglColor gradient_end;
+
+  /* nullable */
+  StShadow *inset_shadow;
+
+  float resource_scale;
+} StRoundedRect;
+
+CoglPipeline *_st_create_rounded_rect_pipeline (CoglContext         *cogl_context,
+                                                const StRoundedRect *rect);
+
+void _st_rounded_rect_pipeline_set_rect (CoglPipeline        *pipeline,
+                                         const StRoundedRect *rect);
+
+G_END_DECLS
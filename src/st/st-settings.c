@@ -52,6 +52,7 @@ enum {
   PROP_MAGNIFIER_ACTIVE,
   PROP_SLOW_DOWN_FACTOR,
   PROP_DISABLE_SHOW_PASSWORD,
+  PROP_SHADER_BACKGROUNDS,
   N_PROPS
 };
 
@@ -74,6 +75,7 @@ struct _StSettings
   gboolean primary_paste;
   gboolean magnifier_active;
   gboolean disable_show_password;
+  gboolean shader_backgrounds;
   gint drag_threshold;
   double slow_down_factor;
   StReducedMotion reduced_motion;
@@ -203,6 +205,29 @@ st_settings_set_slow_down_factor (StSettings *settings,
   g_object_notify_by_pspec (G_OBJECT (settings), props[PROP_SLOW_DOWN_FACTOR]);
 }
 
+gboolean
+st_settings_get_shader_backgrounds (StSettings *settings)
+{
+  g_return_val_if_fail (ST_IS_SETTINGS (settings), FALSE);
+
+  return settings->shader_backgrounds;
+}
+
+void
+st_settings_set_shader_backgrounds (StSettings *settings,
+                                    gboolean    shader_backgrounds)
+{
+  g_return_if_fail (ST_IS_SETTINGS (settings));
+
+  shader_backgrounds = !!shader_backgrounds;
+
+  if (settings->shader_backgrounds == shader_backgrounds)
+    return;
+
+  settings->shader_backgrounds = shader_backgrounds;
+  g_object_notify_by_pspec (G_OBJECT (settings), props[PROP_SHADER_BACKGROUNDS]);
+}
+
 void
 st_settings_inhibit_animations (StSettings *settings)
 {
@@ -258,6 +283,9 @@ st_settings_set_property (GObject      *object,
     case PROP_SLOW_DOWN_FACTOR:
       st_settings_set_slow_down_factor (settings, g_value_get_double (value));
       break;
+    case PROP_SHADER_BACKGROUNDS:
+      st_settings_set_shader_backgrounds (settings, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -309,6 +337,9 @@ st_settings_get_property (GObject    *object,
     case PROP_DISABLE_SHOW_PASSWORD:
       g_value_set_boolean (value, settings->disable_show_password);
       break;
+    case PROP_SHADER_BACKGROUNDS:
+      g_value_set_boolean (value, settings->shader_backgrounds);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -435,6 +466,17 @@ st_settings_class_init (StSettingsClass *klass)
                                                            FALSE,
                                                            ST_PARAM_READABLE);
 
+  /**
+   * StSettings:shader-backgrounds:
+   *
+   * Whether rounded, gradient and multi-colored backgrounds and borders
+   * are drawn with a shader, rather than rendered to a texture with
+   * cairo first.
+   */
+  props[PROP_SHADER_BACKGROUNDS] = g_param_spec_boolean ("shader-backgrounds", NULL, NULL,
+                                                         TRUE,
+                                                         ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (object_class, N_PROPS, props);
 }
 
@@ -576,6 +618,7 @@ st_settings_init (StSettings *settings)
   settings->reduced_motion = g_settings_get_enum (settings->a11y_interface_settings,
                                                   KEY_REDUCED_MOTION);
   settings->slow_down_factor = 1.;
+  settings->shader_backgrounds = TRUE;
   settings->disable_show_password = g_settings_get_boolean (settings->lockdown_settings, KEY_DISABLE_SHOW_PASSWORD);
 }
 
@@ -78,4 +78,8 @@ double st_settings_get_slow_down_factor (StSettings *settings);
 void st_settings_set_slow_down_factor (StSettings *settings,
                                        double      factor);
 
+gboolean st_settings_get_shader_backgrounds (StSettings *settings);
+void st_settings_set_shader_backgrounds (StSettings *settings,
+                                         gboolean    shader_backgrounds);
+
 G_END_DECLS
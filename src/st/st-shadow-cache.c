@@ -0,0 +1,168 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-shadow-cache.c: Shared cache of blurred box-shadow pipelines
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Rendering a box-shadow means painting the silhouette of the node
+ * offscreen and blurring it, which is done for each paint state. Many
+ * widgets share a style and are painted at the same size though (popup
+ * menus, dash items, app grid icons), so keep the resulting pipelines
+ * around and hand out references to them.
+ *
+ * The cache holds a reference on each pipeline; when it grows beyond
+ * MAX_CACHE_SIZE bytes of textures, the least recently used entries
+ * are dropped. Pipelines that are still in use stay alive until their
+ * last user lets go, they just won't be shared anymore.
+ */
+
+#include <string.h>
+
+#include "st-shadow-cache.h"
+
+#define MAX_CACHE_SIZE (16 * 1024 * 1024)
+
+typedef struct {
+  StShadowCacheKey key;
+  CoglPipeline *pipeline;
+  gsize size;
+  GList link;
+} StShadowCacheEntry;
+
+static GHashTable *cache = NULL;
+
+/* Most recently used first */
+static GQueue lru = G_QUEUE_INIT;
+static gsize cache_size = 0;
+
+static guint
+key_hash (gconstpointer data)
+{
+  const guint8 *p = data;
+  const guint8 *end = p + sizeof (StShadowCacheKey);
+  guint hash = 5381;
+
+  for (; p < end; p++)
+    hash = (hash << 5) + hash + *p;
+
+  return hash;
+}
+
+static gboolean
+key_equal (gconstpointer a,
+           gconstpointer b)
+{
+  return memcmp (a, b, sizeof (StShadowCacheKey)) == 0;
+}
+
+static void
+entry_free (StShadowCacheEntry *entry)
+{
+  g_clear_object (&entry->key.color_state);
+  g_clear_object (&entry->key.source);
+  g_clear_object (&entry->pipeline);
+
+  g_free (entry);
+}
+
+static void
+remove_entry (StShadowCacheEntry *entry)
+{
+  g_queue_unlink (&lru, &entry->link);
+  cache_size -= entry->size;
+
+  /* Frees the entry */
+  g_hash_table_remove (cache, &entry->key);
+}
+
+/**
+ * _st_shadow_cache_lookup:
+ * @key: the parameters of the shadow
+ *
+ * Looks up a shadow pipeline previously added with
+ * _st_shadow_cache_insert(). The pipeline is shared, callers must only
+ * change its layer combine constant, like paint states do anyway.
+ *
+ * Returns: (transfer full) (nullable): the pipeline, or %NULL
+ */
+CoglPipeline *
+_st_shadow_cache_lookup (const StShadowCacheKey *key)
+{
+  StShadowCacheEntry *entry;
+
+  if (cache == NULL)
+    return NULL;
+
+  entry = g_hash_table_lookup (cache, key);
+  if (entry == NULL)
+    return NULL;
+
+  g_queue_unlink (&lru, &entry->link);
+  g_queue_push_head_link (&lru, &entry->link);
+
+  return g_object_ref (entry->pipeline);
+}
+
+/**
+ * _st_shadow_cache_insert:
+ * @key: the parameters of the shadow
+ * @pipeline: the shadow pipeline created for @key
+ *
+ * Adds @pipeline to the cache, so that it is returned by future lookups
+ * of @key.
+ */
+void
+_st_shadow_cache_insert (const StShadowCacheKey *key,
+                         CoglPipeline           *pipeline)
+{
+  StShadowCacheEntry *entry;
+  CoglTexture *texture;
+
+  g_return_if_fail (COGL_IS_PIPELINE (pipeline));
+
+  texture = cogl_pipeline_get_layer_texture (pipeline, 0);
+  if (texture == NULL)
+    return;
+
+  if (cache == NULL)
+    cache = g_hash_table_new_full (key_hash, key_equal,
+                                   NULL, (GDestroyNotify) entry_free);
+
+  entry = g_hash_table_lookup (cache, key);
+  if (entry != NULL)
+    remove_entry (entry);
+
+  entry = g_new0 (StShadowCacheEntry, 1);
+  /* Copy the padding as well, for key_hash() */
+  memcpy (&entry->key, key, sizeof (StShadowCacheKey));
+  entry->link.data = entry;
+  entry->pipeline = g_object_ref (pipeline);
+  entry->size = (gsize) cogl_texture_get_width (texture) *
+                cogl_texture_get_height (texture) * 4;
+
+  /* Keep the objects alive, so their addresses in the key stay unique */
+  if (entry->key.color_state != NULL)
+    g_object_ref (entry->key.color_state);
+  if (entry->key.source != NULL)
+    g_object_ref (entry->key.source);
+
+  g_hash_table_insert (cache, &entry->key, entry);
+  g_queue_push_head_link (&lru, &entry->link);
+  cache_size += entry->size;
+
+  /* Always keep the entry we just added */
+  while (cache_size > MAX_CACHE_SIZE && lru.tail != &entry->link)
+    remove_entry (lru.tail->data);
+}
@@ -0,0 +1,55 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-shadow-cache.h: Shared cache of blurred box-shadow pipelines
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+/* Everything the blurred shadow texture depends on. The shadow color,
+ * offset and spread are only applied when painting, so nodes that only
+ * differ in those share a texture. Keys are hashed and compared
+ * bytewise, so they must be zero-initialized.
+ */
+typedef struct {
+  /* What the paint context renders to */
+  ClutterColorState *color_state;
+
+  /* The border image the shadow is cast by, or %NULL for the
+   * silhouette of the background and borders
+   */
+  CoglTexture *source;
+
+  float blur;
+  float resource_scale;
+
+  /* The silhouette, unused with a source texture */
+  float width;
+  float height;
+  guint border_width[4];
+  guint border_radius[4];
+  guint8 background_alpha;
+  guint8 border_alpha[4];
+} StShadowCacheKey;
+
+CoglPipeline *_st_shadow_cache_lookup (const StShadowCacheKey *key);
+void          _st_shadow_cache_insert (const StShadowCacheKey *key,
+                                       CoglPipeline           *pipeline);
+
+G_END_DECLS
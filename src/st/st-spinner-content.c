@@ -67,6 +67,7 @@ struct _StSpinnerContent
 };
 
 static void st_spinner_content_iface_init (ClutterContentInterface *iface);
+static void st_spinner_content_invalidate (ClutterContent *content);
 
 G_DEFINE_FINAL_TYPE_WITH_CODE (StSpinnerContent, st_spinner_content, G_TYPE_OBJECT,
                                G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_CONTENT,
@@ -118,9 +119,20 @@ new_frame_cb (ClutterTimeline *timeline,
               int              elapsed,
               gpointer         user_data)
 {
-  ClutterContent *content = user_data;
+  StSpinnerContent *spinner = user_data;
 
-  clutter_content_invalidate (content);
+  /* Spinning doesn't change the background of the widget around it,
+   * so don't invalidate all of it like clutter_content_invalidate()
+   */
+  if (ST_IS_WIDGET (spinner->actor))
+    {
+      st_spinner_content_invalidate (CLUTTER_CONTENT (spinner));
+      st_widget_queue_redraw_area (ST_WIDGET (spinner->actor), NULL);
+    }
+  else
+    {
+      clutter_content_invalidate (CLUTTER_CONTENT (spinner));
+    }
 }
 
 static void
@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include "st-image-content-private.h"
+#include "st-icon-disk-cache.h"
 #include "st-texture-cache.h"
 #include "st-private.h"
 #include "st-settings.h"
@@ -34,12 +35,29 @@
 #define CACHE_PREFIX_FILE "file:"
 #define CACHE_PREFIX_FILE_FOR_CAIRO "file-for-cairo:"
 
+/* How many images are decoded at the same time, at most */
+#define MAX_RUNNING_LOADS 4
+
+/* Loads waiting to be started are served lane by lane, so that
+ * the images of actors on screen aren't stuck behind those of
+ * actors that aren't, like the other pages of the app grid.
+ */
+typedef enum {
+  LOAD_LANE_VISIBLE,
+  LOAD_LANE_OFFSCREEN,
+
+  N_LOAD_LANES
+} LoadLane;
+
 typedef struct _StTextureCache
 {
   GObject parent;
 
   StIconTheme *icon_theme;
 
+  /* The icon theme the disk cache holds the icons of */
+  char *disk_cache_icon_theme;
+
   /* Things that were loaded with a cache policy != NONE */
   GHashTable *keyed_cache; /* char * -> StImageContent* */
   GHashTable *keyed_surface_cache; /* char * -> cairo_surface_t* */
@@ -53,10 +71,21 @@ typedef struct _StTextureCache
   GHashTable *file_monitors; /* char * -> GFileMonitor * */
 
   GCancellable *cancellable;
+
+  /* AsyncTextureLoadData waiting for one of the running slots */
+  GQueue pending_loads[N_LOAD_LANES];
+  guint n_running_loads;
+  guint max_running_loads;
+
+  guint n_finished_loads;
+  guint n_cancelled_loads;
+  gint64 total_load_time;
+  gint64 max_load_time;
 } StTextureCache;
 
 static void st_texture_cache_dispose (GObject *object);
 static void st_texture_cache_finalize (GObject *object);
+static void texture_load_data_free (gpointer p);
 
 enum
 {
@@ -153,17 +182,74 @@ st_texture_cache_evict_icons (StTextureCache *cache)
     }
 }
 
+static void
+clear_disk_cache_thread (GTask        *task,
+                         gpointer      source,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+  _st_icon_disk_cache_clear ();
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+prune_disk_cache_thread (GTask        *task,
+                         gpointer      source,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+  _st_icon_disk_cache_prune ();
+  g_task_return_boolean (task, TRUE);
+}
+
 static void
 on_icon_theme_changed (StIconTheme    *icon_theme,
                        StTextureCache *self)
 {
+  g_autoptr (GTask) task = NULL;
+  const char *theme_name;
+
   st_texture_cache_evict_icons (self);
+
+  theme_name = st_settings_get_gtk_icon_theme (st_settings_get ());
+
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_source_tag (task, on_icon_theme_changed);
+
+  /* The icons that were rendered for the previous theme are mostly
+   * not going to be used again. Icons that were merely installed or
+   * updated get new entries, as those depend on the modification time
+   * of the files, and the old ones are pruned eventually.
+   */
+  if (g_strcmp0 (theme_name, self->disk_cache_icon_theme) != 0)
+    {
+      g_free (self->disk_cache_icon_theme);
+      self->disk_cache_icon_theme = g_strdup (theme_name);
+
+      g_task_run_in_thread (task, clear_disk_cache_thread);
+    }
+  else
+    {
+      g_task_run_in_thread (task, prune_disk_cache_thread);
+    }
+
   g_signal_emit (self, signals[ICON_THEME_CHANGED], 0);
 }
 
 static void
 st_texture_cache_init (StTextureCache *self)
 {
+  g_autoptr (GTask) task = NULL;
+  int i;
+
+  self->disk_cache_icon_theme =
+    g_strdup (st_settings_get_gtk_icon_theme (st_settings_get ()));
+
+  /* Entries of icons that were updated since the last session */
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_source_tag (task, st_texture_cache_init);
+  g_task_run_in_thread (task, prune_disk_cache_thread);
+
   self->icon_theme = st_icon_theme_new ();
   st_icon_theme_add_resource_path (self->icon_theme,
                                    "/org/gnome/shell/icons");
@@ -184,15 +270,33 @@ st_texture_cache_init (StTextureCache *self)
                                                g_object_unref, g_object_unref);
 
   self->cancellable = g_cancellable_new ();
+
+  for (i = 0; i < N_LOAD_LANES; i++)
+    g_queue_init (&self->pending_loads[i]);
+  self->max_running_loads = MIN (g_get_num_processors (), MAX_RUNNING_LOADS);
 }
 
 static void
 st_texture_cache_dispose (GObject *object)
 {
   StTextureCache *self = (StTextureCache*)object;
+  int i;
 
   g_cancellable_cancel (self->cancellable);
 
+  for (i = 0; i < N_LOAD_LANES; i++)
+    {
+      GList *link;
+
+      while ((link = g_queue_pop_head_link (&self->pending_loads[i])) != NULL)
+        {
+          gpointer data = link->data;
+
+          link->data = NULL;
+          texture_load_data_free (data);
+        }
+    }
+
   g_clear_object (&self->icon_theme);
   g_clear_object (&self->cancellable);
 
@@ -208,6 +312,10 @@ st_texture_cache_dispose (GObject *object)
 static void
 st_texture_cache_finalize (GObject *object)
 {
+  StTextureCache *self = (StTextureCache *) object;
+
+  g_free (self->disk_cache_icon_theme);
+
   G_OBJECT_CLASS (st_texture_cache_parent_class)->finalize (object);
 }
 
@@ -294,17 +402,39 @@ typedef struct {
   StIconColors *colors;
   GFile *file;
   CoglContext *cogl_context;
+
+  /* For icons, their entry in the disk cache, and the pixels
+   * found there
+   */
+  char *disk_cache_entry;
+  GBytes *disk_cache_pixels;
+  int disk_cache_width;
+  int disk_cache_height;
+  int disk_cache_rowstride;
+
+  /* Our link in cache->pending_loads, with data set while queued */
+  GList link;
+  LoadLane lane;
+  gint64 queue_time;
 } AsyncTextureLoadData;
 
 static void
 texture_load_data_free (gpointer p)
 {
   AsyncTextureLoadData *data = p;
+  GSList *l;
+
+  g_assert (data->link.data == NULL);
 
   g_clear_object (&data->icon_info);
   g_clear_pointer (&data->colors, st_icon_colors_unref);
   g_clear_object (&data->file);
   g_clear_pointer (&data->key, g_free);
+  g_clear_pointer (&data->disk_cache_entry, g_free);
+  g_clear_pointer (&data->disk_cache_pixels, g_bytes_unref);
+
+  for (l = data->actors; l; l = l->next)
+    g_signal_handlers_disconnect_by_data (l->data, data);
 
   if (data->actors)
     g_slist_free_full (data->actors, (GDestroyNotify) g_object_unref);
@@ -480,22 +610,22 @@ load_pixbuf_async_finish (StTextureCache *cache, GAsyncResult *result, GError **
   return g_task_propagate_pointer (G_TASK (result), error);
 }
 
-static ClutterContent *
-pixbuf_to_st_content_image (GdkPixbuf    *pixbuf,
-                            CoglContext  *context,
-                            int           width,
-                            int           height,
-                            int           paint_scale,
-                            float         resource_scale,
-                            GError      **error)
+/* Creates an image without data for @pixel_width x @pixel_height
+ * pixels, with the preferred size @width x @height, either of which
+ * can be -1 to keep the aspect ratio
+ */
+static StImageContent *
+create_st_content_image (int   pixel_width,
+                         int   pixel_height,
+                         int   width,
+                         int   height,
+                         int   paint_scale,
+                         float resource_scale)
 {
-  ClutterContent *image;
-  g_autoptr(GError) local_error = NULL;
-
   float native_width, native_height;
 
-  native_width = ceilf (gdk_pixbuf_get_width (pixbuf) / resource_scale);
-  native_height = ceilf (gdk_pixbuf_get_height (pixbuf) / resource_scale);
+  native_width = ceilf (pixel_width / resource_scale);
+  native_height = ceilf (pixel_height / resource_scale);
 
   if (width < 0 && height < 0)
     {
@@ -518,24 +648,71 @@ pixbuf_to_st_content_image (GdkPixbuf    *pixbuf,
       height *= paint_scale;
     }
 
-  image = st_image_content_new_with_preferred_size (width, height);
-  st_image_content_set_data (ST_IMAGE_CONTENT (image),
-                             context,
-                             gdk_pixbuf_get_pixels (pixbuf),
-                             gdk_pixbuf_get_has_alpha (pixbuf) ?
-                               COGL_PIXEL_FORMAT_RGBA_8888 : COGL_PIXEL_FORMAT_RGB_888,
-                             gdk_pixbuf_get_width (pixbuf),
-                             gdk_pixbuf_get_height (pixbuf),
-                             gdk_pixbuf_get_rowstride (pixbuf),
-                             &local_error);
-
-  if (local_error)
-    {
-      g_propagate_error (error, g_steal_pointer (&local_error));
-      g_clear_object (&image);
-    }
+  return ST_IMAGE_CONTENT (st_image_content_new_with_preferred_size (width, height));
+}
+
+static ClutterContent *
+pixels_to_st_content_image (const guint8    *pixels,
+                            CoglPixelFormat  format,
+                            int              pixel_width,
+                            int              pixel_height,
+                            int              rowstride,
+                            CoglContext     *context,
+                            int              width,
+                            int              height,
+                            int              paint_scale,
+                            float            resource_scale,
+                            GError         **error)
+{
+  g_autoptr (StImageContent) image = NULL;
+
+  image = create_st_content_image (pixel_width, pixel_height,
+                                   width, height,
+                                   paint_scale, resource_scale);
+
+  if (!st_image_content_set_data (image,
+                                  context,
+                                  pixels,
+                                  format,
+                                  pixel_width,
+                                  pixel_height,
+                                  rowstride,
+                                  error))
+    return NULL;
+
+  return CLUTTER_CONTENT (g_steal_pointer (&image));
+}
+
+static ClutterContent *
+pixbuf_to_st_content_image (GdkPixbuf    *pixbuf,
+                            CoglContext  *context,
+                            int           width,
+                            int           height,
+                            int           paint_scale,
+                            float         resource_scale,
+                            GError      **error)
+{
+  g_autoptr (StImageContent) image = NULL;
 
-  return image;
+  image = create_st_content_image (gdk_pixbuf_get_width (pixbuf),
+                                   gdk_pixbuf_get_height (pixbuf),
+                                   width, height,
+                                   paint_scale, resource_scale);
+
+  /* Icons from icon-theme.cache point right into the mapped cache,
+   * so this reads them from there straight into the texture upload
+   */
+  if (!st_image_content_set_unpremultiplied_data (image,
+                                                  context,
+                                                  gdk_pixbuf_read_pixels (pixbuf),
+                                                  gdk_pixbuf_get_has_alpha (pixbuf),
+                                                  gdk_pixbuf_get_width (pixbuf),
+                                                  gdk_pixbuf_get_height (pixbuf),
+                                                  gdk_pixbuf_get_rowstride (pixbuf),
+                                                  error))
+    return NULL;
+
+  return CLUTTER_CONTENT (g_steal_pointer (&image));
 }
 
 static void
@@ -674,6 +851,92 @@ pixbuf_to_cairo_surface (GdkPixbuf *pixbuf)
   return surface;
 }
 
+static void dispatch_texture_loads (StTextureCache *cache);
+
+/* Creates the image from the pixels found in the disk cache, if any,
+ * or from @pixbuf
+ */
+static ClutterContent *
+create_content_image (AsyncTextureLoadData  *data,
+                      GdkPixbuf             *pixbuf,
+                      GError               **error)
+{
+  if (data->disk_cache_pixels != NULL)
+    return pixels_to_st_content_image (g_bytes_get_data (data->disk_cache_pixels, NULL),
+                                       ST_ICON_DISK_CACHE_FORMAT,
+                                       data->disk_cache_width,
+                                       data->disk_cache_height,
+                                       data->disk_cache_rowstride,
+                                       data->cogl_context,
+                                       data->width, data->height,
+                                       data->paint_scale,
+                                       data->resource_scale,
+                                       error);
+
+  return pixbuf_to_st_content_image (pixbuf,
+                                     data->cogl_context,
+                                     data->width, data->height,
+                                     data->paint_scale,
+                                     data->resource_scale,
+                                     error);
+}
+
+typedef struct {
+  char *entry;
+  GdkPixbuf *pixbuf;
+} DiskCacheStoreData;
+
+static void
+disk_cache_store_data_free (DiskCacheStoreData *data)
+{
+  g_free (data->entry);
+  g_clear_object (&data->pixbuf);
+  g_free (data);
+}
+
+static void
+store_in_disk_cache_thread (GTask        *task,
+                            gpointer      source,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+  DiskCacheStoreData *data = task_data;
+
+  _st_icon_disk_cache_store (data->entry, data->pixbuf);
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+on_stored_in_disk_cache (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+  DiskCacheStoreData *data = g_task_get_task_data (G_TASK (result));
+
+  /* Icon pixbufs are proxies that put their icon info back into the
+   * LRU of the icon theme when released, which can't happen in a
+   * thread; the task itself may be released in one
+   */
+  g_clear_object (&data->pixbuf);
+}
+
+static void
+store_in_disk_cache (const char *entry,
+                     GdkPixbuf  *pixbuf)
+{
+  g_autoptr (GTask) task = NULL;
+  DiskCacheStoreData *data;
+
+  data = g_new0 (DiskCacheStoreData, 1);
+  data->entry = g_strdup (entry);
+  data->pixbuf = g_object_ref (pixbuf);
+
+  task = g_task_new (NULL, NULL, on_stored_in_disk_cache, NULL);
+  g_task_set_source_tag (task, store_in_disk_cache);
+  g_task_set_task_data (task, data, (GDestroyNotify) disk_cache_store_data_free);
+  g_task_run_in_thread (task, store_in_disk_cache_thread);
+}
+
 static void
 finish_texture_load (AsyncTextureLoadData *data,
                      GdkPixbuf            *pixbuf)
@@ -681,14 +944,24 @@ finish_texture_load (AsyncTextureLoadData *data,
   g_autoptr(ClutterContent) image = NULL;
   GSList *iter;
   StTextureCache *cache;
+  gint64 load_time;
 
   cache = data->cache;
 
   g_hash_table_remove (cache->outstanding_requests, data->key);
 
-  if (pixbuf == NULL)
+  load_time = g_get_monotonic_time () - data->queue_time;
+  cache->total_load_time += load_time;
+  cache->max_load_time = MAX (cache->max_load_time, load_time);
+  cache->n_finished_loads++;
+  cache->n_running_loads--;
+
+  if (pixbuf == NULL && data->disk_cache_pixels == NULL)
     goto out;
 
+  if (pixbuf != NULL && data->disk_cache_entry != NULL)
+    store_in_disk_cache (data->disk_cache_entry, pixbuf);
+
   if (data->policy != ST_TEXTURE_CACHE_POLICY_NONE)
     {
       gpointer orig_key = NULL, value = NULL;
@@ -698,12 +971,7 @@ finish_texture_load (AsyncTextureLoadData *data,
         {
           g_autoptr (GError) error = NULL;
 
-          image = pixbuf_to_st_content_image (pixbuf,
-                                              data->cogl_context,
-                                              data->width, data->height,
-                                              data->paint_scale,
-                                              data->resource_scale,
-                                              &error);
+          image = create_content_image (data, pixbuf, &error);
           if (!image)
             {
               g_warning ("Failed to load pixbuf into a content: %s",
@@ -723,12 +991,7 @@ finish_texture_load (AsyncTextureLoadData *data,
     {
       g_autoptr (GError) error = NULL;
 
-      image = pixbuf_to_st_content_image (pixbuf,
-                                          data->cogl_context,
-                                          data->width, data->height,
-                                          data->paint_scale,
-                                          data->resource_scale,
-                                          &error);
+      image = create_content_image (data, pixbuf, &error);
       if (!image)
         {
           g_warning ("Failed to load pixbuf into a content: %s",
@@ -749,6 +1012,8 @@ finish_texture_load (AsyncTextureLoadData *data,
 
 out:
   texture_load_data_free (data);
+
+  dispatch_texture_loads (cache);
 }
 
 static void
@@ -785,38 +1050,203 @@ on_pixbuf_loaded (GObject      *source,
 }
 
 static void
-load_texture_async (StTextureCache       *cache,
+start_icon_load (StTextureCache       *cache,
+                 AsyncTextureLoadData *data)
+{
+  StIconColors *colors = data->colors;
+  if (colors)
+    {
+      st_icon_info_load_symbolic_async (data->icon_info,
+                                        data->colors,
+                                        cache->cancellable,
+                                        on_symbolic_icon_loaded, data);
+    }
+  else
+    {
+      st_icon_info_load_icon_async (data->icon_info,
+                                    cache->cancellable,
+                                    on_icon_loaded, data);
+    }
+}
+
+static void
+lookup_disk_cache_thread (GTask        *task,
+                          gpointer      source,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+  AsyncTextureLoadData *data = task_data;
+  int scale = ceilf (data->paint_scale * data->resource_scale);
+  gboolean is_symbolic;
+
+  /* These only look at the file name, which never changes */
+  is_symbolic = st_icon_info_is_symbolic (data->icon_info);
+  data->disk_cache_entry =
+    _st_icon_disk_cache_get_entry (st_icon_info_get_filename (data->icon_info),
+                                   data->width, scale,
+                                   is_symbolic ? data->colors : NULL);
+
+  if (data->disk_cache_entry != NULL)
+    data->disk_cache_pixels =
+      _st_icon_disk_cache_lookup (data->disk_cache_entry,
+                                  &data->disk_cache_width,
+                                  &data->disk_cache_height,
+                                  &data->disk_cache_rowstride);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+on_disk_cache_looked_up (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+  AsyncTextureLoadData *data = user_data;
+
+  if (data->disk_cache_pixels != NULL)
+    finish_texture_load (data, NULL);
+  else
+    start_icon_load (ST_TEXTURE_CACHE (source), data);
+}
+
+static void
+start_texture_load (StTextureCache       *cache,
                     AsyncTextureLoadData *data)
 {
   if (data->file)
     {
       GTask *task = g_task_new (cache, NULL, on_pixbuf_loaded, data);
-      g_task_set_source_tag (task, load_texture_async);
+      g_task_set_source_tag (task, start_texture_load);
       g_task_set_task_data (task, data, NULL);
       g_task_run_in_thread (task, load_pixbuf_thread);
       g_object_unref (task);
     }
   else if (data->icon_info)
     {
-      StIconColors *colors = data->colors;
-      if (colors)
+      /* Rendered icons are looked up on disk first, which needs
+       * a stat() and so happens in a thread as well
+       */
+      if (st_icon_info_get_filename (data->icon_info) != NULL)
         {
-          st_icon_info_load_symbolic_async (data->icon_info,
-                                            data->colors,
-                                            cache->cancellable,
-                                            on_symbolic_icon_loaded, data);
+          GTask *task = g_task_new (cache, NULL, on_disk_cache_looked_up, data);
+          g_task_set_source_tag (task, start_texture_load);
+          g_task_set_task_data (task, data, NULL);
+          g_task_run_in_thread (task, lookup_disk_cache_thread);
+          g_object_unref (task);
         }
       else
         {
-          st_icon_info_load_icon_async (data->icon_info,
-                                        cache->cancellable,
-                                        on_icon_loaded, data);
+          start_icon_load (cache, data);
         }
     }
   else
     g_assert_not_reached ();
 }
 
+static void
+dispatch_texture_loads (StTextureCache *cache)
+{
+  int i;
+
+  for (i = 0; i < N_LOAD_LANES; i++)
+    {
+      while (cache->n_running_loads < cache->max_running_loads &&
+             !g_queue_is_empty (&cache->pending_loads[i]))
+        {
+          GList *link = g_queue_pop_head_link (&cache->pending_loads[i]);
+          AsyncTextureLoadData *data = link->data;
+
+          link->data = NULL;
+          cache->n_running_loads++;
+          start_texture_load (cache, data);
+        }
+    }
+}
+
+static LoadLane
+get_texture_load_lane (AsyncTextureLoadData *data)
+{
+  GSList *l;
+
+  for (l = data->actors; l; l = l->next)
+    {
+      if (clutter_actor_is_mapped (l->data))
+        return LOAD_LANE_VISIBLE;
+    }
+
+  return LOAD_LANE_OFFSCREEN;
+}
+
+static void
+update_texture_load_lane (AsyncTextureLoadData *data)
+{
+  StTextureCache *cache = data->cache;
+  LoadLane lane;
+
+  /* Only loads that haven't started yet can change lanes */
+  if (data->link.data == NULL)
+    return;
+
+  lane = get_texture_load_lane (data);
+  if (lane == data->lane)
+    return;
+
+  g_queue_unlink (&cache->pending_loads[data->lane], &data->link);
+  g_queue_push_tail_link (&cache->pending_loads[lane], &data->link);
+  data->lane = lane;
+}
+
+static void
+queue_texture_load (StTextureCache       *cache,
+                    AsyncTextureLoadData *data)
+{
+  data->queue_time = g_get_monotonic_time ();
+  data->lane = get_texture_load_lane (data);
+  data->link.data = data;
+  g_queue_push_tail_link (&cache->pending_loads[data->lane], &data->link);
+
+  dispatch_texture_loads (cache);
+}
+
+static void
+on_request_actor_mapped (ClutterActor         *actor,
+                         GParamSpec           *pspec,
+                         AsyncTextureLoadData *data)
+{
+  update_texture_load_lane (data);
+}
+
+static void
+on_request_actor_destroy (ClutterActor         *actor,
+                          AsyncTextureLoadData *data)
+{
+  StTextureCache *cache = data->cache;
+
+  g_signal_handlers_disconnect_by_data (actor, data);
+  data->actors = g_slist_remove (data->actors, actor);
+  g_object_unref (actor);
+
+  /* A load that is running is kept, it may still end up in the cache */
+  if (data->link.data == NULL)
+    return;
+
+  if (data->actors != NULL)
+    {
+      update_texture_load_lane (data);
+      return;
+    }
+
+  /* Nobody is waiting for this one anymore */
+  g_queue_unlink (&cache->pending_loads[data->lane], &data->link);
+  data->link.data = NULL;
+
+  if (g_hash_table_lookup (cache->outstanding_requests, data->key) == data)
+    g_hash_table_remove (cache->outstanding_requests, data->key);
+
+  cache->n_cancelled_loads++;
+  texture_load_data_free (data);
+}
+
 /**
  * st_texture_cache_load: (skip)
  * @cache: A #StTextureCache
@@ -907,6 +1337,11 @@ ensure_request (StTextureCache        *cache,
   /* Regardless of whether there was a pending request, prepend our texture here. */
   (*request)->actors = g_slist_prepend ((*request)->actors, g_object_ref (actor));
 
+  g_signal_connect (actor, "notify::mapped",
+                    G_CALLBACK (on_request_actor_mapped), *request);
+  g_signal_connect (actor, "destroy",
+                    G_CALLBACK (on_request_actor_destroy), *request);
+
   return had_pending;
 }
 
@@ -1046,7 +1481,7 @@ st_texture_cache_load_gicon (StTextureCache    *cache,
       request->resource_scale = resource_scale;
       request->cogl_context = clutter_backend_get_cogl_context (clutter_backend);
 
-      load_texture_async (cache, request);
+      queue_texture_load (cache, request);
     }
 
   return actor;
@@ -1192,7 +1627,7 @@ st_texture_cache_load_file_async (StTextureCache *cache,
       request->resource_scale = resource_scale;
       request->cogl_context = clutter_backend_get_cogl_context (clutter_backend);
 
-      load_texture_async (cache, request);
+      queue_texture_load (cache, request);
     }
 
   ensure_monitor_for_file (cache, file);
@@ -1407,3 +1842,65 @@ st_texture_cache_rescan_icon_theme (StTextureCache *cache)
 {
   return st_icon_theme_rescan_if_needed (cache->icon_theme);
 }
+
+/**
+ * st_texture_cache_get_icon_theme:
+ * @cache: A #StTextureCache
+ *
+ * Gets the icon theme @cache loads themed icons from.
+ *
+ * Returns: (transfer none): the #StIconTheme of @cache
+ */
+StIconTheme *
+st_texture_cache_get_icon_theme (StTextureCache *cache)
+{
+  g_return_val_if_fail (ST_IS_TEXTURE_CACHE (cache), NULL);
+
+  return cache->icon_theme;
+}
+
+/**
+ * st_texture_cache_get_load_statistics:
+ * @cache: A #StTextureCache
+ * @n_pending: (out) (optional): return location for the number of
+ *   loads waiting to be started
+ * @n_finished: (out) (optional): return location for the number of
+ *   loads that finished
+ * @n_cancelled: (out) (optional): return location for the number of
+ *   loads dropped before starting, because their actors were destroyed
+ * @average_latency: (out) (optional): return location for the average
+ *   time from requesting an image to loading it, in microseconds
+ * @max_latency: (out) (optional): return location for the longest
+ *   such time, in microseconds
+ *
+ * Gets statistics about the asynchronous loads of @cache.
+ */
+void
+st_texture_cache_get_load_statistics (StTextureCache *cache,
+                                      guint          *n_pending,
+                                      guint          *n_finished,
+                                      guint          *n_cancelled,
+                                      gint64         *average_latency,
+                                      gint64         *max_latency)
+{
+  int i;
+
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+
+  if (n_pending)
+    {
+      *n_pending = 0;
+      for (i = 0; i < N_LOAD_LANES; i++)
+        *n_pending += cache->pending_loads[i].length;
+    }
+  if (n_finished)
+    *n_finished = cache->n_finished_loads;
+  if (n_cancelled)
+    *n_cancelled = cache->n_cancelled_loads;
+  if (average_latency)
+    *average_latency = cache->n_finished_loads > 0
+                     ? cache->total_load_time / cache->n_finished_loads
+                     : 0;
+  if (max_latency)
+    *max_latency = cache->max_load_time;
+}
@@ -29,6 +29,7 @@
 #include <clutter/clutter.h>
 #include <gio/gio.h>
 
+#include <st/st-icon-theme.h>
 #include <st/st-types.h>
 #include <st/st-theme-node.h>
 #include <st/st-widget.h>
@@ -90,3 +91,12 @@ CoglTexture * st_texture_cache_load (StTextureCache       *cache,
                                      GError              **error);
 
 gboolean st_texture_cache_rescan_icon_theme (StTextureCache *cache);
+
+StIconTheme *st_texture_cache_get_icon_theme (StTextureCache *cache);
+
+void st_texture_cache_get_load_statistics (StTextureCache *cache,
+                                           guint          *n_pending,
+                                           guint          *n_finished,
+                                           guint          *n_cancelled,
+                                           gint64         *average_latency,
+                                           gint64         *max_latency);
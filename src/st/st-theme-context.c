@@ -21,6 +21,7 @@
 
 #include <config.h>
 
+#include "st-background-cache.h"
 #include "st-private.h"
 #include "st-settings.h"
 #include "st-texture-cache.h"
@@ -111,6 +112,9 @@ st_theme_context_finalize (GObject *object)
   g_signal_handlers_disconnect_by_func (st_settings_get (),
                                         (gpointer) update_accent_colors,
                                         context);
+  g_signal_handlers_disconnect_by_func (st_settings_get (),
+                                        (gpointer) st_theme_context_changed,
+                                        context);
   g_signal_handlers_disconnect_by_func (st_texture_cache_get_default (),
                                        (gpointer) on_icon_theme_changed,
                                        context);
@@ -182,6 +186,11 @@ st_theme_context_init (StThemeContext *context)
                             "notify::accent-color",
                             G_CALLBACK (update_accent_colors),
                             context);
+  /* Nodes need to be painted again with the other code path */
+  g_signal_connect_swapped (st_settings_get (),
+                            "notify::shader-backgrounds",
+                            G_CALLBACK (st_theme_context_changed),
+                            context);
   g_signal_connect (st_texture_cache_get_default (),
                     "icon-theme-changed",
                     G_CALLBACK (on_icon_theme_changed),
@@ -318,6 +327,9 @@ st_theme_context_changed (StThemeContext *context)
   context->root_node = NULL;
   old_nodes = g_hash_table_steal_all_keys (context->nodes);
 
+  /* Nodes painting like the old ones are unlikely to come back */
+  _st_background_cache_clear ();
+
   g_signal_emit (context, signals[CHANGED], 0);
 
   /* Force a run of the dispose() vfuncs of theme nodes so that their references
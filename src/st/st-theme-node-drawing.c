@@ -28,9 +28,15 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include "st-background-cache.h"
+#include "st-corner-atlas.h"
 #include "st-shadow.h"
+#include "st-rounded-rect.h"
+#include "st-settings.h"
+#include "st-shadow-cache.h"
 #include "st-private.h"
 #include "st-theme-private.h"
 #include "st-theme-context.h"
@@ -41,21 +47,6 @@
  * Rounded corners
  ****/
 
-typedef struct {
-  /*
-   * The context here is not really part of the corner
-   * definition per se, but is used for the drawing part.
-  */
-  CoglContext   *cogl_context;
-  CoglColor      color;
-  CoglColor      border_color_1;
-  CoglColor      border_color_2;
-  guint          radius;
-  guint          border_width_1;
-  guint          border_width_2;
-  float          resource_scale;
-} StCornerSpec;
-
 typedef enum {
   ST_PAINT_BORDERS_MODE_COLOR,
   ST_PAINT_BORDERS_MODE_SILHOUETTE
@@ -77,11 +68,11 @@ elliptical_arc (cairo_t *cr,
   cairo_restore (cr);
 }
 
-static CoglTexture *
-create_corner_pipeline (StCornerSpec *corner)
+static guint8 *
+render_corner (StCornerSpec *corner,
+               guint        *size_out,
+               guint        *rowstride_out)
 {
-  GError *error = NULL;
-  CoglTexture *texture;
   cairo_t *cr;
   cairo_surface_t *surface;
   guint rowstride;
@@ -183,43 +174,10 @@ create_corner_pipeline (StCornerSpec *corner)
 
   cairo_surface_destroy (surface);
 
-  texture = cogl_texture_2d_new_from_data (corner->cogl_context, size, size,
-                                           COGL_PIXEL_FORMAT_ARGB32_NATIVE,
-                                           rowstride,
-                                           data,
-                                           &error);
-
-  if (error)
-    {
-      g_warning ("Failed to allocate texture: %s", error->message);
-      g_error_free (error);
-    }
-
-  g_free (data);
-
-  return texture;
-}
-
-static char *
-corner_to_string (StCornerSpec *corner)
-{
-  return g_strdup_printf ("st-theme-node-corner:%02x%02x%02x%02x,%02x%02x%02x%02x,%02x%02x%02x%02x,%u,%u,%u,%.4f",
-                          corner->color.red, corner->color.blue, corner->color.green, corner->color.alpha,
-                          corner->border_color_1.red, corner->border_color_1.green, corner->border_color_1.blue, corner->border_color_1.alpha,
-                          corner->border_color_2.red, corner->border_color_2.green, corner->border_color_2.blue, corner->border_color_2.alpha,
-                          corner->radius,
-                          corner->border_width_1,
-                          corner->border_width_2,
-                          corner->resource_scale);
-}
+  *size_out = size;
+  *rowstride_out = rowstride;
 
-static CoglTexture *
-load_corner (StTextureCache  *cache,
-             const char      *key,
-             void            *datap,
-             GError         **error)
-{
-  return create_corner_pipeline ((StCornerSpec *) datap);
+  return data;
 }
 
 /* To match the CSS specification, we want the border to look like it was
@@ -292,37 +250,37 @@ st_theme_node_reduce_border_radius (StThemeNode  *node,
   scale = 1.0;
 
   /* top */
-  sum = node->border_radius[ST_CORNER_TOPLEFT]
-    + node->border_radius[ST_CORNER_TOPRIGHT];
+  sum = node->borders->border_radius[ST_CORNER_TOPLEFT]
+    + node->borders->border_radius[ST_CORNER_TOPRIGHT];
 
   if (sum > 0)
     scale = MIN (width / sum, scale);
 
   /* right */
-  sum = node->border_radius[ST_CORNER_TOPRIGHT]
-    + node->border_radius[ST_CORNER_BOTTOMRIGHT];
+  sum = node->borders->border_radius[ST_CORNER_TOPRIGHT]
+    + node->borders->border_radius[ST_CORNER_BOTTOMRIGHT];
 
   if (sum > 0)
     scale = MIN (height / sum, scale);
 
   /* bottom */
-  sum = node->border_radius[ST_CORNER_BOTTOMLEFT]
-    + node->border_radius[ST_CORNER_BOTTOMRIGHT];
+  sum = node->borders->border_radius[ST_CORNER_BOTTOMLEFT]
+    + node->borders->border_radius[ST_CORNER_BOTTOMRIGHT];
 
   if (sum > 0)
     scale = MIN (width / sum, scale);
 
   /* left */
-  sum = node->border_radius[ST_CORNER_BOTTOMLEFT]
-    + node->border_radius[ST_CORNER_TOPLEFT];
+  sum = node->borders->border_radius[ST_CORNER_BOTTOMLEFT]
+    + node->borders->border_radius[ST_CORNER_TOPLEFT];
 
   if (sum > 0)
     scale = MIN (height / sum, scale);
 
-  corners[ST_CORNER_TOPLEFT]     = node->border_radius[ST_CORNER_TOPLEFT]     * scale;
-  corners[ST_CORNER_TOPRIGHT]    = node->border_radius[ST_CORNER_TOPRIGHT]    * scale;
-  corners[ST_CORNER_BOTTOMLEFT]  = node->border_radius[ST_CORNER_BOTTOMLEFT]  * scale;
-  corners[ST_CORNER_BOTTOMRIGHT] = node->border_radius[ST_CORNER_BOTTOMRIGHT] * scale;
+  corners[ST_CORNER_TOPLEFT]     = node->borders->border_radius[ST_CORNER_TOPLEFT]     * scale;
+  corners[ST_CORNER_TOPRIGHT]    = node->borders->border_radius[ST_CORNER_TOPRIGHT]    * scale;
+  corners[ST_CORNER_BOTTOMLEFT]  = node->borders->border_radius[ST_CORNER_BOTTOMLEFT]  * scale;
+  corners[ST_CORNER_BOTTOMRIGHT] = node->borders->border_radius[ST_CORNER_BOTTOMRIGHT] * scale;
 }
 
 static void
@@ -335,27 +293,27 @@ st_theme_node_get_corner_border_widths (StThemeNode *node,
     {
       case ST_CORNER_TOPLEFT:
         if (border_width_1)
-            *border_width_1 = node->border_width[ST_SIDE_TOP];
+            *border_width_1 = node->geometry->border_width[ST_SIDE_TOP];
         if (border_width_2)
-            *border_width_2 = node->border_width[ST_SIDE_LEFT];
+            *border_width_2 = node->geometry->border_width[ST_SIDE_LEFT];
         break;
       case ST_CORNER_TOPRIGHT:
         if (border_width_1)
-            *border_width_1 = node->border_width[ST_SIDE_TOP];
+            *border_width_1 = node->geometry->border_width[ST_SIDE_TOP];
         if (border_width_2)
-            *border_width_2 = node->border_width[ST_SIDE_RIGHT];
+            *border_width_2 = node->geometry->border_width[ST_SIDE_RIGHT];
         break;
       case ST_CORNER_BOTTOMRIGHT:
         if (border_width_1)
-            *border_width_1 = node->border_width[ST_SIDE_BOTTOM];
+            *border_width_1 = node->geometry->border_width[ST_SIDE_BOTTOM];
         if (border_width_2)
-            *border_width_2 = node->border_width[ST_SIDE_RIGHT];
+            *border_width_2 = node->geometry->border_width[ST_SIDE_RIGHT];
         break;
       case ST_CORNER_BOTTOMLEFT:
         if (border_width_1)
-            *border_width_1 = node->border_width[ST_SIDE_BOTTOM];
+            *border_width_1 = node->geometry->border_width[ST_SIDE_BOTTOM];
         if (border_width_2)
-            *border_width_2 = node->border_width[ST_SIDE_LEFT];
+            *border_width_2 = node->geometry->border_width[ST_SIDE_LEFT];
         break;
       default:
         g_assert_not_reached();
@@ -363,7 +321,7 @@ st_theme_node_get_corner_border_widths (StThemeNode *node,
     }
 }
 
-static CoglPipeline *
+static const StCornerAtlasRegion *
 st_theme_node_lookup_corner (StThemeNode    *node,
                              CoglContext    *cogl_context,
                              float           width,
@@ -371,22 +329,19 @@ st_theme_node_lookup_corner (StThemeNode    *node,
                              float           resource_scale,
                              StCorner        corner_id)
 {
-  CoglTexture *texture = NULL;
-  CoglPipeline *pipeline = NULL;
-  char *key;
-  StTextureCache *cache;
+  const StCornerAtlasRegion *region;
   StCornerSpec corner;
   guint radius[4];
 
-  cache = st_texture_cache_get_default ();
-
   st_theme_node_reduce_border_radius (node, width, height, radius);
 
   if (radius[corner_id] == 0)
     return NULL;
 
+  /* The spec is the atlas key, so clear the padding */
+  memset (&corner, 0, sizeof (StCornerSpec));
   corner.radius = radius[corner_id];
-  corner.color = node->background_color;
+  corner.color = node->background->color;
   corner.resource_scale = resource_scale;
   corner.cogl_context = cogl_context;
   st_theme_node_get_corner_border_widths (node, corner_id,
@@ -396,20 +351,20 @@ st_theme_node_lookup_corner (StThemeNode    *node,
   switch (corner_id)
     {
       case ST_CORNER_TOPLEFT:
-        over (&node->border_color[ST_SIDE_TOP], &corner.color, &corner.border_color_1);
-        over (&node->border_color[ST_SIDE_LEFT], &corner.color, &corner.border_color_2);
+        over (&node->borders->border_color[ST_SIDE_TOP], &corner.color, &corner.border_color_1);
+        over (&node->borders->border_color[ST_SIDE_LEFT], &corner.color, &corner.border_color_2);
         break;
       case ST_CORNER_TOPRIGHT:
-        over (&node->border_color[ST_SIDE_TOP], &corner.color, &corner.border_color_1);
-        over (&node->border_color[ST_SIDE_RIGHT], &corner.color, &corner.border_color_2);
+        over (&node->borders->border_color[ST_SIDE_TOP], &corner.color, &corner.border_color_1);
+        over (&node->borders->border_color[ST_SIDE_RIGHT], &corner.color, &corner.border_color_2);
         break;
       case ST_CORNER_BOTTOMRIGHT:
-        over (&node->border_color[ST_SIDE_BOTTOM], &corner.color, &corner.border_color_1);
-        over (&node->border_color[ST_SIDE_RIGHT], &corner.color, &corner.border_color_2);
+        over (&node->borders->border_color[ST_SIDE_BOTTOM], &corner.color, &corner.border_color_1);
+        over (&node->borders->border_color[ST_SIDE_RIGHT], &corner.color, &corner.border_color_2);
         break;
       case ST_CORNER_BOTTOMLEFT:
-        over (&node->border_color[ST_SIDE_BOTTOM], &corner.color, &corner.border_color_1);
-        over (&node->border_color[ST_SIDE_LEFT], &corner.color, &corner.border_color_2);
+        over (&node->borders->border_color[ST_SIDE_BOTTOM], &corner.color, &corner.border_color_1);
+        over (&node->borders->border_color[ST_SIDE_LEFT], &corner.color, &corner.border_color_2);
         break;
       default:
         g_assert_not_reached();
@@ -426,18 +381,18 @@ st_theme_node_lookup_corner (StThemeNode    *node,
         corner.color = (CoglColor) {0, 0, 0, 255};
     }
 
-  key = corner_to_string (&corner);
-  texture = st_texture_cache_load (cache, key, ST_TEXTURE_CACHE_POLICY_FOREVER, load_corner, &corner, NULL);
+  region = _st_corner_atlas_lookup (&corner);
 
-  if (texture)
+  if (region == NULL)
     {
-      pipeline = _st_create_texture_pipeline (texture);
-      g_object_unref (texture);
-    }
+      g_autofree guint8 *data = NULL;
+      guint size, rowstride;
 
-  g_free (key);
+      data = render_corner (&corner, &size, &rowstride);
+      region = _st_corner_atlas_insert (&corner, size, rowstride, data);
+    }
 
-  return pipeline;
+  return region;
 }
 
 static void
@@ -452,7 +407,7 @@ get_background_scale (StThemeNode *node,
   *scale_w = -1.0;
   *scale_h = -1.0;
 
-  switch (node->background_size)
+  switch (node->background->size)
     {
       case ST_BACKGROUND_SIZE_AUTO:
         *scale_w = 1.0f;
@@ -466,14 +421,14 @@ get_background_scale (StThemeNode *node,
                         painting_area_height / background_image_height);
         break;
       case ST_BACKGROUND_SIZE_FIXED:
-        if (node->background_size_w > -1)
+        if (node->background->size_w > -1)
           {
-            *scale_w = node->background_size_w / background_image_width;
-            if (node->background_size_h > -1)
-              *scale_h = node->background_size_h / background_image_height;
+            *scale_w = node->background->size_w / background_image_width;
+            if (node->background->size_h > -1)
+              *scale_h = node->background->size_h / background_image_height;
           }
-        else if (node->background_size_h > -1)
-          *scale_w = node->background_size_h / background_image_height;
+        else if (node->background->size_h > -1)
+          *scale_w = node->background->size_h / background_image_height;
         break;
       default:
         g_assert_not_reached();
@@ -493,10 +448,10 @@ get_background_coordinates (StThemeNode *node,
                             gdouble     *y)
 {
   /* honor the specified position if any */
-  if (node->background_position_set)
+  if (node->background->position_set)
     {
-      *x = node->background_position_x;
-      *y = node->background_position_y;
+      *x = node->background->position_x;
+      *y = node->background->position_y;
     }
   else
     {
@@ -544,7 +499,7 @@ get_background_position (StThemeNode             *self,
                               background_image_width, background_image_height,
                               &x1, &y1);
 
-  if (self->background_repeat)
+  if (self->background->repeat)
     {
       gdouble width = allocation->x2 - allocation->x1 + x1;
       gdouble height = allocation->y2 - allocation->y1 + y1;
@@ -583,22 +538,22 @@ get_arbitrary_border_color (StThemeNode   *node,
 static gboolean
 st_theme_node_has_visible_outline (StThemeNode *node)
 {
-  if (node->background_color.alpha > 0)
+  if (node->background->color.alpha > 0)
     return TRUE;
 
-  if (node->background_gradient_end.alpha > 0)
+  if (node->background->gradient_end.alpha > 0)
     return TRUE;
 
-  if (node->border_radius[ST_CORNER_TOPLEFT] > 0 ||
-      node->border_radius[ST_CORNER_TOPRIGHT] > 0 ||
-      node->border_radius[ST_CORNER_BOTTOMLEFT] > 0 ||
-      node->border_radius[ST_CORNER_BOTTOMRIGHT] > 0)
+  if (node->borders->border_radius[ST_CORNER_TOPLEFT] > 0 ||
+      node->borders->border_radius[ST_CORNER_TOPRIGHT] > 0 ||
+      node->borders->border_radius[ST_CORNER_BOTTOMLEFT] > 0 ||
+      node->borders->border_radius[ST_CORNER_BOTTOMRIGHT] > 0)
     return TRUE;
 
-  if (node->border_width[ST_SIDE_TOP] > 0 ||
-      node->border_width[ST_SIDE_LEFT] > 0 ||
-      node->border_width[ST_SIDE_RIGHT] > 0 ||
-      node->border_width[ST_SIDE_BOTTOM] > 0)
+  if (node->geometry->border_width[ST_SIDE_TOP] > 0 ||
+      node->geometry->border_width[ST_SIDE_LEFT] > 0 ||
+      node->geometry->border_width[ST_SIDE_RIGHT] > 0 ||
+      node->geometry->border_width[ST_SIDE_BOTTOM] > 0)
     return TRUE;
 
   return FALSE;
@@ -611,12 +566,12 @@ create_cairo_pattern_of_background_gradient (StThemeNode *node,
 {
   cairo_pattern_t *pattern;
 
-  g_return_val_if_fail (node->background_gradient_type != ST_GRADIENT_NONE,
+  g_return_val_if_fail (node->background->gradient_type != ST_GRADIENT_NONE,
                         NULL);
 
-  if (node->background_gradient_type == ST_GRADIENT_VERTICAL)
+  if (node->background->gradient_type == ST_GRADIENT_VERTICAL)
     pattern = cairo_pattern_create_linear (0, 0, 0, height);
-  else if (node->background_gradient_type == ST_GRADIENT_HORIZONTAL)
+  else if (node->background->gradient_type == ST_GRADIENT_HORIZONTAL)
     pattern = cairo_pattern_create_linear (0, 0, width, 0);
   else
     {
@@ -628,15 +583,15 @@ create_cairo_pattern_of_background_gradient (StThemeNode *node,
     }
 
   cairo_pattern_add_color_stop_rgba (pattern, 0,
-                                     node->background_color.red / 255.,
-                                     node->background_color.green / 255.,
-                                     node->background_color.blue / 255.,
-                                     node->background_color.alpha / 255.);
+                                     node->background->color.red / 255.,
+                                     node->background->color.green / 255.,
+                                     node->background->color.blue / 255.,
+                                     node->background->color.alpha / 255.);
   cairo_pattern_add_color_stop_rgba (pattern, 1,
-                                     node->background_gradient_end.red / 255.,
-                                     node->background_gradient_end.green / 255.,
-                                     node->background_gradient_end.blue / 255.,
-                                     node->background_gradient_end.alpha / 255.);
+                                     node->background->gradient_end.red / 255.,
+                                     node->background->gradient_end.green / 255.,
+                                     node->background->gradient_end.blue / 255.,
+                                     node->background->gradient_end.alpha / 255.);
   return pattern;
 }
 
@@ -707,7 +662,7 @@ create_cairo_pattern_of_background_image (StThemeNode *node,
                               &x, &y);
   cairo_matrix_translate (&matrix, -x, -y);
 
-  if (node->background_repeat)
+  if (node->background->repeat)
     cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
 
   /* If it's opaque, fills up the entire allocated
@@ -715,7 +670,7 @@ create_cairo_pattern_of_background_image (StThemeNode *node,
    */
   if (content != CAIRO_CONTENT_COLOR_ALPHA)
     {
-      if (node->background_repeat ||
+      if (node->background->repeat ||
           (x >= 0 &&
            y >= 0 &&
            background_image_width - x >= width &&
@@ -1156,7 +1111,7 @@ st_theme_node_prerender_background (StThemeNode *node,
   /* Note we don't support translucent background images on top
    * of gradients. It's strictly either/or.
    */
-  if (node->background_gradient_type != ST_GRADIENT_NONE)
+  if (node->background->gradient_type != ST_GRADIENT_NONE)
     {
       pattern = create_cairo_pattern_of_background_gradient (node, width, height);
       draw_solid_background = FALSE;
@@ -1166,8 +1121,8 @@ st_theme_node_prerender_background (StThemeNode *node,
        * what's actually under the gradient and not whatever is
        * left over from filling the border, etc.
        */
-      if (node->background_color.alpha < 255 ||
-          node->background_gradient_end.alpha < 255)
+      if (node->background->color.alpha < 255 ||
+          node->background->gradient_end.alpha < 255)
         background_is_translucent = TRUE;
       else
         background_is_translucent = FALSE;
@@ -1352,10 +1307,10 @@ st_theme_node_prerender_background (StThemeNode *node,
       cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
 
       cairo_set_source_rgba (cr,
-                             node->background_color.red / 255.,
-                             node->background_color.green / 255.,
-                             node->background_color.blue / 255.,
-                             node->background_color.alpha / 255.);
+                             node->background->color.red / 255.,
+                             node->background->color.green / 255.,
+                             node->background->color.blue / 255.,
+                             node->background->color.alpha / 255.);
       cairo_fill_preserve (cr);
       cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
     }
@@ -1422,37 +1377,245 @@ st_theme_node_prerender_background (StThemeNode *node,
   return texture;
 }
 
+/* Describes the background and borders of @node for drawing them
+ * with a shader, see st-rounded-rect.c
+ */
+static void
+st_theme_node_init_rounded_rect (StThemeNode   *node,
+                                 float          width,
+                                 float          height,
+                                 float          resource_scale,
+                                 StRoundedRect *rect)
+{
+  StShadow *box_shadow_spec;
+  ClutterActorBox actor_box;
+  ClutterActorBox paint_box;
+  guint border_radius[4];
+  int i;
+
+  memset (rect, 0, sizeof (StRoundedRect));
+
+  actor_box.x1 = 0;
+  actor_box.y1 = 0;
+  actor_box.x2 = width;
+  actor_box.y2 = height;
+
+  st_theme_node_get_background_paint_box (node, &actor_box, &paint_box);
+
+  rect->paint_width = paint_box.x2 - paint_box.x1;
+  rect->paint_height = paint_box.y2 - paint_box.y1;
+  rect->box.x1 = actor_box.x1 - paint_box.x1;
+  rect->box.y1 = actor_box.y1 - paint_box.y1;
+  rect->box.x2 = actor_box.x2 - paint_box.x1;
+  rect->box.y2 = actor_box.y2 - paint_box.y1;
+
+  st_theme_node_reduce_border_radius (node, width, height, border_radius);
+
+  for (i = 0; i < 4; i++)
+    {
+      rect->radius[i] = border_radius[i];
+      rect->border_width[i] = st_theme_node_get_border_width (node, i);
+      rect->border_color[i] = node->borders->border_color[i];
+    }
+
+  rect->color = node->background->color;
+  rect->gradient_type = node->background->gradient_type;
+  rect->gradient_end = node->background->gradient_end;
+
+  box_shadow_spec = st_theme_node_get_box_shadow (node);
+  if (box_shadow_spec && box_shadow_spec->inset)
+    rect->inset_shadow = box_shadow_spec;
+
+  rect->resource_scale = resource_scale;
+}
+
+static CoglPipeline *
+st_theme_node_create_rounded_rect_pipeline (StThemeNode *node,
+                                            CoglContext *cogl_context,
+                                            float        width,
+                                            float        height,
+                                            float        resource_scale)
+{
+  StRoundedRect rect;
+
+  st_theme_node_init_rounded_rect (node, width, height, resource_scale, &rect);
+
+  return _st_create_rounded_rect_pipeline (cogl_context, &rect);
+}
+
+/* Whether everything @node paints is drawn by the rounded rectangle
+ * shader
+ */
+static gboolean
+st_theme_node_paints_rounded_rect (StThemeNode *node)
+{
+  StShadow *box_shadow_spec;
+
+  if (st_theme_node_get_background_image (node) != NULL ||
+      st_theme_node_get_border_image (node) != NULL ||
+      st_theme_node_get_background_image_shadow (node) != NULL ||
+      st_theme_node_get_outline_width (node) > 0)
+    return FALSE;
+
+  box_shadow_spec = st_theme_node_get_box_shadow (node);
+  if (box_shadow_spec && !box_shadow_spec->inset)
+    return FALSE;
+
+  return TRUE;
+}
+
+/**
+ * _st_theme_node_can_interpolate:
+ * @node: a #StThemeNode
+ * @other: a different #StThemeNode
+ *
+ * Checks whether a transition between @node and @other can be painted
+ * by interpolating their background and border properties with
+ * _st_theme_node_interpolate_rounded_rect(), rather than by cross-fading
+ * between the two.
+ *
+ * Returns: %TRUE if @node and @other can be interpolated
+ */
+gboolean
+_st_theme_node_can_interpolate (StThemeNode *node,
+                                StThemeNode *other)
+{
+  StShadow *shadow, *other_shadow;
+
+  _st_theme_node_ensure_background (node);
+  _st_theme_node_ensure_background (other);
+
+  if (node->background->gradient_type != other->background->gradient_type)
+    return FALSE;
+
+  if (!st_theme_node_paints_rounded_rect (node) ||
+      !st_theme_node_paints_rounded_rect (other))
+    return FALSE;
+
+  shadow = st_theme_node_get_box_shadow (node);
+  other_shadow = st_theme_node_get_box_shadow (other);
+
+  if ((shadow == NULL) != (other_shadow == NULL))
+    return FALSE;
+
+  if (shadow != NULL && !st_shadow_equal (shadow, other_shadow))
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+interpolate_color (const CoglColor *from,
+                   const CoglColor *to,
+                   double           progress,
+                   CoglColor       *result)
+{
+  CoglColor color = { 0, 0, 0, 0 };
+  double alpha;
+
+  /* In premultiplied space, like a cross-fade */
+  alpha = from->alpha + (to->alpha - from->alpha) * progress;
+
+  if (alpha > 0)
+    {
+#define INTERPOLATE(c) \
+  CLAMP ((from->c * from->alpha + \
+          (to->c * to->alpha - from->c * from->alpha) * progress) / alpha, \
+         0, 255)
+
+      color.red = INTERPOLATE (red);
+      color.green = INTERPOLATE (green);
+      color.blue = INTERPOLATE (blue);
+      color.alpha = CLAMP (alpha, 0, 255);
+
+#undef INTERPOLATE
+    }
+
+  *result = color;
+}
+
+/**
+ * _st_theme_node_interpolate_rounded_rect:
+ * @node: the #StThemeNode transitioned from
+ * @other: the #StThemeNode transitioned to
+ * @progress: the progress of the transition, from 0 to 1
+ * @width: the width of the allocation
+ * @height: the height of the allocation
+ * @resource_scale: the resource scale
+ * @rect: (out caller-allocates): return location for the interpolated
+ *   background and borders
+ *
+ * Computes the background and borders of a node halfway between
+ * @node and @other, which must be interpolatable as told by
+ * _st_theme_node_can_interpolate().
+ */
+void
+_st_theme_node_interpolate_rounded_rect (StThemeNode   *node,
+                                         StThemeNode   *other,
+                                         double         progress,
+                                         float          width,
+                                         float          height,
+                                         float          resource_scale,
+                                         StRoundedRect *rect)
+{
+  StRoundedRect other_rect;
+  int i;
+
+  st_theme_node_init_rounded_rect (node, width, height, resource_scale, rect);
+  st_theme_node_init_rounded_rect (other, width, height, resource_scale,
+                                   &other_rect);
+
+  for (i = 0; i < 4; i++)
+    {
+      rect->radius[i] += (other_rect.radius[i] - rect->radius[i]) * progress;
+      rect->border_width[i] +=
+        (other_rect.border_width[i] - rect->border_width[i]) * progress;
+      interpolate_color (&rect->border_color[i], &other_rect.border_color[i],
+                         progress, &rect->border_color[i]);
+    }
+
+  interpolate_color (&rect->color, &other_rect.color,
+                     progress, &rect->color);
+  interpolate_color (&rect->gradient_end, &other_rect.gradient_end,
+                     progress, &rect->gradient_end);
+}
+
 static void
 st_theme_node_maybe_prerender_background (StThemeNodePaintState *state,
                                           StThemeNode           *node,
                                           CoglContext           *cogl_context,
                                           float                  width,
                                           float                  height,
-                                          float                  resource_scale)
+                                          float                  resource_scale,
+                                          gboolean               share)
 {
   gboolean has_border;
   gboolean has_border_radius;
   gboolean has_inset_box_shadow;
   gboolean has_large_corners;
+  gboolean has_mixed_border_colors;
+  gboolean use_shader;
+  const StCornerAtlasRegion *solid_region;
   StShadow *box_shadow_spec;
   StCorner corner_id;
+  int i;
 
   box_shadow_spec = st_theme_node_get_box_shadow (node);
 
   has_inset_box_shadow = box_shadow_spec && box_shadow_spec->inset;
 
-  if (node->border_width[ST_SIDE_TOP] > 0 ||
-      node->border_width[ST_SIDE_LEFT] > 0 ||
-      node->border_width[ST_SIDE_RIGHT] > 0 ||
-      node->border_width[ST_SIDE_BOTTOM] > 0)
+  if (node->geometry->border_width[ST_SIDE_TOP] > 0 ||
+      node->geometry->border_width[ST_SIDE_LEFT] > 0 ||
+      node->geometry->border_width[ST_SIDE_RIGHT] > 0 ||
+      node->geometry->border_width[ST_SIDE_BOTTOM] > 0)
     has_border = TRUE;
   else
     has_border = FALSE;
 
-  if (node->border_radius[ST_CORNER_TOPLEFT] > 0 ||
-      node->border_radius[ST_CORNER_TOPRIGHT] > 0 ||
-      node->border_radius[ST_CORNER_BOTTOMLEFT] > 0 ||
-      node->border_radius[ST_CORNER_BOTTOMRIGHT] > 0)
+  if (node->borders->border_radius[ST_CORNER_TOPLEFT] > 0 ||
+      node->borders->border_radius[ST_CORNER_TOPRIGHT] > 0 ||
+      node->borders->border_radius[ST_CORNER_BOTTOMLEFT] > 0 ||
+      node->borders->border_radius[ST_CORNER_BOTTOMRIGHT] > 0)
     has_border_radius = TRUE;
   else
     has_border_radius = FALSE;
@@ -1478,25 +1641,86 @@ st_theme_node_maybe_prerender_background (StThemeNodePaintState *state,
     }
   }
 
+  has_mixed_border_colors = FALSE;
+
+  for (i = 1; i < 4 && has_border; i++)
+    {
+      if (!cogl_color_equal (&node->borders->border_color[i],
+                             &node->borders->border_color[0]))
+        {
+          has_mixed_border_colors = TRUE;
+          break;
+        }
+    }
+
+  /* The shader draws everything but images */
+  use_shader = st_settings_get_shader_backgrounds (st_settings_get ()) &&
+               st_theme_node_get_background_image (node) == NULL &&
+               st_theme_node_get_border_image (node) == NULL;
+
   for (corner_id = 0; corner_id < 4; corner_id++)
     g_clear_object (&state->corner_pipeline[corner_id]);
 
-  state->corner_pipeline[ST_CORNER_TOPLEFT] =
-    st_theme_node_lookup_corner (node, cogl_context,
-                                 width, height, resource_scale,
-                                 ST_CORNER_TOPLEFT);
-  state->corner_pipeline[ST_CORNER_TOPRIGHT] =
-    st_theme_node_lookup_corner (node, cogl_context,
-                                 width, height, resource_scale,
-                                 ST_CORNER_TOPRIGHT);
-  state->corner_pipeline[ST_CORNER_BOTTOMRIGHT] =
-    st_theme_node_lookup_corner (node, cogl_context,
-                                 width, height, resource_scale,
-                                 ST_CORNER_BOTTOMRIGHT);
-  state->corner_pipeline[ST_CORNER_BOTTOMLEFT] =
-    st_theme_node_lookup_corner (node, cogl_context,
-                                 width, height, resource_scale,
-                                 ST_CORNER_BOTTOMLEFT);
+  if (use_shader &&
+      ((node->background->gradient_type != ST_GRADIENT_NONE)
+       || (has_inset_box_shadow && (has_border || node->background->color.alpha > 0))
+       || has_mixed_border_colors
+       || has_large_corners))
+    {
+      state->prerendered_pipeline =
+        st_theme_node_create_rounded_rect_pipeline (node, cogl_context,
+                                                    width, height,
+                                                    resource_scale);
+      return;
+    }
+
+  /* Corners on the same atlas page share a pipeline, so that they
+   * can be painted together
+   */
+  solid_region = NULL;
+
+  for (corner_id = 0; corner_id < 4; corner_id++)
+    {
+      const StCornerAtlasRegion *region;
+      StCorner other_id;
+
+      region = st_theme_node_lookup_corner (node, cogl_context,
+                                            width, height, resource_scale,
+                                            corner_id);
+      if (region == NULL)
+        continue;
+
+      state->corner_coords[corner_id][0] = region->x1;
+      state->corner_coords[corner_id][1] = region->y1;
+      state->corner_coords[corner_id][2] = region->x2;
+      state->corner_coords[corner_id][3] = region->y2;
+
+      /* Solid parts are drawn with the page of the first corner */
+      if (solid_region == NULL)
+        solid_region = region;
+
+      for (other_id = 0; other_id < corner_id; other_id++)
+        {
+          CoglPipeline *other = state->corner_pipeline[other_id];
+
+          if (other != NULL &&
+              cogl_pipeline_get_layer_texture (other, 0) == region->texture)
+            {
+              state->corner_pipeline[corner_id] = g_object_ref (other);
+              break;
+            }
+        }
+
+      if (state->corner_pipeline[corner_id] == NULL)
+        state->corner_pipeline[corner_id] =
+          _st_create_texture_pipeline (region->texture);
+    }
+
+  if (solid_region != NULL)
+    {
+      state->solid_coords[0] = solid_region->solid_x;
+      state->solid_coords[1] = solid_region->solid_y;
+    }
 
   /* Use cairo to prerender the node if there is a gradient, or
    * background image with borders and/or rounded corners,
@@ -1507,19 +1731,40 @@ st_theme_node_maybe_prerender_background (StThemeNodePaintState *state,
    * background image won't overlap with the node borders,
    * then we could use cogl for that case.
    */
-  if ((node->background_gradient_type != ST_GRADIENT_NONE)
-      || (has_inset_box_shadow && (has_border || node->background_color.alpha > 0))
+  if ((node->background->gradient_type != ST_GRADIENT_NONE)
+      || (has_inset_box_shadow && (has_border || node->background->color.alpha > 0))
       || (st_theme_node_get_background_image (node) && (has_border || has_border_radius))
       || has_large_corners)
     {
+      /* Widgets sharing a style are often the same size as well */
+      state->prerendered_pipeline = _st_background_cache_lookup (node,
+                                                                 width, height,
+                                                                 resource_scale);
+      if (state->prerendered_pipeline != NULL)
+        {
+          CoglTexture *texture;
+
+          texture = cogl_pipeline_get_layer_texture (state->prerendered_pipeline, 0);
+          state->prerendered_texture = g_object_ref (texture);
+          return;
+        }
+
       state->prerendered_texture = st_theme_node_prerender_background (node, cogl_context,
                                                                        width, height,
                                                                        resource_scale);
 
       if (state->prerendered_texture)
-        state->prerendered_pipeline = _st_create_texture_pipeline (state->prerendered_texture);
+        {
+          state->prerendered_pipeline = _st_create_texture_pipeline (state->prerendered_texture);
+
+          if (share)
+            _st_background_cache_insert (node, width, height, resource_scale,
+                                         state->prerendered_pipeline);
+        }
       else
-        state->prerendered_pipeline = NULL;
+        {
+          state->prerendered_pipeline = NULL;
+        }
     }
 }
 
@@ -1601,7 +1846,7 @@ st_theme_node_load_background_image (StThemeNode         *node,
 
       node->background_pipeline = _st_create_texture_pipeline (node->background_texture);
 
-      if (node->background_repeat)
+      if (node->background->repeat)
         cogl_pipeline_set_layer_wrap_mode (node->background_pipeline, 0,
                                            COGL_PIPELINE_WRAP_MODE_REPEAT);
 
@@ -1649,6 +1894,56 @@ static void st_theme_node_prerender_shadow (StThemeNodePaintState *state,
                                             CoglContext           *cogl_context,
                                             ClutterPaintContext   *paint_context);
 
+static void
+init_shadow_cache_key (StShadowCacheKey      *key,
+                       StThemeNodePaintState *state,
+                       ClutterPaintContext   *paint_context,
+                       CoglTexture           *source)
+{
+  StThemeNode *node = state->node;
+  int i;
+
+  memset (key, 0, sizeof (StShadowCacheKey));
+
+  key->color_state = clutter_paint_context_get_color_state (paint_context);
+  key->source = source;
+  key->blur = node->box_shadow->blur;
+  key->resource_scale = state->resource_scale;
+
+  if (source != NULL)
+    return;
+
+  /* The silhouette is only painted with full opacity, and the shadow
+   * pipeline saturates its alpha, so only the shape matters
+   */
+  key->width = state->box_shadow_width;
+  key->height = state->box_shadow_height;
+  st_theme_node_reduce_border_radius (node, key->width, key->height,
+                                      key->border_radius);
+
+  for (i = 0; i < 4; i++)
+    {
+      key->border_width[i] = node->geometry->border_width[i];
+      key->border_alpha[i] = node->borders->border_color[i].alpha;
+    }
+
+  key->background_alpha = node->background->color.alpha;
+}
+
+/* The silhouette only has the shape of plain colored backgrounds;
+ * gradients and images can be translucent or shaped, so their shadow
+ * is cast by the prerendered background at the size of the allocation
+ */
+static gboolean
+st_theme_node_casts_background_shadow (StThemeNodePaintState *state,
+                                       StThemeNode           *node)
+{
+  return node->border_slices_texture == NULL &&
+         state->prerendered_texture != NULL &&
+         (node->background->gradient_type != ST_GRADIENT_NONE ||
+          st_theme_node_get_background_image (node) != NULL);
+}
+
 static void
 st_theme_node_render_resources (StThemeNodePaintState *state,
                                 StThemeNode           *node,
@@ -1676,29 +1971,59 @@ st_theme_node_render_resources (StThemeNodePaintState *state,
 
   _st_theme_node_ensure_background (node);
   _st_theme_node_ensure_geometry (node);
+  _st_theme_node_ensure_borders (node);
 
   box_shadow_spec = st_theme_node_get_box_shadow (node);
   has_inset_box_shadow = box_shadow_spec && box_shadow_spec->inset;
 
   st_theme_node_maybe_prerender_background (state, node, cogl_context,
-                                            width, height, resource_scale);
+                                            width, height, resource_scale,
+                                            TRUE);
 
   if (box_shadow_spec && !has_inset_box_shadow)
     {
+      StShadowCacheKey key;
+
       st_theme_node_compute_maximum_borders (state);
 
+      /* Shadows of border images and of the silhouette can be shared,
+       * the prerendered background is specific to this paint state
+       */
       if (st_theme_node_load_border_image (node, cogl_context, resource_scale))
-        state->box_shadow_pipeline = _st_create_shadow_pipeline (box_shadow_spec,
-                                                                 paint_context,
-                                                                 node->border_slices_texture,
-                                                                 state->resource_scale);
-      else if (state->prerendered_texture != NULL)
-        state->box_shadow_pipeline = _st_create_shadow_pipeline (box_shadow_spec,
-                                                                 paint_context,
-                                                                 state->prerendered_texture,
-                                                                 state->resource_scale);
+        {
+          init_shadow_cache_key (&key, state, paint_context,
+                                 node->border_slices_texture);
+          state->box_shadow_pipeline = _st_shadow_cache_lookup (&key);
+
+          if (state->box_shadow_pipeline == NULL)
+            {
+              state->box_shadow_pipeline = _st_create_shadow_pipeline (box_shadow_spec,
+                                                                       paint_context,
+                                                                       node->border_slices_texture,
+                                                                       state->resource_scale);
+              if (state->box_shadow_pipeline != NULL)
+                _st_shadow_cache_insert (&key, state->box_shadow_pipeline);
+            }
+        }
+      else if (st_theme_node_casts_background_shadow (state, node))
+        {
+          state->box_shadow_pipeline = _st_create_shadow_pipeline (box_shadow_spec,
+                                                                   paint_context,
+                                                                   state->prerendered_texture,
+                                                                   state->resource_scale);
+        }
       else
-        st_theme_node_prerender_shadow (state, cogl_context, paint_context);
+        {
+          init_shadow_cache_key (&key, state, paint_context, NULL);
+          state->box_shadow_pipeline = _st_shadow_cache_lookup (&key);
+
+          if (state->box_shadow_pipeline == NULL)
+            {
+              st_theme_node_prerender_shadow (state, cogl_context, paint_context);
+              if (state->box_shadow_pipeline != NULL)
+                _st_shadow_cache_insert (&key, state->box_shadow_pipeline);
+            }
+        }
     }
 
   /* If we don't have cached textures yet, check whether we can cache
@@ -1724,43 +2049,46 @@ st_theme_node_update_resources (StThemeNodePaintState *state,
                                 float                  height,
                                 float                  resource_scale)
 {
-  gboolean had_box_shadow = FALSE;
-  StShadow *box_shadow_spec;
+  gboolean had_background_shadow = FALSE;
 
   g_return_if_fail (width > 0 && height > 0);
 
-  /* Free handles we can't reuse */
-  g_clear_object (&state->prerendered_texture);
-
-  if (state->prerendered_pipeline != NULL)
+  /* Free handles we can't reuse; only a box-shadow cast by the
+   * prerendered background depends on the allocation */
+  if (state->box_shadow_pipeline != NULL &&
+      st_theme_node_casts_background_shadow (state, node))
     {
-      g_clear_object (&state->prerendered_pipeline);
-
-      if (node->border_slices_texture == NULL &&
-          state->box_shadow_pipeline != NULL)
-        {
-          g_clear_object (&state->box_shadow_pipeline);
-          had_box_shadow = TRUE;
-        }
+      g_clear_object (&state->box_shadow_pipeline);
+      had_background_shadow = TRUE;
     }
 
+  g_clear_object (&state->prerendered_texture);
+  g_clear_object (&state->prerendered_pipeline);
+  g_clear_object (&state->border_slices_texture);
+  g_clear_pointer (&state->border_slices, g_free);
+
   st_theme_node_paint_state_set_node (state, node);
   state->alloc_width = width;
   state->alloc_height = height;
   state->resource_scale = resource_scale;
 
-  box_shadow_spec = st_theme_node_get_box_shadow (node);
-
+  /* Sizes passed through while resizing are unlikely to come back,
+   * don't let them push out what widgets at rest share
+   */
   st_theme_node_maybe_prerender_background (state, node, cogl_context,
-                                            width, height, resource_scale);
+                                            width, height, resource_scale,
+                                            FALSE);
 
-  if (had_box_shadow)
-    state->box_shadow_pipeline = _st_create_shadow_pipeline (box_shadow_spec,
+  if (had_background_shadow && state->prerendered_texture != NULL)
+    state->box_shadow_pipeline = _st_create_shadow_pipeline (st_theme_node_get_box_shadow (node),
                                                              paint_context,
                                                              state->prerendered_texture,
                                                              state->resource_scale);
 }
 
+/* The most rectangles the background of a node is made of */
+#define MAX_SOLID_RECTANGLES 11
+
 static void
 paint_pipeline_with_opacity (ClutterPaintNode *node,
                              CoglPipeline     *pipeline,
@@ -1787,6 +2115,105 @@ paint_pipeline_with_opacity (ClutterPaintNode *node,
     clutter_paint_node_add_rectangle (pipeline_node, box);
 }
 
+static void
+paint_corners (ClutterPaintNode *root,
+               CoglPipeline     *pipeline,
+               const CoglColor  *color,
+               const float      *rectangles,
+               int               n_rectangles)
+{
+  g_autoptr (ClutterPaintNode) corners_node = NULL;
+
+  if (n_rectangles == 0)
+    return;
+
+  cogl_pipeline_set_color (pipeline, color);
+
+  corners_node = clutter_pipeline_node_new (pipeline);
+  clutter_paint_node_set_static_name (corners_node,
+                                      "StThemeNode (CSS border corners)");
+  clutter_paint_node_add_child (root, corners_node);
+  clutter_paint_node_add_texture_rectangles (corners_node,
+                                             rectangles,
+                                             n_rectangles);
+}
+
+static void
+add_rectangle (float *rectangles,
+               int   *n_rectangles,
+               float  x1,
+               float  y1,
+               float  x2,
+               float  y2)
+{
+  float *r = rectangles + 4 * (*n_rectangles)++;
+
+  r[0] = x1;
+  r[1] = y1;
+  r[2] = x2;
+  r[3] = y2;
+}
+
+/* Paints solid rectangles, either with a color node, or with the white
+ * texel of the corner atlas page used by @solid_pipeline, which lets
+ * the journal batch them with the corners of the node and its siblings
+ */
+static void
+paint_solid_rectangles (ClutterPaintNode *root,
+                        CoglPipeline     *solid_pipeline,
+                        const float      *solid_coords,
+                        const CoglColor  *color,
+                        const float      *rectangles,
+                        int               n_rectangles,
+                        const char       *name)
+{
+  g_autoptr (ClutterPaintNode) solid_node = NULL;
+  g_autoptr (CoglPipeline) pipeline = NULL;
+  float texture_rectangles[8 * MAX_SOLID_RECTANGLES];
+  CoglColor premultiplied;
+  int i;
+
+  g_assert (n_rectangles <= MAX_SOLID_RECTANGLES);
+
+  if (n_rectangles == 0)
+    return;
+
+  if (solid_pipeline == NULL)
+    {
+      solid_node = clutter_color_node_new (color);
+      clutter_paint_node_set_static_name (solid_node, name);
+      clutter_paint_node_add_child (root, solid_node);
+      clutter_paint_node_add_rectangles (solid_node, rectangles, n_rectangles);
+      return;
+    }
+
+  premultiplied = *color;
+  cogl_color_premultiply (&premultiplied);
+
+  /* Not a copy of @solid_pipeline, whose color is changed when
+   * painting the corners
+   */
+  pipeline =
+    _st_create_texture_pipeline (cogl_pipeline_get_layer_texture (solid_pipeline, 0));
+  cogl_pipeline_set_color (pipeline, &premultiplied);
+
+  for (i = 0; i < n_rectangles; i++)
+    {
+      memcpy (texture_rectangles + 8 * i, rectangles + 4 * i, 4 * sizeof (float));
+      texture_rectangles[8 * i + 4] = solid_coords[0];
+      texture_rectangles[8 * i + 5] = solid_coords[1];
+      texture_rectangles[8 * i + 6] = solid_coords[0];
+      texture_rectangles[8 * i + 7] = solid_coords[1];
+    }
+
+  solid_node = clutter_pipeline_node_new (pipeline);
+  clutter_paint_node_set_static_name (solid_node, name);
+  clutter_paint_node_add_child (root, solid_node);
+  clutter_paint_node_add_texture_rectangles (solid_node,
+                                             texture_rectangles,
+                                             n_rectangles);
+}
+
 static void
 st_theme_node_paint_borders (StThemeNodePaintState *state,
                              ClutterPaintNode      *root,
@@ -1805,10 +2232,33 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
   guint8 alpha;
   gboolean corners_are_transparent;
   CoglColor pipeline_color;
+  CoglPipeline *solid_pipeline = NULL;
 
   width = box->x2 - box->x1;
   height = box->y2 - box->y1;
 
+  /* If all corners are on the same atlas page, the borders and the
+   * background are drawn with its texture too, so that the whole node
+   * ends up in a single batch
+   */
+  for (corner_id = 0; corner_id < 4; corner_id++)
+    {
+      CoglPipeline *corner_pipeline = state->corner_pipeline[corner_id];
+
+      if (corner_pipeline == NULL)
+        continue;
+
+      if (solid_pipeline == NULL)
+        {
+          solid_pipeline = corner_pipeline;
+        }
+      else if (corner_pipeline != solid_pipeline)
+        {
+          solid_pipeline = NULL;
+          break;
+        }
+    }
+
   /* TODO - support non-uniform border colors */
   get_arbitrary_border_color (node, &border_color);
 
@@ -1840,12 +2290,11 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
       gboolean skip_corner_1, skip_corner_2;
       float rects[16];
 
-      over (&border_color, &node->background_color, &effective_border);
+      over (&border_color, &node->background->color, &effective_border);
       alpha = paint_opacity * effective_border.alpha / 255;
 
       if (alpha > 0)
         {
-          g_autoptr (ClutterPaintNode) border_color_node = NULL;
           CoglColor color;
 
           cogl_color_init_from_4f (&color,
@@ -1895,17 +2344,15 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
           rects[15] = skip_corner_2 ? height - max_width_radius[ST_CORNER_BOTTOMLEFT]
                              : height - border_width[ST_SIDE_BOTTOM];
 
-          border_color_node = clutter_color_node_new (&color);
-          clutter_paint_node_set_static_name (border_color_node,
-                                              "StThemeNode (CSS borders)");
-          clutter_paint_node_add_child (root, border_color_node);
-          clutter_paint_node_add_rectangles (border_color_node, rects, 4);
+          paint_solid_rectangles (root, solid_pipeline, state->solid_coords,
+                                  &color, rects, 4,
+                                  "StThemeNode (CSS borders)");
         }
     }
 
   corners_are_transparent = mode == ST_PAINT_BORDERS_MODE_COLOR &&
-                            node->background_color.alpha == 0 &&
-                            node->border_color[0].alpha == 0;
+                            node->background->color.alpha == 0 &&
+                            node->borders->border_color[0].alpha == 0;
 
   cogl_color_init_from_4f (&pipeline_color,
                            paint_opacity / 255.0, paint_opacity / 255.0,
@@ -1913,100 +2360,115 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
   /* corners */
   if (max_border_radius > 0 && paint_opacity > 0 && !corners_are_transparent)
     {
+      float rectangles[8 * 4];
+      CoglPipeline *pipeline = NULL;
+      int n_rectangles = 0;
+
       for (corner_id = 0; corner_id < 4; corner_id++)
         {
-          g_autoptr (ClutterPaintNode) corners_node = NULL;
+          const float *coords = state->corner_coords[corner_id];
+          float x1, y1, x2, y2, tx1, ty1, tx2, ty2;
+          float mid_x, mid_y;
+          float *r;
 
           if (state->corner_pipeline[corner_id] == NULL)
             continue;
 
-          cogl_pipeline_set_color (state->corner_pipeline[corner_id], &pipeline_color);
+          /* Consecutive corners from the same atlas page are drawn
+           * with a single paint node
+           */
+          if (state->corner_pipeline[corner_id] != pipeline)
+            {
+              paint_corners (root, pipeline, &pipeline_color,
+                             rectangles, n_rectangles);
+              pipeline = state->corner_pipeline[corner_id];
+              n_rectangles = 0;
+            }
 
-          corners_node =
-            clutter_pipeline_node_new (state->corner_pipeline[corner_id]);
-          clutter_paint_node_set_static_name (corners_node,
-                                              "StThemeNode (CSS border corners)");
-          clutter_paint_node_add_child (root, corners_node);
+          /* Each corner uses a quarter of its texture */
+          mid_x = (coords[0] + coords[2]) / 2;
+          mid_y = (coords[1] + coords[3]) / 2;
 
           switch (corner_id)
             {
             case ST_CORNER_TOPLEFT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          0, 0,
-                                                          max_width_radius[ST_CORNER_TOPLEFT],
-                                                          max_width_radius[ST_CORNER_TOPLEFT],
-                                                        },
-                                                        0.0, 0.0,
-                                                        0.5, 0.5);
+              x1 = 0;
+              y1 = 0;
+              tx1 = coords[0];
+              ty1 = coords[1];
+              tx2 = mid_x;
+              ty2 = mid_y;
               break;
             case ST_CORNER_TOPRIGHT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          width - max_width_radius[ST_CORNER_TOPRIGHT],
-                                                          0,
-                                                          width,
-                                                          max_width_radius[ST_CORNER_TOPRIGHT],
-                                                        },
-                                                        0.5, 0.0,
-                                                        1.0, 0.5);
+              x1 = width - max_width_radius[corner_id];
+              y1 = 0;
+              tx1 = mid_x;
+              ty1 = coords[1];
+              tx2 = coords[2];
+              ty2 = mid_y;
               break;
             case ST_CORNER_BOTTOMRIGHT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          width - max_width_radius[ST_CORNER_BOTTOMRIGHT],
-                                                          height - max_width_radius[ST_CORNER_BOTTOMRIGHT],
-                                                          width,
-                                                          height,
-                                                        },
-                                                        0.5, 0.5,
-                                                        1.0, 1.0);
+              x1 = width - max_width_radius[corner_id];
+              y1 = height - max_width_radius[corner_id];
+              tx1 = mid_x;
+              ty1 = mid_y;
+              tx2 = coords[2];
+              ty2 = coords[3];
               break;
             case ST_CORNER_BOTTOMLEFT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          0,
-                                                          height - max_width_radius[ST_CORNER_BOTTOMLEFT],
-                                                          max_width_radius[ST_CORNER_BOTTOMLEFT],
-                                                          height,
-                                                        },
-                                                        0.0, 0.5,
-                                                        0.5, 1.0);
+              x1 = 0;
+              y1 = height - max_width_radius[corner_id];
+              tx1 = coords[0];
+              ty1 = mid_y;
+              tx2 = mid_x;
+              ty2 = coords[3];
               break;
             default:
               g_assert_not_reached();
               break;
             }
+
+          x2 = x1 + max_width_radius[corner_id];
+          y2 = y1 + max_width_radius[corner_id];
+
+          r = rectangles + 8 * n_rectangles++;
+          r[0] = x1;
+          r[1] = y1;
+          r[2] = x2;
+          r[3] = y2;
+          r[4] = tx1;
+          r[5] = ty1;
+          r[6] = tx2;
+          r[7] = ty2;
         }
+
+      paint_corners (root, pipeline, &pipeline_color,
+                     rectangles, n_rectangles);
     }
 
   /* background color */
   alpha = mode == ST_PAINT_BORDERS_MODE_SILHOUETTE ?
           255 :
-          paint_opacity * node->background_color.alpha / 255;
+          paint_opacity * node->background->color.alpha / 255;
   if (alpha > 0)
     {
-      g_autoptr (ClutterPaintNode) background_color_node = NULL;
+      float rectangles[4 * MAX_SOLID_RECTANGLES];
+      int n_rectangles = 0;
       CoglColor color;
 
       cogl_color_init_from_4f (&color,
-                               node->background_color.red / 255.0f,
-                               node->background_color.green / 255.0f,
-                               node->background_color.blue / 255.0f,
+                               node->background->color.red / 255.0f,
+                               node->background->color.green / 255.0f,
+                               node->background->color.blue / 255.0f,
                                alpha / 255.0f);
 
-      background_color_node = clutter_color_node_new (&color);
-      clutter_paint_node_set_static_name (background_color_node,
-                                          "StThemeNode (CSS background color)");
-      clutter_paint_node_add_child (root, background_color_node);
-
       /* We add padding to each corner, so that all corners end up as if they
        * had a border-radius of max_border_radius, which allows us to treat
        * corners as uniform further on.
        */
       for (corner_id = 0; corner_id < 4; corner_id++)
         {
-          float verts[8];
+          float *verts = rectangles + 4 * n_rectangles;
           int n_rects;
 
           /* corner texture does not need padding */
@@ -2086,9 +2548,7 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
                 break;
             }
 
-          clutter_paint_node_add_rectangles (background_color_node,
-                                             verts,
-                                             n_rects);
+          n_rectangles += n_rects;
         }
 
       /* Once we've drawn the borders and corners, if the corners are bigger
@@ -2104,33 +2564,31 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
        */
       if (max_border_radius > border_width[ST_SIDE_TOP])
         {
-          clutter_paint_node_add_rectangle (background_color_node,
-                                            &(ClutterActorBox) {
-                                              MAX (max_border_radius, border_width[ST_SIDE_LEFT]),
-                                              border_width[ST_SIDE_TOP],
-                                              width - MAX (max_border_radius, border_width[ST_SIDE_RIGHT]),
-                                              max_border_radius,
-                                            });
+          add_rectangle (rectangles, &n_rectangles,
+                         MAX (max_border_radius, border_width[ST_SIDE_LEFT]),
+                         border_width[ST_SIDE_TOP],
+                         width - MAX (max_border_radius, border_width[ST_SIDE_RIGHT]),
+                         max_border_radius);
         }
 
       if (max_border_radius > border_width[ST_SIDE_BOTTOM])
         {
-          clutter_paint_node_add_rectangle (background_color_node,
-                                            &(ClutterActorBox) {
-                                              MAX (max_border_radius, border_width[ST_SIDE_LEFT]),
-                                              height - max_border_radius,
-                                              width - MAX (max_border_radius, border_width[ST_SIDE_RIGHT]),
-                                              height - border_width[ST_SIDE_BOTTOM],
-                                            });
+          add_rectangle (rectangles, &n_rectangles,
+                         MAX (max_border_radius, border_width[ST_SIDE_LEFT]),
+                         height - max_border_radius,
+                         width - MAX (max_border_radius, border_width[ST_SIDE_RIGHT]),
+                         height - border_width[ST_SIDE_BOTTOM]);
         }
 
-      clutter_paint_node_add_rectangle (background_color_node,
-                                        &(ClutterActorBox) {
-                                          border_width[ST_SIDE_LEFT],
-                                          MAX (border_width[ST_SIDE_TOP], max_border_radius),
-                                          width - border_width[ST_SIDE_RIGHT],
-                                          height - MAX (border_width[ST_SIDE_BOTTOM], max_border_radius)
-                                        });
+      add_rectangle (rectangles, &n_rectangles,
+                     border_width[ST_SIDE_LEFT],
+                     MAX (border_width[ST_SIDE_TOP], max_border_radius),
+                     width - border_width[ST_SIDE_RIGHT],
+                     height - MAX (border_width[ST_SIDE_BOTTOM], max_border_radius));
+
+      paint_solid_rectangles (root, solid_pipeline, state->solid_coords,
+                              &color, rectangles, n_rectangles,
+                              "StThemeNode (CSS background color)");
     }
 }
 
@@ -2195,17 +2653,17 @@ st_theme_node_paint_sliced_shadow (StThemeNodePaintState *state,
 
   /* Compute input regions parameters */
   s_top = shadow_blur_radius + box_shadow_spec->blur +
-    MAX (node->border_radius[ST_CORNER_TOPLEFT],
-         node->border_radius[ST_CORNER_TOPRIGHT]);
+    MAX (node->borders->border_radius[ST_CORNER_TOPLEFT],
+         node->borders->border_radius[ST_CORNER_TOPRIGHT]);
   s_bottom = shadow_blur_radius + box_shadow_spec->blur +
-    MAX (node->border_radius[ST_CORNER_BOTTOMLEFT],
-         node->border_radius[ST_CORNER_BOTTOMRIGHT]);
+    MAX (node->borders->border_radius[ST_CORNER_BOTTOMLEFT],
+         node->borders->border_radius[ST_CORNER_BOTTOMRIGHT]);
   s_left = shadow_blur_radius + box_shadow_spec->blur +
-    MAX (node->border_radius[ST_CORNER_TOPLEFT],
-         node->border_radius[ST_CORNER_BOTTOMLEFT]);
+    MAX (node->borders->border_radius[ST_CORNER_TOPLEFT],
+         node->borders->border_radius[ST_CORNER_BOTTOMLEFT]);
   s_right = shadow_blur_radius + box_shadow_spec->blur +
-    MAX (node->border_radius[ST_CORNER_TOPRIGHT],
-         node->border_radius[ST_CORNER_BOTTOMRIGHT]);
+    MAX (node->borders->border_radius[ST_CORNER_TOPRIGHT],
+         node->borders->border_radius[ST_CORNER_BOTTOMRIGHT]);
 
   /* Compute output regions parameters */
   xoffset = box->x1 + box_shadow_spec->xoffset - shadow_blur_radius - box_shadow_spec->spread;
@@ -2227,6 +2685,26 @@ st_theme_node_paint_sliced_shadow (StThemeNodePaintState *state,
   left = s_left * x_spread_factor;
   right = s_right * x_spread_factor;
 
+  /* The shadow is always rendered at its minimum size; when the
+   * allocation is smaller than that, squeeze the corners so they meet
+   * in the middle, like st_theme_node_reduce_border_radius() does.
+   */
+  if (left + right > width)
+    {
+      gfloat factor = width / (left + right);
+
+      left *= factor;
+      right *= factor;
+    }
+
+  if (top + bottom > height)
+    {
+      gfloat factor = height / (top + bottom);
+
+      top *= factor;
+      bottom *= factor;
+    }
+
   bottom = height - bottom;
   right  = width - right;
 
@@ -2574,47 +3052,42 @@ st_theme_node_compute_maximum_borders (StThemeNodePaintState *state)
   StThemeNode * node = state->node;
 
   /* Compute maximum borders sizes */
-  max_borders[ST_SIDE_TOP] = MAX (node->border_radius[ST_CORNER_TOPLEFT],
-                                  node->border_radius[ST_CORNER_TOPRIGHT]);
-  max_borders[ST_SIDE_BOTTOM] = MAX (node->border_radius[ST_CORNER_BOTTOMLEFT],
-                                     node->border_radius[ST_CORNER_BOTTOMRIGHT]);
-  max_borders[ST_SIDE_LEFT] = MAX (node->border_radius[ST_CORNER_TOPLEFT],
-                                   node->border_radius[ST_CORNER_BOTTOMLEFT]);
-  max_borders[ST_SIDE_RIGHT] = MAX (node->border_radius[ST_CORNER_TOPRIGHT],
-                                    node->border_radius[ST_CORNER_BOTTOMRIGHT]);
+  max_borders[ST_SIDE_TOP] = MAX (node->borders->border_radius[ST_CORNER_TOPLEFT],
+                                  node->borders->border_radius[ST_CORNER_TOPRIGHT]);
+  max_borders[ST_SIDE_BOTTOM] = MAX (node->borders->border_radius[ST_CORNER_BOTTOMLEFT],
+                                     node->borders->border_radius[ST_CORNER_BOTTOMRIGHT]);
+  max_borders[ST_SIDE_LEFT] = MAX (node->borders->border_radius[ST_CORNER_TOPLEFT],
+                                   node->borders->border_radius[ST_CORNER_BOTTOMLEFT]);
+  max_borders[ST_SIDE_RIGHT] = MAX (node->borders->border_radius[ST_CORNER_TOPRIGHT],
+                                    node->borders->border_radius[ST_CORNER_BOTTOMRIGHT]);
 
   center_radius = (node->box_shadow->blur > 0) ? (2 * node->box_shadow->blur + 1) : 1;
 
   node->box_shadow_min_width = max_borders[ST_SIDE_LEFT] + max_borders[ST_SIDE_RIGHT] + center_radius;
   node->box_shadow_min_height = max_borders[ST_SIDE_TOP] + max_borders[ST_SIDE_BOTTOM] + center_radius;
-  if (state->alloc_width < node->box_shadow_min_width ||
-      state->alloc_height < node->box_shadow_min_height)
-    {
-      state->box_shadow_width = state->alloc_width;
-      state->box_shadow_height = state->alloc_height;
-    }
-  else
-    {
-      state->box_shadow_width = node->box_shadow_min_width;
-      state->box_shadow_height = node->box_shadow_min_height;
-    }
+
+  /* The silhouette is rendered at this size whatever the allocation,
+   * and stretched as nine slices when painting, so resizing the node
+   * never requires blurring again.
+   */
+  state->box_shadow_width = node->box_shadow_min_width;
+  state->box_shadow_height = node->box_shadow_min_height;
 }
 
+/* The nine slices only depend on the size and the texture, so they are
+ * computed once for the paint state
+ */
 static void
-st_theme_node_paint_sliced_border_image (StThemeNode      *node,
-                                         ClutterPaintNode *root,
-                                         float             width,
-                                         float             height,
-                                         guint8            paint_opacity)
+st_theme_node_compute_border_slices (StThemeNodePaintState *state,
+                                     StThemeNode           *node,
+                                     float                  width,
+                                     float                  height)
 {
-  g_autoptr (ClutterPaintNode) pipeline_node = NULL;
   gfloat ex, ey;
   gfloat tx1, ty1, tx2, ty2;
   gint border_left, border_right, border_top, border_bottom;
   float img_width, img_height;
   StBorderImage *border_image;
-  CoglPipeline *pipeline;
-  CoglColor color;
 
   border_image = st_theme_node_get_border_image (node);
   g_assert (border_image != NULL);
@@ -2638,12 +3111,6 @@ st_theme_node_paint_sliced_border_image (StThemeNode      *node,
   if (ey < 0)
     ey = border_bottom;          /* FIXME ? */
 
-  pipeline = node->border_slices_pipeline;
-  cogl_color_init_from_4f (&color,
-                           paint_opacity / 255.0, paint_opacity / 255.0,
-                           paint_opacity / 255.0, paint_opacity / 255.0);
-  cogl_pipeline_set_color (pipeline, &color);
-
   {
     float rectangles[] =
     {
@@ -2693,12 +3160,44 @@ st_theme_node_paint_sliced_border_image (StThemeNode      *node,
       1.0, 1.0
     };
 
-    pipeline_node = clutter_pipeline_node_new (pipeline);
-    clutter_paint_node_set_static_name (pipeline_node,
-                                        "StThemeNode (CSS border image)");
-    clutter_paint_node_add_child (root, pipeline_node);
-    clutter_paint_node_add_texture_rectangles (pipeline_node, rectangles, 9);
+    g_free (state->border_slices);
+    state->border_slices = g_memdup2 (rectangles, sizeof (rectangles));
   }
+
+  g_set_object (&state->border_slices_texture, node->border_slices_texture);
+}
+
+static void
+st_theme_node_paint_sliced_border_image (StThemeNodePaintState *state,
+                                         ClutterPaintNode      *root,
+                                         float                  width,
+                                         float                  height,
+                                         guint8                 paint_opacity)
+{
+  g_autoptr (ClutterPaintNode) pipeline_node = NULL;
+  StThemeNode *node = state->node;
+  CoglPipeline *pipeline;
+  CoglColor color;
+
+  /* The texture of the node is replaced when the border image is
+   * invalidated, see st_theme_node_invalidate_border_image()
+   */
+  if (state->border_slices == NULL ||
+      state->border_slices_texture != node->border_slices_texture)
+    st_theme_node_compute_border_slices (state, node, width, height);
+
+  pipeline = node->border_slices_pipeline;
+  cogl_color_init_from_4f (&color,
+                           paint_opacity / 255.0, paint_opacity / 255.0,
+                           paint_opacity / 255.0, paint_opacity / 255.0);
+  cogl_pipeline_set_color (pipeline, &color);
+
+  pipeline_node = clutter_pipeline_node_new (pipeline);
+  clutter_paint_node_set_static_name (pipeline_node,
+                                      "StThemeNode (CSS border image)");
+  clutter_paint_node_add_child (root, pipeline_node);
+  clutter_paint_node_add_texture_rectangles (pipeline_node,
+                                             state->border_slices, 9);
 }
 
 static void
@@ -2724,7 +3223,7 @@ st_theme_node_paint_outline (StThemeNode           *node,
     return;
 
   st_theme_node_get_outline_color (node, &outline_color);
-  over (&outline_color, &node->background_color, &effective_outline);
+  over (&outline_color, &node->background->color, &effective_outline);
 
   alpha = paint_opacity * outline_color.alpha / 255;
 
@@ -2785,31 +3284,9 @@ st_theme_node_needs_new_box_shadow_for_size (StThemeNodePaintState *state,
   if (fabsf (state->resource_scale - resource_scale) > FLT_EPSILON)
     return TRUE;
 
-  /* The allocation hasn't changed, no need to recompute a new
-     box-shadow. */
-  if (state->alloc_width == width &&
-      state->alloc_height == height)
-    return FALSE;
-
-  /* If there is no shadow, no need to recompute a new box-shadow. */
-  if (node->box_shadow_min_width == 0 ||
-      node->box_shadow_min_height == 0)
-    return FALSE;
-
-  /* If the new size is inferior to the box-shadow minimum size (we
-     already know the size has changed), we need to recompute the
-     box-shadow. */
-  if (width < node->box_shadow_min_width ||
-      height < node->box_shadow_min_height)
-    return TRUE;
-
-  /* Now checking whether the size of the node has crossed the minimum
-     box-shadow size boundary, from below to above the minimum size .
-     If that's the case, we need to recompute the box-shadow */
-  if (state->alloc_width < node->box_shadow_min_width ||
-      state->alloc_height < node->box_shadow_min_height)
-    return TRUE;
-
+  /* Other box-shadows are rendered at their minimum size and painted
+     as nine slices, so they don't depend on the allocation; those cast
+     by a prerendered background are updated along with it. */
   return FALSE;
 }
 
@@ -2839,7 +3316,7 @@ st_theme_node_paint (StThemeNode           *node,
   /* Check whether we need to recreate the textures of the paint
    * state, either because :
    *  1) the theme node associated to the paint state has changed
-   *  2) the allocation size change requires recreating textures
+   *  2) the resource scale changed
    */
   if (state->node != node ||
       st_theme_node_needs_new_box_shadow_for_size (state, node, width, height,
@@ -2894,8 +3371,14 @@ st_theme_node_paint (StThemeNode           *node,
 
   if (state->box_shadow_pipeline)
     {
-      if (state->alloc_width < node->box_shadow_min_width ||
-          state->alloc_height < node->box_shadow_min_height)
+      /* Shadows of backgrounds are cast at the size of the allocation,
+       * those of border images by the whole image when it is smaller
+       * than the slices
+       */
+      if (st_theme_node_casts_background_shadow (state, node) ||
+          (node->border_slices_texture != NULL &&
+           (state->alloc_width < node->box_shadow_min_width ||
+            state->alloc_height < node->box_shadow_min_height)))
         _st_paint_shadow_with_opacity (node->box_shadow,
                                        root,
                                        state->box_shadow_pipeline,
@@ -2927,7 +3410,7 @@ st_theme_node_paint (StThemeNode           *node,
         }
 
       if (node->border_slices_pipeline != NULL)
-        st_theme_node_paint_sliced_border_image (node, root, width, height, paint_opacity);
+        st_theme_node_paint_sliced_border_image (state, root, width, height, paint_opacity);
     }
   else
     {
@@ -2952,7 +3435,7 @@ st_theme_node_paint (StThemeNode           *node,
       get_background_position (node, &allocation, resource_scale,
                                &background_box, &texture_coords);
 
-      if (has_visible_outline || node->background_repeat)
+      if (has_visible_outline || node->background->repeat)
         {
           g_autoptr (ClutterPaintNode) clip_node = NULL;
 
@@ -3000,6 +3483,8 @@ st_theme_node_paint_state_node_free_internal (StThemeNodePaintState *state,
   g_clear_object (&state->prerendered_texture);
   g_clear_object (&state->prerendered_pipeline);
   g_clear_object (&state->box_shadow_pipeline);
+  g_clear_object (&state->border_slices_texture);
+  g_clear_pointer (&state->border_slices, g_free);
 
   for (corner_id = 0; corner_id < 4; corner_id++)
     g_clear_object (&state->corner_pipeline[corner_id]);
@@ -3052,6 +3537,12 @@ st_theme_node_paint_state_init (StThemeNodePaintState *state)
 
   for (corner_id = 0; corner_id < 4; corner_id++)
     state->corner_pipeline[corner_id] = NULL;
+
+  memset (state->corner_coords, 0, sizeof (state->corner_coords));
+  memset (state->solid_coords, 0, sizeof (state->solid_coords));
+
+  state->border_slices_texture = NULL;
+  state->border_slices = NULL;
 }
 
 void
@@ -3082,6 +3573,18 @@ st_theme_node_paint_state_copy (StThemeNodePaintState *state,
   for (corner_id = 0; corner_id < 4; corner_id++)
     if (other->corner_pipeline[corner_id])
       state->corner_pipeline[corner_id] = g_object_ref (other->corner_pipeline[corner_id]);
+
+  memcpy (state->corner_coords, other->corner_coords,
+          sizeof (state->corner_coords));
+  memcpy (state->solid_coords, other->solid_coords,
+          sizeof (state->solid_coords));
+
+  if (other->border_slices)
+    {
+      state->border_slices_texture = g_object_ref (other->border_slices_texture);
+      state->border_slices = g_memdup2 (other->border_slices,
+                                        9 * 8 * sizeof (float));
+    }
 }
 
 void
@@ -3105,3 +3608,23 @@ st_theme_node_paint_state_invalidate_for_file (StThemeNodePaintState *state,
 
   return FALSE;
 }
+
+/**
+ * st_theme_node_get_corner_atlas_usage:
+ * @n_corners: (out) (optional): return location for the number of
+ *   distinct rounded corners
+ * @n_pixels: (out) (optional): return location for the size of the
+ *   corner atlas, in pixels
+ * @n_used_pixels: (out) (optional): return location for the number of
+ *   atlas pixels taken by corners
+ *
+ * Gets statistics about the texture atlas the rounded corners of all
+ * theme nodes are rendered to.
+ */
+void
+st_theme_node_get_corner_atlas_usage (guint *n_corners,
+                                      guint *n_pixels,
+                                      guint *n_used_pixels)
+{
+  _st_corner_atlas_get_usage (n_corners, n_pixels, n_used_pixels);
+}
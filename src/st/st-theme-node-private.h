@@ -21,40 +21,24 @@
 
 #pragma once
 
+#include "st-rounded-rect.h"
 #include "st-theme-node.h"
+#include "st-theme-private.h"
 #include "croco/libcroco.h"
 #include "st-types.h"
 
 G_BEGIN_DECLS
 
-struct _StThemeNode {
-  GObject parent;
-
-  StThemeContext *context;
-  StThemeNode *parent_node;
-  StTheme *theme;
-
-  PangoFontDescription *font_desc;
-
-  CoglColor background_color;
-  /* If gradient is set, then background_color is the gradient start */
-  StGradientType background_gradient_type;
-  CoglColor background_gradient_end;
-
-  int background_position_x;
-  int background_position_y;
+/* The computed values of a group of properties. These are immutable and
+ * interned, so that all nodes that compute to the same values share one
+ * record and can be compared by pointer.
+ */
 
-  StBackgroundSize background_size;
-  gint background_size_w;
-  gint background_size_h;
-
-  CoglColor foreground_color;
-  CoglColor border_color[4];
-  CoglColor outline_color;
+/* Everything that affects layout */
+typedef struct {
+  int ref_count;
 
   int border_width[4];
-  int border_radius[4];
-  int outline_width;
   guint padding[4];
   guint margin[4];
 
@@ -64,10 +48,58 @@ struct _StThemeNode {
   int min_height;
   int max_width;
   int max_height;
+} StThemeGeometry;
+
+/* The paint-only parts of the border and outline */
+typedef struct {
+  int ref_count;
+
+  CoglColor border_color[4];
+  int border_radius[4];
+
+  CoglColor outline_color;
+  int outline_width;
+} StThemeBorders;
+
+typedef struct {
+  int ref_count;
+
+  /* If gradient is set, then color is the gradient start */
+  CoglColor color;
+  StGradientType gradient_type;
+  CoglColor gradient_end;
+
+  int position_x;
+  int position_y;
+  gboolean position_set;
+  gboolean repeat;
+
+  StBackgroundSize size;
+  int size_w;
+  int size_h;
+
+  /* Not compared bytewise, must stay last */
+  GFile *image;
+} StThemeBackground;
+
+struct _StThemeNode {
+  GObject parent;
+
+  StThemeContext *context;
+  StThemeNode *parent_node;
+  StTheme *theme;
+
+  PangoFontDescription *font_desc;
+
+  /* Computed values, shared with all nodes that compute to the same ones */
+  StThemeGeometry *geometry;
+  StThemeBorders *borders;
+  StThemeBackground *background;
+
+  CoglColor foreground_color;
 
   int transition_duration;
 
-  GFile *background_image;
   StBorderImage *border_image;
   StShadow *box_shadow;
   StShadow *background_image_shadow;
@@ -83,14 +115,17 @@ struct _StThemeNode {
   CRDeclaration **properties;
   int n_properties;
 
+  /* properties points into these. They are shared with nodes that have
+   * the same signature unless there is an inline style. */
+  StThemeStyleSignature *style_signature;
+  StThemeDeclarations *declarations;
+
   /* We hold onto these separately so we can destroy them on finalize */
   CRDeclaration *inline_properties;
 
-  guint background_position_set : 1;
-  guint background_repeat : 1;
-
   guint properties_computed : 1;
   guint geometry_computed : 1;
+  guint borders_computed : 1;
   guint background_computed : 1;
   guint foreground_computed : 1;
   guint border_image_computed : 1;
@@ -115,9 +150,27 @@ struct _StThemeNode {
   int cached_scale_factor;
 };
 
+StThemeGeometry   *_st_theme_geometry_ref     (StThemeGeometry   *geometry);
+void               _st_theme_geometry_unref   (StThemeGeometry   *geometry);
+StThemeBorders    *_st_theme_borders_ref      (StThemeBorders    *borders);
+void               _st_theme_borders_unref    (StThemeBorders    *borders);
+StThemeBackground *_st_theme_background_ref   (StThemeBackground *background);
+void               _st_theme_background_unref (StThemeBackground *background);
+
 void _st_theme_node_ensure_background (StThemeNode *node);
 void _st_theme_node_ensure_geometry (StThemeNode *node);
+void _st_theme_node_ensure_borders (StThemeNode *node);
 void _st_theme_node_apply_margins (StThemeNode *node,
                                    ClutterActor *actor);
 
+gboolean _st_theme_node_can_interpolate          (StThemeNode   *node,
+                                                  StThemeNode   *other);
+void     _st_theme_node_interpolate_rounded_rect (StThemeNode   *node,
+                                                  StThemeNode   *other,
+                                                  double         progress,
+                                                  float          width,
+                                                  float          height,
+                                                  float          resource_scale,
+                                                  StRoundedRect *rect);
+
 G_END_DECLS
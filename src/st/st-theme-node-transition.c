@@ -21,6 +21,8 @@
 
 #include <math.h>
 
+#include "st-settings.h"
+#include "st-theme-node-private.h"
 #include "st-theme-node-transition.h"
 
 enum {
@@ -46,6 +48,9 @@ typedef struct _StThemeNodeTransition {
 
   CoglPipeline *pipeline;
 
+  /* Paints the interpolated nodes, when they can be */
+  CoglPipeline *interpolated_pipeline;
+
   ClutterTimeline *timeline;
 
   gulong timeline_completed_id;
@@ -343,6 +348,62 @@ setup_framebuffers (StThemeNodeTransition *transition,
   return TRUE;
 }
 
+/* Transitions that only change colors, border widths and radii are
+ * painted in a single pass with the interpolated values, rather than
+ * by painting both nodes offscreen and cross-fading
+ */
+static gboolean
+paint_interpolated (StThemeNodeTransition *transition,
+                    CoglContext           *cogl_context,
+                    ClutterPaintNode      *node,
+                    ClutterActorBox       *allocation,
+                    guint8                 paint_opacity,
+                    float                  resource_scale)
+{
+  g_autoptr (ClutterPaintNode) pipeline_node = NULL;
+  StRoundedRect rect;
+  CoglColor pipeline_color;
+  float width, height;
+
+  if (!st_settings_get_shader_backgrounds (st_settings_get ()) ||
+      !_st_theme_node_can_interpolate (transition->old_theme_node,
+                                       transition->new_theme_node))
+    return FALSE;
+
+  width = allocation->x2 - allocation->x1;
+  height = allocation->y2 - allocation->y1;
+
+  if (width <= 0 || height <= 0 || resource_scale <= 0.0f)
+    return TRUE;
+
+  _st_theme_node_interpolate_rounded_rect (transition->old_theme_node,
+                                           transition->new_theme_node,
+                                           clutter_timeline_get_progress (transition->timeline),
+                                           width, height, resource_scale,
+                                           &rect);
+
+  if (transition->interpolated_pipeline == NULL)
+    transition->interpolated_pipeline =
+      _st_create_rounded_rect_pipeline (cogl_context, &rect);
+  else
+    _st_rounded_rect_pipeline_set_rect (transition->interpolated_pipeline,
+                                        &rect);
+
+  cogl_color_init_from_4f (&pipeline_color,
+                           paint_opacity / 255.0, paint_opacity / 255.0,
+                           paint_opacity / 255.0, paint_opacity / 255.0);
+  cogl_pipeline_set_color (transition->interpolated_pipeline, &pipeline_color);
+
+  pipeline_node = clutter_pipeline_node_new (transition->interpolated_pipeline);
+  clutter_paint_node_set_static_name (pipeline_node,
+                                      "StThemeNodeTransition (interpolated)");
+  clutter_paint_node_add_child (node, pipeline_node);
+  clutter_paint_node_add_rectangle (pipeline_node,
+                                    &(ClutterActorBox) { 0, 0, width, height });
+
+  return TRUE;
+}
+
 void
 st_theme_node_transition_paint (StThemeNodeTransition *transition,
                                 CoglContext           *cogl_context,
@@ -363,6 +424,10 @@ st_theme_node_transition_paint (StThemeNodeTransition *transition,
   g_return_if_fail (ST_IS_THEME_NODE (transition->old_theme_node));
   g_return_if_fail (ST_IS_THEME_NODE (transition->new_theme_node));
 
+  if (paint_interpolated (transition, cogl_context, node, allocation,
+                          paint_opacity, resource_scale))
+    return;
+
   if (!clutter_actor_box_equal (allocation, &transition->last_allocation))
     transition->needs_setup = TRUE;
 
@@ -415,6 +480,7 @@ st_theme_node_transition_dispose (GObject *object)
   g_clear_object (&self->new_offscreen);
 
   g_clear_object (&self->pipeline);
+  g_clear_object (&self->interpolated_pipeline);
 
   if (self->timeline)
     {
@@ -42,11 +42,329 @@ static const CoglColor DEFAULT_ERROR_COLOR = { 0xcc, 0x00, 0x00, 0xff };
 
 G_DEFINE_TYPE (StThemeNode, st_theme_node, G_TYPE_OBJECT)
 
+/* Properties that the getters below look up by name; their ids are
+ * interned once so that lookups don't need to compare strings.
+ */
+enum {
+  PROP_COLOR,
+  PROP_ST_ICON_STYLE,
+  PROP_TEXT_DECORATION,
+  PROP_TEXT_ALIGN,
+  PROP_FONT,
+  PROP_FONT_FAMILY,
+  PROP_FONT_WEIGHT,
+  PROP_FONT_STYLE,
+  PROP_FONT_VARIANT,
+  PROP_FONT_SIZE,
+  PROP_FONT_FEATURE_SETTINGS,
+  PROP_BORDER_IMAGE,
+  PROP_WARNING_COLOR,
+  PROP_ERROR_COLOR,
+  PROP_SUCCESS_COLOR,
+  PROP_WIDTH,
+  PROP_HEIGHT,
+  PROP_ST_NATURAL_WIDTH,
+  PROP_ST_NATURAL_HEIGHT,
+  PROP_MIN_WIDTH,
+  PROP_MIN_HEIGHT,
+  PROP_MAX_WIDTH,
+  PROP_MAX_HEIGHT,
+  PROP_TRANSITION_DURATION,
+  PROP_LETTER_SPACING,
+  PROP_BOX_SHADOW,
+  PROP_ST_BACKGROUND_IMAGE_SHADOW,
+  PROP_TEXT_SHADOW,
+
+  N_KNOWN_PROPERTIES
+};
+
+static const char * const known_property_names[N_KNOWN_PROPERTIES] = {
+  [PROP_COLOR] = "color",
+  [PROP_ST_ICON_STYLE] = "-st-icon-style",
+  [PROP_TEXT_DECORATION] = "text-decoration",
+  [PROP_TEXT_ALIGN] = "text-align",
+  [PROP_FONT] = "font",
+  [PROP_FONT_FAMILY] = "font-family",
+  [PROP_FONT_WEIGHT] = "font-weight",
+  [PROP_FONT_STYLE] = "font-style",
+  [PROP_FONT_VARIANT] = "font-variant",
+  [PROP_FONT_SIZE] = "font-size",
+  [PROP_FONT_FEATURE_SETTINGS] = "font-feature-settings",
+  [PROP_BORDER_IMAGE] = "border-image",
+  [PROP_WARNING_COLOR] = "warning-color",
+  [PROP_ERROR_COLOR] = "error-color",
+  [PROP_SUCCESS_COLOR] = "success-color",
+  [PROP_WIDTH] = "width",
+  [PROP_HEIGHT] = "height",
+  [PROP_ST_NATURAL_WIDTH] = "-st-natural-width",
+  [PROP_ST_NATURAL_HEIGHT] = "-st-natural-height",
+  [PROP_MIN_WIDTH] = "min-width",
+  [PROP_MIN_HEIGHT] = "min-height",
+  [PROP_MAX_WIDTH] = "max-width",
+  [PROP_MAX_HEIGHT] = "max-height",
+  [PROP_TRANSITION_DURATION] = "transition-duration",
+  [PROP_LETTER_SPACING] = "letter-spacing",
+  [PROP_BOX_SHADOW] = "box-shadow",
+  [PROP_ST_BACKGROUND_IMAGE_SHADOW] = "-st-background-image-shadow",
+  [PROP_TEXT_SHADOW] = "text-shadow",
+};
+
+static guint known_property_ids[N_KNOWN_PROPERTIES];
+
+/* Interned computed value records, see st-theme-node-private.h. The
+ * tables don't hold a reference, records are removed when the last
+ * node or cache entry using them lets go. All of them start with their ref_count,
+ * the rest of the record is hashed and compared bytewise.
+ */
+static GHashTable *interned_geometries;
+static GHashTable *interned_borders;
+static GHashTable *interned_backgrounds;
+
+static const StThemeGeometry default_geometry;
+static const StThemeBorders default_borders;
+static const StThemeBackground default_background;
+
+/* How often each property group was resolved, for profiling */
+static guint group_computations[ST_THEME_NODE_GROUP_ICON_COLORS + 1];
+
+static guint
+hash_record_data (gconstpointer record,
+                  gsize         start,
+                  gsize         end)
+{
+  const guint8 *p = (const guint8 *) record + start;
+  const guint8 *p_end = (const guint8 *) record + end;
+  guint hash = 5381;
+
+  for (; p < p_end; p++)
+    hash = hash * 33 + *p;
+
+  return hash;
+}
+
+static gboolean
+record_data_equal (gconstpointer a,
+                   gconstpointer b,
+                   gsize         start,
+                   gsize         end)
+{
+  return memcmp ((const guint8 *) a + start,
+                 (const guint8 *) b + start,
+                 end - start) == 0;
+}
+
+#define RECORD_DATA_START(Type) (G_STRUCT_OFFSET (Type, ref_count) + sizeof (int))
+
+static guint
+geometry_hash (gconstpointer data)
+{
+  return hash_record_data (data,
+                           RECORD_DATA_START (StThemeGeometry),
+                           sizeof (StThemeGeometry));
+}
+
+static gboolean
+geometry_equal (gconstpointer a,
+                gconstpointer b)
+{
+  return record_data_equal (a, b,
+                            RECORD_DATA_START (StThemeGeometry),
+                            sizeof (StThemeGeometry));
+}
+
+static guint
+borders_hash (gconstpointer data)
+{
+  return hash_record_data (data,
+                           RECORD_DATA_START (StThemeBorders),
+                           sizeof (StThemeBorders));
+}
+
+static gboolean
+borders_equal (gconstpointer a,
+               gconstpointer b)
+{
+  return record_data_equal (a, b,
+                            RECORD_DATA_START (StThemeBorders),
+                            sizeof (StThemeBorders));
+}
+
+static guint
+background_hash (gconstpointer data)
+{
+  const StThemeBackground *background = data;
+  guint hash;
+
+  hash = hash_record_data (data,
+                           RECORD_DATA_START (StThemeBackground),
+                           G_STRUCT_OFFSET (StThemeBackground, image));
+  if (background->image)
+    hash ^= g_file_hash (background->image);
+
+  return hash;
+}
+
+static gboolean
+background_equal (gconstpointer a,
+                  gconstpointer b)
+{
+  const StThemeBackground *background = a;
+  const StThemeBackground *other = b;
+
+  if (!record_data_equal (a, b,
+                          RECORD_DATA_START (StThemeBackground),
+                          G_STRUCT_OFFSET (StThemeBackground, image)))
+    return FALSE;
+
+  if (background->image == other->image)
+    return TRUE;
+
+  return background->image != NULL && other->image != NULL &&
+         g_file_equal (background->image, other->image);
+}
+
+/* Returns a reference to the interned copy of @record, and whether
+ * that copy was just created from it.
+ */
+static gpointer
+intern_record (GHashTable    **table,
+               GHashFunc       hash_func,
+               GEqualFunc      equal_func,
+               gconstpointer   record,
+               gsize           size,
+               gboolean       *created)
+{
+  int *interned;
+
+  if (*table == NULL)
+    *table = g_hash_table_new (hash_func, equal_func);
+
+  interned = g_hash_table_lookup (*table, record);
+  if (interned != NULL)
+    {
+      (*interned)++;
+      *created = FALSE;
+      return interned;
+    }
+
+  interned = g_memdup2 (record, size);
+  *interned = 1;
+  g_hash_table_add (*table, interned);
+  *created = TRUE;
+
+  return interned;
+}
+
+/* Drops a reference to @record, returning %TRUE if it was the last one
+ * and the record has to be freed.
+ */
+static gboolean
+release_record (GHashTable *table,
+                gpointer    record)
+{
+  int *ref_count = record;
+
+  if (record == NULL)
+    return FALSE;
+
+  g_assert (*ref_count > 0);
+
+  if (--(*ref_count) > 0)
+    return FALSE;
+
+  g_hash_table_remove (table, record);
+  return TRUE;
+}
+
+static StThemeGeometry *
+intern_geometry (const StThemeGeometry *geometry)
+{
+  gboolean created;
+
+  return intern_record (&interned_geometries, geometry_hash, geometry_equal,
+                        geometry, sizeof (StThemeGeometry), &created);
+}
+
+StThemeGeometry *
+_st_theme_geometry_ref (StThemeGeometry *geometry)
+{
+  geometry->ref_count++;
+  return geometry;
+}
+
+void
+_st_theme_geometry_unref (StThemeGeometry *geometry)
+{
+  if (release_record (interned_geometries, geometry))
+    g_free (geometry);
+}
+
+static StThemeBorders *
+intern_borders (const StThemeBorders *borders)
+{
+  gboolean created;
+
+  return intern_record (&interned_borders, borders_hash, borders_equal,
+                        borders, sizeof (StThemeBorders), &created);
+}
+
+StThemeBorders *
+_st_theme_borders_ref (StThemeBorders *borders)
+{
+  borders->ref_count++;
+  return borders;
+}
+
+void
+_st_theme_borders_unref (StThemeBorders *borders)
+{
+  if (release_record (interned_borders, borders))
+    g_free (borders);
+}
+
+/* Takes over the reference to @background->image */
+static StThemeBackground *
+intern_background (StThemeBackground *background)
+{
+  StThemeBackground *interned;
+  gboolean created;
+
+  interned = intern_record (&interned_backgrounds,
+                            background_hash, background_equal,
+                            background, sizeof (StThemeBackground),
+                            &created);
+  if (!created)
+    g_clear_object (&background->image);
+
+  return interned;
+}
+
+StThemeBackground *
+_st_theme_background_ref (StThemeBackground *background)
+{
+  background->ref_count++;
+  return background;
+}
+
+void
+_st_theme_background_unref (StThemeBackground *background)
+{
+  if (release_record (interned_backgrounds, background))
+    {
+      g_clear_object (&background->image);
+      g_free (background);
+    }
+}
+
 static void
 st_theme_node_init (StThemeNode *node)
 {
   node->transition_duration = -1;
 
+  node->geometry = intern_geometry (&default_geometry);
+  node->borders = intern_borders (&default_borders);
+  node->background = intern_background ((StThemeBackground *) &default_background);
+
   st_theme_node_paint_state_init (&node->cached_state);
 }
 
@@ -54,19 +372,23 @@ static void
 st_theme_node_class_init (StThemeNodeClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  int i;
 
   object_class->dispose = st_theme_node_dispose;
   object_class->finalize = st_theme_node_finalize;
+
+  for (i = 0; i < N_KNOWN_PROPERTIES; i++)
+    known_property_ids[i] = cr_declaration_intern_property_name (known_property_names[i]);
 }
 
 static void
 maybe_free_properties (StThemeNode *node)
 {
-  if (node->properties)
-    {
-      g_clear_pointer (&node->properties, g_free);
-      node->n_properties = 0;
-    }
+  node->properties = NULL;
+  node->n_properties = 0;
+
+  g_clear_pointer (&node->declarations, _st_theme_declarations_unref);
+  g_clear_pointer (&node->style_signature, _st_theme_style_signature_unref);
 
   /* This destroys the list, not just the head of the list */
   g_clear_pointer (&node->inline_properties, cr_declaration_destroy);
@@ -105,7 +427,9 @@ st_theme_node_finalize (GObject *object)
   g_clear_pointer (&node->background_image_shadow, st_shadow_unref);
   g_clear_pointer (&node->text_shadow, st_shadow_unref);
 
-  g_clear_object (&node->background_image);
+  g_clear_pointer (&node->geometry, _st_theme_geometry_unref);
+  g_clear_pointer (&node->borders, _st_theme_borders_unref);
+  g_clear_pointer (&node->background, _st_theme_background_unref);
 
   g_clear_object (&node->background_texture);
   g_clear_object (&node->background_pipeline);
@@ -423,38 +747,105 @@ st_theme_node_hash (StThemeNode *node)
   return hash;
 }
 
+/* The signature is interned in @theme, which is usually the node's own
+ * theme; in that case it is cached on the node. */
+static StThemeStyleSignature *
+get_style_signature (StThemeNode *node,
+                     StTheme     *theme)
+{
+  StThemeStyleSignature *parent_signature = NULL;
+  StThemeStyleSignature *signature;
+
+  if (node->style_signature != NULL && node->theme == theme)
+    return _st_theme_style_signature_ref (node->style_signature);
+
+  if (node->parent_node)
+    parent_signature = get_style_signature (node->parent_node, theme);
+
+  signature = _st_theme_intern_style_signature (theme,
+                                                parent_signature,
+                                                node->element_type,
+                                                node->element_id,
+                                                node->element_classes,
+                                                node->pseudo_classes);
+
+  g_clear_pointer (&parent_signature, _st_theme_style_signature_unref);
+
+  if (node->theme == theme)
+    node->style_signature = _st_theme_style_signature_ref (signature);
+
+  return signature;
+}
+
 static void
 ensure_properties (StThemeNode *node)
 {
   if (!node->properties_computed)
     {
-      GPtrArray *properties = NULL;
-
       node->properties_computed = TRUE;
 
       if (node->theme)
-        properties = _st_theme_get_matched_properties (node->theme, node);
+        {
+          StThemeStyleSignature *signature;
+
+          signature = get_style_signature (node, node->theme);
+          node->declarations =
+            _st_theme_get_matched_declarations (node->theme, signature, node);
+          _st_theme_style_signature_unref (signature);
+        }
 
       if (node->inline_style && *node->inline_style != '\0')
         {
+          g_autoptr (GPtrArray) properties = NULL;
           CRDeclaration *cur_decl;
+          int i;
 
-          if (!properties)
-            properties = g_ptr_array_new ();
+          properties = g_ptr_array_new ();
+          if (node->declarations)
+            {
+              for (i = 0; i < node->declarations->n_properties; i++)
+                g_ptr_array_add (properties, node->declarations->properties[i]);
+            }
 
           node->inline_properties = _st_theme_parse_declaration_list (node->inline_style);
           for (cur_decl = node->inline_properties; cur_decl; cur_decl = cur_decl->next)
             g_ptr_array_add (properties, cur_decl);
+
+          g_clear_pointer (&node->declarations, _st_theme_declarations_unref);
+          node->declarations = _st_theme_declarations_new ((CRDeclaration **) properties->pdata,
+                                                           properties->len);
         }
 
-      if (properties)
+      if (node->declarations)
         {
-          node->n_properties = properties->len;
-          node->properties = (CRDeclaration **)g_ptr_array_free (properties, FALSE);
+          node->properties = node->declarations->properties;
+          node->n_properties = node->declarations->n_properties;
         }
     }
 }
 
+/* Iterate over the declarations of a property from highest to lowest
+ * priority, without having to compare property names:
+ *
+ *   for (i = find_last_property (node, id); i >= 0; i = find_previous_property (node, i))
+ */
+static inline int
+find_last_property (StThemeNode *node,
+                    guint        property_id)
+{
+  if (node->declarations == NULL)
+    return -1;
+
+  return _st_theme_declarations_find_last (node->declarations, property_id);
+}
+
+static inline int
+find_previous_property (StThemeNode *node,
+                        int          index)
+{
+  return node->declarations->prev_index[index];
+}
+
 typedef enum {
   VALUE_FOUND,
   VALUE_NOT_FOUND,
@@ -877,6 +1268,42 @@ get_color_from_term (StThemeNode  *node,
   return VALUE_FOUND;
 }
 
+static gboolean
+lookup_color (StThemeNode *node,
+              guint        property_id,
+              gboolean     inherit,
+              CoglColor   *color)
+{
+  int i;
+
+  ensure_properties (node);
+
+  for (i = find_last_property (node, property_id);
+       i >= 0;
+       i = find_previous_property (node, i))
+    {
+      CRDeclaration *decl = node->properties[i];
+
+      GetFromTermResult result = get_color_from_term (node, decl->value, color);
+      if (result == VALUE_FOUND)
+        {
+          return TRUE;
+        }
+      else if (result == VALUE_INHERIT)
+        {
+          if (node->parent_node)
+            return lookup_color (node->parent_node, property_id, inherit, color);
+          else
+            break;
+        }
+    }
+
+  if (inherit && node->parent_node)
+    return lookup_color (node->parent_node, property_id, inherit, color);
+
+  return FALSE;
+}
+
 /**
  * st_theme_node_lookup_color:
  * @node: a #StThemeNode
@@ -906,39 +1333,13 @@ st_theme_node_lookup_color (StThemeNode  *node,
                             gboolean      inherit,
                             CoglColor    *color)
 {
-
-  int i;
-
-  g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
+  g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
-  ensure_properties (node);
-
-  for (i = node->n_properties - 1; i >= 0; i--)
-    {
-      CRDeclaration *decl = node->properties[i];
-
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          GetFromTermResult result = get_color_from_term (node, decl->value, color);
-          if (result == VALUE_FOUND)
-            {
-              return TRUE;
-            }
-          else if (result == VALUE_INHERIT)
-            {
-              if (node->parent_node)
-                return st_theme_node_lookup_color (node->parent_node, property_name, inherit, color);
-              else
-                break;
-            }
-        }
-    }
-
-  if (inherit && node->parent_node)
-    return st_theme_node_lookup_color (node->parent_node, property_name, inherit, color);
-
-  return FALSE;
+  return lookup_color (node,
+                       cr_declaration_lookup_property_id (property_name),
+                       inherit,
+                       color);
 }
 
 /**
@@ -972,6 +1373,38 @@ st_theme_node_get_color (StThemeNode  *node,
     }
 }
 
+static gboolean
+lookup_double (StThemeNode *node,
+               guint        property_id,
+               gboolean     inherit,
+               double      *value)
+{
+  gboolean result = FALSE;
+  int i;
+
+  ensure_properties (node);
+
+  for (i = find_last_property (node, property_id);
+       i >= 0;
+       i = find_previous_property (node, i))
+    {
+      CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
+
+      if (term->type != TERM_NUMBER || term->content.num->type != NUM_GENERIC)
+        continue;
+
+      *value = term->content.num->val;
+      result = TRUE;
+      break;
+    }
+
+  if (!result && inherit && node->parent_node)
+    result = lookup_double (node->parent_node, property_id, inherit, value);
+
+  return result;
+}
+
 /**
  * st_theme_node_lookup_double:
  * @node: a #StThemeNode
@@ -998,34 +1431,52 @@ st_theme_node_lookup_double (StThemeNode *node,
                              const char  *property_name,
                              gboolean     inherit,
                              double      *value)
+{
+  g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
+  g_return_val_if_fail (property_name != NULL, FALSE);
+
+  return lookup_double (node,
+                        cr_declaration_lookup_property_id (property_name),
+                        inherit,
+                        value);
+}
+
+static gboolean
+lookup_time (StThemeNode *node,
+             guint        property_id,
+             gboolean     inherit,
+             double      *value)
 {
   gboolean result = FALSE;
   int i;
 
-  g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
-  g_return_val_if_fail (property_name != NULL, FALSE);
-
   ensure_properties (node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  for (i = find_last_property (node, property_id);
+       i >= 0;
+       i = find_previous_property (node, i))
     {
       CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
+      int factor = 1;
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          CRTerm *term = decl->value;
+      if (term->type != TERM_NUMBER)
+        continue;
 
-          if (term->type != TERM_NUMBER || term->content.num->type != NUM_GENERIC)
-            continue;
+      if (term->content.num->type != NUM_TIME_S &&
+          term->content.num->type != NUM_TIME_MS)
+        continue;
 
-          *value = term->content.num->val;
-          result = TRUE;
-          break;
-        }
+      if (term->content.num->type == NUM_TIME_S)
+        factor = 1000;
+
+      *value = factor * term->content.num->val;
+      result = TRUE;
+      break;
     }
 
   if (!result && inherit && node->parent_node)
-    result = st_theme_node_lookup_double (node->parent_node, property_name, inherit, value);
+    result = lookup_time (node->parent_node, property_id, inherit, value);
 
   return result;
 }
@@ -1055,43 +1506,13 @@ st_theme_node_lookup_time (StThemeNode *node,
                            gboolean     inherit,
                            double      *value)
 {
-  gboolean result = FALSE;
-  int i;
-
-  g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
+  g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
-  ensure_properties (node);
-
-  for (i = node->n_properties - 1; i >= 0; i--)
-    {
-      CRDeclaration *decl = node->properties[i];
-
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          CRTerm *term = decl->value;
-          int factor = 1;
-
-          if (term->type != TERM_NUMBER)
-            continue;
-
-          if (term->content.num->type != NUM_TIME_S &&
-              term->content.num->type != NUM_TIME_MS)
-            continue;
-
-          if (term->content.num->type == NUM_TIME_S)
-            factor = 1000;
-
-          *value = factor * term->content.num->val;
-          result = TRUE;
-          break;
-        }
-    }
-
-  if (!result && inherit && node->parent_node)
-    result = st_theme_node_lookup_time (node->parent_node, property_name, inherit, value);
-
-  return result;
+  return lookup_time (node,
+                      cr_declaration_lookup_property_id (property_name),
+                      inherit,
+                      value);
 }
 
 /**
@@ -1124,6 +1545,46 @@ st_theme_node_get_double (StThemeNode *node,
     }
 }
 
+static gboolean
+lookup_url (StThemeNode *node,
+            guint        property_id,
+            gboolean     inherit,
+            GFile      **file)
+{
+  gboolean result = FALSE;
+  int i;
+
+  ensure_properties (node);
+
+  for (i = find_last_property (node, property_id);
+       i >= 0;
+       i = find_previous_property (node, i))
+    {
+      CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
+      CRStyleSheet *base_stylesheet;
+
+      if (term->type != TERM_URI && term->type != TERM_STRING)
+        continue;
+
+      if (decl->parent_statement != NULL)
+        base_stylesheet = decl->parent_statement->parent_sheet;
+      else
+        base_stylesheet = NULL;
+
+      *file = _st_theme_resolve_url (node->theme,
+                                     base_stylesheet,
+                                     decl->value->content.str->stryng->str);
+      result = TRUE;
+      break;
+    }
+
+  if (!result && inherit && node->parent_node)
+    result = lookup_url (node->parent_node, property_id, inherit, file);
+
+  return result;
+}
+
 /**
  * st_theme_node_lookup_url:
  * @node: a #StThemeNode
@@ -1150,43 +1611,13 @@ st_theme_node_lookup_url (StThemeNode  *node,
                           gboolean      inherit,
                           GFile       **file)
 {
-  gboolean result = FALSE;
-  int i;
-
-  g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
+  g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
-  ensure_properties (node);
-
-  for (i = node->n_properties - 1; i >= 0; i--)
-    {
-      CRDeclaration *decl = node->properties[i];
-
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          CRTerm *term = decl->value;
-          CRStyleSheet *base_stylesheet;
-
-          if (term->type != TERM_URI && term->type != TERM_STRING)
-            continue;
-
-          if (decl->parent_statement != NULL)
-            base_stylesheet = decl->parent_statement->parent_sheet;
-          else
-            base_stylesheet = NULL;
-
-          *file = _st_theme_resolve_url (node->theme,
-                                         base_stylesheet,
-                                         decl->value->content.str->stryng->str);
-          result = TRUE;
-          break;
-        }
-    }
-
-  if (!result && inherit && node->parent_node)
-    result = st_theme_node_lookup_url (node->parent_node, property_name, inherit, file);
-
-  return result;
+  return lookup_url (node,
+                     cr_declaration_lookup_property_id (property_name),
+                     inherit,
+                     file);
 }
 
 /**
@@ -1398,28 +1829,48 @@ get_length_from_term_int (StThemeNode *node,
 
 static GetFromTermResult
 get_length_internal (StThemeNode *node,
-                     const char  *property_name,
+                     guint        property_id,
                      gdouble     *length)
 {
   int i;
 
   ensure_properties (node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  for (i = find_last_property (node, property_id);
+       i >= 0;
+       i = find_previous_property (node, i))
     {
       CRDeclaration *decl = node->properties[i];
+      GetFromTermResult result = get_length_from_term (node, decl->value, FALSE, length);
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          GetFromTermResult result = get_length_from_term (node, decl->value, FALSE, length);
-          if (result != VALUE_NOT_FOUND)
-            return result;
-        }
+      if (result != VALUE_NOT_FOUND)
+        return result;
     }
 
   return VALUE_NOT_FOUND;
 }
 
+static gboolean
+lookup_length (StThemeNode *node,
+               guint        property_id,
+               gboolean     inherit,
+               gdouble     *length)
+{
+  GetFromTermResult result;
+
+  result = get_length_internal (node, property_id, length);
+
+  if (result == VALUE_FOUND)
+    return TRUE;
+  else if (result == VALUE_INHERIT)
+    inherit = TRUE;
+
+  if (inherit && node->parent_node)
+    return lookup_length (node->parent_node, property_id, inherit, length);
+
+  return FALSE;
+}
+
 /**
  * st_theme_node_lookup_length:
  * @node: a #StThemeNode
@@ -1450,22 +1901,13 @@ st_theme_node_lookup_length (StThemeNode *node,
                              gboolean     inherit,
                              gdouble     *length)
 {
-  GetFromTermResult result;
-
-  g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
+  g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
-  result = get_length_internal (node, property_name, length);
-
-  if (result == VALUE_FOUND)
-    return TRUE;
-  else if (result == VALUE_INHERIT)
-    inherit = TRUE;
-
-  if (inherit && node->parent_node)
-    return st_theme_node_lookup_length (node->parent_node, property_name, inherit, length);
-
-  return FALSE;
+  return lookup_length (node,
+                        cr_declaration_lookup_property_id (property_name),
+                        inherit,
+                        length);
 }
 
 /**
@@ -1500,12 +1942,13 @@ st_theme_node_get_length (StThemeNode *node,
 }
 
 static void
-do_border_radius_term (StThemeNode *node,
-                       CRTerm      *term,
-                       gboolean     topleft,
-                       gboolean     topright,
-                       gboolean     bottomright,
-                       gboolean     bottomleft)
+do_border_radius_term (StThemeNode    *node,
+                       StThemeBorders *borders,
+                       CRTerm         *term,
+                       gboolean        topleft,
+                       gboolean        topright,
+                       gboolean        bottomright,
+                       gboolean        bottomleft)
 {
   int value;
 
@@ -1513,18 +1956,19 @@ do_border_radius_term (StThemeNode *node,
     return;
 
   if (topleft)
-    node->border_radius[ST_CORNER_TOPLEFT] = value;
+    borders->border_radius[ST_CORNER_TOPLEFT] = value;
   if (topright)
-    node->border_radius[ST_CORNER_TOPRIGHT] = value;
+    borders->border_radius[ST_CORNER_TOPRIGHT] = value;
   if (bottomright)
-    node->border_radius[ST_CORNER_BOTTOMRIGHT] = value;
+    borders->border_radius[ST_CORNER_BOTTOMRIGHT] = value;
   if (bottomleft)
-    node->border_radius[ST_CORNER_BOTTOMLEFT] = value;
+    borders->border_radius[ST_CORNER_BOTTOMLEFT] = value;
 }
 
 static void
-do_border_radius (StThemeNode   *node,
-                  CRDeclaration *decl)
+do_border_radius (StThemeNode    *node,
+                  StThemeBorders *borders,
+                  CRDeclaration  *decl)
 {
   const char *property_name = decl->property->stryng->str + 13; /* Skip 'border-radius' */
 
@@ -1538,26 +1982,26 @@ do_border_radius (StThemeNode   *node,
         return;
       else if (decl->value->next == NULL) /* 1 value */
         {
-          do_border_radius_term (node, decl->value,       TRUE, TRUE, TRUE, TRUE); /* all corners */
+          do_border_radius_term (node, borders, decl->value,       TRUE, TRUE, TRUE, TRUE); /* all corners */
           return;
         }
       else if (decl->value->next->next == NULL) /* 2 values */
         {
-          do_border_radius_term (node, decl->value,       TRUE,  FALSE,  TRUE,  FALSE);  /* topleft/bottomright */
-          do_border_radius_term (node, decl->value->next, FALSE,  TRUE,   FALSE, TRUE);  /* topright/bottomleft */
+          do_border_radius_term (node, borders, decl->value,       TRUE,  FALSE,  TRUE,  FALSE);  /* topleft/bottomright */
+          do_border_radius_term (node, borders, decl->value->next, FALSE,  TRUE,   FALSE, TRUE);  /* topright/bottomleft */
         }
       else if (decl->value->next->next->next == NULL) /* 3 values */
         {
-          do_border_radius_term (node, decl->value,             TRUE,  FALSE, FALSE, FALSE); /* topleft */
-          do_border_radius_term (node, decl->value->next,       FALSE, TRUE,  FALSE, TRUE);  /* topright/bottomleft */
-          do_border_radius_term (node, decl->value->next->next, FALSE, FALSE, TRUE,  FALSE);  /* bottomright */
+          do_border_radius_term (node, borders, decl->value,             TRUE,  FALSE, FALSE, FALSE); /* topleft */
+          do_border_radius_term (node, borders, decl->value->next,       FALSE, TRUE,  FALSE, TRUE);  /* topright/bottomleft */
+          do_border_radius_term (node, borders, decl->value->next->next, FALSE, FALSE, TRUE,  FALSE);  /* bottomright */
         }
       else if (decl->value->next->next->next->next == NULL) /* 4 values */
         {
-          do_border_radius_term (node, decl->value,                   TRUE,  FALSE, FALSE, FALSE); /* topleft */
-          do_border_radius_term (node, decl->value->next,             FALSE, TRUE,  FALSE, FALSE); /* topright */
-          do_border_radius_term (node, decl->value->next->next,       FALSE, FALSE, TRUE,  FALSE); /* bottomright */
-          do_border_radius_term (node, decl->value->next->next->next, FALSE, FALSE, FALSE, TRUE);  /* bottomleft */
+          do_border_radius_term (node, borders, decl->value,                   TRUE,  FALSE, FALSE, FALSE); /* topleft */
+          do_border_radius_term (node, borders, decl->value->next,             FALSE, TRUE,  FALSE, FALSE); /* topright */
+          do_border_radius_term (node, borders, decl->value->next->next,       FALSE, FALSE, TRUE,  FALSE); /* bottomright */
+          do_border_radius_term (node, borders, decl->value->next->next->next, FALSE, FALSE, FALSE, TRUE);  /* bottomleft */
         }
       else
         {
@@ -1571,19 +2015,21 @@ do_border_radius (StThemeNode   *node,
         return;
 
       if (strcmp (property_name, "-topleft") == 0)
-        do_border_radius_term (node, decl->value, TRUE,  FALSE, FALSE, FALSE);
+        do_border_radius_term (node, borders, decl->value, TRUE,  FALSE, FALSE, FALSE);
       else if (strcmp (property_name, "-topright") == 0)
-        do_border_radius_term (node, decl->value, FALSE, TRUE,  FALSE, FALSE);
+        do_border_radius_term (node, borders, decl->value, FALSE, TRUE,  FALSE, FALSE);
       else if (strcmp (property_name, "-bottomright") == 0)
-        do_border_radius_term (node, decl->value, FALSE, FALSE, TRUE,  FALSE);
+        do_border_radius_term (node, borders, decl->value, FALSE, FALSE, TRUE,  FALSE);
       else if (strcmp (property_name, "-bottomleft") == 0)
-        do_border_radius_term (node, decl->value, FALSE, FALSE, FALSE, TRUE);
+        do_border_radius_term (node, borders, decl->value, FALSE, FALSE, FALSE, TRUE);
     }
 }
 
 static void
-do_border_property (StThemeNode   *node,
-                    CRDeclaration *decl)
+do_border_property (StThemeNode     *node,
+                    StThemeGeometry *geometry,
+                    StThemeBorders  *borders,
+                    CRDeclaration   *decl)
 {
   const char *property_name = decl->property->stryng->str + 6; /* Skip 'border' */
   StSide side = (StSide)-1;
@@ -1593,9 +2039,14 @@ do_border_property (StThemeNode   *node,
   gboolean width_set = FALSE;
   int j;
 
+  /* Widths are resolved with the rest of the geometry, colors and
+   * radii only once the node is painted; either record may be %NULL
+   * to skip the corresponding half of the declaration.
+   */
   if (g_str_has_prefix (property_name, "-radius"))
     {
-      do_border_radius (node, decl);
+      if (borders != NULL)
+        do_border_radius (node, borders, decl);
       return;
     }
 
@@ -1668,6 +2119,9 @@ do_border_property (StThemeNode   *node,
                 }
             }
 
+          if (borders == NULL)
+            continue;
+
           result = get_color_from_term (node, term, &color);
           if (result != VALUE_NOT_FOUND)
             {
@@ -1679,7 +2133,7 @@ do_border_property (StThemeNode   *node,
     }
   else if (strcmp (property_name, "-color") == 0)
     {
-      if (decl->value == NULL || decl->value->next != NULL)
+      if (borders == NULL || decl->value == NULL || decl->value->next != NULL)
         return;
 
       if (get_color_from_term (node, decl->value, &color) == VALUE_FOUND)
@@ -1688,7 +2142,7 @@ do_border_property (StThemeNode   *node,
     }
   else if (strcmp (property_name, "-width") == 0)
     {
-      if (decl->value == NULL || decl->value->next != NULL)
+      if (geometry == NULL || decl->value == NULL || decl->value->next != NULL)
         return;
 
       if (get_length_from_term_int (node, decl->value, FALSE, &width) == VALUE_FOUND)
@@ -1700,24 +2154,25 @@ do_border_property (StThemeNode   *node,
     {
       for (j = 0; j < 4; j++)
         {
-          if (color_set)
-            node->border_color[j] = color;
-          if (width_set)
-            node->border_width[j] = width;
+          if (color_set && borders != NULL)
+            borders->border_color[j] = color;
+          if (width_set && geometry != NULL)
+            geometry->border_width[j] = width;
         }
     }
   else
     {
-      if (color_set)
-        node->border_color[side] = color;
-      if (width_set)
-        node->border_width[side] = width;
+      if (color_set && borders != NULL)
+        borders->border_color[side] = color;
+      if (width_set && geometry != NULL)
+        geometry->border_width[side] = width;
     }
 }
 
 static void
-do_outline_property (StThemeNode   *node,
-                     CRDeclaration *decl)
+do_outline_property (StThemeNode    *node,
+                     StThemeBorders *borders,
+                     CRDeclaration  *decl)
 {
   const char *property_name = decl->property->stryng->str + 7; /* Skip 'outline' */
   CoglColor color;
@@ -1802,18 +2257,19 @@ do_outline_property (StThemeNode   *node,
     }
 
   if (color_set)
-    node->outline_color = color;
+    borders->outline_color = color;
   if (width_set)
-    node->outline_width = width;
+    borders->outline_width = width;
 }
 
 static void
-do_padding_property_term (StThemeNode *node,
-                          CRTerm      *term,
-                          gboolean     left,
-                          gboolean     right,
-                          gboolean     top,
-                          gboolean     bottom)
+do_padding_property_term (StThemeNode     *node,
+                          StThemeGeometry *geometry,
+                          CRTerm          *term,
+                          gboolean         left,
+                          gboolean         right,
+                          gboolean         top,
+                          gboolean         bottom)
 {
   int value;
 
@@ -1821,18 +2277,19 @@ do_padding_property_term (StThemeNode *node,
     return;
 
   if (left)
-    node->padding[ST_SIDE_LEFT] = value;
+    geometry->padding[ST_SIDE_LEFT] = value;
   if (right)
-    node->padding[ST_SIDE_RIGHT] = value;
+    geometry->padding[ST_SIDE_RIGHT] = value;
   if (top)
-    node->padding[ST_SIDE_TOP] = value;
+    geometry->padding[ST_SIDE_TOP] = value;
   if (bottom)
-    node->padding[ST_SIDE_BOTTOM] = value;
+    geometry->padding[ST_SIDE_BOTTOM] = value;
 }
 
 static void
-do_padding_property (StThemeNode   *node,
-                     CRDeclaration *decl)
+do_padding_property (StThemeNode     *node,
+                     StThemeGeometry *geometry,
+                     CRDeclaration   *decl)
 {
   const char *property_name = decl->property->stryng->str + 7; /* Skip 'padding' */
 
@@ -1846,26 +2303,26 @@ do_padding_property (StThemeNode   *node,
         return;
       else if (decl->value->next == NULL) /* 1 value */
         {
-          do_padding_property_term (node, decl->value, TRUE, TRUE, TRUE, TRUE); /* left/right/top/bottom */
+          do_padding_property_term (node, geometry, decl->value, TRUE, TRUE, TRUE, TRUE); /* left/right/top/bottom */
           return;
         }
       else if (decl->value->next->next == NULL) /* 2 values */
         {
-          do_padding_property_term (node, decl->value,       FALSE, FALSE, TRUE,  TRUE);  /* top/bottom */
-          do_padding_property_term (node, decl->value->next, TRUE, TRUE,   FALSE, FALSE); /* left/right */
+          do_padding_property_term (node, geometry, decl->value,       FALSE, FALSE, TRUE,  TRUE);  /* top/bottom */
+          do_padding_property_term (node, geometry, decl->value->next, TRUE, TRUE,   FALSE, FALSE); /* left/right */
         }
       else if (decl->value->next->next->next == NULL) /* 3 values */
         {
-          do_padding_property_term (node, decl->value,             FALSE, FALSE, TRUE,  FALSE); /* top */
-          do_padding_property_term (node, decl->value->next,       TRUE,  TRUE,  FALSE, FALSE); /* left/right */
-          do_padding_property_term (node, decl->value->next->next, FALSE, FALSE, FALSE, TRUE);  /* bottom */
+          do_padding_property_term (node, geometry, decl->value,             FALSE, FALSE, TRUE,  FALSE); /* top */
+          do_padding_property_term (node, geometry, decl->value->next,       TRUE,  TRUE,  FALSE, FALSE); /* left/right */
+          do_padding_property_term (node, geometry, decl->value->next->next, FALSE, FALSE, FALSE, TRUE);  /* bottom */
         }
       else if (decl->value->next->next->next->next == NULL) /* 4 values */
         {
-          do_padding_property_term (node, decl->value,                   FALSE, FALSE, TRUE,  FALSE); /* top */
-          do_padding_property_term (node, decl->value->next,             FALSE, TRUE,  FALSE, FALSE); /* right */
-          do_padding_property_term (node, decl->value->next->next,       FALSE, FALSE, FALSE, TRUE);  /* bottom */
-          do_padding_property_term (node, decl->value->next->next->next, TRUE,  FALSE, FALSE, FALSE); /* left */
+          do_padding_property_term (node, geometry, decl->value,                   FALSE, FALSE, TRUE,  FALSE); /* top */
+          do_padding_property_term (node, geometry, decl->value->next,             FALSE, TRUE,  FALSE, FALSE); /* right */
+          do_padding_property_term (node, geometry, decl->value->next->next,       FALSE, FALSE, FALSE, TRUE);  /* bottom */
+          do_padding_property_term (node, geometry, decl->value->next->next->next, TRUE,  FALSE, FALSE, FALSE); /* left */
         }
       else
         {
@@ -1879,23 +2336,24 @@ do_padding_property (StThemeNode   *node,
         return;
 
       if (strcmp (property_name, "-left") == 0)
-        do_padding_property_term (node, decl->value, TRUE,  FALSE, FALSE, FALSE);
+        do_padding_property_term (node, geometry, decl->value, TRUE,  FALSE, FALSE, FALSE);
       else if (strcmp (property_name, "-right") == 0)
-        do_padding_property_term (node, decl->value, FALSE, TRUE,  FALSE, FALSE);
+        do_padding_property_term (node, geometry, decl->value, FALSE, TRUE,  FALSE, FALSE);
       else if (strcmp (property_name, "-top") == 0)
-        do_padding_property_term (node, decl->value, FALSE, FALSE, TRUE,  FALSE);
+        do_padding_property_term (node, geometry, decl->value, FALSE, FALSE, TRUE,  FALSE);
       else if (strcmp (property_name, "-bottom") == 0)
-        do_padding_property_term (node, decl->value, FALSE, FALSE, FALSE, TRUE);
+        do_padding_property_term (node, geometry, decl->value, FALSE, FALSE, FALSE, TRUE);
     }
 }
 
 static void
-do_margin_property_term (StThemeNode *node,
-                         CRTerm      *term,
-                         gboolean     left,
-                         gboolean     right,
-                         gboolean     top,
-                         gboolean     bottom)
+do_margin_property_term (StThemeNode     *node,
+                         StThemeGeometry *geometry,
+                         CRTerm          *term,
+                         gboolean         left,
+                         gboolean         right,
+                         gboolean         top,
+                         gboolean         bottom)
 {
   int value;
 
@@ -1903,18 +2361,19 @@ do_margin_property_term (StThemeNode *node,
     return;
 
   if (left)
-    node->margin[ST_SIDE_LEFT] = value;
+    geometry->margin[ST_SIDE_LEFT] = value;
   if (right)
-    node->margin[ST_SIDE_RIGHT] = value;
+    geometry->margin[ST_SIDE_RIGHT] = value;
   if (top)
-    node->margin[ST_SIDE_TOP] = value;
+    geometry->margin[ST_SIDE_TOP] = value;
   if (bottom)
-    node->margin[ST_SIDE_BOTTOM] = value;
+    geometry->margin[ST_SIDE_BOTTOM] = value;
 }
 
 static void
-do_margin_property (StThemeNode   *node,
-                    CRDeclaration *decl)
+do_margin_property (StThemeNode     *node,
+                    StThemeGeometry *geometry,
+                    CRDeclaration   *decl)
 {
   const char *property_name = decl->property->stryng->str + 6; /* Skip 'margin' */
 
@@ -1928,26 +2387,26 @@ do_margin_property (StThemeNode   *node,
         return;
       else if (decl->value->next == NULL) /* 1 value */
         {
-          do_margin_property_term (node, decl->value, TRUE, TRUE, TRUE, TRUE); /* left/right/top/bottom */
+          do_margin_property_term (node, geometry, decl->value, TRUE, TRUE, TRUE, TRUE); /* left/right/top/bottom */
           return;
         }
       else if (decl->value->next->next == NULL) /* 2 values */
         {
-          do_margin_property_term (node, decl->value,       FALSE, FALSE, TRUE,  TRUE);  /* top/bottom */
-          do_margin_property_term (node, decl->value->next, TRUE, TRUE,   FALSE, FALSE); /* left/right */
+          do_margin_property_term (node, geometry, decl->value,       FALSE, FALSE, TRUE,  TRUE);  /* top/bottom */
+          do_margin_property_term (node, geometry, decl->value->next, TRUE, TRUE,   FALSE, FALSE); /* left/right */
         }
       else if (decl->value->next->next->next == NULL) /* 3 values */
         {
-          do_margin_property_term (node, decl->value,             FALSE, FALSE, TRUE,  FALSE); /* top */
-          do_margin_property_term (node, decl->value->next,       TRUE,  TRUE,  FALSE, FALSE); /* left/right */
-          do_margin_property_term (node, decl->value->next->next, FALSE, FALSE, FALSE, TRUE);  /* bottom */
+          do_margin_property_term (node, geometry, decl->value,             FALSE, FALSE, TRUE,  FALSE); /* top */
+          do_margin_property_term (node, geometry, decl->value->next,       TRUE,  TRUE,  FALSE, FALSE); /* left/right */
+          do_margin_property_term (node, geometry, decl->value->next->next, FALSE, FALSE, FALSE, TRUE);  /* bottom */
         }
       else if (decl->value->next->next->next->next == NULL) /* 4 values */
         {
-          do_margin_property_term (node, decl->value,                   FALSE, FALSE, TRUE,  FALSE); /* top */
-          do_margin_property_term (node, decl->value->next,             FALSE, TRUE,  FALSE, FALSE); /* right */
-          do_margin_property_term (node, decl->value->next->next,       FALSE, FALSE, FALSE, TRUE);  /* bottom */
-          do_margin_property_term (node, decl->value->next->next->next, TRUE,  FALSE, FALSE, FALSE); /* left */
+          do_margin_property_term (node, geometry, decl->value,                   FALSE, FALSE, TRUE,  FALSE); /* top */
+          do_margin_property_term (node, geometry, decl->value->next,             FALSE, TRUE,  FALSE, FALSE); /* right */
+          do_margin_property_term (node, geometry, decl->value->next->next,       FALSE, FALSE, FALSE, TRUE);  /* bottom */
+          do_margin_property_term (node, geometry, decl->value->next->next->next, TRUE,  FALSE, FALSE, FALSE); /* left */
         }
       else
         {
@@ -1961,13 +2420,13 @@ do_margin_property (StThemeNode   *node,
         return;
 
       if (strcmp (property_name, "-left") == 0)
-        do_margin_property_term (node, decl->value, TRUE,  FALSE, FALSE, FALSE);
+        do_margin_property_term (node, geometry, decl->value, TRUE,  FALSE, FALSE, FALSE);
       else if (strcmp (property_name, "-right") == 0)
-        do_margin_property_term (node, decl->value, FALSE, TRUE,  FALSE, FALSE);
+        do_margin_property_term (node, geometry, decl->value, FALSE, TRUE,  FALSE, FALSE);
       else if (strcmp (property_name, "-top") == 0)
-        do_margin_property_term (node, decl->value, FALSE, FALSE, TRUE,  FALSE);
+        do_margin_property_term (node, geometry, decl->value, FALSE, FALSE, TRUE,  FALSE);
       else if (strcmp (property_name, "-bottom") == 0)
-        do_margin_property_term (node, decl->value, FALSE, FALSE, FALSE, TRUE);
+        do_margin_property_term (node, geometry, decl->value, FALSE, FALSE, FALSE, TRUE);
     }
 }
 
@@ -1988,33 +2447,29 @@ do_size_property (StThemeNode   *node,
 void
 _st_theme_node_ensure_geometry (StThemeNode *node)
 {
-  int i, j;
+  StThemeGeometry geometry;
+  int i;
   int width, height;
 
   if (node->geometry_computed)
     return;
 
   node->geometry_computed = TRUE;
+  group_computations[ST_THEME_NODE_GROUP_GEOMETRY]++;
 
   ensure_properties (node);
 
-  for (j = 0; j < 4; j++)
-    {
-      node->border_width[j] = 0;
-      node->border_color[j] = TRANSPARENT_COLOR;
-    }
-
-  node->outline_width = 0;
-  node->outline_color = TRANSPARENT_COLOR;
+  /* Zero any padding too, the records are hashed bytewise */
+  memset (&geometry, 0, sizeof (geometry));
 
   width = -1;
   height = -1;
-  node->width = -1;
-  node->height = -1;
-  node->min_width = -1;
-  node->min_height = -1;
-  node->max_width = -1;
-  node->max_height = -1;
+  geometry.width = -1;
+  geometry.height = -1;
+  geometry.min_width = -1;
+  geometry.min_height = -1;
+  geometry.max_width = -1;
+  geometry.max_height = -1;
 
   for (i = 0; i < node->n_properties; i++)
     {
@@ -2022,29 +2477,27 @@ _st_theme_node_ensure_geometry (StThemeNode *node)
       const char *property_name = decl->property->stryng->str;
 
       if (g_str_has_prefix (property_name, "border"))
-        do_border_property (node, decl);
-      else if (g_str_has_prefix (property_name, "outline"))
-        do_outline_property (node, decl);
+        do_border_property (node, &geometry, NULL, decl);
       else if (g_str_has_prefix (property_name, "padding"))
-        do_padding_property (node, decl);
+        do_padding_property (node, &geometry, decl);
       else if (g_str_has_prefix (property_name, "margin"))
-        do_margin_property (node, decl);
-      else if (strcmp (property_name, "width") == 0)
+        do_margin_property (node, &geometry, decl);
+      else if (decl->property_id == known_property_ids[PROP_WIDTH])
         do_size_property (node, decl, &width);
-      else if (strcmp (property_name, "height") == 0)
+      else if (decl->property_id == known_property_ids[PROP_HEIGHT])
         do_size_property (node, decl, &height);
-      else if (strcmp (property_name, "-st-natural-width") == 0)
-        do_size_property (node, decl, &node->width);
-      else if (strcmp (property_name, "-st-natural-height") == 0)
-        do_size_property (node, decl, &node->height);
-      else if (strcmp (property_name, "min-width") == 0)
-        do_size_property (node, decl, &node->min_width);
-      else if (strcmp (property_name, "min-height") == 0)
-        do_size_property (node, decl, &node->min_height);
-      else if (strcmp (property_name, "max-width") == 0)
-        do_size_property (node, decl, &node->max_width);
-      else if (strcmp (property_name, "max-height") == 0)
-        do_size_property (node, decl, &node->max_height);
+      else if (decl->property_id == known_property_ids[PROP_ST_NATURAL_WIDTH])
+        do_size_property (node, decl, &geometry.width);
+      else if (decl->property_id == known_property_ids[PROP_ST_NATURAL_HEIGHT])
+        do_size_property (node, decl, &geometry.height);
+      else if (decl->property_id == known_property_ids[PROP_MIN_WIDTH])
+        do_size_property (node, decl, &geometry.min_width);
+      else if (decl->property_id == known_property_ids[PROP_MIN_HEIGHT])
+        do_size_property (node, decl, &geometry.min_height);
+      else if (decl->property_id == known_property_ids[PROP_MAX_WIDTH])
+        do_size_property (node, decl, &geometry.max_width);
+      else if (decl->property_id == known_property_ids[PROP_MAX_HEIGHT])
+        do_size_property (node, decl, &geometry.max_height);
     }
 
   /*
@@ -2053,37 +2506,78 @@ _st_theme_node_ensure_geometry (StThemeNode *node)
    * Setting min-width sets natural width too, so that the minimum
    * width reported by get_preferred_width() is always not greater
    * than the natural width.
-   * The natural width in node->width is actually a lower bound, the
+   * The natural width in geometry.width is actually a lower bound, the
    * actor is allowed to request something greater than that, but
    * not greater than max-width.
-   * We don't need to clamp node->width to be less than max_width,
+   * We don't need to clamp geometry.width to be less than max_width,
    * that's done by adjust_preferred_width.
    */
   if (width != -1)
     {
-      if (node->width == -1)
-        node->width = width;
-      if (node->min_width == -1)
-        node->min_width = width;
-      if (node->max_width == -1)
-        node->max_width = width;
+      if (geometry.width == -1)
+        geometry.width = width;
+      if (geometry.min_width == -1)
+        geometry.min_width = width;
+      if (geometry.max_width == -1)
+        geometry.max_width = width;
     }
 
-  if (node->width < node->min_width)
-    node->width = node->min_width;
+  if (geometry.width < geometry.min_width)
+    geometry.width = geometry.min_width;
 
   if (height != -1)
     {
-      if (node->height == -1)
-        node->height = height;
-      if (node->min_height == -1)
-        node->min_height = height;
-      if (node->max_height == -1)
-        node->max_height = height;
+      if (geometry.height == -1)
+        geometry.height = height;
+      if (geometry.min_height == -1)
+        geometry.min_height = height;
+      if (geometry.max_height == -1)
+        geometry.max_height = height;
+    }
+
+  if (geometry.height < geometry.min_height)
+    geometry.height = geometry.min_height;
+
+  _st_theme_geometry_unref (node->geometry);
+  node->geometry = intern_geometry (&geometry);
+}
+
+void
+_st_theme_node_ensure_borders (StThemeNode *node)
+{
+  StThemeBorders borders;
+  int i, j;
+
+  if (node->borders_computed)
+    return;
+
+  node->borders_computed = TRUE;
+  group_computations[ST_THEME_NODE_GROUP_BORDERS]++;
+
+  ensure_properties (node);
+
+  /* Zero any padding too, the records are hashed bytewise */
+  memset (&borders, 0, sizeof (borders));
+
+  for (j = 0; j < 4; j++)
+    borders.border_color[j] = TRANSPARENT_COLOR;
+
+  borders.outline_width = 0;
+  borders.outline_color = TRANSPARENT_COLOR;
+
+  for (i = 0; i < node->n_properties; i++)
+    {
+      CRDeclaration *decl = node->properties[i];
+      const char *property_name = decl->property->stryng->str;
+
+      if (g_str_has_prefix (property_name, "border"))
+        do_border_property (node, NULL, &borders, decl);
+      else if (g_str_has_prefix (property_name, "outline"))
+        do_outline_property (node, &borders, decl);
     }
 
-  if (node->height < node->min_height)
-    node->height = node->min_height;
+  _st_theme_borders_unref (node->borders);
+  node->borders = intern_borders (&borders);
 }
 
 /**
@@ -2104,7 +2598,7 @@ st_theme_node_get_border_width (StThemeNode *node,
 
   _st_theme_node_ensure_geometry (node);
 
-  return node->border_width[side];
+  return node->geometry->border_width[side];
 }
 
 /**
@@ -2123,9 +2617,9 @@ st_theme_node_get_border_radius (StThemeNode *node,
   g_return_val_if_fail (ST_IS_THEME_NODE (node), 0.);
   g_return_val_if_fail (corner >= ST_CORNER_TOPLEFT && corner <= ST_CORNER_BOTTOMLEFT, 0.);
 
-  _st_theme_node_ensure_geometry (node);
+  _st_theme_node_ensure_borders (node);
 
-  return node->border_radius[corner];
+  return node->borders->border_radius[corner];
 }
 
 /**
@@ -2141,9 +2635,9 @@ st_theme_node_get_outline_width (StThemeNode  *node)
 {
   g_return_val_if_fail (ST_IS_THEME_NODE (node), 0);
 
-  _st_theme_node_ensure_geometry (node);
+  _st_theme_node_ensure_borders (node);
 
-  return node->outline_width;
+  return node->borders->outline_width;
 }
 
 /**
@@ -2159,9 +2653,9 @@ st_theme_node_get_outline_color (StThemeNode *node,
 {
   g_return_if_fail (ST_IS_THEME_NODE (node));
 
-  _st_theme_node_ensure_geometry (node);
+  _st_theme_node_ensure_borders (node);
 
-  *color = node->outline_color;
+  *color = node->borders->outline_color;
 }
 
 /**
@@ -2178,7 +2672,7 @@ st_theme_node_get_width (StThemeNode *node)
   g_return_val_if_fail (ST_IS_THEME_NODE (node), -1);
 
   _st_theme_node_ensure_geometry (node);
-  return node->width;
+  return node->geometry->width;
 }
 
 /**
@@ -2195,7 +2689,7 @@ st_theme_node_get_height (StThemeNode *node)
   g_return_val_if_fail (ST_IS_THEME_NODE (node), -1);
 
   _st_theme_node_ensure_geometry (node);
-  return node->height;
+  return node->geometry->height;
 }
 
 /**
@@ -2212,7 +2706,7 @@ st_theme_node_get_min_width (StThemeNode *node)
   g_return_val_if_fail (ST_IS_THEME_NODE (node), -1);
 
   _st_theme_node_ensure_geometry (node);
-  return node->min_width;
+  return node->geometry->min_width;
 }
 
 /**
@@ -2229,7 +2723,7 @@ st_theme_node_get_min_height (StThemeNode *node)
   g_return_val_if_fail (ST_IS_THEME_NODE (node), -1);
 
   _st_theme_node_ensure_geometry (node);
-  return node->min_height;
+  return node->geometry->min_height;
 }
 
 /**
@@ -2246,7 +2740,7 @@ st_theme_node_get_max_width (StThemeNode *node)
   g_return_val_if_fail (ST_IS_THEME_NODE (node), -1);
 
   _st_theme_node_ensure_geometry (node);
-  return node->max_width;
+  return node->geometry->max_width;
 }
 
 /**
@@ -2263,23 +2757,29 @@ st_theme_node_get_max_height (StThemeNode *node)
   g_return_val_if_fail (ST_IS_THEME_NODE (node), -1);
 
   _st_theme_node_ensure_geometry (node);
-  return node->max_height;
+  return node->geometry->max_height;
 }
 
 void
 _st_theme_node_ensure_background (StThemeNode *node)
 {
+  StThemeBackground background;
   int i;
 
   if (node->background_computed)
     return;
 
-  node->background_repeat = FALSE;
   node->background_computed = TRUE;
-  node->background_color = TRANSPARENT_COLOR;
-  node->background_gradient_type = ST_GRADIENT_NONE;
-  node->background_position_set = FALSE;
-  node->background_size = ST_BACKGROUND_SIZE_AUTO;
+  group_computations[ST_THEME_NODE_GROUP_BACKGROUND]++;
+
+  /* Zero any padding too, the record is hashed bytewise */
+  memset (&background, 0, sizeof (background));
+
+  background.repeat = FALSE;
+  background.color = TRANSPARENT_COLOR;
+  background.gradient_type = ST_GRADIENT_NONE;
+  background.position_set = FALSE;
+  background.size = ST_BACKGROUND_SIZE_AUTO;
 
   ensure_properties (node);
 
@@ -2303,29 +2803,29 @@ _st_theme_node_ensure_background (StThemeNode *node)
 
           CRTerm *term;
           /* background: property sets all terms to specified or default values */
-          node->background_color = TRANSPARENT_COLOR;
-          g_clear_object (&node->background_image);
-          node->background_position_set = FALSE;
-          node->background_size = ST_BACKGROUND_SIZE_AUTO;
+          background.color = TRANSPARENT_COLOR;
+          g_clear_object (&background.image);
+          background.position_set = FALSE;
+          background.size = ST_BACKGROUND_SIZE_AUTO;
 
           for (term = decl->value; term; term = term->next)
             {
-              GetFromTermResult result = get_color_from_term (node, term, &node->background_color);
+              GetFromTermResult result = get_color_from_term (node, term, &background.color);
               if (result == VALUE_FOUND)
                 {
-                  /* color stored in node->background_color */
+                  /* color stored in background.color */
                 }
               else if (result == VALUE_INHERIT)
                 {
                   if (node->parent_node)
                     {
-                      st_theme_node_get_background_color (node->parent_node, &node->background_color);
-                      node->background_image = g_object_ref (st_theme_node_get_background_image (node->parent_node));
+                      st_theme_node_get_background_color (node->parent_node, &background.color);
+                      background.image = g_object_ref (st_theme_node_get_background_image (node->parent_node));
                     }
                 }
               else if (term_is_none (term))
                 {
-                  /* leave node->background_color as transparent */
+                  /* leave background.color as transparent */
                 }
               else if (term->type == TERM_URI)
                 {
@@ -2341,37 +2841,37 @@ _st_theme_node_ensure_background (StThemeNode *node)
                                                 base_stylesheet,
                                                 term->content.str->stryng->str);
 
-                  node->background_image = file;
+                  background.image = file;
                 }
             }
         }
       else if (strcmp (property_name, "-position") == 0)
         {
-          GetFromTermResult result = get_length_from_term_int (node, decl->value, FALSE, &node->background_position_x);
+          GetFromTermResult result = get_length_from_term_int (node, decl->value, FALSE, &background.position_x);
           if (result == VALUE_NOT_FOUND)
             {
-              node->background_position_set = FALSE;
+              background.position_set = FALSE;
               continue;
             }
           else
-            node->background_position_set = TRUE;
+            background.position_set = TRUE;
 
-          result = get_length_from_term_int (node, decl->value->next, FALSE, &node->background_position_y);
+          result = get_length_from_term_int (node, decl->value->next, FALSE, &background.position_y);
 
           if (result == VALUE_NOT_FOUND)
             {
-              node->background_position_set = FALSE;
+              background.position_set = FALSE;
               continue;
             }
           else
-            node->background_position_set = TRUE;
+            background.position_set = TRUE;
         }
       else if (strcmp (property_name, "-repeat") == 0)
         {
           if (decl->value->type == TERM_IDENT)
             {
               if (strcmp (decl->value->content.str->stryng->str, "repeat") == 0)
-                node->background_repeat = TRUE;
+                background.repeat = TRUE;
             }
         }
       else if (strcmp (property_name, "-size") == 0)
@@ -2379,38 +2879,38 @@ _st_theme_node_ensure_background (StThemeNode *node)
           if (decl->value->type == TERM_IDENT)
             {
               if (strcmp (decl->value->content.str->stryng->str, "contain") == 0)
-                node->background_size = ST_BACKGROUND_SIZE_CONTAIN;
+                background.size = ST_BACKGROUND_SIZE_CONTAIN;
               else if (strcmp (decl->value->content.str->stryng->str, "cover") == 0)
-                node->background_size = ST_BACKGROUND_SIZE_COVER;
+                background.size = ST_BACKGROUND_SIZE_COVER;
               else if ((strcmp (decl->value->content.str->stryng->str, "auto") == 0) && (decl->value->next) && (decl->value->next->type == TERM_NUMBER))
                 {
-                  GetFromTermResult result = get_length_from_term_int (node, decl->value->next, FALSE, &node->background_size_h);
+                  GetFromTermResult result = get_length_from_term_int (node, decl->value->next, FALSE, &background.size_h);
 
-                  node->background_size_w = -1;
-                  node->background_size = (result == VALUE_FOUND) ? ST_BACKGROUND_SIZE_FIXED : ST_BACKGROUND_SIZE_AUTO;
+                  background.size_w = -1;
+                  background.size = (result == VALUE_FOUND) ? ST_BACKGROUND_SIZE_FIXED : ST_BACKGROUND_SIZE_AUTO;
                 }
               else
-                node->background_size = ST_BACKGROUND_SIZE_AUTO;
+                background.size = ST_BACKGROUND_SIZE_AUTO;
             }
           else if (decl->value->type == TERM_NUMBER)
             {
-              GetFromTermResult result = get_length_from_term_int (node, decl->value, FALSE, &node->background_size_w);
+              GetFromTermResult result = get_length_from_term_int (node, decl->value, FALSE, &background.size_w);
               if (result == VALUE_NOT_FOUND)
                 continue;
 
-              node->background_size = ST_BACKGROUND_SIZE_FIXED;
+              background.size = ST_BACKGROUND_SIZE_FIXED;
 
               if ((decl->value->next) && (decl->value->next->type == TERM_NUMBER))
                 {
-                  result = get_length_from_term_int (node, decl->value->next, FALSE, &node->background_size_h);
+                  result = get_length_from_term_int (node, decl->value->next, FALSE, &background.size_h);
 
                   if (result == VALUE_FOUND)
                     continue;
                 }
-              node->background_size_h = -1;
+              background.size_h = -1;
             }
           else
-            node->background_size = ST_BACKGROUND_SIZE_AUTO;
+            background.size = ST_BACKGROUND_SIZE_AUTO;
         }
       else if (strcmp (property_name, "-color") == 0)
         {
@@ -2419,15 +2919,15 @@ _st_theme_node_ensure_background (StThemeNode *node)
           if (decl->value == NULL || decl->value->next != NULL)
             continue;
 
-          result = get_color_from_term (node, decl->value, &node->background_color);
+          result = get_color_from_term (node, decl->value, &background.color);
           if (result == VALUE_FOUND)
             {
-              /* color stored in node->background_color */
+              /* color stored in background.color */
             }
           else if (result == VALUE_INHERIT)
             {
               if (node->parent_node)
-                st_theme_node_get_background_color (node->parent_node, &node->background_color);
+                st_theme_node_get_background_color (node->parent_node, &background.color);
             }
         }
       else if (strcmp (property_name, "-image") == 0)
@@ -2444,19 +2944,19 @@ _st_theme_node_ensure_background (StThemeNode *node)
               else
                 base_stylesheet = NULL;
 
-              g_clear_object (&node->background_image);
-              node->background_image = _st_theme_resolve_url (node->theme,
+              g_clear_object (&background.image);
+              background.image = _st_theme_resolve_url (node->theme,
                                                               base_stylesheet,
                                                               decl->value->content.str->stryng->str);
             }
           else if (term_is_inherit (decl->value))
             {
-              g_clear_object (&node->background_image);
-              node->background_image = g_object_ref (st_theme_node_get_background_image (node->parent_node));
+              g_clear_object (&background.image);
+              background.image = g_object_ref (st_theme_node_get_background_image (node->parent_node));
             }
           else if (term_is_none (decl->value))
             {
-              g_clear_object (&node->background_image);
+              g_clear_object (&background.image);
             }
         }
       else if (strcmp (property_name, "-gradient-direction") == 0)
@@ -2464,19 +2964,19 @@ _st_theme_node_ensure_background (StThemeNode *node)
           CRTerm *term = decl->value;
           if (strcmp (term->content.str->stryng->str, "vertical") == 0)
             {
-              node->background_gradient_type = ST_GRADIENT_VERTICAL;
+              background.gradient_type = ST_GRADIENT_VERTICAL;
             }
           else if (strcmp (term->content.str->stryng->str, "horizontal") == 0)
             {
-              node->background_gradient_type = ST_GRADIENT_HORIZONTAL;
+              background.gradient_type = ST_GRADIENT_HORIZONTAL;
             }
           else if (strcmp (term->content.str->stryng->str, "radial") == 0)
             {
-              node->background_gradient_type = ST_GRADIENT_RADIAL;
+              background.gradient_type = ST_GRADIENT_RADIAL;
             }
           else if (strcmp (term->content.str->stryng->str, "none") == 0)
             {
-              node->background_gradient_type = ST_GRADIENT_NONE;
+              background.gradient_type = ST_GRADIENT_NONE;
             }
           else
             {
@@ -2486,13 +2986,16 @@ _st_theme_node_ensure_background (StThemeNode *node)
         }
       else if (strcmp (property_name, "-gradient-start") == 0)
         {
-          get_color_from_term (node, decl->value, &node->background_color);
+          get_color_from_term (node, decl->value, &background.color);
         }
       else if (strcmp (property_name, "-gradient-end") == 0)
         {
-          get_color_from_term (node, decl->value, &node->background_gradient_end);
+          get_color_from_term (node, decl->value, &background.gradient_end);
         }
     }
+
+  _st_theme_background_unref (node->background);
+  node->background = intern_background (&background);
 }
 
 /**
@@ -2510,7 +3013,7 @@ st_theme_node_get_background_color (StThemeNode *node,
 
   _st_theme_node_ensure_background (node);
 
-  *color = node->background_color;
+  *color = node->background->color;
 }
 
 /**
@@ -2526,7 +3029,7 @@ st_theme_node_get_background_image (StThemeNode *node)
 
   _st_theme_node_ensure_background (node);
 
-  return node->background_image;
+  return node->background->image;
 }
 
 /**
@@ -2547,21 +3050,20 @@ st_theme_node_get_foreground_color (StThemeNode  *node,
       int i;
 
       node->foreground_computed = TRUE;
+      group_computations[ST_THEME_NODE_GROUP_FOREGROUND]++;
 
       ensure_properties (node);
 
-      for (i = node->n_properties - 1; i >= 0; i--)
+      for (i = find_last_property (node, known_property_ids[PROP_COLOR]);
+           i >= 0;
+           i = find_previous_property (node, i))
         {
           CRDeclaration *decl = node->properties[i];
-
-          if (strcmp (decl->property->stryng->str, "color") == 0)
-            {
-              GetFromTermResult result = get_color_from_term (node, decl->value, &node->foreground_color);
-              if (result == VALUE_FOUND)
-                goto out;
-              else if (result == VALUE_INHERIT)
-                break;
-            }
+          GetFromTermResult result = get_color_from_term (node, decl->value, &node->foreground_color);
+          if (result == VALUE_FOUND)
+            goto out;
+          else if (result == VALUE_INHERIT)
+            break;
         }
 
       if (node->parent_node)
@@ -2594,11 +3096,11 @@ st_theme_node_get_background_gradient (StThemeNode    *node,
 
   _st_theme_node_ensure_background (node);
 
-  *type = node->background_gradient_type;
+  *type = node->background->gradient_type;
   if (*type != ST_GRADIENT_NONE)
     {
-      *start = node->background_color;
-      *end = node->background_gradient_end;
+      *start = node->background->color;
+      *end = node->background->gradient_end;
     }
 }
 
@@ -2618,9 +3120,9 @@ st_theme_node_get_border_color (StThemeNode  *node,
   g_return_if_fail (ST_IS_THEME_NODE (node));
   g_return_if_fail (side >= ST_SIDE_TOP && side <= ST_SIDE_LEFT);
 
-  _st_theme_node_ensure_geometry (node);
+  _st_theme_node_ensure_borders (node);
 
-  *color = node->border_color[side];
+  *color = node->borders->border_color[side];
 }
 
 /**
@@ -2642,7 +3144,7 @@ st_theme_node_get_padding (StThemeNode *node,
 
   _st_theme_node_ensure_geometry (node);
 
-  return node->padding[side];
+  return node->geometry->padding[side];
 }
 
 /**
@@ -2664,7 +3166,7 @@ st_theme_node_get_margin (StThemeNode *node,
 
   _st_theme_node_ensure_geometry (node);
 
-  return node->margin[side];
+  return node->geometry->margin[side];
 }
 
 /**
@@ -2692,7 +3194,7 @@ st_theme_node_get_transition_duration (StThemeNode *node)
   if (node->transition_duration > -1)
     return factor * node->transition_duration;
 
-  st_theme_node_lookup_time (node, "transition-duration", FALSE, &value);
+  lookup_time (node, known_property_ids[PROP_TRANSITION_DURATION], FALSE, &value);
 
   node->transition_duration = (int)value;
 
@@ -2717,29 +3219,27 @@ st_theme_node_get_icon_style (StThemeNode *node)
 
   ensure_properties (node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  for (i = find_last_property (node, known_property_ids[PROP_ST_ICON_STYLE]);
+       i >= 0;
+       i = find_previous_property (node, i))
     {
       CRDeclaration *decl = node->properties[i];
+      CRTerm *term;
 
-      if (strcmp (decl->property->stryng->str, "-st-icon-style") == 0)
+      for (term = decl->value; term; term = term->next)
         {
-          CRTerm *term;
-
-          for (term = decl->value; term; term = term->next)
-            {
-              if (term->type != TERM_IDENT)
-                goto next_decl;
-
-              if (strcmp (term->content.str->stryng->str, "requested") == 0)
-                return ST_ICON_STYLE_REQUESTED;
-              else if (strcmp (term->content.str->stryng->str, "regular") == 0)
-                return ST_ICON_STYLE_REGULAR;
-              else if (strcmp (term->content.str->stryng->str, "symbolic") == 0)
-                return ST_ICON_STYLE_SYMBOLIC;
-              else
-                g_warning ("Unknown -st-icon-style \"%s\"",
-                           term->content.str->stryng->str);
-            }
+          if (term->type != TERM_IDENT)
+            goto next_decl;
+
+          if (strcmp (term->content.str->stryng->str, "requested") == 0)
+            return ST_ICON_STYLE_REQUESTED;
+          else if (strcmp (term->content.str->stryng->str, "regular") == 0)
+            return ST_ICON_STYLE_REGULAR;
+          else if (strcmp (term->content.str->stryng->str, "symbolic") == 0)
+            return ST_ICON_STYLE_SYMBOLIC;
+          else
+            g_warning ("Unknown -st-icon-style \"%s\"",
+                       term->content.str->stryng->str);
         }
 
     next_decl:
@@ -2769,59 +3269,57 @@ st_theme_node_get_text_decoration (StThemeNode *node)
 
   ensure_properties (node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  for (i = find_last_property (node, known_property_ids[PROP_TEXT_DECORATION]);
+       i >= 0;
+       i = find_previous_property (node, i))
     {
       CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
+      StTextDecoration decoration = 0;
 
-      if (strcmp (decl->property->stryng->str, "text-decoration") == 0)
+      /* Specification is none | [ underline || overline || line-through || blink ] | inherit
+       *
+       * We're a bit more liberal, and for example treat 'underline none' as the same as
+       * none.
+       */
+      for (; term; term = term->next)
         {
-          CRTerm *term = decl->value;
-          StTextDecoration decoration = 0;
+          if (term->type != TERM_IDENT)
+            goto next_decl;
 
-          /* Specification is none | [ underline || overline || line-through || blink ] | inherit
-           *
-           * We're a bit more liberal, and for example treat 'underline none' as the same as
-           * none.
-           */
-          for (; term; term = term->next)
+          if (strcmp (term->content.str->stryng->str, "none") == 0)
             {
-              if (term->type != TERM_IDENT)
-                goto next_decl;
-
-              if (strcmp (term->content.str->stryng->str, "none") == 0)
-                {
-                  return 0;
-                }
-              else if (strcmp (term->content.str->stryng->str, "inherit") == 0)
-                {
-                  if (node->parent_node)
-                    return st_theme_node_get_text_decoration (node->parent_node);
-                }
-              else if (strcmp (term->content.str->stryng->str, "underline") == 0)
-                {
-                  decoration |= ST_TEXT_DECORATION_UNDERLINE;
-                }
-              else if (strcmp (term->content.str->stryng->str, "overline") == 0)
-                {
-                  decoration |= ST_TEXT_DECORATION_OVERLINE;
-                }
-              else if (strcmp (term->content.str->stryng->str, "line-through") == 0)
-                {
-                  decoration |= ST_TEXT_DECORATION_LINE_THROUGH;
-                }
-              else if (strcmp (term->content.str->stryng->str, "blink") == 0)
-                {
-                  decoration |= ST_TEXT_DECORATION_BLINK;
-                }
-              else
-                {
-                  goto next_decl;
-                }
+              return 0;
+            }
+          else if (strcmp (term->content.str->stryng->str, "inherit") == 0)
+            {
+              if (node->parent_node)
+                return st_theme_node_get_text_decoration (node->parent_node);
+            }
+          else if (strcmp (term->content.str->stryng->str, "underline") == 0)
+            {
+              decoration |= ST_TEXT_DECORATION_UNDERLINE;
+            }
+          else if (strcmp (term->content.str->stryng->str, "overline") == 0)
+            {
+              decoration |= ST_TEXT_DECORATION_OVERLINE;
+            }
+          else if (strcmp (term->content.str->stryng->str, "line-through") == 0)
+            {
+              decoration |= ST_TEXT_DECORATION_LINE_THROUGH;
+            }
+          else if (strcmp (term->content.str->stryng->str, "blink") == 0)
+            {
+              decoration |= ST_TEXT_DECORATION_BLINK;
+            }
+          else
+            {
+              goto next_decl;
             }
-
-          return decoration;
         }
 
+      return decoration;
+
     next_decl:
       ;
     }
@@ -2846,47 +3344,45 @@ st_theme_node_get_text_align(StThemeNode *node)
 
   ensure_properties(node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  for (i = find_last_property (node, known_property_ids[PROP_TEXT_ALIGN]);
+       i >= 0;
+       i = find_previous_property (node, i))
     {
       CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
 
-      if (strcmp(decl->property->stryng->str, "text-align") == 0)
-        {
-          CRTerm *term = decl->value;
-
-          if (term->type != TERM_IDENT || term->next)
-            continue;
+      if (term->type != TERM_IDENT || term->next)
+        continue;
 
-          if (strcmp(term->content.str->stryng->str, "inherit") == 0)
-            {
-              if (node->parent_node)
-                return st_theme_node_get_text_align(node->parent_node);
-              return ST_TEXT_ALIGN_LEFT;
-            }
-          else if (strcmp(term->content.str->stryng->str, "start") == 0)
-            {
-              return ST_TEXT_ALIGN_START;
-            }
-          else if (strcmp(term->content.str->stryng->str, "end") == 0)
-            {
-              return ST_TEXT_ALIGN_END;
-            }
-          else if (strcmp(term->content.str->stryng->str, "left") == 0)
-            {
-              return ST_TEXT_ALIGN_LEFT;
-            }
-          else if (strcmp(term->content.str->stryng->str, "right") == 0)
-            {
-              return ST_TEXT_ALIGN_RIGHT;
-            }
-          else if (strcmp(term->content.str->stryng->str, "center") == 0)
-            {
-              return ST_TEXT_ALIGN_CENTER;
-            }
-          else if (strcmp(term->content.str->stryng->str, "justify") == 0)
-            {
-              return ST_TEXT_ALIGN_JUSTIFY;
-            }
+      if (strcmp(term->content.str->stryng->str, "inherit") == 0)
+        {
+          if (node->parent_node)
+            return st_theme_node_get_text_align(node->parent_node);
+          return ST_TEXT_ALIGN_LEFT;
+        }
+      else if (strcmp(term->content.str->stryng->str, "start") == 0)
+        {
+          return ST_TEXT_ALIGN_START;
+        }
+      else if (strcmp(term->content.str->stryng->str, "end") == 0)
+        {
+          return ST_TEXT_ALIGN_END;
+        }
+      else if (strcmp(term->content.str->stryng->str, "left") == 0)
+        {
+          return ST_TEXT_ALIGN_LEFT;
+        }
+      else if (strcmp(term->content.str->stryng->str, "right") == 0)
+        {
+          return ST_TEXT_ALIGN_RIGHT;
+        }
+      else if (strcmp(term->content.str->stryng->str, "center") == 0)
+        {
+          return ST_TEXT_ALIGN_CENTER;
+        }
+      else if (strcmp(term->content.str->stryng->str, "justify") == 0)
+        {
+          return ST_TEXT_ALIGN_JUSTIFY;
         }
     }
   if(node->parent_node)
@@ -2913,7 +3409,7 @@ st_theme_node_get_letter_spacing (StThemeNode *node)
 
   ensure_properties (node);
 
-  st_theme_node_lookup_length (node, "letter-spacing", FALSE, &spacing);
+  lookup_length (node, known_property_ids[PROP_LETTER_SPACING], FALSE, &spacing);
   return spacing;
 }
 
@@ -3207,6 +3703,8 @@ st_theme_node_get_font (StThemeNode *node)
   if (node->font_desc)
     return node->font_desc;
 
+  group_computations[ST_THEME_NODE_GROUP_FONT]++;
+
   node->font_desc = pango_font_description_copy (get_parent_font (node));
   parent_size = pango_font_description_get_size (node->font_desc);
   if (!pango_font_description_get_size_is_absolute (node->font_desc))
@@ -3221,7 +3719,7 @@ st_theme_node_get_font (StThemeNode *node)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, "font") == 0)
+      if (decl->property_id == known_property_ids[PROP_FONT])
         {
           PangoStyle tmp_style = PANGO_STYLE_NORMAL;
           PangoVariant tmp_variant = PANGO_VARIANT_NORMAL;
@@ -3290,7 +3788,7 @@ st_theme_node_get_font (StThemeNode *node)
           size_set = TRUE;
 
         }
-      else if (strcmp (decl->property->stryng->str, "font-family") == 0)
+      else if (decl->property_id == known_property_ids[PROP_FONT_FAMILY])
         {
           if (!font_family_from_terms (decl->value, &family))
             {
@@ -3298,7 +3796,7 @@ st_theme_node_get_font (StThemeNode *node)
               continue;
             }
         }
-      else if (strcmp (decl->property->stryng->str, "font-weight") == 0)
+      else if (decl->property_id == known_property_ids[PROP_FONT_WEIGHT])
         {
           if (decl->value == NULL || decl->value->next != NULL)
             continue;
@@ -3306,7 +3804,7 @@ st_theme_node_get_font (StThemeNode *node)
           if (font_weight_from_term (decl->value, &weight, &weight_absolute))
             weight_set = TRUE;
         }
-      else if (strcmp (decl->property->stryng->str, "font-style") == 0)
+      else if (decl->property_id == known_property_ids[PROP_FONT_STYLE])
         {
           if (decl->value == NULL || decl->value->next != NULL)
             continue;
@@ -3314,7 +3812,7 @@ st_theme_node_get_font (StThemeNode *node)
           if (font_style_from_term (decl->value, &font_style))
             font_style_set = TRUE;
         }
-      else if (strcmp (decl->property->stryng->str, "font-variant") == 0)
+      else if (decl->property_id == known_property_ids[PROP_FONT_VARIANT])
         {
           if (decl->value == NULL || decl->value->next != NULL)
             continue;
@@ -3322,7 +3820,7 @@ st_theme_node_get_font (StThemeNode *node)
           if (font_variant_from_term (decl->value, &variant))
             variant_set = TRUE;
         }
-      else if (strcmp (decl->property->stryng->str, "font-size") == 0)
+      else if (decl->property_id == known_property_ids[PROP_FONT_SIZE])
         {
           gdouble tmp_size;
           if (decl->value == NULL || decl->value->next != NULL)
@@ -3396,27 +3894,25 @@ st_theme_node_get_font_features (StThemeNode *node)
 
   ensure_properties (node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  for (i = find_last_property (node, known_property_ids[PROP_FONT_FEATURE_SETTINGS]);
+       i >= 0;
+       i = find_previous_property (node, i))
     {
       CRDeclaration *decl = node->properties[i];
+      CRTerm *term = decl->value;
 
-      if (strcmp (decl->property->stryng->str, "font-feature-settings") == 0)
+      if (!term->next && term->type == TERM_IDENT)
         {
-          CRTerm *term = decl->value;
-
-          if (!term->next && term->type == TERM_IDENT)
-            {
-              gchar *ident = term->content.str->stryng->str;
-
-              if (strcmp (ident, "inherit") == 0)
-                break;
+          gchar *ident = term->content.str->stryng->str;
 
-              if (strcmp (ident, "normal") == 0)
-                return NULL;
-            }
+          if (strcmp (ident, "inherit") == 0)
+            break;
 
-          return (gchar *)cr_term_to_string (term);
+          if (strcmp (ident, "normal") == 0)
+            return NULL;
         }
+
+      return (gchar *)cr_term_to_string (term);
     }
 
   return node->parent_node ? st_theme_node_get_font_features (node->parent_node) : NULL;
@@ -3443,118 +3939,117 @@ st_theme_node_get_border_image (StThemeNode *node)
 
   node->border_image = NULL;
   node->border_image_computed = TRUE;
+  group_computations[ST_THEME_NODE_GROUP_BORDER_IMAGE]++;
 
   ensure_properties (node);
 
-  for (i = node->n_properties - 1; i >= 0; i--)
+  for (i = find_last_property (node, known_property_ids[PROP_BORDER_IMAGE]);
+       i >= 0;
+       i = find_previous_property (node, i))
     {
       CRDeclaration *decl = node->properties[i];
-
-      if (strcmp (decl->property->stryng->str, "border-image") == 0)
+      CRTerm *term = decl->value;
+      CRStyleSheet *base_stylesheet;
+      int borders[4];
+      int n_borders = 0;
+      int j;
+
+      const char *url;
+      int border_top;
+      int border_right;
+      int border_bottom;
+      int border_left;
+
+      GFile *file;
+
+      /* Support border-image: none; to suppress a previously specified border image */
+      if (term_is_none (term))
         {
-          CRTerm *term = decl->value;
-          CRStyleSheet *base_stylesheet;
-          int borders[4];
-          int n_borders = 0;
-          int j;
-
-          const char *url;
-          int border_top;
-          int border_right;
-          int border_bottom;
-          int border_left;
-
-          GFile *file;
-
-          /* Support border-image: none; to suppress a previously specified border image */
-          if (term_is_none (term))
-            {
-              if (term->next == NULL)
-                return NULL;
-              else
-                goto next_property;
-            }
-
-          /* First term must be the URL to the image */
-          if (term->type != TERM_URI)
+          if (term->next == NULL)
+            return NULL;
+          else
             goto next_property;
+        }
 
-          url = term->content.str->stryng->str;
+      /* First term must be the URL to the image */
+      if (term->type != TERM_URI)
+        goto next_property;
 
-          term = term->next;
+      url = term->content.str->stryng->str;
 
-          /* Followed by 0 to 4 numbers or percentages. *Not lengths*. The interpretation
-           * of a number is supposed to be pixels if the image is pixel based, otherwise CSS pixels.
-           */
-          for (j = 0; j < 4; j++)
-            {
-              if (term == NULL)
-                break;
+      term = term->next;
 
-              if (term->type != TERM_NUMBER)
-                goto next_property;
+      /* Followed by 0 to 4 numbers or percentages. *Not lengths*. The interpretation
+       * of a number is supposed to be pixels if the image is pixel based, otherwise CSS pixels.
+       */
+      for (j = 0; j < 4; j++)
+        {
+          if (term == NULL)
+            break;
 
-              if (term->content.num->type == NUM_GENERIC)
-                {
-                  borders[n_borders] = (int)(0.5 + term->content.num->val);
-                  n_borders++;
-                }
-              else if (term->content.num->type == NUM_PERCENTAGE)
-                {
-                  /* This would be easiest to support if we moved image handling into StBorderImage */
-                  g_warning ("Percentages not supported for border-image");
-                  goto next_property;
-                }
-              else
-                goto next_property;
+          if (term->type != TERM_NUMBER)
+            goto next_property;
 
-              term = term->next;
+          if (term->content.num->type == NUM_GENERIC)
+            {
+              borders[n_borders] = (int)(0.5 + term->content.num->val);
+              n_borders++;
             }
-
-          switch (n_borders)
+          else if (term->content.num->type == NUM_PERCENTAGE)
             {
-            case 0:
-              border_top = border_right = border_bottom = border_left = 0;
-              break;
-            case 1:
-              border_top = border_right = border_bottom = border_left = borders[0];
-              break;
-            case 2:
-              border_top = border_bottom = borders[0];
-              border_left = border_right = borders[1];
-              break;
-            case 3:
-              border_top = borders[0];
-              border_left = border_right = borders[1];
-              border_bottom = borders[2];
-              break;
-            case 4:
-            default:
-              border_top = borders[0];
-              border_right = borders[1];
-              border_bottom = borders[2];
-              border_left = borders[3];
-              break;
+              /* This would be easiest to support if we moved image handling into StBorderImage */
+              g_warning ("Percentages not supported for border-image");
+              goto next_property;
             }
-
-          if (decl->parent_statement != NULL)
-            base_stylesheet = decl->parent_statement->parent_sheet;
           else
-            base_stylesheet = NULL;
+            goto next_property;
+
+          term = term->next;
+        }
 
-          file = _st_theme_resolve_url (node->theme, base_stylesheet, url);
+      switch (n_borders)
+        {
+        case 0:
+          border_top = border_right = border_bottom = border_left = 0;
+          break;
+        case 1:
+          border_top = border_right = border_bottom = border_left = borders[0];
+          break;
+        case 2:
+          border_top = border_bottom = borders[0];
+          border_left = border_right = borders[1];
+          break;
+        case 3:
+          border_top = borders[0];
+          border_left = border_right = borders[1];
+          border_bottom = borders[2];
+          break;
+        case 4:
+        default:
+          border_top = borders[0];
+          border_right = borders[1];
+          border_bottom = borders[2];
+          border_left = borders[3];
+          break;
+        }
 
-          if (file == NULL)
-            goto next_property;
+      if (decl->parent_statement != NULL)
+        base_stylesheet = decl->parent_statement->parent_sheet;
+      else
+        base_stylesheet = NULL;
 
-          node->border_image = st_border_image_new (file,
-                                                    border_top, border_right, border_bottom, border_left,
-                                                    node->cached_scale_factor);
+      file = _st_theme_resolve_url (node->theme, base_stylesheet, url);
 
-          g_object_unref (file);
+      if (file == NULL)
+        goto next_property;
 
-          return node->border_image;
-        }
+      node->border_image = st_border_image_new (file,
+                                                border_top, border_right, border_bottom, border_left,
+                                                node->cached_scale_factor);
+
+      g_object_unref (file);
+
+      return node->border_image;
 
     next_property:
       ;
@@ -3735,6 +4230,71 @@ parse_shadow_property (StThemeNode       *node,
     return VALUE_NOT_FOUND;
 }
 
+static gboolean
+lookup_shadow (StThemeNode *node,
+               guint        property_id,
+               gboolean     inherit,
+               StShadow   **shadow)
+{
+  CoglColor color = { 0., };
+  gdouble xoffset = 0.;
+  gdouble yoffset = 0.;
+  gdouble blur = 0.;
+  gdouble spread = 0.;
+  gboolean inset = FALSE;
+  gboolean is_none = FALSE;
+
+  int i;
+
+  ensure_properties (node);
+
+  for (i = find_last_property (node, property_id);
+       i >= 0;
+       i = find_previous_property (node, i))
+    {
+      CRDeclaration *decl = node->properties[i];
+
+      GetFromTermResult result = parse_shadow_property (node,
+                                                        decl,
+                                                        &color,
+                                                        &xoffset,
+                                                        &yoffset,
+                                                        &blur,
+                                                        &spread,
+                                                        &inset,
+                                                        &is_none);
+      if (result == VALUE_FOUND)
+        {
+          if (is_none)
+            return FALSE;
+
+          *shadow = st_shadow_new (&color,
+                                   xoffset, yoffset,
+                                   blur, spread,
+                                   inset);
+          return TRUE;
+        }
+      else if (result == VALUE_INHERIT)
+        {
+          if (node->parent_node)
+            return lookup_shadow (node->parent_node,
+                                  property_id,
+                                  inherit,
+                                  shadow);
+          else
+            break;
+        }
+    }
+
+    if (inherit && node->parent_node)
+      return lookup_shadow (node->parent_node,
+                            property_id,
+                            inherit,
+                            shadow);
+
+  return FALSE;
+}
+
 /**
  * st_theme_node_lookup_shadow:
  * @node: a #StThemeNode
@@ -3766,67 +4326,13 @@ st_theme_node_lookup_shadow (StThemeNode  *node,
                              gboolean      inherit,
                              StShadow    **shadow)
 {
-  CoglColor color = { 0., };
-  gdouble xoffset = 0.;
-  gdouble yoffset = 0.;
-  gdouble blur = 0.;
-  gdouble spread = 0.;
-  gboolean inset = FALSE;
-  gboolean is_none = FALSE;
-
-  int i;
-
   g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
-  ensure_properties (node);
-
-  for (i = node->n_properties - 1; i >= 0; i--)
-    {
-      CRDeclaration *decl = node->properties[i];
-
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
-        {
-          GetFromTermResult result = parse_shadow_property (node,
-                                                            decl,
-                                                            &color,
-                                                            &xoffset,
-                                                            &yoffset,
-                                                            &blur,
-                                                            &spread,
-                                                            &inset,
-                                                            &is_none);
-          if (result == VALUE_FOUND)
-            {
-              if (is_none)
-                return FALSE;
-
-              *shadow = st_shadow_new (&color,
-                                       xoffset, yoffset,
-                                       blur, spread,
-                                       inset);
-              return TRUE;
-            }
-          else if (result == VALUE_INHERIT)
-            {
-              if (node->parent_node)
-                return st_theme_node_lookup_shadow (node->parent_node,
-                                                    property_name,
-                                                    inherit,
-                                                    shadow);
-              else
-                break;
-            }
-        }
-    }
-
-    if (inherit && node->parent_node)
-      return st_theme_node_lookup_shadow (node->parent_node,
-                                          property_name,
-                                          inherit,
-                                          shadow);
-
-  return FALSE;
+  return lookup_shadow (node,
+                        cr_declaration_lookup_property_id (property_name),
+                        inherit,
+                        shadow);
 }
 
 /**
@@ -3880,11 +4386,12 @@ st_theme_node_get_box_shadow (StThemeNode *node)
 
   node->box_shadow = NULL;
   node->box_shadow_computed = TRUE;
+  group_computations[ST_THEME_NODE_GROUP_SHADOWS]++;
 
-  if (st_theme_node_lookup_shadow (node,
-                                   "box-shadow",
-                                   FALSE,
-                                   &shadow))
+  if (lookup_shadow (node,
+                     known_property_ids[PROP_BOX_SHADOW],
+                     FALSE,
+                     &shadow))
     {
       node->box_shadow = shadow;
 
@@ -3915,11 +4422,12 @@ st_theme_node_get_background_image_shadow (StThemeNode *node)
 
   node->background_image_shadow = NULL;
   node->background_image_shadow_computed = TRUE;
+  group_computations[ST_THEME_NODE_GROUP_SHADOWS]++;
 
-  if (st_theme_node_lookup_shadow (node,
-                                   "-st-background-image-shadow",
-                                   FALSE,
-                                   &shadow))
+  if (lookup_shadow (node,
+                     known_property_ids[PROP_ST_BACKGROUND_IMAGE_SHADOW],
+                     FALSE,
+                     &shadow))
     {
       if (shadow->inset)
         {
@@ -3958,10 +4466,10 @@ st_theme_node_get_text_shadow (StThemeNode *node)
 
   ensure_properties (node);
 
-  if (!st_theme_node_lookup_shadow (node,
-                                    "text-shadow",
-                                    FALSE,
-                                    &result))
+  if (!lookup_shadow (node,
+                      known_property_ids[PROP_TEXT_SHADOW],
+                      FALSE,
+                      &result))
     {
       if (node->parent_node)
         {
@@ -3980,6 +4488,7 @@ st_theme_node_get_text_shadow (StThemeNode *node)
 
   node->text_shadow = result;
   node->text_shadow_computed = TRUE;
+  group_computations[ST_THEME_NODE_GROUP_SHADOWS]++;
 
   return result;
 }
@@ -4018,6 +4527,8 @@ st_theme_node_get_icon_colors (StThemeNode *node)
   if (node->icon_colors)
     return node->icon_colors;
 
+  group_computations[ST_THEME_NODE_GROUP_ICON_COLORS]++;
+
   if (node->parent_node)
     {
       node->icon_colors = st_theme_node_get_icon_colors (node->parent_node);
@@ -4042,25 +4553,25 @@ st_theme_node_get_icon_colors (StThemeNode *node)
       guint found = 0;
 
       if ((still_need & FOREGROUND) != 0 &&
-          strcmp (decl->property->stryng->str, "color") == 0)
+          decl->property_id == known_property_ids[PROP_COLOR])
         {
           found = FOREGROUND;
           result = get_color_from_term (node, decl->value, &color);
         }
       else if ((still_need & WARNING) != 0 &&
-               strcmp (decl->property->stryng->str, "warning-color") == 0)
+               decl->property_id == known_property_ids[PROP_WARNING_COLOR])
         {
           found = WARNING;
           result = get_color_from_term (node, decl->value, &color);
         }
       else if ((still_need & ERROR) != 0 &&
-               strcmp (decl->property->stryng->str, "error-color") == 0)
+               decl->property_id == known_property_ids[PROP_ERROR_COLOR])
         {
           found = ERROR;
           result = get_color_from_term (node, decl->value, &color);
         }
       else if ((still_need & SUCCESS) != 0 &&
-               strcmp (decl->property->stryng->str, "success-color") == 0)
+               decl->property_id == known_property_ids[PROP_SUCCESS_COLOR])
         {
           found = SUCCESS;
           result = get_color_from_term (node, decl->value, &color);
@@ -4109,15 +4620,15 @@ st_theme_node_get_icon_colors (StThemeNode *node)
 static float
 get_width_inc (StThemeNode *node)
 {
-  return ((int)(0.5 + node->border_width[ST_SIDE_LEFT]) + node->padding[ST_SIDE_LEFT] +
-          (int)(0.5 + node->border_width[ST_SIDE_RIGHT]) + node->padding[ST_SIDE_RIGHT]);
+  return ((int)(0.5 + node->geometry->border_width[ST_SIDE_LEFT]) + node->geometry->padding[ST_SIDE_LEFT] +
+          (int)(0.5 + node->geometry->border_width[ST_SIDE_RIGHT]) + node->geometry->padding[ST_SIDE_RIGHT]);
 }
 
 static float
 get_height_inc (StThemeNode *node)
 {
-  return ((int)(0.5 + node->border_width[ST_SIDE_TOP]) + node->padding[ST_SIDE_TOP] +
-          (int)(0.5 + node->border_width[ST_SIDE_BOTTOM]) + node->padding[ST_SIDE_BOTTOM]);
+  return ((int)(0.5 + node->geometry->border_width[ST_SIDE_TOP]) + node->geometry->padding[ST_SIDE_TOP] +
+          (int)(0.5 + node->geometry->border_width[ST_SIDE_BOTTOM]) + node->geometry->padding[ST_SIDE_BOTTOM]);
 }
 
 /**
@@ -4172,17 +4683,17 @@ st_theme_node_adjust_preferred_width (StThemeNode  *node,
 
   if (min_width_p)
     {
-      if (node->min_width != -1)
-        *min_width_p = node->min_width;
+      if (node->geometry->min_width != -1)
+        *min_width_p = node->geometry->min_width;
       *min_width_p += width_inc;
     }
 
   if (natural_width_p)
     {
-      if (node->width != -1)
-        *natural_width_p = MAX (*natural_width_p, node->width);
-      if (node->max_width != -1)
-        *natural_width_p = MIN (*natural_width_p, node->max_width);
+      if (node->geometry->width != -1)
+        *natural_width_p = MAX (*natural_width_p, node->geometry->width);
+      if (node->geometry->max_width != -1)
+        *natural_width_p = MIN (*natural_width_p, node->geometry->max_width);
       *natural_width_p += width_inc;
     }
 }
@@ -4239,16 +4750,16 @@ st_theme_node_adjust_preferred_height (StThemeNode  *node,
 
   if (min_height_p)
     {
-      if (node->min_height != -1)
-        *min_height_p = node->min_height;
+      if (node->geometry->min_height != -1)
+        *min_height_p = node->geometry->min_height;
       *min_height_p += height_inc;
     }
   if (natural_height_p)
     {
-      if (node->height != -1)
-        *natural_height_p = MAX (*natural_height_p, node->height);
-      if (node->max_height != -1)
-        *natural_height_p = MIN (*natural_height_p, node->max_height);
+      if (node->geometry->height != -1)
+        *natural_height_p = MAX (*natural_height_p, node->geometry->height);
+      if (node->geometry->max_height != -1)
+        *natural_height_p = MIN (*natural_height_p, node->geometry->max_height);
       *natural_height_p += height_inc;
     }
 }
@@ -4279,10 +4790,10 @@ st_theme_node_get_content_box (StThemeNode           *node,
   avail_width = allocation->x2 - allocation->x1;
   avail_height = allocation->y2 - allocation->y1;
 
-  noncontent_left = node->border_width[ST_SIDE_LEFT] + node->padding[ST_SIDE_LEFT];
-  noncontent_top = node->border_width[ST_SIDE_TOP] + node->padding[ST_SIDE_TOP];
-  noncontent_right = node->border_width[ST_SIDE_RIGHT] + node->padding[ST_SIDE_RIGHT];
-  noncontent_bottom = node->border_width[ST_SIDE_BOTTOM] + node->padding[ST_SIDE_BOTTOM];
+  noncontent_left = node->geometry->border_width[ST_SIDE_LEFT] + node->geometry->padding[ST_SIDE_LEFT];
+  noncontent_top = node->geometry->border_width[ST_SIDE_TOP] + node->geometry->padding[ST_SIDE_TOP];
+  noncontent_right = node->geometry->border_width[ST_SIDE_RIGHT] + node->geometry->padding[ST_SIDE_RIGHT];
+  noncontent_bottom = node->geometry->border_width[ST_SIDE_BOTTOM] + node->geometry->padding[ST_SIDE_BOTTOM];
 
   content_box->x1 = (int)(0.5 + noncontent_left);
   content_box->y1 = (int)(0.5 + noncontent_top);
@@ -4382,14 +4893,33 @@ st_theme_node_get_paint_box (StThemeNode           *node,
     }
 }
 
+/**
+ * st_theme_node_get_group_computations:
+ * @group: a #StThemeNodeGroup
+ *
+ * Gets the number of times any #StThemeNode resolved the properties
+ * in @group since startup. Each node resolves a group at most once,
+ * and only when one of its properties is first looked up, so this
+ * can be used to profile how much style computation is done.
+ *
+ * Returns: the number of times @group was resolved
+ */
+guint
+st_theme_node_get_group_computations (StThemeNodeGroup group)
+{
+  g_return_val_if_fail (group < G_N_ELEMENTS (group_computations), 0);
+
+  return group_computations[group];
+}
+
 /**
  * st_theme_node_geometry_equal:
  * @node: a #StThemeNode
  * @other: a different #StThemeNode
  *
- * Tests if two theme nodes have the same borders and padding; this can be
- * used to optimize having to relayout when the style applied to a Clutter
- * actor changes colors without changing the geometry.
+ * Tests if two theme nodes have the same borders, padding, margins and size
+ * constraints; this can be used to optimize having to relayout when the style
+ * applied to a Clutter actor changes colors without changing the geometry.
  *
  * Returns: %TRUE if equal, %FALSE otherwise
  */
@@ -4397,8 +4927,6 @@ gboolean
 st_theme_node_geometry_equal (StThemeNode *node,
                               StThemeNode *other)
 {
-  StSide side;
-
   g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
 
   if (node == other)
@@ -4412,22 +4940,7 @@ st_theme_node_geometry_equal (StThemeNode *node,
   _st_theme_node_ensure_geometry (node);
   _st_theme_node_ensure_geometry (other);
 
-  for (side = ST_SIDE_TOP; side <= ST_SIDE_LEFT; side++)
-    {
-      if (node->border_width[side] != other->border_width[side])
-        return FALSE;
-      if (node->padding[side] != other->padding[side])
-        return FALSE;
-    }
-
-  if (node->width != other->width || node->height != other->height)
-    return FALSE;
-  if (node->min_width != other->min_width || node->min_height != other->min_height)
-    return FALSE;
-  if (node->max_width != other->max_width || node->max_height != other->max_height)
-    return FALSE;
-
-  return TRUE;
+  return node->geometry == other->geometry;
 }
 
 /**
@@ -4460,19 +4973,7 @@ st_theme_node_paint_equal (StThemeNode *node,
   _st_theme_node_ensure_background (node);
   _st_theme_node_ensure_background (other);
 
-  if (!cogl_color_equal (&node->background_color, &other->background_color))
-    return FALSE;
-
-  if (node->background_gradient_type != other->background_gradient_type)
-    return FALSE;
-
-  if (node->background_gradient_type != ST_GRADIENT_NONE &&
-      !cogl_color_equal (&node->background_gradient_end, &other->background_gradient_end))
-    return FALSE;
-
-  if ((node->background_image != NULL) &&
-      (other->background_image != NULL) &&
-      !g_file_equal (node->background_image, other->background_image))
+  if (node->background != other->background)
     return FALSE;
 
   _st_theme_node_ensure_geometry (node);
@@ -4480,22 +4981,14 @@ st_theme_node_paint_equal (StThemeNode *node,
 
   for (i = 0; i < 4; i++)
     {
-      if (node->border_width[i] != other->border_width[i])
-        return FALSE;
-
-      if (node->border_width[i] > 0 &&
-          !cogl_color_equal (&node->border_color[i], &other->border_color[i]))
-        return FALSE;
-
-      if (node->border_radius[i] != other->border_radius[i])
+      if (node->geometry->border_width[i] != other->geometry->border_width[i])
         return FALSE;
     }
 
-  if (node->outline_width != other->outline_width)
-    return FALSE;
+  _st_theme_node_ensure_borders (node);
+  _st_theme_node_ensure_borders (other);
 
-  if (node->outline_width > 0 &&
-      !cogl_color_equal (&node->outline_color, &other->outline_color))
+  if (node->borders != other->borders)
     return FALSE;
 
   border_image = st_theme_node_get_border_image (node);
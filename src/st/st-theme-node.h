@@ -162,6 +162,32 @@ typedef enum {
   ST_ICON_STYLE_SYMBOLIC
 } StIconStyle;
 
+/**
+ * StThemeNodeGroup:
+ * @ST_THEME_NODE_GROUP_GEOMETRY: Border widths, padding, margins and size
+ *   constraints.
+ * @ST_THEME_NODE_GROUP_BORDERS: Border colors, border radii and the outline.
+ * @ST_THEME_NODE_GROUP_BACKGROUND: Background color, gradient and image.
+ * @ST_THEME_NODE_GROUP_FOREGROUND: The foreground color.
+ * @ST_THEME_NODE_GROUP_FONT: The font.
+ * @ST_THEME_NODE_GROUP_BORDER_IMAGE: The border image.
+ * @ST_THEME_NODE_GROUP_SHADOWS: The box, background image and text shadows.
+ * @ST_THEME_NODE_GROUP_ICON_COLORS: The icon colors.
+ *
+ * Groups of properties a #StThemeNode resolves together, the first time
+ * one of them is looked up. See st_theme_node_get_group_computations().
+ */
+typedef enum {
+  ST_THEME_NODE_GROUP_GEOMETRY,
+  ST_THEME_NODE_GROUP_BORDERS,
+  ST_THEME_NODE_GROUP_BACKGROUND,
+  ST_THEME_NODE_GROUP_FOREGROUND,
+  ST_THEME_NODE_GROUP_FONT,
+  ST_THEME_NODE_GROUP_BORDER_IMAGE,
+  ST_THEME_NODE_GROUP_SHADOWS,
+  ST_THEME_NODE_GROUP_ICON_COLORS
+} StThemeNodeGroup;
+
 typedef struct _StThemeNodePaintState StThemeNodePaintState;
 
 struct _StThemeNodePaintState {
@@ -179,6 +205,14 @@ struct _StThemeNodePaintState {
   CoglTexture *prerendered_texture;
   CoglPipeline *prerendered_pipeline;
   CoglPipeline *corner_pipeline[4];
+  float corner_coords[4][4];
+  float solid_coords[2];
+
+  /* The nine texture rectangles of the border image, computed for
+   * border_slices_texture at the allocation size
+   */
+  CoglTexture *border_slices_texture;
+  float *border_slices;
 };
 
 StThemeNode *st_theme_node_new (StThemeContext *context,
@@ -338,6 +372,12 @@ void st_theme_node_get_background_paint_box (StThemeNode           *node,
                                              const ClutterActorBox *allocation,
                                              ClutterActorBox       *paint_box);
 
+guint st_theme_node_get_group_computations (StThemeNodeGroup group);
+
+void  st_theme_node_get_corner_atlas_usage (guint *n_corners,
+                                            guint *n_pixels,
+                                            guint *n_used_pixels);
+
 gboolean st_theme_node_geometry_equal (StThemeNode *node,
                                        StThemeNode *other);
 gboolean st_theme_node_paint_equal    (StThemeNode *node,
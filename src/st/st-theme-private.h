@@ -25,8 +25,57 @@
 
 G_BEGIN_DECLS
 
-GPtrArray *_st_theme_get_matched_properties (StTheme       *theme,
-                                             StThemeNode   *node);
+typedef struct _StThemeStyleSignature StThemeStyleSignature;
+typedef struct _StThemeDeclarations StThemeDeclarations;
+
+/* A set of declarations sorted by increasing priority, like the ones
+ * matching a style signature which are shared between all nodes with
+ * that signature.
+ *
+ * To find the declarations of a property without comparing names,
+ * last_index maps an interned property id (see
+ * cr_declaration_intern_property_name()) to the index of the last
+ * declaration of that property, and prev_index links each declaration
+ * to the previous one of the same property. Both use -1 for none.
+ */
+struct _StThemeDeclarations
+{
+  int n_properties;
+  CRDeclaration **properties;
+
+  guint n_property_ids;
+  int *last_index;
+  int *prev_index;
+};
+
+StThemeStyleSignature *_st_theme_intern_style_signature (StTheme               *theme,
+                                                         StThemeStyleSignature *parent,
+                                                         GType                  element_type,
+                                                         const char            *element_id,
+                                                         GStrv                  element_classes,
+                                                         GStrv                  pseudo_classes);
+
+StThemeStyleSignature *_st_theme_style_signature_ref   (StThemeStyleSignature *signature);
+void                   _st_theme_style_signature_unref (StThemeStyleSignature *signature);
+
+StThemeDeclarations *_st_theme_get_matched_declarations (StTheme               *theme,
+                                                         StThemeStyleSignature *signature,
+                                                         StThemeNode           *node);
+
+StThemeDeclarations *_st_theme_declarations_new   (CRDeclaration       **properties,
+                                                   int                   n_properties);
+StThemeDeclarations *_st_theme_declarations_ref   (StThemeDeclarations  *declarations);
+void                 _st_theme_declarations_unref (StThemeDeclarations  *declarations);
+
+static inline int
+_st_theme_declarations_find_last (StThemeDeclarations *declarations,
+                                  guint                property_id)
+{
+  if (property_id >= declarations->n_property_ids)
+    return -1;
+
+  return declarations->last_index[property_id];
+}
 
 /* Resolve an URL from the stylesheet to a file */
 GFile *_st_theme_resolve_url (StTheme      *theme,
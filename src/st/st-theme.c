@@ -42,6 +42,7 @@
 
 #include <gio/gio.h>
 
+#include "st-compiled-stylesheet.h"
 #include "st-private.h"
 #include "st-theme-node.h"
 #include "st-theme-private.h"
@@ -57,6 +58,87 @@ static void st_theme_get_property (GObject      *object,
                                    GValue       *value,
                                    GParamSpec   *pspec);
 
+static void invalidate_rule_cache (StTheme *theme);
+
+static guint    style_signature_hash  (gconstpointer key);
+static gboolean style_signature_equal (gconstpointer a,
+                                       gconstpointer b);
+
+typedef struct _StThemeRule StThemeRule;
+typedef struct _StThemeRuleBuckets StThemeRuleBuckets;
+typedef struct _StThemeRuleIndex StThemeRuleIndex;
+
+/* A single selector of a ruleset, flattened out of the stylesheets
+ * (including imported ones) in cascade order. The position is used to
+ * restore that document order after collecting candidates from several
+ * buckets.
+ */
+struct _StThemeRule
+{
+  CRStatement *statement;
+  CRSimpleSel *simple_sel;
+  gulong specificity;
+  guint position;
+  /* Whether any simple selector of the rule has a pseudo-class */
+  gboolean has_pseudo_classes;
+};
+
+/* Rules bucketed by the most selective part of their rightmost simple
+ * selector, so that matching a node only has to look at the rules that
+ * can possibly apply to it rather than at every ruleset of every sheet.
+ */
+struct _StThemeRuleBuckets
+{
+  GHashTable *rules_by_id;
+  GHashTable *rules_by_class;
+  GHashTable *rules_by_element;
+  GPtrArray *universal_rules;
+
+  /* GType => sorted element and universal rules applying to that type */
+  GHashTable *rules_by_type;
+};
+
+struct _StThemeRuleIndex
+{
+  GPtrArray *rules;
+
+  /* Rules that can only match nodes with a pseudo-class (either on the
+   * node itself or on an ancestor) are kept apart from the others, so
+   * that changing the pseudo-classes of a node only requires matching
+   * the former again.
+   */
+  StThemeRuleBuckets static_rules;
+  StThemeRuleBuckets pseudo_class_rules;
+};
+
+/* Everything about a node and its ancestors that selectors can match
+ * against. Nodes with the same signature match the same rules, so the
+ * matched declarations are cached here and shared between them.
+ */
+struct _StThemeStyleSignature
+{
+  StTheme *theme;
+  StThemeStyleSignature *parent;
+
+  GType element_type;
+  char *element_id;
+  /* sorted, NULL if empty */
+  GStrv element_classes;
+  GStrv pseudo_classes;
+
+  guint hash;
+
+  /* The same signature with the pseudo-classes of the node and all of
+   * its ancestors removed, or %NULL if there are none */
+  StThemeStyleSignature *static_signature;
+
+  /* Sorted rules not depending on pseudo-classes that match nodes with
+   * this signature, only computed when there are no pseudo-classes */
+  GPtrArray *static_rules;
+
+  StThemeDeclarations *declarations;
+};
+
 struct _StTheme
 {
   GObject parent;
@@ -70,6 +152,12 @@ struct _StTheme
   GHashTable *files_by_stylesheet;
 
   CRCascade *cascade;
+
+  /* Built lazily from the cascade and custom stylesheets */
+  StThemeRuleIndex *rule_index;
+
+  /* set of StThemeStyleSignature, not owned */
+  GHashTable *style_signatures;
 };
 
 enum
@@ -117,6 +205,7 @@ st_theme_init (StTheme *theme)
   theme->stylesheets_by_file = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
                                                       (GDestroyNotify)g_object_unref, (GDestroyNotify)cr_stylesheet_unref);
   theme->files_by_stylesheet = g_hash_table_new (g_direct_hash, g_direct_equal);
+  theme->style_signatures = g_hash_table_new (style_signature_hash, style_signature_equal);
 }
 
 static void
@@ -170,6 +259,29 @@ st_theme_class_init (StThemeClass *klass)
                   G_TYPE_NONE, 0);
 }
 
+/* Use the compiled form of the stylesheet next to it, if it's up to date */
+static CRStyleSheet *
+load_compiled_stylesheet (GFile      *file,
+                          const char *contents,
+                          gsize       length)
+{
+  g_autoptr (GError) error = NULL;
+  CRStyleSheet *stylesheet;
+
+  stylesheet = _st_compiled_stylesheet_load (file, contents, length, &error);
+  if (stylesheet == NULL &&
+      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED) &&
+      !g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT) &&
+      !g_error_matches (error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND))
+    {
+      g_autofree char *uri = g_file_get_uri (file);
+
+      g_debug ("Not using compiled stylesheet for '%s': %s", uri, error->message);
+    }
+
+  return stylesheet;
+}
+
 static CRStyleSheet *
 parse_stylesheet (GFile   *file,
                   GError **error)
@@ -185,9 +297,17 @@ parse_stylesheet (GFile   *file,
   if (!g_file_load_contents (file, NULL, &contents, &length, NULL, error))
     return NULL;
 
-  status = cr_om_parser_simply_parse_buf ((const guchar *) contents,
-                                          length,
-                                          &stylesheet);
+  stylesheet = load_compiled_stylesheet (file, contents, length);
+  if (stylesheet == NULL)
+    {
+      status = cr_om_parser_simply_parse_buf ((const guchar *) contents,
+                                              length,
+                                              &stylesheet);
+    }
+  else
+    {
+      status = CR_OK;
+    }
   g_free (contents);
 
   if (status != CR_OK)
@@ -263,6 +383,18 @@ resolve_stylesheet (StTheme  *theme,
   return sheet;
 }
 
+static void
+add_custom_stylesheet (StTheme      *theme,
+                       CRStyleSheet *stylesheet)
+{
+  stylesheet->app_data = GUINT_TO_POINTER (TRUE);
+
+  cr_stylesheet_ref (stylesheet);
+  theme->custom_stylesheets = g_slist_prepend (theme->custom_stylesheets, stylesheet);
+  invalidate_rule_cache (theme);
+  g_signal_emit (theme, signals[STYLESHEETS_CHANGED], 0);
+}
+
 /**
  * st_theme_load_stylesheet:
  * @theme: a #StTheme
@@ -284,15 +416,137 @@ st_theme_load_stylesheet (StTheme    *theme,
   if (!stylesheet)
     return FALSE;
 
-  stylesheet->app_data = GUINT_TO_POINTER (TRUE);
-
-  cr_stylesheet_ref (stylesheet);
-  theme->custom_stylesheets = g_slist_prepend (theme->custom_stylesheets, stylesheet);
-  g_signal_emit (theme, signals[STYLESHEETS_CHANGED], 0);
+  add_custom_stylesheet (theme, stylesheet);
 
   return TRUE;
 }
 
+static void
+parse_stylesheet_thread (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+  GFile *file = task_data;
+  CRStyleSheet *stylesheet;
+  GError *error = NULL;
+
+  stylesheet = parse_stylesheet (file, &error);
+  if (stylesheet)
+    g_task_return_pointer (task, stylesheet, (GDestroyNotify) cr_stylesheet_unref);
+  else
+    g_task_return_error (task, error);
+}
+
+static void
+on_stylesheet_parsed (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  g_autoptr (GTask) task = user_data;
+  StTheme *theme = ST_THEME (source);
+  GFile *file = g_task_get_task_data (task);
+  CRStyleSheet *stylesheet, *existing;
+  GError *error = NULL;
+
+  stylesheet = g_task_propagate_pointer (G_TASK (result), &error);
+  if (!stylesheet)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      cr_stylesheet_unref (stylesheet);
+      return;
+    }
+
+  /* The same file may have been loaded while we were parsing it */
+  existing = g_hash_table_lookup (theme->stylesheets_by_file, file);
+  if (existing)
+    {
+      cr_stylesheet_unref (stylesheet);
+      stylesheet = existing;
+      cr_stylesheet_ref (stylesheet);
+    }
+  else
+    {
+      insert_stylesheet (theme, file, stylesheet);
+    }
+
+  add_custom_stylesheet (theme, stylesheet);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * st_theme_load_stylesheet_async:
+ * @theme: a #StTheme
+ * @file: a #GFile
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: (scope async): callback to invoke when the stylesheet is loaded
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronously load the stylesheet associated with @file, like
+ * st_theme_load_stylesheet(). Reading and parsing the stylesheet happens
+ * in a separate thread; the stylesheet is only added to @theme, and
+ * #StTheme::custom-stylesheets-changed emitted, once that is done.
+ */
+void
+st_theme_load_stylesheet_async (StTheme             *theme,
+                                GFile               *file,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  GTask *task, *parse_task;
+  CRStyleSheet *stylesheet;
+
+  g_return_if_fail (ST_IS_THEME (theme));
+  g_return_if_fail (G_IS_FILE (file));
+
+  task = g_task_new (theme, cancellable, callback, user_data);
+  g_task_set_source_tag (task, st_theme_load_stylesheet_async);
+  g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+
+  stylesheet = g_hash_table_lookup (theme->stylesheets_by_file, file);
+  if (stylesheet)
+    {
+      cr_stylesheet_ref (stylesheet);
+      add_custom_stylesheet (theme, stylesheet);
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  parse_task = g_task_new (theme, cancellable, on_stylesheet_parsed, task);
+  g_task_set_source_tag (parse_task, st_theme_load_stylesheet_async);
+  g_task_set_task_data (parse_task, g_object_ref (file), g_object_unref);
+  g_task_run_in_thread (parse_task, parse_stylesheet_thread);
+  g_object_unref (parse_task);
+}
+
+/**
+ * st_theme_load_stylesheet_finish:
+ * @theme: a #StTheme
+ * @result: a #GAsyncResult
+ * @error: a #GError
+ *
+ * Finishes an operation started with st_theme_load_stylesheet_async().
+ *
+ * Returns: %TRUE if successful
+ */
+gboolean
+st_theme_load_stylesheet_finish (StTheme       *theme,
+                                 GAsyncResult  *result,
+                                 GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, theme), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /**
  * st_theme_unload_stylesheet:
  * @theme: a #StTheme
@@ -315,6 +569,7 @@ st_theme_unload_stylesheet (StTheme    *theme,
     return;
 
   theme->custom_stylesheets = g_slist_remove (theme->custom_stylesheets, stylesheet);
+  invalidate_rule_cache (theme);
 
   g_signal_emit (theme, signals[STYLESHEETS_CHANGED], 0);
 
@@ -384,12 +639,19 @@ st_theme_finalize (GObject * object)
 {
   StTheme *theme = ST_THEME (object);
 
+  invalidate_rule_cache (theme);
+
   g_slist_foreach (theme->custom_stylesheets, (GFunc) cr_stylesheet_unref, NULL);
   g_clear_slist (&theme->custom_stylesheets, NULL);
 
   g_hash_table_destroy (theme->stylesheets_by_file);
   g_hash_table_destroy (theme->files_by_stylesheet);
 
+  /* Theme nodes keep a reference on their theme for as long as they hold
+   * on to a signature, so there should not be any left */
+  g_warn_if_fail (g_hash_table_size (theme->style_signatures) == 0);
+  g_hash_table_destroy (theme->style_signatures);
+
   g_clear_object (&theme->application_stylesheet);
   g_clear_object (&theme->theme_stylesheet);
   g_clear_object (&theme->default_stylesheet);
@@ -857,41 +1119,167 @@ done:
 }
 
 static void
-add_matched_properties (StTheme      *a_this,
-                        CRStyleSheet *a_nodesheet,
-                        StThemeNode  *a_node,
-                        GPtrArray    *props)
+st_theme_rule_buckets_init (StThemeRuleBuckets *buckets)
 {
-  CRStatement *cur_stmt = NULL;
-  CRSelector *sel_list = NULL;
-  CRSelector *cur_sel = NULL;
-  gboolean matches = FALSE;
-  enum CRStatus status = CR_OK;
+  buckets->rules_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                NULL, (GDestroyNotify) g_ptr_array_unref);
+  buckets->rules_by_class = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   NULL, (GDestroyNotify) g_ptr_array_unref);
+  buckets->rules_by_element = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     NULL, (GDestroyNotify) g_ptr_array_unref);
+  buckets->rules_by_type = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                  NULL, (GDestroyNotify) g_ptr_array_unref);
+  buckets->universal_rules = g_ptr_array_new ();
+}
 
-  /*
-   *walk through the list of statements and,
-   *get the selectors list inside the statements that
-   *contain some, and try to match our style node in these
-   *selectors lists.
+static void
+st_theme_rule_buckets_clear (StThemeRuleBuckets *buckets)
+{
+  g_hash_table_destroy (buckets->rules_by_id);
+  g_hash_table_destroy (buckets->rules_by_class);
+  g_hash_table_destroy (buckets->rules_by_element);
+  g_hash_table_destroy (buckets->rules_by_type);
+  g_ptr_array_unref (buckets->universal_rules);
+}
+
+static void
+st_theme_rule_index_free (StThemeRuleIndex *index)
+{
+  st_theme_rule_buckets_clear (&index->static_rules);
+  st_theme_rule_buckets_clear (&index->pseudo_class_rules);
+  g_ptr_array_unref (index->rules);
+
+  g_free (index);
+}
+
+static void
+add_rule_to_bucket (GHashTable  *table,
+                    const char  *key,
+                    StThemeRule *rule)
+{
+  GPtrArray *bucket = g_hash_table_lookup (table, key);
+
+  if (bucket == NULL)
+    {
+      bucket = g_ptr_array_new ();
+      g_hash_table_insert (table, (gpointer) key, bucket);
+    }
+
+  g_ptr_array_add (bucket, rule);
+}
+
+static gboolean
+simple_sel_has_pseudo_classes (CRSimpleSel *simple_sel)
+{
+  CRSimpleSel *cur_sel;
+  CRAdditionalSel *add_sel;
+
+  for (cur_sel = simple_sel; cur_sel; cur_sel = cur_sel->next)
+    {
+      for (add_sel = cur_sel->add_sel; add_sel; add_sel = add_sel->next)
+        {
+          if (add_sel->type == PSEUDO_CLASS_ADD_SELECTOR)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static void
+add_rule_to_index (StThemeRuleIndex *index,
+                   CRStatement      *stmt,
+                   CRSimpleSel      *simple_sel)
+{
+  StThemeRuleBuckets *buckets;
+  CRSimpleSel *last_sel;
+  CRAdditionalSel *add_sel;
+  const char *class_name = NULL;
+  StThemeRule *rule;
+
+  rule = g_new0 (StThemeRule, 1);
+  rule->statement = stmt;
+  rule->simple_sel = simple_sel;
+  rule->position = index->rules->len;
+  rule->has_pseudo_classes = simple_sel_has_pseudo_classes (simple_sel);
+
+  /* The specificity only depends on the selector, so compute it once here
+   * instead of every time the selector matches a node.
    */
-  for (cur_stmt = a_nodesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+  cr_simple_sel_compute_specificity (simple_sel);
+  rule->specificity = simple_sel->specificity;
+
+  g_ptr_array_add (index->rules, rule);
+
+  if (rule->has_pseudo_classes)
+    buckets = &index->pseudo_class_rules;
+  else
+    buckets = &index->static_rules;
+
+  for (last_sel = simple_sel; last_sel->next; last_sel = last_sel->next)
+    ;
+
+  for (add_sel = last_sel->add_sel; add_sel; add_sel = add_sel->next)
     {
-      /*
-       *initialize the selector list in which we will
-       *really perform the search.
-       */
-      sel_list = NULL;
+      if (add_sel->type == ID_ADD_SELECTOR &&
+          add_sel->content.id_name &&
+          add_sel->content.id_name->stryng &&
+          add_sel->content.id_name->stryng->str)
+        {
+          add_rule_to_bucket (buckets->rules_by_id,
+                              add_sel->content.id_name->stryng->str,
+                              rule);
+          return;
+        }
 
-      /*
-       *get the the damn selector list in
-       *which we have to look
-       */
+      if (class_name == NULL &&
+          add_sel->type == CLASS_ADD_SELECTOR &&
+          add_sel->content.class_name &&
+          add_sel->content.class_name->stryng &&
+          add_sel->content.class_name->stryng->str)
+        class_name = add_sel->content.class_name->stryng->str;
+    }
+
+  if (class_name != NULL)
+    {
+      add_rule_to_bucket (buckets->rules_by_class, class_name, rule);
+    }
+  else if ((last_sel->type_mask & TYPE_SELECTOR) &&
+           !(last_sel->type_mask & UNIVERSAL_SELECTOR) &&
+           last_sel->name &&
+           last_sel->name->stryng &&
+           last_sel->name->stryng->str)
+    {
+      add_rule_to_bucket (buckets->rules_by_element,
+                          last_sel->name->stryng->str,
+                          rule);
+    }
+  else
+    {
+      g_ptr_array_add (buckets->universal_rules, rule);
+    }
+}
+
+static void
+index_stylesheet (StTheme          *theme,
+                  StThemeRuleIndex *index,
+                  CRStyleSheet     *sheet)
+{
+  CRStatement *cur_stmt = NULL;
+  CRSelector *cur_sel = NULL;
+
+  for (cur_stmt = sheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
       switch (cur_stmt->type)
         {
         case RULESET_STMT:
-          if (cur_stmt->kind.ruleset && cur_stmt->kind.ruleset->sel_list)
+          if (cur_stmt->kind.ruleset == NULL)
+            break;
+
+          for (cur_sel = cur_stmt->kind.ruleset->sel_list; cur_sel; cur_sel = cur_sel->next)
             {
-              sel_list = cur_stmt->kind.ruleset->sel_list;
+              if (cur_sel->simple_sel)
+                add_rule_to_index (index, cur_stmt, cur_sel->simple_sel);
             }
           break;
 
@@ -901,20 +1289,20 @@ add_matched_properties (StTheme      *a_this,
 
             if (import_rule->sheet == NULL)
               {
-                CRStyleSheet *sheet = NULL;
+                CRStyleSheet *import_sheet = NULL;
                 GFile *file = NULL;
 
                 if (import_rule->url->stryng && import_rule->url->stryng->str)
                   {
-                    file = _st_theme_resolve_url (a_this,
-                                                  a_nodesheet,
+                    file = _st_theme_resolve_url (theme,
+                                                  sheet,
                                                   import_rule->url->stryng->str);
-                    sheet = resolve_stylesheet (a_this, file, NULL);
+                    import_sheet = resolve_stylesheet (theme, file, NULL);
                   }
 
-                if (sheet)
+                if (import_sheet)
                   {
-                    import_rule->sheet = sheet;
+                    import_rule->sheet = import_sheet;
                   }
                 else
                   {
@@ -929,10 +1317,7 @@ add_matched_properties (StTheme      *a_this,
               }
 
             if (import_rule->sheet != (CRStyleSheet *) - 1)
-              {
-                add_matched_properties (a_this, import_rule->sheet,
-                                        a_node, props);
-              }
+              index_stylesheet (theme, index, import_rule->sheet);
           }
           break;
         case AT_MEDIA_RULE_STMT:
@@ -943,43 +1328,271 @@ add_matched_properties (StTheme      *a_this,
         default:
           break;
         }
+    }
+}
 
-      if (!sel_list)
+static StThemeRuleIndex *
+ensure_rule_index (StTheme *theme)
+{
+  StThemeRuleIndex *index;
+  enum CRStyleOrigin origin = 0;
+  GSList *iter;
+
+  if (theme->rule_index)
+    return theme->rule_index;
+
+  index = g_new0 (StThemeRuleIndex, 1);
+  index->rules = g_ptr_array_new_with_free_func (g_free);
+  st_theme_rule_buckets_init (&index->static_rules);
+  st_theme_rule_buckets_init (&index->pseudo_class_rules);
+
+  for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++)
+    {
+      CRStyleSheet *sheet = cr_cascade_get_sheet (theme->cascade, origin);
+      if (!sheet)
         continue;
 
-      /*
-       *now, we have a comma separated selector list to look in.
-       *let's walk it and try to match the style node
-       *on each item of the list.
-       */
-      for (cur_sel = sel_list; cur_sel; cur_sel = cur_sel->next)
-        {
-          if (!cur_sel->simple_sel)
-            continue;
+      index_stylesheet (theme, index, sheet);
+    }
 
-          status = sel_matches_style_real (a_this, cur_sel->simple_sel, a_node, &matches, TRUE, TRUE);
+  for (iter = theme->custom_stylesheets; iter; iter = iter->next)
+    index_stylesheet (theme, index, iter->data);
 
-          if (status == CR_OK && matches)
-            {
-              CRDeclaration *cur_decl = NULL;
-
-              /* In order to sort the matching properties, we need to compute the
-               * specificity of the selector that actually matched this
-               * element. In a non-thread-safe fashion, we store it in the
-               * ruleset. (Fixing this would mean cut-and-pasting
-               * cr_simple_sel_compute_specificity(), and have no need for
-               * thread-safety anyways.)
-               *
-               * Once we've sorted the properties, the specificity no longer
-               * matters and it can be safely overridden.
-               */
-              cr_simple_sel_compute_specificity (cur_sel->simple_sel);
-
-              cur_stmt->specificity = cur_sel->simple_sel->specificity;
-
-              for (cur_decl = cur_stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
-                g_ptr_array_add (props, cur_decl);
-            }
+  theme->rule_index = index;
+
+  return index;
+}
+
+static void
+invalidate_rule_cache (StTheme *theme)
+{
+  GHashTableIter iter;
+  StThemeStyleSignature *signature;
+
+  g_clear_pointer (&theme->rule_index, st_theme_rule_index_free);
+
+  g_hash_table_iter_init (&iter, theme->style_signatures);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &signature, NULL))
+    {
+      g_clear_pointer (&signature->static_rules, g_ptr_array_unref);
+      g_clear_pointer (&signature->declarations, _st_theme_declarations_unref);
+    }
+}
+
+static int
+compare_rule_positions (gconstpointer a,
+                        gconstpointer b)
+{
+  const StThemeRule *rule_a = *(const StThemeRule **) a;
+  const StThemeRule *rule_b = *(const StThemeRule **) b;
+
+  if (rule_a->position < rule_b->position)
+    return -1;
+  if (rule_a->position > rule_b->position)
+    return 1;
+
+  return 0;
+}
+
+static void
+append_bucket (GPtrArray  *candidates,
+               GHashTable *table,
+               const char *key)
+{
+  GPtrArray *bucket = g_hash_table_lookup (table, key);
+
+  if (bucket != NULL)
+    g_ptr_array_extend (candidates, bucket, NULL, NULL);
+}
+
+/* Element selectors match by type name against the node's type, any
+ * of its ancestors and any interface it implements, so the set of
+ * candidates only depends on the GType and can be computed once.
+ */
+static GPtrArray *
+get_rules_for_type (StThemeRuleBuckets *buckets,
+                    GType               element_type)
+{
+  GPtrArray *rules;
+  GType type;
+
+  rules = g_hash_table_lookup (buckets->rules_by_type, GSIZE_TO_POINTER (element_type));
+  if (rules != NULL)
+    return rules;
+
+  rules = g_ptr_array_new ();
+  g_ptr_array_extend (rules, buckets->universal_rules, NULL, NULL);
+
+  if (element_type == G_TYPE_NONE)
+    {
+      append_bucket (rules, buckets->rules_by_element, "stage");
+    }
+  else
+    {
+      GType *interfaces;
+      guint n_interfaces, i;
+
+      for (type = element_type; type != 0; type = g_type_parent (type))
+        append_bucket (rules, buckets->rules_by_element, g_type_name (type));
+
+      interfaces = g_type_interfaces (element_type, &n_interfaces);
+      for (i = 0; i < n_interfaces; i++)
+        append_bucket (rules, buckets->rules_by_element, g_type_name (interfaces[i]));
+      g_free (interfaces);
+    }
+
+  g_ptr_array_sort (rules, compare_rule_positions);
+
+  g_hash_table_insert (buckets->rules_by_type, GSIZE_TO_POINTER (element_type), rules);
+
+  return rules;
+}
+
+/* Appends the rules from @buckets matching @a_node to @matched, in
+ * cascade order */
+static void
+add_matched_rules (StTheme            *a_this,
+                   StThemeRuleBuckets *buckets,
+                   StThemeNode        *a_node,
+                   GPtrArray          *matched)
+{
+  g_autoptr (GPtrArray) candidates = NULL;
+  StThemeRule *prev_rule = NULL;
+  const char *element_id;
+  GStrv element_classes;
+  guint i;
+
+  candidates = g_ptr_array_copy (get_rules_for_type (buckets,
+                                                     st_theme_node_get_element_type (a_node)),
+                                 NULL, NULL);
+
+  element_id = st_theme_node_get_element_id (a_node);
+  if (element_id != NULL)
+    append_bucket (candidates, buckets->rules_by_id, element_id);
+
+  element_classes = st_theme_node_get_element_classes (a_node);
+  if (element_classes != NULL)
+    {
+      gchar **it;
+
+      for (it = element_classes; *it != NULL; it++)
+        append_bucket (candidates, buckets->rules_by_class, *it);
+    }
+
+  /* The order in which rules are matched is significant, since we rely on
+   * a stable sort of the declarations further down. */
+  g_ptr_array_sort (candidates, compare_rule_positions);
+
+  for (i = 0; i < candidates->len; i++)
+    {
+      StThemeRule *rule = g_ptr_array_index (candidates, i);
+      gboolean matches = FALSE;
+      enum CRStatus status;
+
+      /* The same class might be listed twice on the node */
+      if (rule == prev_rule)
+        continue;
+
+      prev_rule = rule;
+
+      status = sel_matches_style_real (a_this, rule->simple_sel, a_node, &matches, TRUE, TRUE);
+
+      if (status == CR_OK && matches)
+        g_ptr_array_add (matched, rule);
+    }
+}
+
+static void
+add_rule_properties (StThemeRule *rule,
+                     GPtrArray   *props)
+{
+  CRStatement *stmt = rule->statement;
+  CRDeclaration *cur_decl = NULL;
+
+  /* In order to sort the matching properties, we need the
+   * specificity of the selector that actually matched this
+   * element. In a non-thread-safe fashion, we store it in the
+   * ruleset.
+   *
+   * Once we've sorted the properties, the specificity no longer
+   * matters and it can be safely overridden.
+   */
+  stmt->specificity = rule->specificity;
+
+  for (cur_decl = stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
+    g_ptr_array_add (props, cur_decl);
+}
+
+/* Rules without pseudo-classes match the same nodes regardless of the
+ * pseudo-classes of the node and its ancestors, so they are matched
+ * once for the signature without any pseudo-classes and reused by all
+ * the variants of it (hovered, focused, checked, ...).
+ */
+static GPtrArray *
+get_static_rules (StTheme               *theme,
+                  StThemeStyleSignature *signature,
+                  StThemeNode           *node)
+{
+  StThemeRuleIndex *index = ensure_rule_index (theme);
+
+  if (signature->static_signature != NULL)
+    signature = signature->static_signature;
+
+  if (signature->static_rules == NULL)
+    {
+      signature->static_rules = g_ptr_array_new ();
+      add_matched_rules (theme, &index->static_rules, node, signature->static_rules);
+    }
+
+  return signature->static_rules;
+}
+
+static void
+add_matched_properties (StTheme               *theme,
+                        StThemeStyleSignature *signature,
+                        StThemeNode           *node,
+                        GPtrArray             *props)
+{
+  StThemeRuleIndex *index = ensure_rule_index (theme);
+  g_autoptr (GPtrArray) pseudo_class_rules = NULL;
+  GPtrArray *static_rules;
+  guint i, j;
+
+  static_rules = get_static_rules (theme, signature, node);
+
+  /* Rules with pseudo-classes can't match unless there are some */
+  if (signature->static_signature == NULL)
+    {
+      for (i = 0; i < static_rules->len; i++)
+        add_rule_properties (g_ptr_array_index (static_rules, i), props);
+      return;
+    }
+
+  pseudo_class_rules = g_ptr_array_new ();
+  add_matched_rules (theme, &index->pseudo_class_rules, node, pseudo_class_rules);
+
+  /* Merge both sets of rules back into cascade order */
+  i = j = 0;
+  while (i < static_rules->len || j < pseudo_class_rules->len)
+    {
+      StThemeRule *static_rule = NULL;
+      StThemeRule *pseudo_class_rule = NULL;
+
+      if (i < static_rules->len)
+        static_rule = g_ptr_array_index (static_rules, i);
+      if (j < pseudo_class_rules->len)
+        pseudo_class_rule = g_ptr_array_index (pseudo_class_rules, j);
+
+      if (pseudo_class_rule == NULL ||
+          (static_rule != NULL && static_rule->position < pseudo_class_rule->position))
+        {
+          add_rule_properties (static_rule, props);
+          i++;
+        }
+      else
+        {
+          add_rule_properties (pseudo_class_rule, props);
+          j++;
         }
     }
 }
@@ -1024,35 +1637,301 @@ compare_declarations (gconstpointer a,
   return 0;
 }
 
-GPtrArray *
-_st_theme_get_matched_properties (StTheme        *theme,
-                                  StThemeNode    *node)
+static StThemeDeclarations *
+match_declarations (StTheme               *theme,
+                    StThemeStyleSignature *signature,
+                    StThemeNode           *node)
 {
-  enum CRStyleOrigin origin = 0;
-  CRStyleSheet *sheet = NULL;
-  GPtrArray *props = g_ptr_array_new ();
-  GSList *iter;
+  StThemeDeclarations *declarations;
+  g_autoptr (GPtrArray) props = g_ptr_array_new ();
 
-  g_return_val_if_fail (ST_IS_THEME (theme), NULL);
-  g_return_val_if_fail (ST_IS_THEME_NODE (node), NULL);
+  add_matched_properties (theme, signature, node, props);
 
-  for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++)
+  /* We count on a stable sort here so that later declarations come
+   * after earlier declarations */
+  g_ptr_array_sort (props, compare_declarations);
+
+  declarations = _st_theme_declarations_new ((CRDeclaration **) props->pdata,
+                                             props->len);
+
+  return declarations;
+}
+
+/**
+ * _st_theme_declarations_new:
+ * @properties: (array length=n_properties): declarations sorted by
+ *   increasing priority
+ * @n_properties: the number of declarations
+ *
+ * Returns: (transfer full): a new #StThemeDeclarations holding a copy of
+ *   @properties
+ */
+StThemeDeclarations *
+_st_theme_declarations_new (CRDeclaration **properties,
+                            int             n_properties)
+{
+  StThemeDeclarations *declarations;
+  guint n_property_ids = 1;
+  gsize size;
+  int i;
+
+  for (i = 0; i < n_properties; i++)
+    n_property_ids = MAX (n_property_ids, properties[i]->property_id + 1);
+
+  /* The arrays are allocated together with the struct */
+  size = sizeof (StThemeDeclarations) +
+         n_properties * sizeof (CRDeclaration *) +
+         n_properties * sizeof (int) +
+         n_property_ids * sizeof (int);
+
+  declarations = g_atomic_rc_box_alloc (size);
+  declarations->n_properties = n_properties;
+  declarations->n_property_ids = n_property_ids;
+  declarations->properties = (CRDeclaration **) (declarations + 1);
+  declarations->prev_index = (int *) (declarations->properties + n_properties);
+  declarations->last_index = declarations->prev_index + n_properties;
+
+  for (i = 0; i < (int) n_property_ids; i++)
+    declarations->last_index[i] = -1;
+
+  for (i = 0; i < n_properties; i++)
     {
-      sheet = cr_cascade_get_sheet (theme->cascade, origin);
-      if (!sheet)
-        continue;
+      guint property_id = properties[i]->property_id;
+
+      declarations->properties[i] = properties[i];
+
+      /* Never hand out declarations without a name for unknown ids */
+      if (property_id == 0)
+        {
+          declarations->prev_index[i] = -1;
+          continue;
+        }
 
-      add_matched_properties (theme, sheet, node, props);
+      declarations->prev_index[i] = declarations->last_index[property_id];
+      declarations->last_index[property_id] = i;
     }
 
-  for (iter = theme->custom_stylesheets; iter; iter = iter->next)
-    add_matched_properties (theme, iter->data, node, props);
+  return declarations;
+}
 
-  /* We count on a stable sort here so that later declarations come
-   * after earlier declarations */
-  g_ptr_array_sort (props, compare_declarations);
+StThemeDeclarations *
+_st_theme_declarations_ref (StThemeDeclarations *declarations)
+{
+  return g_atomic_rc_box_acquire (declarations);
+}
+
+void
+_st_theme_declarations_unref (StThemeDeclarations *declarations)
+{
+  g_atomic_rc_box_release (declarations);
+}
+
+static guint
+strv_hash (GStrv strv)
+{
+  guint hash = 0;
+  gchar **it;
+
+  if (strv == NULL)
+    return 0;
+
+  for (it = strv; *it != NULL; it++)
+    hash = hash * 33 + g_str_hash (*it) + 1;
+
+  return hash;
+}
+
+static gboolean
+strv_equal0 (GStrv a,
+             GStrv b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return g_strv_equal ((const char * const *) a, (const char * const *) b);
+}
+
+static guint
+style_signature_hash (gconstpointer key)
+{
+  const StThemeStyleSignature *signature = key;
+
+  return signature->hash;
+}
+
+static gboolean
+style_signature_equal (gconstpointer a,
+                       gconstpointer b)
+{
+  const StThemeStyleSignature *signature_a = a;
+  const StThemeStyleSignature *signature_b = b;
+
+  return signature_a->hash == signature_b->hash &&
+         signature_a->parent == signature_b->parent &&
+         signature_a->element_type == signature_b->element_type &&
+         g_strcmp0 (signature_a->element_id, signature_b->element_id) == 0 &&
+         strv_equal0 (signature_a->element_classes, signature_b->element_classes) &&
+         strv_equal0 (signature_a->pseudo_classes, signature_b->pseudo_classes);
+}
+
+static int
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+/* Selector matching doesn't care about the order of classes, so sort
+ * them into @sorted (which must have room for all of @strv and the
+ * terminating %NULL) to get a canonical representation.
+ */
+static GStrv
+sort_strv (GStrv  strv,
+           char **sorted)
+{
+  guint len;
+
+  if (strv == NULL || strv[0] == NULL)
+    return NULL;
+
+  len = g_strv_length (strv);
+  memcpy (sorted, strv, (len + 1) * sizeof (char *));
+  qsort (sorted, len, sizeof (char *), compare_strings);
+
+  return sorted;
+}
+
+static void
+clear_style_signature (StThemeStyleSignature *signature)
+{
+  g_hash_table_remove (signature->theme->style_signatures, signature);
+
+  g_clear_pointer (&signature->declarations, _st_theme_declarations_unref);
+  g_clear_pointer (&signature->static_rules, g_ptr_array_unref);
+  g_clear_pointer (&signature->static_signature, _st_theme_style_signature_unref);
+  g_clear_pointer (&signature->parent, _st_theme_style_signature_unref);
+  g_free (signature->element_id);
+  g_strfreev (signature->element_classes);
+  g_strfreev (signature->pseudo_classes);
+}
+
+/**
+ * _st_theme_intern_style_signature:
+ * @theme: a #StTheme
+ * @parent: (nullable): the signature of the parent node
+ * @element_type: the element type of the node
+ * @element_id: (nullable): the element id of the node
+ * @element_classes: (nullable): the element classes of the node
+ * @pseudo_classes: (nullable): the pseudo-classes of the node
+ *
+ * Looks up the style signature for a node with the given parent
+ * signature and attributes, creating it if necessary.
+ *
+ * Returns: (transfer full): the style signature
+ */
+StThemeStyleSignature *
+_st_theme_intern_style_signature (StTheme               *theme,
+                                  StThemeStyleSignature *parent,
+                                  GType                  element_type,
+                                  const char            *element_id,
+                                  GStrv                  element_classes,
+                                  GStrv                  pseudo_classes)
+{
+  StThemeStyleSignature key = { 0, };
+  StThemeStyleSignature *signature;
+  char **sorted_classes;
+  char **sorted_pseudo_classes;
+
+  g_return_val_if_fail (ST_IS_THEME (theme), NULL);
+
+  sorted_classes = g_newa (char *, element_classes ? g_strv_length (element_classes) + 1 : 1);
+  sorted_pseudo_classes = g_newa (char *, pseudo_classes ? g_strv_length (pseudo_classes) + 1 : 1);
+
+  key.parent = parent;
+  key.element_type = element_type;
+  key.element_id = (char *) element_id;
+  key.element_classes = sort_strv (element_classes, sorted_classes);
+  key.pseudo_classes = sort_strv (pseudo_classes, sorted_pseudo_classes);
+
+  key.hash = GPOINTER_TO_UINT (parent);
+  key.hash = key.hash * 33 + (guint) element_type;
+  if (element_id != NULL)
+    key.hash = key.hash * 33 + g_str_hash (element_id);
+  key.hash = key.hash * 33 + strv_hash (key.element_classes);
+  key.hash = key.hash * 33 + strv_hash (key.pseudo_classes);
+
+  signature = g_hash_table_lookup (theme->style_signatures, &key);
+  if (signature != NULL)
+    return _st_theme_style_signature_ref (signature);
+
+  signature = g_atomic_rc_box_new0 (StThemeStyleSignature);
+  signature->theme = theme;
+  signature->parent = parent ? _st_theme_style_signature_ref (parent) : NULL;
+  signature->element_type = element_type;
+  signature->element_id = g_strdup (element_id);
+  signature->element_classes = g_strdupv (key.element_classes);
+  signature->pseudo_classes = g_strdupv (key.pseudo_classes);
+  signature->hash = key.hash;
+
+  if (key.pseudo_classes != NULL || (parent && parent->static_signature))
+    {
+      StThemeStyleSignature *static_parent = NULL;
+
+      if (parent)
+        static_parent = parent->static_signature ? parent->static_signature : parent;
+
+      signature->static_signature =
+        _st_theme_intern_style_signature (theme,
+                                          static_parent,
+                                          element_type,
+                                          element_id,
+                                          element_classes,
+                                          NULL);
+    }
+
+  g_hash_table_add (theme->style_signatures, signature);
+
+  return signature;
+}
+
+StThemeStyleSignature *
+_st_theme_style_signature_ref (StThemeStyleSignature *signature)
+{
+  return g_atomic_rc_box_acquire (signature);
+}
+
+void
+_st_theme_style_signature_unref (StThemeStyleSignature *signature)
+{
+  g_atomic_rc_box_release_full (signature, (GDestroyNotify) clear_style_signature);
+}
+
+/**
+ * _st_theme_get_matched_declarations:
+ * @theme: a #StTheme
+ * @signature: the style signature of @node
+ * @node: a #StThemeNode
+ *
+ * Gets the declarations of @theme matching @node, sorted in order of
+ * increasing priority. The result is cached in @signature and shared with
+ * all other nodes with the same signature until the stylesheets of @theme
+ * change.
+ *
+ * Returns: (transfer full): the matched declarations
+ */
+StThemeDeclarations *
+_st_theme_get_matched_declarations (StTheme               *theme,
+                                    StThemeStyleSignature *signature,
+                                    StThemeNode           *node)
+{
+  g_return_val_if_fail (ST_IS_THEME (theme), NULL);
+  g_return_val_if_fail (signature != NULL && signature->theme == theme, NULL);
+  g_return_val_if_fail (ST_IS_THEME_NODE (node), NULL);
+
+  if (signature->declarations == NULL)
+    signature->declarations = match_declarations (theme, signature, node);
 
-  return props;
+  return _st_theme_declarations_ref (signature->declarations);
 }
 
 /* Resolve an url from an url() reference in a stylesheet into a GFile,
@@ -19,7 +19,7 @@
  */
 #pragma once
 
-#include <glib-object.h>
+#include <gio/gio.h>
 
 #include "st-theme-node.h"
 
@@ -43,6 +43,14 @@ StTheme *st_theme_new (GFile *application_stylesheet,
                        GFile *default_stylesheet);
 
 gboolean  st_theme_load_stylesheet        (StTheme *theme, GFile *file, GError **error);
+void      st_theme_load_stylesheet_async  (StTheme             *theme,
+                                           GFile               *file,
+                                           GCancellable        *cancellable,
+                                           GAsyncReadyCallback  callback,
+                                           gpointer             user_data);
+gboolean  st_theme_load_stylesheet_finish (StTheme       *theme,
+                                           GAsyncResult  *result,
+                                           GError       **error);
 void      st_theme_unload_stylesheet      (StTheme *theme, GFile *file);
 GSList   *st_theme_get_custom_stylesheets (StTheme *theme);
 
@@ -50,6 +50,11 @@
 /* This is set in stone and also hard-coded in GDK. */
 #define VIRTUAL_CORE_POINTER_ID 2
 
+typedef enum {
+  STYLE_CHANGE_FLAGS_NONE = 0,
+  STYLE_CHANGE_FLAGS_NO_TRANSITIONS = 1 << 0,
+} StyleChangeFlags;
+
 /*
  * Forward declaration for sake of StWidgetChild
  */
@@ -57,11 +62,13 @@ typedef struct _StWidgetPrivate        StWidgetPrivate;
 struct _StWidgetPrivate
 {
   StThemeNode  *theme_node;
+  StThemeNode  *old_theme_node;
   gchar        *pseudo_class;
   gchar        *style_class;
   gchar        *inline_style;
 
   StThemeNodeTransition *transition_animation;
+  StyleChangeFlags style_change_flags;
 
   guint is_style_dirty : 1;
   guint first_child_dirty : 1;
@@ -128,11 +135,6 @@ static guint signals[LAST_SIGNAL] = { 0, };
 G_DEFINE_TYPE_WITH_PRIVATE (StWidget, st_widget, CLUTTER_TYPE_ACTOR);
 #define ST_WIDGET_PRIVATE(w) ((StWidgetPrivate *)st_widget_get_instance_private (w))
 
-typedef enum {
-  STYLE_CHANGE_FLAGS_NONE = 0,
-  STYLE_CHANGE_FLAGS_NO_TRANSITIONS = 1 << 0,
-} StyleChangeFlags;
-
 static void st_widget_recompute_style (StWidget         *widget,
                                        StThemeNode      *old_theme_node,
                                        StyleChangeFlags  flags);
@@ -336,6 +338,7 @@ st_widget_dispose (GObject *gobject)
   StWidgetPrivate *priv = st_widget_get_instance_private (actor);
 
   g_clear_pointer (&priv->theme_node, g_object_unref);
+  g_clear_pointer (&priv->old_theme_node, g_object_unref);
 
   st_widget_remove_transition (actor);
 
@@ -375,7 +378,13 @@ st_widget_get_preferred_width (ClutterActor *self,
                                gfloat       *min_width_p,
                                gfloat       *natural_width_p)
 {
-  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (self));
+  StThemeNode *theme_node;
+
+  /* Apply pending style changes, so that our margins match the node */
+  if (clutter_actor_is_mapped (self))
+    st_widget_ensure_style (ST_WIDGET (self));
+
+  theme_node = st_widget_get_theme_node (ST_WIDGET (self));
 
   st_theme_node_adjust_for_width (theme_node, &for_height);
 
@@ -390,7 +399,12 @@ st_widget_get_preferred_height (ClutterActor *self,
                                 gfloat       *min_height_p,
                                 gfloat       *natural_height_p)
 {
-  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (self));
+  StThemeNode *theme_node;
+
+  if (clutter_actor_is_mapped (self))
+    st_widget_ensure_style (ST_WIDGET (self));
+
+  theme_node = st_widget_get_theme_node (ST_WIDGET (self));
 
   st_theme_node_adjust_for_width (theme_node, &for_width);
 
@@ -475,6 +489,57 @@ st_widget_paint_background (StWidget            *widget,
                          resource_scale);
 }
 
+/**
+ * st_widget_queue_redraw_area:
+ * @widget: The #StWidget
+ * @box: (nullable): the area to redraw, relative to @widget, or %NULL
+ *   for its allocation
+ *
+ * Queues a redraw of @box only, rather than of everything @widget
+ * paints. This is meant to be called by subclasses of StWidget whose
+ * content changed, but not its background, borders or shadows, which
+ * then don't need to be painted again outside of @box.
+ */
+void
+st_widget_queue_redraw_area (StWidget              *widget,
+                             const ClutterActorBox *box)
+{
+  ClutterActor *actor;
+  ClutterActorBox area;
+  MtkRectangle clip;
+
+  g_return_if_fail (ST_IS_WIDGET (widget));
+
+  actor = CLUTTER_ACTOR (widget);
+
+  if (!clutter_actor_has_allocation (actor))
+    {
+      clutter_actor_queue_redraw (actor);
+      return;
+    }
+
+  if (box != NULL)
+    {
+      area = *box;
+    }
+  else
+    {
+      area.x1 = 0;
+      area.y1 = 0;
+      clutter_actor_get_size (actor, &area.x2, &area.y2);
+    }
+
+  clip.x = floorf (area.x1);
+  clip.y = floorf (area.y1);
+  clip.width = ceilf (area.x2) - clip.x;
+  clip.height = ceilf (area.y2) - clip.y;
+
+  if (clip.width <= 0 || clip.height <= 0)
+    return;
+
+  clutter_actor_queue_redraw_with_clip (actor, &clip);
+}
+
 static void
 st_widget_paint_node (ClutterActor        *actor,
                       ClutterPaintNode    *node,
@@ -517,6 +582,9 @@ st_widget_unmap (ClutterActor *actor)
 
   st_widget_remove_transition (self);
 
+  /* There is nothing to transition from once we get mapped again */
+  g_clear_pointer (&priv->old_theme_node, g_object_unref);
+
   if (priv->track_hover && priv->hover)
     st_widget_set_hover (self, FALSE);
 }
@@ -548,27 +616,185 @@ st_widget_real_style_changed (StWidget *self)
   clutter_actor_queue_redraw ((ClutterActor *) self);
 }
 
+/* Style changes of mapped widgets are not applied right away, but
+ * collected here and processed once per frame before the stage is
+ * laid out. Only the topmost widget of a changed subtree is queued,
+ * the widgets below it are just marked dirty and restyled from there,
+ * so that a parent is always restyled before its children and every
+ * widget at most once per frame, however often it was changed.
+ */
+static GPtrArray *restyle_queue = NULL;
+static guint restyle_count = 0;
+
+static void
+st_widget_restyle (ClutterActor *actor)
+{
+  ClutterActorIter iter;
+  ClutterActor *child;
+
+  if (ST_IS_WIDGET (actor))
+    {
+      StWidget *widget = ST_WIDGET (actor);
+      StWidgetPrivate *priv = st_widget_get_instance_private (widget);
+      g_autoptr (StThemeNode) old_theme_node = NULL;
+      StyleChangeFlags flags;
+
+      /* Clean widgets are queued on their own if they change later */
+      if (!priv->is_style_dirty)
+        return;
+
+      /* Unmapped widgets catch up in st_widget_ensure_style() once
+       * they get mapped
+       */
+      if (!clutter_actor_is_mapped (actor))
+        return;
+
+      old_theme_node = g_steal_pointer (&priv->old_theme_node);
+      flags = priv->style_change_flags;
+      priv->style_change_flags = STYLE_CHANGE_FLAGS_NONE;
+
+      st_widget_recompute_style (widget, old_theme_node, flags);
+      restyle_count++;
+    }
+
+  clutter_actor_iter_init (&iter, actor);
+  while (clutter_actor_iter_next (&iter, &child))
+    st_widget_restyle (child);
+}
+
+static gboolean
+has_dirty_ancestor (ClutterActor *actor)
+{
+  ClutterActor *parent;
+
+  for (parent = clutter_actor_get_parent (actor);
+       parent != NULL;
+       parent = clutter_actor_get_parent (parent))
+    {
+      if (ST_IS_WIDGET (parent) &&
+          ST_WIDGET_PRIVATE (ST_WIDGET (parent))->is_style_dirty)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Restyles @widget right away, together with the topmost of its
+ * ancestors that has pending changes, so that it gets its style from
+ * up to date parents
+ */
+static void
+restyle_now (StWidget *widget)
+{
+  ClutterActor *top = CLUTTER_ACTOR (widget);
+  ClutterActor *parent;
+
+  for (parent = clutter_actor_get_parent (top);
+       parent != NULL;
+       parent = clutter_actor_get_parent (parent))
+    {
+      if (ST_IS_WIDGET (parent) &&
+          ST_WIDGET_PRIVATE (ST_WIDGET (parent))->is_style_dirty)
+        top = parent;
+    }
+
+  st_widget_restyle (top);
+}
+
+static gboolean
+flush_restyle_queue (gpointer data)
+{
+  /* ::style-changed handlers may change the style of other widgets,
+   * keep going until everything settled
+   */
+  while (restyle_queue->len > 0)
+    {
+      g_autoptr (GPtrArray) queue = g_steal_pointer (&restyle_queue);
+      guint i;
+
+      restyle_queue = g_ptr_array_new_with_free_func (g_object_unref);
+
+      for (i = 0; i < queue->len; i++)
+        {
+          ClutterActor *actor = g_ptr_array_index (queue, i);
+
+          /* The ancestor is in the queue as well, or below a queued
+           * widget; it will restyle us after itself
+           */
+          if (clutter_actor_is_mapped (actor) && has_dirty_ancestor (actor))
+            continue;
+
+          st_widget_restyle (actor);
+        }
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+queue_restyle (StWidget *widget)
+{
+  ClutterActor *stage;
+
+  if (restyle_queue == NULL)
+    {
+      restyle_queue = g_ptr_array_new_with_free_func (g_object_unref);
+      clutter_threads_add_repaint_func (CLUTTER_REPAINT_FLAGS_PRE_PAINT,
+                                        flush_restyle_queue,
+                                        NULL, NULL);
+    }
+
+  g_ptr_array_add (restyle_queue, g_object_ref (widget));
+
+  stage = clutter_actor_get_stage (CLUTTER_ACTOR (widget));
+  if (stage != NULL)
+    clutter_stage_schedule_update (CLUTTER_STAGE (stage));
+}
+
 static void
 st_widget_style_changed_internal (StWidget         *widget,
                                   StyleChangeFlags  flags)
 {
   StWidgetPrivate *priv = st_widget_get_instance_private (widget);
-  StThemeNode *old_theme_node = NULL;
+  g_autoptr (StThemeNode) theme_node = NULL;
+  gboolean was_dirty;
 
+  was_dirty = priv->is_style_dirty;
   priv->is_style_dirty = TRUE;
-  old_theme_node = g_steal_pointer (&priv->theme_node);
+  theme_node = g_steal_pointer (&priv->theme_node);
 
-  /* update the style only if we are mapped */
   if (clutter_actor_is_mapped (CLUTTER_ACTOR (widget)))
-    st_widget_recompute_style (widget, old_theme_node, flags);
+    {
+      /* Keep the node we painted with until we are restyled, so
+       * we can transition from it
+       */
+      if (!was_dirty)
+        {
+          priv->old_theme_node = g_steal_pointer (&theme_node);
+          queue_restyle (widget);
 
-  /* Descend through all children. If the actor is not mapped,
-   * children will clear their theme node without recomputing style.
+          /* Our size request may depend on the style; don't let a
+           * query before the next frame return the cached one
+           */
+          clutter_actor_queue_relayout (CLUTTER_ACTOR (widget));
+        }
+    }
+
+  /* If we still were dirty and nobody asked for our theme node in
+   * the meantime, nobody asked for the theme nodes of our children
+   * either and they are dirty as well.
    */
-  notify_children_of_style_change (CLUTTER_ACTOR (widget), flags);
+  if (was_dirty && theme_node == NULL &&
+      (priv->style_change_flags & flags) == flags)
+    return;
 
-  if (old_theme_node)
-    g_object_unref (old_theme_node);
+  priv->style_change_flags |= flags;
+
+  /* Descend through all children. Whether or not the actor is mapped,
+   * children just clear their theme node, they are restyled together
+   * with us.
+   */
+  notify_children_of_style_change (CLUTTER_ACTOR (widget), flags);
 }
 
 void
@@ -1765,13 +1991,39 @@ st_widget_ensure_style (StWidget *widget)
 
   priv = st_widget_get_instance_private (widget);
 
-  if (priv->is_style_dirty)
+  if (!priv->is_style_dirty)
+    return;
+
+  if (clutter_actor_is_mapped (CLUTTER_ACTOR (widget)))
+    {
+      /* Restyle along with any pending changes above and below us,
+       * instead of waiting for the next frame
+       */
+      restyle_now (widget);
+    }
+  else
     {
+      priv->style_change_flags = STYLE_CHANGE_FLAGS_NONE;
       st_widget_recompute_style (widget, NULL, STYLE_CHANGE_FLAGS_NONE);
       notify_children_of_style_change (CLUTTER_ACTOR (widget), STYLE_CHANGE_FLAGS_NONE);
     }
 }
 
+/**
+ * st_widget_get_restyle_count:
+ *
+ * Gets the number of times a widget had its style recomputed since
+ * startup. Style changes are coalesced and processed once per frame,
+ * so this can be used to profile how many widgets each frame restyles.
+ *
+ * Returns: the number of restyled widgets
+ */
+guint
+st_widget_get_restyle_count (void)
+{
+  return restyle_count;
+}
+
 /**
  * st_widget_set_track_hover:
  * @widget: A #StWidget
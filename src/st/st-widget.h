@@ -121,6 +121,7 @@ gboolean              st_widget_get_hover                 (StWidget        *widg
 void                  st_widget_popup_menu                (StWidget        *self);
 
 void                  st_widget_ensure_style              (StWidget        *widget);
+guint                 st_widget_get_restyle_count         (void);
 
 void                  st_widget_set_can_focus             (StWidget        *widget,
                                                            gboolean         can_focus);
@@ -143,6 +144,8 @@ GList *               st_widget_get_focus_chain           (StWidget        *widg
 void                  st_widget_paint_background          (StWidget            *widget,
                                                            ClutterPaintNode    *node,
                                                            ClutterPaintContext *paint_context);
+void                  st_widget_queue_redraw_area         (StWidget              *widget,
+                                                           const ClutterActorBox *box);
 
 /* debug methods */
 char  *st_describe_actor       (ClutterActor *actor);
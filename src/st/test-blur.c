@@ -0,0 +1,231 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * test-blur.c: test program for the shadow blur
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "st-blur.h"
+
+static gboolean fail;
+
+/* Straightforward column-by-column and pixel-by-pixel version of the
+ * blur, as it was done before. With @truncate, the sum is truncated to
+ * 8 bits after every tap like the old code did; otherwise it is exact.
+ */
+static double *
+reference_blur (const guchar *pixels_in,
+                int           width_in,
+                int           height_in,
+                int           rowstride_in,
+                double        blur,
+                gboolean      truncate)
+{
+  double sigma = blur / 2.;
+  int n_values = (int) (5 * sigma);
+  int half = n_values / 2;
+  int width_out = width_in + 2 * half;
+  int height_out = height_in + 2 * half;
+  double *kernel, *tmp, *out;
+  double sum = 0;
+  int x, y, i;
+
+  kernel = g_new (double, n_values);
+  for (i = 0; i < n_values; i++)
+    {
+      kernel[i] = exp (-(i - half) * (i - half) / (2 * sigma * sigma));
+      sum += kernel[i];
+    }
+  for (i = 0; i < n_values; i++)
+    kernel[i] /= sum;
+
+  tmp = g_new0 (double, width_out * height_out);
+  out = g_new0 (double, width_out * height_out);
+
+  for (x = 0; x < width_in; x++)
+    for (y = 0; y < height_out; y++)
+      {
+        double value = 0;
+
+        for (i = 0; i < n_values; i++)
+          {
+            int y_in = y + i - 2 * half;
+
+            if (y_in < 0 || y_in >= height_in)
+              continue;
+
+            value += pixels_in[y_in * rowstride_in + x] * kernel[i];
+            if (truncate)
+              value = floor (value);
+          }
+
+        tmp[y * width_out + x + half] = value;
+      }
+
+  for (y = 0; y < height_out; y++)
+    for (x = 0; x < width_out; x++)
+      {
+        double value = 0;
+
+        for (i = 0; i < n_values; i++)
+          {
+            int x_in = x + i - half;
+
+            if (x_in < 0 || x_in >= width_out)
+              continue;
+
+            value += tmp[y * width_out + x_in] * kernel[i];
+            if (truncate)
+              value = floor (value);
+          }
+
+        out[y * width_out + x] = value;
+      }
+
+  g_free (kernel);
+  g_free (tmp);
+
+  return out;
+}
+
+/* Some text-like strokes and noise; widths that are not a multiple
+ * of the vector width exercise the scalar tails
+ */
+static guchar *
+create_mask (int width,
+             int height,
+             int rowstride)
+{
+  guchar *pixels = g_malloc0 (rowstride * height);
+  GRand *rand = g_rand_new_with_seed (42);
+  int x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        if ((x / 7 + y / 5) % 3 == 0)
+          pixels[y * rowstride + x] = 0xff;
+        else if (g_rand_int_range (rand, 0, 4) == 0)
+          pixels[y * rowstride + x] = g_rand_int_range (rand, 0, 256);
+      }
+
+  g_rand_free (rand);
+
+  return pixels;
+}
+
+static void
+test_blur (int    width,
+           int    height,
+           double blur)
+{
+  int rowstride = (width + 3) & ~3;
+  g_autofree guchar *pixels_in = create_mask (width, height, rowstride);
+  g_autofree guchar *pixels_out = NULL;
+  g_autofree double *exact = NULL;
+  g_autofree double *truncated = NULL;
+  int width_out, height_out;
+  size_t rowstride_out;
+  double max_error = 0;
+  int x, y;
+
+  pixels_out = _st_blur_pixels (pixels_in, width, height, rowstride, blur,
+                                &width_out, &height_out, &rowstride_out);
+
+  if ((guint) blur == 0)
+    {
+      if (width_out != width || height_out != height ||
+          memcmp (pixels_in, pixels_out, rowstride * height) != 0)
+        {
+          g_print ("%dx%d, blur %g: expected an unmodified copy\n",
+                   width, height, blur);
+          fail = TRUE;
+        }
+      return;
+    }
+
+  exact = reference_blur (pixels_in, width, height, rowstride, blur, FALSE);
+  truncated = reference_blur (pixels_in, width, height, rowstride, blur, TRUE);
+
+  for (y = 0; y < height_out; y++)
+    for (x = 0; x < width_out; x++)
+      {
+        int value = pixels_out[y * rowstride_out + x];
+
+        max_error = MAX (max_error, fabs (value - exact[y * width_out + x]));
+
+        /* The old code only ever lost precision by truncating */
+        if (value < truncated[y * width_out + x])
+          {
+            g_print ("%dx%d, blur %g: pixel %d,%d: %d is darker than before (%g)\n",
+                     width, height, blur, x, y,
+                     value, truncated[y * width_out + x]);
+            fail = TRUE;
+            return;
+          }
+      }
+
+  if (max_error > 1.0)
+    {
+      g_print ("%dx%d, blur %g: maximum error %g, expected at most 1\n",
+               width, height, blur, max_error);
+      fail = TRUE;
+    }
+}
+
+static void
+test_flat (void)
+{
+  int width = 37, height = 23, rowstride = 40;
+  g_autofree guchar *pixels_in = g_malloc (rowstride * height);
+  g_autofree guchar *pixels_out = NULL;
+  int width_out, height_out;
+  size_t rowstride_out;
+  int half;
+
+  memset (pixels_in, 0xff, rowstride * height);
+
+  /* Wide enough that the center is out of reach of the edges */
+  pixels_out = _st_blur_pixels (pixels_in, width, height, rowstride, 6.0,
+                                &width_out, &height_out, &rowstride_out);
+  half = (width_out - width) / 2;
+
+  if (pixels_out[(half + height / 2) * rowstride_out + half + width / 2] != 0xff)
+    {
+      g_print ("flat: center is %d, expected 255\n",
+               pixels_out[(half + height / 2) * rowstride_out + half + width / 2]);
+      fail = TRUE;
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  const double blurs[] = { 0.5, 1.0, 2.0, 3.5, 8.0, 15.0, 40.0 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (blurs); i++)
+    {
+      test_blur (1, 1, blurs[i]);
+      test_blur (17, 9, blurs[i]);
+      test_blur (301, 97, blurs[i]);
+    }
+
+  test_flat ();
+
+  return fail ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * test-css-tokenizer.c: test program for the CSS tokenizer
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "croco/libcroco.h"
+#include "croco/cr-tknzr.h"
+
+static gboolean fail;
+
+/* Text mixing the ASCII runs the tokenizer reads in one go with what
+ * still goes through the UTF-8 decoder character by character
+ */
+static const char * const texts[] = {
+  "",
+  "  \t\n\r\n\f  x",
+  "foo-bar_baz9 qux",
+  "caf\xc3\xa9-au-lait",
+  "\xc3\xa9t\xc3\xa9",
+  "/* comment ** with * stars\n and lines */",
+  "a\nb\n\nc \xc3\xa9\nd\n",
+  "#panel { color: red; }\n\n.button:hover\t{ }",
+};
+
+static gboolean
+is_in_classes (guint32 c,
+               guint   classes)
+{
+  return c > 0 && c < 0x80 && (cr_utils_ascii_classes[c] & classes) != 0;
+}
+
+static gboolean
+same_position (CRInput    *fast,
+               CRInput    *slow,
+               const char *text,
+               guint       classes)
+{
+  CRInputPos fast_pos, slow_pos;
+  g_autofree char *escaped = NULL;
+
+  cr_input_get_cur_pos (fast, &fast_pos);
+  cr_input_get_cur_pos (slow, &slow_pos);
+
+  if (fast_pos.next_byte_index != slow_pos.next_byte_index ||
+      fast_pos.line != slow_pos.line ||
+      fast_pos.col != slow_pos.col ||
+      fast_pos.end_of_line != slow_pos.end_of_line)
+    {
+      escaped = g_strescape (text, NULL);
+      g_print ("\"%s\", classes %u: at byte %ld, line %ld, column %ld, "
+               "expected byte %ld, line %ld, column %ld\n",
+               escaped, classes,
+               fast_pos.next_byte_index, fast_pos.line, fast_pos.col,
+               slow_pos.next_byte_index, slow_pos.line, slow_pos.col);
+      fail = TRUE;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Reading runs has to leave the input exactly where reading the same
+ * characters one by one does, including the line and column numbers
+ */
+static void
+test_ascii_runs (const char *text,
+                 guint       classes)
+{
+  gulong length = strlen (text);
+  g_autofree char *escaped = g_strescape (text, NULL);
+  CRInput *fast, *slow;
+
+  fast = cr_input_new_from_buf ((guchar *) text, length, FALSE);
+  slow = cr_input_new_from_buf ((guchar *) text, length, FALSE);
+
+  for (;;)
+    {
+      guchar *run;
+      gulong run_length, n_read = 0;
+      guint32 c;
+
+      cr_input_read_ascii_run (fast, classes, G_MAXULONG, &run, &run_length);
+
+      while (cr_input_peek_char (slow, &c) == CR_OK && is_in_classes (c, classes))
+        {
+          cr_input_read_char (slow, &c);
+          n_read++;
+        }
+
+      if (run_length != n_read)
+        {
+          g_print ("\"%s\", classes %u: read a run of %lu, expected %lu\n",
+                   escaped, classes, run_length, n_read);
+          fail = TRUE;
+          break;
+        }
+
+      if (!same_position (fast, slow, text, classes))
+        break;
+
+      /* Step over what ended the run */
+      if (cr_input_read_char (slow, &c) != CR_OK)
+        break;
+      cr_input_read_char (fast, &c);
+
+      if (!same_position (fast, slow, text, classes))
+        break;
+    }
+
+  cr_input_unref (fast);
+  cr_input_unref (slow);
+}
+
+typedef struct {
+  enum CRTokenType type;
+  const char *str;
+} ExpectedToken;
+
+static void
+test_tokens (const char          *text,
+             const ExpectedToken *expected,
+             int                  n_expected)
+{
+  g_autofree char *escaped = g_strescape (text, NULL);
+  CRTknzr *tknzr;
+  int i;
+
+  tknzr = cr_tknzr_new_from_buf ((guchar *) text, strlen (text), FALSE);
+
+  for (i = 0; ; i++)
+    {
+      CRToken *token = NULL;
+      enum CRStatus status;
+      const char *str = NULL;
+
+      status = cr_tknzr_get_next_token (tknzr, &token);
+      if (status == CR_END_OF_INPUT_ERROR)
+        {
+          if (i != n_expected)
+            {
+              g_print ("\"%s\": %d tokens, expected %d\n",
+                       escaped, i, n_expected);
+              fail = TRUE;
+            }
+          break;
+        }
+
+      if (status != CR_OK || token == NULL || i >= n_expected)
+        {
+          g_print ("\"%s\": unexpected token %d (status %d)\n",
+                   escaped, i, status);
+          fail = TRUE;
+          if (token)
+            cr_token_destroy (token);
+          break;
+        }
+
+      if (token->type != S_TK && token->u.str && token->u.str->stryng)
+        str = token->u.str->stryng->str;
+
+      if (token->type != expected[i].type ||
+          g_strcmp0 (str, expected[i].str) != 0)
+        {
+          g_print ("\"%s\": token %d is %d \"%s\", expected %d \"%s\"\n",
+                   escaped, i,
+                   token->type, str, expected[i].type, expected[i].str);
+          fail = TRUE;
+        }
+
+      cr_token_destroy (token);
+    }
+
+  cr_tknzr_unref (tknzr);
+}
+
+int
+main (int argc, char **argv)
+{
+  const guint classes[] = {
+    CR_ASCII_WHITE_SPACE,
+    CR_ASCII_NMCHAR,
+    CR_ASCII_COMMENT,
+    CR_ASCII_WHITE_SPACE | CR_ASCII_NMCHAR,
+  };
+  /* Identifiers, names and comments that go back and forth between
+   * runs and single characters, and an escape in the middle of an
+   * identifier
+   */
+  const char *text =
+    "#main-panel caf\xc3\xa9teria\t\n\f /* a * b ** \xc3\xa9 */"
+    "foo-bar_baz9 a\\31 b #\xc3\xa7" "9 r\xc3\xa9sum\xc3\xa9-2";
+  const ExpectedToken expected[] = {
+    { HASH_TK, "main-panel" },
+    { S_TK, NULL },
+    { IDENT_TK, "caf\xc3\xa9teria" },
+    { S_TK, NULL },
+    { COMMENT_TK, " a * b ** \xc3\xa9 */" },
+    { IDENT_TK, "foo-bar_baz9" },
+    { S_TK, NULL },
+    { IDENT_TK, "a1b" },
+    { S_TK, NULL },
+    { HASH_TK, "\xc3\xa7" "9" },
+    { S_TK, NULL },
+    { IDENT_TK, "r\xc3\xa9sum\xc3\xa9-2" },
+  };
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+    for (j = 0; j < G_N_ELEMENTS (classes); j++)
+      test_ascii_runs (texts[i], classes[j]);
+
+  test_tokens (text, expected, G_N_ELEMENTS (expected));
+
+  return fail ? 1 : 0;
+}
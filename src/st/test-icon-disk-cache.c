@@ -0,0 +1,334 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * test-icon-disk-cache.c: test program for the cache of rendered icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <glib/gstdio.h>
+
+#include "st-icon-disk-cache.h"
+
+/* Has to match st-icon-disk-cache.c */
+#define HEADER_LENGTH 32
+#define MAX_CACHE_SIZE (128 * 1024 * 1024)
+
+static gboolean fail;
+static char *cache_home;
+static char *cache_dir;
+
+static char *
+get_entry_path (const char *entry)
+{
+  return g_build_filename (cache_dir, entry, NULL);
+}
+
+static void
+write_header (guint8     *data,
+              const char *magic,
+              guint32     version,
+              guint32     width,
+              guint32     height,
+              guint32     rowstride)
+{
+  guint32 values[] = {
+    GUINT32_TO_LE (version),
+    GUINT32_TO_LE (width),
+    GUINT32_TO_LE (height),
+    GUINT32_TO_LE (rowstride),
+  };
+
+  memset (data, 0, HEADER_LENGTH);
+  memcpy (data, magic, 8);
+  memcpy (data + 8, values, sizeof (values));
+}
+
+static void
+test_round_trip (gboolean has_alpha)
+{
+  const char *entry = has_alpha ? "round-trip-rgba" : "round-trip-rgb";
+  int n_channels = has_alpha ? 4 : 3;
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  const guint8 *pixels, *cached;
+  int width, height, rowstride;
+  int x, y;
+
+  /* Odd sizes, so that the pixbuf rows are padded */
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, has_alpha, 8, 17, 13);
+  for (y = 0; y < 13; y++)
+    {
+      guint8 *p = gdk_pixbuf_get_pixels (pixbuf) + y * gdk_pixbuf_get_rowstride (pixbuf);
+
+      for (x = 0; x < 17 * n_channels; x++)
+        p[x] = (x * 31 + y * 17) % 256;
+
+      /* Some fully transparent and opaque pixels as well */
+      if (has_alpha)
+        {
+          p[3] = 0;
+          p[7] = 255;
+        }
+    }
+
+  _st_icon_disk_cache_store (entry, pixbuf);
+
+  bytes = _st_icon_disk_cache_lookup (entry, &width, &height, &rowstride);
+  if (bytes == NULL)
+    {
+      g_print ("%s: stored icon not found\n", entry);
+      fail = TRUE;
+      return;
+    }
+
+  if (width != 17 || height != 13 || rowstride < width * 4 ||
+      g_bytes_get_size (bytes) != (gsize) rowstride * height)
+    {
+      g_print ("%s: got %dx%d, rowstride %d, %" G_GSIZE_FORMAT " bytes\n",
+               entry, width, height, rowstride, g_bytes_get_size (bytes));
+      fail = TRUE;
+      return;
+    }
+
+  pixels = gdk_pixbuf_read_pixels (pixbuf);
+  cached = g_bytes_get_data (bytes, NULL);
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        const guint8 *p = pixels + y * gdk_pixbuf_get_rowstride (pixbuf) + x * n_channels;
+        const guint8 *q = cached + y * rowstride + x * 4;
+        guint a = has_alpha ? p[3] : 255;
+        guint8 expected[4];
+        int i;
+
+        for (i = 0; i < 3; i++)
+          expected[i] = (p[i] * a + 127) / 255;
+        expected[3] = a;
+
+        if (memcmp (q, expected, 4) != 0)
+          {
+            g_print ("%s: pixel %d,%d is %02x%02x%02x%02x, expected %02x%02x%02x%02x\n",
+                     entry, x, y,
+                     q[0], q[1], q[2], q[3],
+                     expected[0], expected[1], expected[2], expected[3]);
+            fail = TRUE;
+            return;
+          }
+      }
+}
+
+static void
+assert_rejected (const char   *entry,
+                 const guint8 *data,
+                 gsize         length)
+{
+  g_autofree char *path = get_entry_path (entry);
+  g_autoptr (GBytes) bytes = NULL;
+  int width, height, rowstride;
+
+  g_file_set_contents (path, (const char *) data, length, NULL);
+
+  bytes = _st_icon_disk_cache_lookup (entry, &width, &height, &rowstride);
+  if (bytes != NULL)
+    {
+      g_print ("%s: damaged entry was accepted\n", entry);
+      fail = TRUE;
+    }
+}
+
+static void
+test_damaged (void)
+{
+  guint8 data[HEADER_LENGTH + 2 * 2 * 4] = { 0, };
+  g_autofree guint8 *large_data = NULL;
+
+  /* A valid 2x2 entry, so the cases below fail for their own reasons */
+  write_header (data, "StIcon\r\n", 1, 2, 2, 8);
+  assert_rejected ("truncated-header", data, HEADER_LENGTH - 1);
+  assert_rejected ("truncated-pixels", data, sizeof (data) - 1);
+
+  write_header (data, "StIcon\n\n", 1, 2, 2, 8);
+  assert_rejected ("bad-magic", data, sizeof (data));
+
+  write_header (data, "StIcon\r\n", 2, 2, 2, 8);
+  assert_rejected ("bad-version", data, sizeof (data));
+
+  write_header (data, "StIcon\r\n", 1, 0, 2, 8);
+  assert_rejected ("empty", data, sizeof (data));
+
+  write_header (data, "StIcon\r\n", 1, 2, 2, 4);
+  assert_rejected ("short-rowstride", data, sizeof (data));
+
+  /* width * 4 overflows to 0 */
+  write_header (data, "StIcon\r\n", 1, 0x40000000, 2, 0);
+  assert_rejected ("width-overflow", data, sizeof (data));
+
+  /* rowstride * height overflows 32 bits to the actual size */
+  large_data = g_malloc0 (HEADER_LENGTH + 0x10000);
+  write_header (large_data, "StIcon\r\n", 1, 2, 0x10001, 0x10000);
+  assert_rejected ("size-overflow", large_data, HEADER_LENGTH + 0x10000);
+
+  write_header (data, "StIcon\r\n", 1, 2, 2, 0xffffffff);
+  assert_rejected ("rowstride-overflow", data, sizeof (data));
+
+  write_header (data, "StIcon\r\n", 1, 2, 0xffffffff, 8);
+  assert_rejected ("height-overflow", data, sizeof (data));
+}
+
+static void
+create_sparse_entry (const char *entry,
+                     gsize       size,
+                     time_t      last_used)
+{
+  g_autofree char *path = get_entry_path (entry);
+  struct utimbuf times = { last_used, last_used };
+  int fd;
+
+  fd = g_open (path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0 || ftruncate (fd, size) != 0)
+    {
+      g_print ("prune: can't create %s\n", entry);
+      fail = TRUE;
+    }
+
+  if (fd >= 0)
+    close (fd);
+
+  g_utime (path, &times);
+}
+
+static void
+assert_entry_exists (const char *entry,
+                     gboolean    expected)
+{
+  g_autofree char *path = get_entry_path (entry);
+
+  if (g_file_test (path, G_FILE_TEST_EXISTS) != expected)
+    {
+      g_print ("prune: %s %s\n", entry,
+               expected ? "was removed" : "wasn't removed");
+      fail = TRUE;
+    }
+}
+
+static void
+test_prune (void)
+{
+  time_t now = time (NULL);
+
+  _st_icon_disk_cache_clear ();
+
+  /* Entries that fit are kept */
+  create_sparse_entry ("prune-old", MAX_CACHE_SIZE / 4, now - 3 * 24 * 3600);
+  create_sparse_entry ("prune-older", MAX_CACHE_SIZE / 4, now - 4 * 24 * 3600);
+  _st_icon_disk_cache_prune ();
+  assert_entry_exists ("prune-older", TRUE);
+  assert_entry_exists ("prune-old", TRUE);
+
+  /* Past the size of the cache, the least recently used go first */
+  create_sparse_entry ("prune-new", MAX_CACHE_SIZE / 4, now - 2 * 24 * 3600);
+  create_sparse_entry ("prune-newest", MAX_CACHE_SIZE / 2, now - 1 * 24 * 3600);
+  _st_icon_disk_cache_prune ();
+  assert_entry_exists ("prune-older", FALSE);
+  assert_entry_exists ("prune-old", TRUE);
+  assert_entry_exists ("prune-new", TRUE);
+  assert_entry_exists ("prune-newest", TRUE);
+
+  _st_icon_disk_cache_clear ();
+}
+
+static void
+test_entry (void)
+{
+  g_autofree char *path = g_build_filename (cache_home, "icon.png", NULL);
+  g_autofree char *link_path = g_build_filename (cache_home, "link.png", NULL);
+  g_autofree char *entry = NULL;
+  g_autofree char *replaced_entry = NULL;
+  g_autofree char *linked_entry = NULL;
+  struct utimbuf times = { 1, 1 };
+
+  /* OSTree checkouts give every file the same modification time */
+  g_file_set_contents (path, "icon", -1, NULL);
+  g_utime (path, &times);
+  entry = _st_icon_disk_cache_get_entry (path, 16, 1, NULL);
+
+  g_file_set_contents (path, "icon", -1, NULL);
+  g_utime (path, &times);
+  replaced_entry = _st_icon_disk_cache_get_entry (path, 16, 1, NULL);
+
+  if (entry == NULL || g_strcmp0 (entry, replaced_entry) == 0)
+    {
+      g_print ("entry: replaced file with the same modification time got the same entry\n");
+      fail = TRUE;
+    }
+
+  /* New deployments hard link unchanged files, which changes their
+   * change time but not the file
+   */
+  if (link (path, link_path) == 0)
+    {
+      linked_entry = _st_icon_disk_cache_get_entry (path, 16, 1, NULL);
+
+      if (g_strcmp0 (replaced_entry, linked_entry) != 0)
+        {
+          g_print ("entry: hard linking the file changed its entry\n");
+          fail = TRUE;
+        }
+
+      g_unlink (link_path);
+    }
+
+  g_unlink (path);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autofree char *shell_dir = NULL;
+  g_autoptr (GError) error = NULL;
+
+  cache_home = g_dir_make_tmp ("test-icon-disk-cache-XXXXXX", &error);
+  if (cache_home == NULL)
+    {
+      g_print ("Can't create cache directory: %s\n", error->message);
+      return 1;
+    }
+
+  g_setenv ("XDG_CACHE_HOME", cache_home, TRUE);
+  shell_dir = g_build_filename (cache_home, "gnome-shell", NULL);
+  cache_dir = g_build_filename (shell_dir, "icons", NULL);
+
+  test_round_trip (FALSE);
+  test_round_trip (TRUE);
+  test_damaged ();
+  test_prune ();
+  test_entry ();
+
+  _st_icon_disk_cache_clear ();
+  g_rmdir (cache_dir);
+  g_rmdir (shell_dir);
+  g_rmdir (cache_home);
+
+  g_free (cache_dir);
+  g_free (cache_home);
+
+  return fail ? 1 : 0;
+}
@@ -0,0 +1,237 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * test-recolor.c: test program for the recoloring of symbolic icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "st-recolor.h"
+
+static gboolean fail;
+
+/* The loop color_symbolic_pixbuf() used before, which the result
+ * has to be identical to
+ */
+static void
+reference_recolor (const guchar *src_data,
+                   int           src_stride,
+                   guchar       *dst_data,
+                   int           dst_stride,
+                   int           width,
+                   int           height,
+                   const guint8  fg_pixel[3],
+                   const guint8  success_pixel[3],
+                   const guint8  warning_pixel[3],
+                   const guint8  error_pixel[3],
+                   int           alpha)
+{
+  const guchar *src_row;
+  guchar *dst_row;
+  int x, y;
+
+  for (y = 0; y < height; y++)
+    {
+      src_row = src_data + src_stride * y;
+      dst_row = dst_data + dst_stride * y;
+      for (x = 0; x < width; x++)
+        {
+          guint r, g, b, a;
+          int c1, c2, c3, c4;
+
+          a = src_row[3];
+          dst_row[3] = a * alpha / 255;
+
+          if (a == 0)
+            {
+              dst_row[0] = 0;
+              dst_row[1] = 0;
+              dst_row[2] = 0;
+            }
+          else
+            {
+              c2 = src_row[0];
+              c3 = src_row[1];
+              c4 = src_row[2];
+
+              if (c2 == 0 && c3 == 0 && c4 == 0)
+                {
+                  dst_row[0] = fg_pixel[0];
+                  dst_row[1] = fg_pixel[1];
+                  dst_row[2] = fg_pixel[2];
+                }
+              else
+                {
+                  c1 = 255 - c2 - c3 - c4;
+
+                  r = fg_pixel[0] * c1 + success_pixel[0] * c2 +  warning_pixel[0] * c3 +  error_pixel[0] * c4;
+                  g = fg_pixel[1] * c1 + success_pixel[1] * c2 +  warning_pixel[1] * c3 +  error_pixel[1] * c4;
+                  b = fg_pixel[2] * c1 + success_pixel[2] * c2 +  warning_pixel[2] * c3 +  error_pixel[2] * c4;
+
+                  dst_row[0] = r / 255;
+                  dst_row[1] = g / 255;
+                  dst_row[2] = b / 255;
+                }
+            }
+
+          src_row += 4;
+          dst_row += 4;
+        }
+    }
+}
+
+static void
+compare (const char   *name,
+         const guchar *pixels,
+         int           width,
+         int           height,
+         int           rowstride,
+         const guint8  colors[4][3],
+         guint8        alpha)
+{
+  int dst_stride = width * 4 + 4;
+  g_autofree guchar *expected = g_malloc0 (dst_stride * height);
+  g_autofree guchar *result = g_malloc0 (dst_stride * height);
+  int x, y;
+
+  reference_recolor (pixels, rowstride, expected, dst_stride, width, height,
+                     colors[0], colors[1], colors[2], colors[3], alpha);
+  _st_recolor_symbolic_pixels (pixels, rowstride, result, dst_stride,
+                               width, height,
+                               colors[0], colors[1], colors[2], colors[3],
+                               alpha);
+
+  for (y = 0; y < height; y++)
+    {
+      const guchar *e = expected + y * dst_stride;
+      const guchar *r = result + y * dst_stride;
+
+      if (memcmp (e, r, width * 4) == 0)
+        continue;
+
+      for (x = 0; memcmp (e + 4 * x, r + 4 * x, 4) == 0; x++)
+        ;
+
+      g_print ("%s: %dx%d, alpha %d: pixel %d,%d is %02x%02x%02x%02x, expected %02x%02x%02x%02x\n",
+               name, width, height, alpha, x, y,
+               r[4 * x], r[4 * x + 1], r[4 * x + 2], r[4 * x + 3],
+               e[4 * x], e[4 * x + 1], e[4 * x + 2], e[4 * x + 3]);
+      fail = TRUE;
+      return;
+    }
+}
+
+/* Every combination of the three weights in steps of 5, with varying
+ * alpha, including weights that add up to more than 255
+ */
+static void
+test_weights (const guint8 colors[4][3],
+              guint8       alpha)
+{
+  int width = 52 * 52, height = 52, rowstride = width * 4;
+  g_autofree guchar *pixels = g_malloc (rowstride * height);
+  int c2, c3, c4;
+
+  for (c2 = 0; c2 < 52; c2++)
+    for (c3 = 0; c3 < 52; c3++)
+      for (c4 = 0; c4 < 52; c4++)
+        {
+          guchar *p = pixels + c2 * rowstride + 4 * (c3 * 52 + c4);
+
+          p[0] = c2 * 5;
+          p[1] = c3 * 5;
+          p[2] = c4 * 5;
+          p[3] = (c2 * 7 + c3 * 11 + c4 * 13) % 256;
+        }
+
+  compare ("weights", pixels, width, height, rowstride, colors, alpha);
+}
+
+/* Mostly pixels of valid icons, with the odd invalid one; widths
+ * that are not a multiple of the vector width exercise the scalar
+ * tails
+ */
+static void
+test_random (GRand        *rand,
+             const guint8  colors[4][3],
+             guint8        alpha)
+{
+  const int widths[] = { 1, 3, 4, 7, 8, 15, 16, 17, 33, 96 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (widths); i++)
+    {
+      int width = widths[i], height = 13;
+      int rowstride = width * 4 + 12;
+      g_autofree guchar *pixels = g_malloc (rowstride * height);
+      int x, y;
+
+      for (y = 0; y < height; y++)
+        for (x = 0; x < width; x++)
+          {
+            guchar *p = pixels + y * rowstride + 4 * x;
+            int c2 = 0, c3 = 0, c4 = 0;
+
+            switch (g_rand_int_range (rand, 0, 8))
+              {
+              case 0:
+                c2 = g_rand_int_range (rand, 0, 256);
+                c3 = g_rand_int_range (rand, 0, 256);
+                c4 = g_rand_int_range (rand, 0, 256);
+                break;
+              case 1:
+              case 2:
+                c2 = g_rand_int_range (rand, 0, 256);
+                c3 = g_rand_int_range (rand, 0, 256 - c2);
+                c4 = g_rand_int_range (rand, 0, 256 - c2 - c3);
+                break;
+              default:
+                break;
+              }
+
+            p[0] = c2;
+            p[1] = c3;
+            p[2] = c4;
+            p[3] = g_rand_boolean (rand) ? g_rand_int_range (rand, 0, 256) : 255;
+          }
+
+      compare ("random", pixels, width, height, rowstride, colors, alpha);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  const guint8 color_sets[][4][3] = {
+    { { 0x2e, 0x34, 0x36 }, { 0x33, 0xd1, 0x7a }, { 0xf5, 0x79, 0x00 }, { 0xcc, 0x00, 0x00 } },
+    { { 0xff, 0xff, 0xff }, { 0x00, 0x00, 0x00 }, { 0xff, 0xff, 0xff }, { 0x00, 0x00, 0x00 } },
+    { { 0x00, 0x00, 0x00 }, { 0xff, 0xff, 0xff }, { 0xff, 0xff, 0xff }, { 0xff, 0xff, 0xff } },
+    { { 0xff, 0x00, 0x80 }, { 0x01, 0xfe, 0x7f }, { 0x80, 0x80, 0x80 }, { 0xff, 0xff, 0x00 } },
+  };
+  const guint8 alphas[] = { 0, 1, 128, 254, 255 };
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (color_sets); i++)
+    for (j = 0; j < G_N_ELEMENTS (alphas); j++)
+      {
+        test_weights (color_sets[i], alphas[j]);
+        test_random (rand, color_sets[i], alphas[j]);
+      }
+
+  g_rand_free (rand);
+
+  return fail ? 1 : 0;
+}
@@ -24,13 +24,17 @@
 #include "st-theme.h"
 #include "st-theme-context.h"
 #include "st-label.h"
+#include "st-bin.h"
 #include "st-button.h"
+#include "st-compiled-stylesheet.h"
 #include <math.h>
 #include <string.h>
 #include <meta-test/meta-context-test.h>
 #include <meta/meta-backend.h>
+#include <glib/gstdio.h>
 
 static ClutterActor *stage;
+static StThemeContext *theme_context;
 static StThemeNode *root;
 static StThemeNode *group1;
 static StThemeNode *text1;
@@ -38,6 +42,7 @@ static StThemeNode *text2;
 static StThemeNode *group2;
 static StThemeNode *text3;
 static StThemeNode *text4;
+static StThemeNode *text5;
 static StThemeNode *group3;
 static StThemeNode *group4;
 static StThemeNode *group5;
@@ -286,6 +291,8 @@ test_classes (void)
   /* .special-text class overrides size and style;
    * the StBin.special-text selector doesn't match */
   assert_font (text1, "text1", "sans-serif Italic 32px");
+  /* rules are found through any of the node's classes */
+  assert_font (text5, "text5", "sans-serif Italic 32px");
 }
 
 static void
@@ -526,6 +533,96 @@ test_pseudo_class (void)
   g_assert (st_widget_get_style_pseudo_class (label) == NULL);
 }
 
+static void
+on_style_changed (StWidget *widget,
+                  int      *n_changes)
+{
+  (*n_changes)++;
+}
+
+static void
+assert_restyles (const char *description,
+                 guint       start_count,
+                 guint       expected)
+{
+  guint value = st_widget_get_restyle_count () - start_count;
+
+  if (value != expected)
+    {
+      g_print ("%s: %s: expected %u restyles, got %u\n",
+               test, description, expected, value);
+      fail = TRUE;
+    }
+}
+
+static void
+test_restyle (void)
+{
+  StWidget *parent, *child;
+  int parent_changes = 0;
+  float min_width, natural_width;
+  guint count;
+
+  test = "restyle";
+
+  clutter_actor_show (stage);
+
+  parent = g_object_new (ST_TYPE_BIN, "style-class", "restyle-parent", NULL);
+  child = g_object_new (ST_TYPE_BIN, "style-class", "restyle", NULL);
+  st_bin_set_child (ST_BIN (parent), CLUTTER_ACTOR (child));
+  clutter_actor_add_child (stage, CLUTTER_ACTOR (parent));
+  g_signal_connect (parent, "style-changed",
+                    G_CALLBACK (on_style_changed), &parent_changes);
+
+  if (!clutter_actor_is_mapped (CLUTTER_ACTOR (child)))
+    {
+      g_print ("%s: widgets didn't get mapped\n", test);
+      fail = TRUE;
+      clutter_actor_destroy (CLUTTER_ACTOR (parent));
+      return;
+    }
+
+  /* Changes within a frame are applied together */
+  count = st_widget_get_restyle_count ();
+  st_widget_add_style_class_name (child, "restyle-a");
+  st_widget_add_style_pseudo_class (child, "hover");
+  st_widget_remove_style_class_name (child, "restyle-a");
+  st_widget_add_style_class_name (child, "restyle-b");
+  st_widget_ensure_style (child);
+  assert_restyles ("several changes", count, 1);
+
+  /* The parent's pending change is applied before the child's */
+  count = st_widget_get_restyle_count ();
+  st_widget_add_style_pseudo_class (parent, "checked");
+  st_widget_add_style_class_name (child, "restyle-a");
+  st_widget_ensure_style (child);
+  assert_restyles ("parent and child", count, 2);
+  if (parent_changes != 1)
+    {
+      g_print ("%s: parent wasn't restyled with the child\n", test);
+      fail = TRUE;
+    }
+  assert_foreground_color (st_widget_get_theme_node (child), "child", "#00ff00ff");
+
+  count = st_widget_get_restyle_count ();
+  st_widget_ensure_style (parent);
+  assert_restyles ("restyled parent", count, 0);
+
+  /* Size requests right after a change see the new margins */
+  clutter_actor_get_preferred_width (CLUTTER_ACTOR (child), -1,
+                                     &min_width, &natural_width);
+  assert_length ("child", "preferred-width", 0., natural_width);
+
+  st_widget_add_style_class_name (child, "restyle-wide");
+  clutter_actor_get_preferred_width (CLUTTER_ACTOR (child), -1,
+                                     &min_width, &natural_width);
+  assert_length ("child", "preferred-width", 16., natural_width);
+  assert_length ("child", "margin-left", 7.,
+                 clutter_actor_get_margin_left (CLUTTER_ACTOR (child)));
+
+  clutter_actor_destroy (CLUTTER_ACTOR (parent));
+}
+
 static void
 test_inline_style (void)
 {
@@ -536,6 +633,282 @@ test_inline_style (void)
                  st_theme_node_get_padding (text3, ST_SIDE_BOTTOM));
 }
 
+enum {
+  NODE_GROUP1,
+  NODE_TEXT1,
+  NODE_TEXT2,
+  NODE_TEXT5,
+  NODE_GROUP2,
+  NODE_TEXT3,
+  NODE_TEXT4,
+  NODE_GROUP3,
+  NODE_BUTTON,
+  N_NODES
+};
+
+static const char * const node_names[N_NODES] = {
+  "group1", "text1", "text2", "text5", "group2",
+  "text3", "text4", "group3", "button",
+};
+
+/* The same nodes as in main(), but styled by @theme */
+static void
+create_nodes (StTheme     *theme,
+              StThemeNode *nodes[N_NODES])
+{
+  nodes[NODE_GROUP1] = st_theme_node_new (theme_context, NULL, theme,
+                                          CLUTTER_TYPE_ACTOR, "group1", NULL, NULL, NULL);
+  nodes[NODE_TEXT1] = st_theme_node_new (theme_context, nodes[NODE_GROUP1], NULL,
+                                         CLUTTER_TYPE_TEXT, "text1", "special-text", NULL, NULL);
+  nodes[NODE_TEXT2] = st_theme_node_new (theme_context, nodes[NODE_GROUP1], NULL,
+                                         CLUTTER_TYPE_TEXT, "text2", NULL, NULL, NULL);
+  nodes[NODE_TEXT5] = st_theme_node_new (theme_context, nodes[NODE_GROUP1], NULL,
+                                         CLUTTER_TYPE_TEXT, "text5", "unrelated special-text", NULL, NULL);
+  nodes[NODE_GROUP2] = st_theme_node_new (theme_context, NULL, theme,
+                                          CLUTTER_TYPE_ACTOR, "group2", NULL, NULL, NULL);
+  nodes[NODE_TEXT3] = st_theme_node_new (theme_context, nodes[NODE_GROUP2], NULL,
+                                         CLUTTER_TYPE_TEXT, "text3", NULL, NULL,
+                                         "color: #0000ff; padding-bottom: 12px;");
+  nodes[NODE_TEXT4] = st_theme_node_new (theme_context, nodes[NODE_GROUP2], NULL,
+                                         CLUTTER_TYPE_TEXT, "text4", NULL, "visited hover", NULL);
+  nodes[NODE_GROUP3] = st_theme_node_new (theme_context, nodes[NODE_GROUP2], NULL,
+                                          CLUTTER_TYPE_ACTOR, "group3", NULL, "hover", NULL);
+  nodes[NODE_BUTTON] = st_theme_node_new (theme_context, NULL, theme,
+                                          ST_TYPE_BUTTON, "button", NULL, NULL, NULL);
+}
+
+static void
+free_nodes (StThemeNode *nodes[N_NODES])
+{
+  int i;
+
+  for (i = 0; i < N_NODES; i++)
+    g_object_unref (nodes[i]);
+}
+
+/* The computed values of all properties test-theme.css sets */
+static char *
+describe_node (StThemeNode *node)
+{
+  GString *result = g_string_new (NULL);
+  g_autofree char *font = NULL;
+  g_autofree char *font_features = NULL;
+  g_autofree char *foreground = NULL;
+  g_autofree char *background = NULL;
+  GFile *background_image;
+  CoglColor color;
+  int i;
+
+  font = pango_font_description_to_string (st_theme_node_get_font (node));
+  font_features = st_theme_node_get_font_features (node);
+  st_theme_node_get_foreground_color (node, &color);
+  foreground = cogl_color_to_string (&color);
+  st_theme_node_get_background_color (node, &color);
+  background = cogl_color_to_string (&color);
+  background_image = st_theme_node_get_background_image (node);
+
+  g_string_append_printf (result, "font: %s; font-features: %s; color: %s; "
+                          "background-color: %s; text-decoration: %d;",
+                          font, font_features ? font_features : "none",
+                          foreground, background,
+                          st_theme_node_get_text_decoration (node));
+
+  if (background_image != NULL)
+    {
+      g_autofree char *uri = g_file_get_uri (background_image);
+
+      g_string_append_printf (result, " background-image: %s;", uri);
+    }
+
+  for (i = ST_SIDE_TOP; i <= ST_SIDE_LEFT; i++)
+    {
+      g_autofree char *border_color = NULL;
+
+      st_theme_node_get_border_color (node, i, &color);
+      border_color = cogl_color_to_string (&color);
+
+      g_string_append_printf (result,
+                              " %s: padding %g, margin %g, border %g %s;",
+                              side_to_string (i),
+                              st_theme_node_get_padding (node, i),
+                              st_theme_node_get_margin (node, i),
+                              st_theme_node_get_border_width (node, i),
+                              border_color);
+    }
+
+  for (i = ST_CORNER_TOPLEFT; i <= ST_CORNER_BOTTOMLEFT; i++)
+    g_string_append_printf (result, " radius %d: %g;", i,
+                            st_theme_node_get_border_radius (node, i));
+
+  return g_string_free_and_steal (result);
+}
+
+static void
+assert_same_styles (StTheme    *expected_theme,
+                    StTheme    *theme,
+                    const char *description)
+{
+  StThemeNode *expected_nodes[N_NODES];
+  StThemeNode *nodes[N_NODES];
+  int i;
+
+  create_nodes (expected_theme, expected_nodes);
+  create_nodes (theme, nodes);
+
+  for (i = 0; i < N_NODES; i++)
+    {
+      g_autofree char *expected = describe_node (expected_nodes[i]);
+      g_autofree char *value = describe_node (nodes[i]);
+
+      if (strcmp (expected, value) != 0)
+        {
+          g_print ("%s: %s, %s:\n  expected: %s\n  got: %s\n",
+                   test, description, node_names[i], expected, value);
+          fail = TRUE;
+        }
+    }
+
+  free_nodes (expected_nodes);
+  free_nodes (nodes);
+}
+
+static GBytes *
+compile_stylesheet (const char *contents,
+                    gsize       length)
+{
+  g_autoptr (GError) error = NULL;
+  CRStyleSheet *stylesheet = NULL;
+  GBytes *compiled;
+
+  if (cr_om_parser_simply_parse_buf ((const guchar *) contents, length,
+                                     &stylesheet) != CR_OK)
+    g_error ("Failed to parse test-theme.css");
+
+  compiled = _st_compiled_stylesheet_compile (stylesheet, contents, length, &error);
+  if (compiled == NULL)
+    g_error ("Failed to compile test-theme.css: %s", error->message);
+
+  cr_stylesheet_unref (stylesheet);
+
+  return compiled;
+}
+
+static void
+write_file (const char   *path,
+            const guint8 *data,
+            gsize         length)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (!g_file_set_contents (path, (const char *) data, length, &error))
+    g_error ("Failed to write %s: %s", path, error->message);
+}
+
+/* Loads test-theme.css from @dir, next to what is in its compiled file,
+ * and checks that it is styled like @parsed_theme
+ */
+static void
+test_compiled_file (StTheme      *parsed_theme,
+                    const char   *dir,
+                    const char   *description,
+                    const char   *contents,
+                    gsize         length,
+                    const guint8 *compiled,
+                    gsize         compiled_length,
+                    gboolean      expect_valid)
+{
+  g_autofree char *path = g_build_filename (dir, "test-theme.css", NULL);
+  g_autofree char *compiled_path = g_strconcat (path, ST_COMPILED_STYLESHEET_SUFFIX, NULL);
+  g_autoptr (GFile) file = g_file_new_for_path (path);
+  g_autoptr (GError) error = NULL;
+  g_autoptr (StTheme) theme = NULL;
+  CRStyleSheet *stylesheet;
+
+  write_file (compiled_path, compiled, compiled_length);
+
+  stylesheet = _st_compiled_stylesheet_load (file, contents, length, &error);
+  if (expect_valid && stylesheet == NULL)
+    {
+      g_print ("%s: %s: not loaded: %s\n", test, description, error->message);
+      fail = TRUE;
+    }
+  else if (!expect_valid && stylesheet != NULL)
+    {
+      g_print ("%s: %s: loaded, expected to fall back to parsing\n",
+               test, description);
+      fail = TRUE;
+    }
+  g_clear_pointer (&stylesheet, cr_stylesheet_unref);
+
+  theme = st_theme_new (file, NULL, NULL);
+  assert_same_styles (parsed_theme, theme, description);
+
+  g_unlink (compiled_path);
+}
+
+static void
+test_compiled_stylesheet (void)
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *dir = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *contents = NULL;
+  g_autofree char *stale_contents = NULL;
+  g_autofree guint8 *corrupt = NULL;
+  g_autoptr (GFile) file = NULL;
+  g_autoptr (GBytes) compiled = NULL;
+  g_autoptr (GBytes) stale = NULL;
+  g_autoptr (StTheme) parsed_theme = NULL;
+  const guint8 *data;
+  gsize length, compiled_length;
+
+  test = "compiled_stylesheet";
+
+  if (!g_file_get_contents ("test-theme.css", &contents, &length, &error))
+    g_error ("Failed to read test-theme.css: %s", error->message);
+
+  /* A copy, so that the compiled files can be put next to it, and
+   * relative URLs resolve the same way for all themes
+   */
+  dir = g_dir_make_tmp ("test-theme-XXXXXX", &error);
+  if (dir == NULL)
+    g_error ("Failed to create temporary directory: %s", error->message);
+
+  path = g_build_filename (dir, "test-theme.css", NULL);
+  file = g_file_new_for_path (path);
+  write_file (path, (const guint8 *) contents, length);
+
+  parsed_theme = st_theme_new (file, NULL, NULL);
+
+  compiled = compile_stylesheet (contents, length);
+  data = g_bytes_get_data (compiled, &compiled_length);
+
+  test_compiled_file (parsed_theme, dir, "compiled",
+                      contents, length, data, compiled_length, TRUE);
+
+  /* Compiled from an older version of the stylesheet */
+  stale_contents = g_strconcat (contents, "#group1 { color: #123456; }\n", NULL);
+  stale = compile_stylesheet (stale_contents, strlen (stale_contents));
+  test_compiled_file (parsed_theme, dir, "stale",
+                      contents, length,
+                      g_bytes_get_data (stale, NULL), g_bytes_get_size (stale),
+                      FALSE);
+
+  test_compiled_file (parsed_theme, dir, "truncated",
+                      contents, length, data, compiled_length / 2, FALSE);
+  test_compiled_file (parsed_theme, dir, "truncated header",
+                      contents, length, data, 16, FALSE);
+
+  /* A flipped bit in the statements, which would still be readable */
+  corrupt = g_memdup2 (data, compiled_length);
+  corrupt[compiled_length - 12] ^= 0x01;
+  test_compiled_file (parsed_theme, dir, "corrupted",
+                      contents, length, corrupt, compiled_length, FALSE);
+
+  g_unlink (path);
+  g_rmdir (dir);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -543,7 +916,6 @@ main (int argc, char **argv)
   g_autoptr (GError) error = NULL;
   MetaBackend *backend;
   StTheme *theme;
-  StThemeContext *theme_context;
   ClutterContext *clutter_context;
   PangoFontDescription *font_desc;
   GFile *file;
@@ -588,6 +960,8 @@ main (int argc, char **argv)
                               CLUTTER_TYPE_TEXT, "text1", "special-text", NULL, NULL);
   text2 = st_theme_node_new  (theme_context, group1, NULL,
                               CLUTTER_TYPE_TEXT, "text2", NULL, NULL, NULL);
+  text5 = st_theme_node_new  (theme_context, group1, NULL,
+                              CLUTTER_TYPE_TEXT, "text5", "unrelated special-text", NULL, NULL);
   group2 = st_theme_node_new (theme_context, root, NULL,
                               CLUTTER_TYPE_ACTOR, "group2", NULL, NULL, NULL);
   group4 = st_theme_node_new (theme_context, root, NULL,
@@ -618,7 +992,9 @@ main (int argc, char **argv)
   test_font ();
   test_font_features ();
   test_pseudo_class ();
+  test_restyle ();
   test_inline_style ();
+  test_compiled_stylesheet ();
 
   g_object_unref (button);
   g_object_unref (group1);
@@ -631,6 +1007,7 @@ main (int argc, char **argv)
   g_object_unref (text2);
   g_object_unref (text3);
   g_object_unref (text4);
+  g_object_unref (text5);
   g_object_unref (theme);
 
   g_object_unref (context);